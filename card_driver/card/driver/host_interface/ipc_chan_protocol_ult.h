@@ -18,6 +18,7 @@
 enum ult2Opcodes {
 	NNP_IPC_ULT2_OP_CARD_HWQ_MSG = 0,
 	NNP_IPC_ULT2_OP_DMA_PING = 1,
+	NNP_IPC_ULT2_OP_HOSTRES_PGT = 2,
 	NNP_IPC_ULT2_NUM_OPCODES
 };
 NNP_STATIC_ASSERT(NNP_IPC_ULT2_NUM_OPCODES <= 16, "Opcode ID overflow for ULT2 opcodes");
@@ -52,6 +53,24 @@ union ULT2DmaPingMsg {
 };
 CHECK_MESSAGE_SIZE(union ULT2HwQMsg, 1);
 
+/*
+ * Host resource page table cache test, the host sends the address of a
+ * resource page list and the card replies with the same message where
+ * result is 0 on success or the number of the failed step.
+ */
+union ULT2HostresPgtMsg {
+	struct {
+		__le64 opcode       :  6;
+		__le64 channelID    : NNP_IPC_CHANNEL_BITS;
+		__le64 ultOpcode    :  4;
+		__le64 hostPfn      : 40;
+		__le64 result       :  4;
+	};
+
+	__le64 value;
+};
+CHECK_MESSAGE_SIZE(union ULT2HostresPgtMsg, 1);
+
 #pragma pack(pop)
 
 #endif
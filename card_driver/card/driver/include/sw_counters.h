@@ -13,6 +13,7 @@
 
 #include <linux/types.h>
 #include <linux/spinlock.h>
+#include <linux/percpu.h>
 
 struct kobject;
 
@@ -38,6 +39,8 @@ struct nnp_sw_counters_set {
 	const u32				counters_count;
 	const struct nnp_sw_counters_group_info *groups_info;
 	const u32				groups_count;
+	/* counters are updated in per-CPU shards and folded to values */
+	const bool				perCPU;
 };
 
 /* struct to describe counter values and enabled groups */
@@ -46,8 +49,15 @@ struct nnp_sw_counters {
 	u32        *groups;
 	const u32  *global_groups;
 	spinlock_t *spinlocks;
+	u64 __percpu *pcpu_values; /* NULL unless counters set is perCPU */
+	int          pcpu_fold_state;
 };
 
+/* pcpu_fold_state, the fold work stops while no per-CPU counter changes */
+#define NNP_SW_COUNTERS_FOLD_IDLE	0
+#define NNP_SW_COUNTERS_FOLD_ACTIVE	1
+#define NNP_SW_COUNTERS_FOLD_DEAD	2
+
 /* create sw counters_set_node */
 int nnp_create_sw_counters_info_node(struct kobject *kobj,
 				     const struct nnp_sw_counters_set	*counters_set,
@@ -66,6 +76,33 @@ int nnp_create_sw_counters_values_node(void *hInfoNode,
 /* create values object, also need to attach to corrent info node that matches values creation */
 int nnp_remove_sw_counters_values_node(struct nnp_sw_counters *counters);
 
+/* per-CPU counters helpers, used by the macros below */
+u64 nnp_sw_counter_fold(struct nnp_sw_counters *counters, u32 index);
+void nnp_sw_counter_percpu_set(struct nnp_sw_counters *counters, u32 index, u64 val);
+void nnp_sw_counter_fold_kick(struct nnp_sw_counters *counters);
+
+/* restart the fold work on the first update after it went idle */
+#define NNP_SW_COUNTER_PCPU_KICK(_obj)                                  \
+	do {                                                            \
+		if (unlikely(READ_ONCE((_obj)->pcpu_fold_state) ==      \
+			     NNP_SW_COUNTERS_FOLD_IDLE))                \
+			nnp_sw_counter_fold_kick(_obj);                 \
+	} while (0)
+
+/*
+ * In per-CPU mode writers only touch their local shard,
+ * this_cpu_add is irq-safe so the atomic variants need no lock.
+ */
+#define NNP_SW_COUNTER_PCPU_ADD(_obj, _index, _val)                     \
+	do {                                                            \
+		if ((_obj)->pcpu_values) {                              \
+			this_cpu_add((_obj)->pcpu_values[(_index)],     \
+				     (u64)(_val));                      \
+			NNP_SW_COUNTER_PCPU_KICK(_obj);                 \
+		} else                                                  \
+			((_obj)->values[(_index)] += (_val));           \
+	} while (0)
+
 /* MACROS FOR SW COUNTER - g_nnp_sw_counters */
 
 #define NNP_SW_GROUP_IS_ENABLE(_obj, _index)    \
@@ -76,26 +113,37 @@ int nnp_remove_sw_counters_values_node(struct nnp_sw_counters *counters);
 	((_val) ? ++((_obj)->groups[(_index)]) :                           \
 	 (((_obj)->groups[(_index)]) ? --((_obj)->groups[(_index)]) : 0))
 
-#define SPH_SW_COUNTER_SET(_obj, _index, _val) \
-	((_obj)->values[(_index)] = (_val))
+#define SPH_SW_COUNTER_SET(_obj, _index, _val)                            \
+	do {                                                              \
+		if ((_obj)->pcpu_values)                                  \
+			nnp_sw_counter_percpu_set((_obj), (_index), (_val)); \
+		else                                                      \
+			((_obj)->values[(_index)] = (_val));              \
+	} while (0)
 
-#define SPH_SW_COUNTER_GET(_obj, _index) \
-	((_obj)->values[(_index)])
+#define SPH_SW_COUNTER_GET(_obj, _index)                        \
+	((_obj)->pcpu_values ? nnp_sw_counter_fold((_obj), (_index)) : \
+			       (_obj)->values[(_index)])
 
 #define NNP_SW_COUNTER_INC(_obj, _index) \
-	(_obj->values[_index]++)
+	NNP_SW_COUNTER_PCPU_ADD(_obj, _index, 1)
 
 #define SPH_SW_COUNTER_DEC(_obj, _index) \
-	((_obj)->values[(_index)]--)
+	NNP_SW_COUNTER_PCPU_ADD(_obj, _index, -1)
 
 #define NNP_SW_COUNTER_ADD(_obj, _index, _val) \
-	((_obj)->values[(_index)] += (_val))
+	NNP_SW_COUNTER_PCPU_ADD(_obj, _index, _val)
 
 #define SPH_SW_COUNTER_DEC_VAL(_obj, _index, _val) \
-	((_obj)->values[(_index)] -= (_val))
+	NNP_SW_COUNTER_PCPU_ADD(_obj, _index, -(u64)(_val))
 
 #define SPH_SW_COUNTER_ATOMIC_INC(_obj, _index)            \
 	do {                                               \
+		if ((_obj)->pcpu_values) {                 \
+			this_cpu_inc((_obj)->pcpu_values[(_index)]); \
+			NNP_SW_COUNTER_PCPU_KICK(_obj);              \
+			break;                             \
+		}                                          \
 		spin_lock(&((_obj)->spinlocks[(_index)]));   \
 		((_obj)->values[(_index)]++);                  \
 		spin_unlock(&((_obj)->spinlocks[(_index)])); \
@@ -103,6 +151,11 @@ int nnp_remove_sw_counters_values_node(struct nnp_sw_counters *counters);
 
 #define SPH_SW_COUNTER_ATOMIC_DEC(_obj, _index)            \
 	do {                                               \
+		if ((_obj)->pcpu_values) {                 \
+			this_cpu_dec((_obj)->pcpu_values[(_index)]); \
+			NNP_SW_COUNTER_PCPU_KICK(_obj);              \
+			break;                             \
+		}                                          \
 		spin_lock(&((_obj)->spinlocks[(_index)]));   \
 		((_obj)->values[(_index)]--);                  \
 		spin_unlock(&((_obj)->spinlocks[(_index)])); \
@@ -110,6 +163,11 @@ int nnp_remove_sw_counters_values_node(struct nnp_sw_counters *counters);
 
 #define NNP_SW_COUNTER_ATOMIC_ADD(_obj, _index, _val)        \
 	do {                                                 \
+		if ((_obj)->pcpu_values) {                   \
+			this_cpu_add((_obj)->pcpu_values[(_index)], (u64)(_val)); \
+			NNP_SW_COUNTER_PCPU_KICK(_obj);                           \
+			break;                               \
+		}                                            \
 		spin_lock(&((_obj)->spinlocks[(_index)]));     \
 		((_obj)->values[(_index)] += (_val));            \
 		spin_unlock(&((_obj)->spinlocks[(_index)]));   \
@@ -117,6 +175,11 @@ int nnp_remove_sw_counters_values_node(struct nnp_sw_counters *counters);
 
 #define NNP_SW_COUNTER_ATOMIC_DEC_VAL(_obj, _index, _val)         \
 	do {                                                      \
+		if ((_obj)->pcpu_values) {                        \
+			this_cpu_sub((_obj)->pcpu_values[(_index)], (u64)(_val)); \
+			NNP_SW_COUNTER_PCPU_KICK(_obj);                           \
+			break;                                    \
+		}                                                 \
 		spin_lock(&((_obj)->spinlocks[(_index)]));          \
 		((_obj)->values[(_index)] -= (_val));                 \
 		spin_unlock(&((_obj)->spinlocks[(_index)]));        \
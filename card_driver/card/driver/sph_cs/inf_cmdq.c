@@ -7,13 +7,104 @@
 #include "inf_cmdq.h"
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/vmalloc.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "nnp_debug.h"
+#include "nnp_time.h"
+
+/* max args size of each size class */
+static const uint32_t s_size_class_args[INF_CMD_NUM_SIZE_CLASSES] = {
+	64, 256, 1024
+};
+static struct kmem_cache *s_cmd_caches[INF_CMD_NUM_SIZE_CLASSES];
+
+int inf_cmd_queue_caches_init(void)
+{
+	char name[24];
+	int i;
+
+	for (i = 0; i < INF_CMD_NUM_SIZE_CLASSES; i++) {
+		snprintf(name, sizeof(name), "sph_infcmd%u", s_size_class_args[i]);
+		s_cmd_caches[i] = kmem_cache_create(name,
+						    sizeof(struct inf_command) + s_size_class_args[i] - 1,
+						    0, 0, NULL);
+		if (unlikely(s_cmd_caches[i] == NULL)) {
+			sph_log_err(START_UP_LOG, "failed to create %s slab cache\n", name);
+			inf_cmd_queue_caches_fini();
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+void inf_cmd_queue_caches_fini(void)
+{
+	int i;
+
+	for (i = 0; i < INF_CMD_NUM_SIZE_CLASSES; i++) {
+		kmem_cache_destroy(s_cmd_caches[i]);
+		s_cmd_caches[i] = NULL;
+	}
+}
+
+static struct inf_command *cmd_alloc(uint32_t extra_size)
+{
+	struct inf_command *cmd;
+	int i;
+
+	for (i = 0; i < INF_CMD_NUM_SIZE_CLASSES; i++)
+		if (extra_size < s_size_class_args[i])
+			break;
+
+	if (i < INF_CMD_NUM_SIZE_CLASSES) {
+		cmd = kmem_cache_alloc(s_cmd_caches[i], GFP_NOWAIT);
+		if (unlikely(cmd == NULL))
+			return NULL;
+		memset(cmd, 0, sizeof(*cmd));
+	} else {
+		cmd = kzalloc(sizeof(struct inf_command) + extra_size, GFP_NOWAIT);
+		if (unlikely(cmd == NULL))
+			return NULL;
+		i = INF_CMD_SIZE_CLASS_KMALLOC;
+	}
+	cmd->size_class = i;
+
+	return cmd;
+}
+
+static void cmd_free(struct inf_command *cmd)
+{
+	if (cmd->size_class == INF_CMD_SIZE_CLASS_KMALLOC)
+		kfree(cmd);
+	else
+		kmem_cache_free(s_cmd_caches[cmd->size_class], cmd);
+}
+
+/* called with lock_irq held */
+static void cmd_unlink(struct inf_cmd_queue *cmdq, struct inf_command *cmd)
+{
+	list_del(&cmd->node);
+	list_del(&cmd->op_node);
+	cmdq->depth--;
+}
 
 void inf_cmd_queue_init(struct inf_cmd_queue *cmdq)
 {
+	int i;
+
 	spin_lock_init(&cmdq->lock_irq);
 	INIT_LIST_HEAD(&cmdq->pending_commands);
+	for (i = 0; i < INF_CMD_QUEUE_OPCODE_LISTS; i++)
+		INIT_LIST_HEAD(&cmdq->opcode_commands[i]);
+	cmdq->depth = 0;
+	cmdq->max_depth = 0;
+	cmdq->bulk_read = false;
 	init_waitqueue_head(&cmdq->waitq);
+	mutex_init(&cmdq->ring_cpl_lock);
+	cmdq->ring = NULL;
 }
 
 void inf_cmd_queue_fini(struct inf_cmd_queue *cmdq)
@@ -27,12 +118,74 @@ void inf_cmd_queue_fini(struct inf_cmd_queue *cmdq)
 		cmd = list_first_entry(&cmdq->pending_commands,
 				       struct inf_command,
 				       node);
-		list_del(&cmd->node);
+		cmd_unlink(cmdq, cmd);
 		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
-		kfree(cmd);
+		cmd_free(cmd);
 		NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
 	}
 	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+
+	if (cmdq->ring != NULL) {
+		vfree(cmdq->ring);
+		cmdq->ring = NULL;
+	}
+}
+
+static inline bool ring_cmd_empty(struct inf_cmd_queue *cmdq)
+{
+	return cmdq->ring == NULL ||
+	       READ_ONCE(cmdq->ring->cmd_cons) == cmdq->ring_cmd_prod;
+}
+
+/*
+ * Copies the command into the cmd ring, called with lock_irq held.
+ * Returns false if the command does not fit, the ring
+ * cmd_cons is written by the runtime and is not trusted.
+ */
+static bool ring_cmd_push(struct inf_cmd_queue *cmdq,
+			  uint32_t              opcode,
+			  void                 *cmd_args,
+			  uint32_t              args_size,
+			  bool                 *was_empty)
+{
+	u8 *base = (u8 *)cmdq->ring + INF_RING_CMD_OFFSET;
+	struct inf_cmd_header *hdr;
+	uint32_t prod = cmdq->ring_cmd_prod;
+	uint32_t cons = READ_ONCE(cmdq->ring->cmd_cons);
+	uint32_t used = prod - cons;
+	uint32_t pos = prod % INF_RING_CMD_SIZE;
+	uint32_t len = ALIGN(sizeof(*hdr) + args_size, INF_RING_ALIGN);
+	uint32_t pad = 0;
+
+	if (pos + len > INF_RING_CMD_SIZE)
+		pad = INF_RING_CMD_SIZE - pos;
+
+	if (used > INF_RING_CMD_SIZE ||
+	    len + pad > INF_RING_CMD_SIZE - used)
+		return false;
+
+	if (pad > 0) {
+		hdr = (struct inf_cmd_header *)(base + pos);
+		hdr->opcode = INF_RING_OPCODE_PAD;
+		hdr->size = pad - sizeof(*hdr);
+		pos = 0;
+	}
+
+	hdr = (struct inf_cmd_header *)(base + pos);
+	hdr->opcode = opcode;
+	hdr->size = args_size;
+	if (args_size > 0)
+		memcpy(hdr + 1, cmd_args, args_size);
+
+	cmdq->ring_cmd_prod = prod + pad + len;
+	/* publish the entry before the producer index */
+	smp_store_release(&cmdq->ring->cmd_prod, cmdq->ring_cmd_prod);
+
+	/* pairs with the runtime storing cmd_cons before it goes to poll */
+	smp_mb();
+	*was_empty = (READ_ONCE(cmdq->ring->cmd_cons) == prod);
+
+	return true;
 }
 
 int inf_cmd_queue_add(struct inf_cmd_queue *cmdq,
@@ -48,9 +201,27 @@ int inf_cmd_queue_add(struct inf_cmd_queue *cmdq,
 	struct inf_command *cmd;
 	unsigned long flags;
 	uint32_t extra_size = read_payload == NULL && args_size > 0 ? args_size-1 : 0;
+	bool wake = true;
+
+	/*
+	 * Commands are pushed to the cmd ring only while no command waits in
+	 * the list, so that all ring entries precede the list entries.
+	 * The runtime is woken up only when the ring was empty, otherwise it
+	 * is still draining it.
+	 */
+	if (cmdq->ring != NULL && read_payload == NULL) {
+		NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+		if (list_empty(&cmdq->pending_commands) &&
+		    ring_cmd_push(cmdq, opcode, cmd_args, args_size, &wake)) {
+			NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+			if (wake)
+				wake_up_all(&cmdq->waitq);
+			return 0;
+		}
+		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+	}
 
-	cmd = kzalloc(sizeof(struct inf_command)+extra_size,
-		      GFP_NOWAIT);
+	cmd = cmd_alloc(extra_size);
 	if (unlikely(cmd == NULL))
 		return -ENOMEM;
 
@@ -60,9 +231,14 @@ int inf_cmd_queue_add(struct inf_cmd_queue *cmdq,
 	cmd->read_payload_ctx = read_payload_ctx;
 	if (read_payload == NULL && args_size > 0)
 		memcpy(&cmd->cmd_args[0], cmd_args, args_size);
+	cmd->enqueue_time = nnp_time_us();
 
 	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
 	list_add_tail(&cmd->node, &cmdq->pending_commands);
+	list_add_tail(&cmd->op_node,
+		      &cmdq->opcode_commands[opcode % INF_CMD_QUEUE_OPCODE_LISTS]);
+	if (++cmdq->depth > cmdq->max_depth)
+		cmdq->max_depth = cmdq->depth;
 	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
 
 	wake_up_all(&cmdq->waitq);
@@ -75,17 +251,19 @@ void inf_cmd_queue_exe(struct inf_cmd_queue *cmdq,
 		      void (*exe_cmd)(void *cmd_args))
 {
 	unsigned long flags;
-	struct inf_command *cmd = list_first_entry(&cmdq->pending_commands, struct inf_command, node);
+	struct list_head *head = &cmdq->opcode_commands[opcode % INF_CMD_QUEUE_OPCODE_LISTS];
+	struct inf_command *cmd;
 
 	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
-	while (&cmd->node != &cmdq->pending_commands) {
+	cmd = list_first_entry(head, struct inf_command, op_node);
+	while (&cmd->op_node != head) {
 		if (cmd->header.opcode == opcode) {
 			NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
 			exe_cmd(cmd->cmd_args);
 			NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
 		}
 
-		cmd = list_next_entry(cmd, node);
+		cmd = list_next_entry(cmd, op_node);
 	}
 	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
 }
@@ -110,13 +288,87 @@ unsigned int inf_cmd_queue_poll(struct inf_cmd_queue *cmdq,
 
 	poll_wait(f, &cmdq->waitq, pt);
 	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
-	if (!list_empty(&cmdq->pending_commands) || cmdq->hangup)
+	if (!list_empty(&cmdq->pending_commands) || cmdq->hangup ||
+	    !ring_cmd_empty(cmdq))
 		mask |= (POLLIN | POLLRDNORM);
 	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
 
 	return mask;
 }
 
+void inf_cmd_queue_set_bulk_read(struct inf_cmd_queue *cmdq, bool enable)
+{
+	unsigned long flags;
+
+	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+	cmdq->bulk_read = enable;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+}
+
+void inf_cmd_queue_get_stats(struct inf_cmd_queue *cmdq,
+			     uint32_t             *depth,
+			     u64                  *oldest_age_us)
+{
+	struct inf_command *cmd;
+	unsigned long flags;
+	u64 now = nnp_time_us();
+
+	*oldest_age_us = 0;
+
+	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+	*depth = cmdq->depth;
+	if (!list_empty(&cmdq->pending_commands)) {
+		cmd = list_first_entry(&cmdq->pending_commands, struct inf_command, node);
+		if (now > cmd->enqueue_time)
+			*oldest_age_us = now - cmd->enqueue_time;
+	}
+	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+}
+
+/* copies whole commands which follow a completed one, see bulk_read */
+static ssize_t cmd_queue_read_bulk(struct inf_cmd_queue *cmdq,
+				   char __user          *buf,
+				   size_t                size)
+{
+	ssize_t was_read = 0;
+	struct inf_command *cmd;
+	unsigned long flags;
+	size_t len;
+
+	while (size >= sizeof(cmd->header)) {
+		NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+		if (list_empty(&cmdq->pending_commands)) {
+			NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+			break;
+		}
+		cmd = list_first_entry(&cmdq->pending_commands, struct inf_command, node);
+		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+
+		len = sizeof(cmd->header) + cmd->header.size;
+		if (cmd->read_payload != NULL || len > size)
+			break;
+
+		if (unlikely(copy_to_user(buf, &cmd->header, sizeof(cmd->header)) != 0))
+			break;
+		if (cmd->header.size > 0 &&
+		    unlikely(copy_to_user(buf + sizeof(cmd->header),
+					  &cmd->cmd_args[0],
+					  cmd->header.size) != 0))
+			break;
+
+		NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+		cmd_unlink(cmdq, cmd);
+		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+		cmd_free(cmd);
+
+		buf += len;
+		size -= len;
+		was_read += len;
+	}
+
+	return was_read;
+}
+
 ssize_t inf_cmd_queue_read(struct inf_cmd_queue *cmdq,
 			   char __user          *buf,
 			   size_t                size,
@@ -128,13 +380,18 @@ ssize_t inf_cmd_queue_read(struct inf_cmd_queue *cmdq,
 	unsigned long flags;
 
 	err = wait_event_interruptible(cmdq->waitq,
-				       !list_empty(&cmdq->pending_commands) || cmdq->hangup);
+				       !list_empty(&cmdq->pending_commands) || cmdq->hangup ||
+				       !ring_cmd_empty(cmdq));
 	if (unlikely(err < 0))
 		return err;
 
 	if (cmdq->hangup)
 		return -1;
 
+	/* ring entries are older than the list entries */
+	if (!ring_cmd_empty(cmdq))
+		return -EAGAIN;
+
 	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
 	cmd = list_first_entry(&cmdq->pending_commands, struct inf_command, node);
 	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
@@ -168,14 +425,327 @@ ssize_t inf_cmd_queue_read(struct inf_cmd_queue *cmdq,
 
 	cmd->offset += n_to_read;
 	was_read += n_to_read;
+	buf += n_to_read;
+	size -= n_to_read;
 
 done:
 	if (cmd->offset >= cmd->header.size) {
 		NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
-		list_del(&cmd->node);
+		cmd_unlink(cmdq, cmd);
 		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
-		kfree(cmd);
+		cmd_free(cmd);
+
+		if (cmdq->bulk_read)
+			was_read += cmd_queue_read_bulk(cmdq, buf, size);
 	}
 
 	return was_read;
 }
+
+int inf_cmd_queue_ring_setup(struct inf_cmd_queue *cmdq,
+			     uint32_t             *mmap_size)
+{
+	struct inf_ring_hdr *ring;
+	unsigned long flags;
+
+	ring = vmalloc_user(INF_RING_MMAP_SIZE);
+	if (unlikely(ring == NULL))
+		return -ENOMEM;
+
+	ring->cmd_size = INF_RING_CMD_SIZE;
+	ring->cmd_offset = INF_RING_CMD_OFFSET;
+	ring->cpl_entries = INF_RING_CPL_ENTRIES;
+	ring->cpl_offset = INF_RING_CPL_OFFSET;
+
+	NNP_SPIN_LOCK_IRQSAVE(&cmdq->lock_irq, flags);
+	if (unlikely(cmdq->ring != NULL)) {
+		NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+		vfree(ring);
+		return -EBUSY;
+	}
+	cmdq->ring_cmd_prod = 0;
+	cmdq->ring_cpl_cons = 0;
+	cmdq->ring = ring;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&cmdq->lock_irq, flags);
+
+	*mmap_size = INF_RING_MMAP_SIZE;
+
+	return 0;
+}
+
+int inf_cmd_queue_ring_mmap(struct inf_cmd_queue  *cmdq,
+			    struct vm_area_struct *vma)
+{
+	if (unlikely(cmdq->ring == NULL))
+		return -ENODEV;
+
+	if (vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start != INF_RING_MMAP_SIZE)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, cmdq->ring, 0);
+}
+
+bool inf_cmd_queue_ring_cpl_pop(struct inf_cmd_queue *cmdq,
+				struct inf_ring_cpl  *cpl)
+{
+	struct inf_ring_cpl *entries;
+	uint32_t cons = cmdq->ring_cpl_cons;
+	uint32_t prod;
+
+	if (unlikely(cmdq->ring == NULL))
+		return false;
+
+	prod = smp_load_acquire(&cmdq->ring->cpl_prod);
+	if (prod == cons) {
+		/*
+		 * pairs with the runtime checking cpl_cons after publishing
+		 * cpl_prod, either it sees the ring drained and kicks or we
+		 * see its entry here.
+		 */
+		smp_mb();
+		prod = smp_load_acquire(&cmdq->ring->cpl_prod);
+		if (prod == cons)
+			return false;
+	}
+
+	if (unlikely(prod - cons > INF_RING_CPL_ENTRIES)) {
+		sph_log_err(GENERAL_LOG, "Corrupted cpl ring prod=%u cons=%u\n",
+			    prod, cons);
+		return false;
+	}
+
+	entries = (struct inf_ring_cpl *)((u8 *)cmdq->ring + INF_RING_CPL_OFFSET);
+	memcpy(cpl, &entries[cons % INF_RING_CPL_ENTRIES], sizeof(*cpl));
+
+	cmdq->ring_cpl_cons = cons + 1;
+	smp_store_release(&cmdq->ring->cpl_cons, cmdq->ring_cpl_cons);
+
+	return true;
+}
+
+#ifdef ULT
+/*
+ * Ring benchmark: a kernel thread takes the runtime side of the ring
+ * protocol on a context-less queue, like a fake daemon. It consumes the
+ * cmd ring, posts a completion per command and kicks only when the cpl
+ * ring was drained. Written through debugfs with the number of commands,
+ * reports commands/sec on read.
+ */
+#define INF_RING_BENCH_WINDOW  (INF_RING_CPL_ENTRIES / 2)
+
+struct inf_ring_bench {
+	struct inf_cmd_queue cmdq;
+	wait_queue_head_t    kick_waitq;
+	bool                 kicked;
+	uint32_t             daemon_sleeps;
+	uint32_t             kicks;
+};
+
+static struct inf_ring_bench_result {
+	int      err;
+	uint32_t num_cmds;
+	u64      elapsed_us;
+	uint32_t daemon_sleeps;
+	uint32_t kicks;
+} s_ring_bench_res;
+
+static DEFINE_MUTEX(s_ring_bench_lock);
+
+static int ring_bench_daemon(void *data)
+{
+	struct inf_ring_bench *b = (struct inf_ring_bench *)data;
+	struct inf_ring_hdr *ring = b->cmdq.ring;
+	u8 *cmd_base = (u8 *)ring + ring->cmd_offset;
+	struct inf_ring_cpl *cpl_entries = (struct inf_ring_cpl *)((u8 *)ring + ring->cpl_offset);
+	struct inf_ring_cpl *cpl;
+	struct inf_cmd_header *hdr;
+	uint32_t cons = 0, prod, cpl_prod = 0, cpl_first;
+
+	while (!kthread_should_stop()) {
+		prod = smp_load_acquire(&ring->cmd_prod);
+		if (prod == cons) {
+			/* driver wakes up only on empty to non-empty */
+			b->daemon_sleeps++;
+			wait_event_interruptible(b->cmdq.waitq,
+						 READ_ONCE(ring->cmd_prod) != cons ||
+						 kthread_should_stop());
+			continue;
+		}
+
+		/* producer keeps less commands in flight than cpl entries */
+		cpl_first = cpl_prod;
+		while (cons != prod) {
+			hdr = (struct inf_cmd_header *)(cmd_base + cons % ring->cmd_size);
+			if (hdr->opcode != INF_RING_OPCODE_PAD) {
+				cpl = &cpl_entries[cpl_prod % ring->cpl_entries];
+				cpl->infreq_drv_handle = *(uint64_t *)(hdr + 1);
+				cpl->infreq_ctx_id = 0;
+				cpl->i_sphcs_err = IOCTL_SPHCS_NO_ERROR;
+				cpl_prod++;
+			}
+			cons += ALIGN(sizeof(*hdr) + hdr->size, INF_RING_ALIGN);
+		}
+
+		smp_store_release(&ring->cmd_cons, cons);
+		smp_store_release(&ring->cpl_prod, cpl_prod);
+
+		/* pairs with inf_cmd_queue_ring_cpl_pop seeing an empty ring */
+		smp_mb();
+		if (READ_ONCE(ring->cpl_cons) == cpl_first) {
+			b->kicks++;
+			WRITE_ONCE(b->kicked, true);
+			wake_up(&b->kick_waitq);
+		}
+	}
+
+	return 0;
+}
+
+static int ring_bench_run(uint32_t num_cmds)
+{
+	struct inf_ring_bench *b;
+	struct task_struct *daemon;
+	struct inf_ring_cpl cpl;
+	uint32_t mmap_size, sent = 0, done = 0;
+	uint64_t handle;
+	u64 start;
+	int ret;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (unlikely(b == NULL))
+		return -ENOMEM;
+
+	inf_cmd_queue_init(&b->cmdq);
+	init_waitqueue_head(&b->kick_waitq);
+
+	ret = inf_cmd_queue_ring_setup(&b->cmdq, &mmap_size);
+	if (unlikely(ret < 0))
+		goto free_bench;
+
+	daemon = kthread_run(ring_bench_daemon, b, "inf_ring_bench");
+	if (IS_ERR(daemon)) {
+		ret = PTR_ERR(daemon);
+		goto fini_cmdq;
+	}
+
+	start = nnp_time_us();
+	while (done < num_cmds) {
+		while (sent < num_cmds && sent - done < INF_RING_BENCH_WINDOW) {
+			handle = sent;
+			ret = inf_cmd_queue_add(&b->cmdq, 0, &handle, sizeof(handle), NULL, NULL);
+			if (unlikely(ret < 0))
+				goto stop_daemon;
+			sent++;
+		}
+
+		/* the fake daemon does not read() commands left in the list */
+		if (unlikely(READ_ONCE(b->cmdq.depth) > 0)) {
+			ret = -ENOSPC;
+			goto stop_daemon;
+		}
+
+		if (!wait_event_timeout(b->kick_waitq, READ_ONCE(b->kicked), HZ)) {
+			ret = -ETIMEDOUT;
+			goto stop_daemon;
+		}
+		WRITE_ONCE(b->kicked, false);
+
+		mutex_lock(&b->cmdq.ring_cpl_lock);
+		while (inf_cmd_queue_ring_cpl_pop(&b->cmdq, &cpl)) {
+			if (unlikely(cpl.infreq_drv_handle != done)) {
+				ret = -EIO;
+				break;
+			}
+			done++;
+		}
+		mutex_unlock(&b->cmdq.ring_cpl_lock);
+		if (unlikely(ret < 0))
+			goto stop_daemon;
+	}
+
+	s_ring_bench_res.num_cmds = num_cmds;
+	s_ring_bench_res.elapsed_us = nnp_time_us() - start;
+
+stop_daemon:
+	kthread_stop(daemon);
+	s_ring_bench_res.daemon_sleeps = b->daemon_sleeps;
+	s_ring_bench_res.kicks = b->kicks;
+fini_cmdq:
+	inf_cmd_queue_fini(&b->cmdq);
+free_bench:
+	kfree(b);
+
+	return ret;
+}
+
+static ssize_t ring_bench_write(struct file *filp,
+				const char __user *buf,
+				size_t count,
+				loff_t *pos)
+{
+	uint32_t num_cmds;
+	int ret;
+
+	ret = kstrtouint_from_user(buf, count, 0, &num_cmds);
+	if (ret < 0)
+		return ret;
+	if (num_cmds == 0)
+		return -EINVAL;
+
+	mutex_lock(&s_ring_bench_lock);
+	memset(&s_ring_bench_res, 0, sizeof(s_ring_bench_res));
+	s_ring_bench_res.err = ring_bench_run(num_cmds);
+	ret = s_ring_bench_res.err;
+	mutex_unlock(&s_ring_bench_lock);
+
+	if (ret < 0)
+		sph_log_err(GENERAL_LOG, "inf ring bench failed %d\n", ret);
+
+	return count;
+}
+
+static int ring_bench_show(struct seq_file *m, void *v)
+{
+	u64 cmds_per_sec = 0;
+
+	mutex_lock(&s_ring_bench_lock);
+	if (s_ring_bench_res.elapsed_us > 0)
+		cmds_per_sec = div64_u64((u64)s_ring_bench_res.num_cmds * USEC_PER_SEC,
+					 s_ring_bench_res.elapsed_us);
+
+	seq_printf(m, "err %d\n", s_ring_bench_res.err);
+	seq_printf(m, "commands %u elapsed us %llu commands/sec %llu\n",
+		   s_ring_bench_res.num_cmds,
+		   s_ring_bench_res.elapsed_us,
+		   cmds_per_sec);
+	seq_printf(m, "daemon sleeps %u kicks %u\n",
+		   s_ring_bench_res.daemon_sleeps,
+		   s_ring_bench_res.kicks);
+	mutex_unlock(&s_ring_bench_lock);
+
+	return 0;
+}
+
+static int ring_bench_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, ring_bench_show, inode->i_private);
+}
+
+static const struct file_operations ring_bench_fops = {
+	.open		= ring_bench_open,
+	.read		= seq_read,
+	.write		= ring_bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void inf_cmd_queue_init_debugfs(struct dentry *parent)
+{
+	debugfs_create_file("inf_ring_bench",
+			    0600,
+			    parent,
+			    NULL,
+			    &ring_bench_fops);
+}
+#endif
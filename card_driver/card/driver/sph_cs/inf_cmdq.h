@@ -12,11 +12,16 @@
 #include <linux/wait.h>
 #include <linux/spinlock.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
 #include "ioctl_inf.h"
 #include "sph_log.h"
 
 struct inf_command {
 	struct list_head node;
+	struct list_head op_node;
+	int              size_class;
+	u64              enqueue_time;
 	uint32_t         header_read;
 	uint32_t         offset;
 	struct inf_cmd_header header;
@@ -28,13 +33,42 @@ struct inf_command {
 	u8               cmd_args[1];
 };
 
+/*
+ * Commands are allocated from per size class caches, commands with bigger
+ * args are allocated by kmalloc.
+ */
+#define INF_CMD_NUM_SIZE_CLASSES  3
+#define INF_CMD_SIZE_CLASS_KMALLOC  (-1)
+
+/* pending commands are also linked by opcode for inf_cmd_queue_exe */
+#define INF_CMD_QUEUE_OPCODE_LISTS  16
+
 struct inf_cmd_queue {
 	struct list_head  pending_commands;
+	struct list_head  opcode_commands[INF_CMD_QUEUE_OPCODE_LISTS];
+	uint32_t          depth;
+	uint32_t          max_depth;
+	bool              bulk_read;
 	int               hangup;
 	wait_queue_head_t waitq;
 	spinlock_t        lock_irq;
+
+	/* shared memory rings, NULL until runtime sets them up */
+	struct inf_ring_hdr *ring;
+	uint32_t          ring_cmd_prod;
+	uint32_t          ring_cpl_cons;
+	struct mutex      ring_cpl_lock;
 };
 
+/* layout of the ring mapping */
+#define INF_RING_CMD_OFFSET  PAGE_ALIGN(sizeof(struct inf_ring_hdr))
+#define INF_RING_CPL_OFFSET  (INF_RING_CMD_OFFSET + INF_RING_CMD_SIZE)
+#define INF_RING_MMAP_SIZE   (INF_RING_CPL_OFFSET + \
+			      PAGE_ALIGN(INF_RING_CPL_ENTRIES * sizeof(struct inf_ring_cpl)))
+
+int inf_cmd_queue_caches_init(void);
+void inf_cmd_queue_caches_fini(void);
+
 void inf_cmd_queue_init(struct inf_cmd_queue *cmdq);
 void inf_cmd_queue_fini(struct inf_cmd_queue *cmdq);
 
@@ -58,9 +92,36 @@ unsigned int inf_cmd_queue_poll(struct inf_cmd_queue *cmdq,
 				struct file *f,
 				struct poll_table_struct *pt);
 
+/*
+ * In bulk read mode read() returns, after the current command, every
+ * following command which fits entirely in the buffer, each as
+ * struct inf_cmd_header followed by its args.
+ */
+void inf_cmd_queue_set_bulk_read(struct inf_cmd_queue *cmdq, bool enable);
+
+/* number of pending commands in the list and age of the oldest one */
+void inf_cmd_queue_get_stats(struct inf_cmd_queue *cmdq,
+			     uint32_t             *depth,
+			     u64                  *oldest_age_us);
+
 ssize_t inf_cmd_queue_read(struct inf_cmd_queue *cmdq,
 			   char __user          *buf,
 			   size_t                size,
 			   loff_t               *off);
 
+int inf_cmd_queue_ring_setup(struct inf_cmd_queue *cmdq,
+			     uint32_t             *mmap_size);
+
+int inf_cmd_queue_ring_mmap(struct inf_cmd_queue  *cmdq,
+			    struct vm_area_struct *vma);
+
+/* called with ring_cpl_lock held, returns false when cpl ring is empty */
+bool inf_cmd_queue_ring_cpl_pop(struct inf_cmd_queue *cmdq,
+				struct inf_ring_cpl  *cpl);
+
+#ifdef ULT
+/* debugfs inf_ring_bench, ring throughput with a fake runtime daemon */
+void inf_cmd_queue_init_debugfs(struct dentry *parent);
+#endif
+
 #endif
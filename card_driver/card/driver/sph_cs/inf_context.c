@@ -24,6 +24,8 @@ static void update_sw_counters(void *ctx)
 	struct inf_context *context = (struct inf_context *)ctx;
 	u64 current_time;
 	unsigned long flags;
+	uint32_t depth;
+	u64 oldest_age;
 
 	NNP_SPIN_LOCK_IRQSAVE(&context->sw_counters_lock_irq, flags);
 	if (context->infreq_counter > 0 &&
@@ -40,6 +42,20 @@ static void update_sw_counters(void *ctx)
 		context->runtime_busy_starttime = 0;
 	}
 	NNP_SPIN_UNLOCK_IRQRESTORE(&context->sw_counters_lock_irq, flags);
+
+	if (NNP_SW_GROUP_IS_ENABLE(context->sw_counters,
+				   CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE)) {
+		inf_cmd_queue_get_stats(&context->cmdq, &depth, &oldest_age);
+		SPH_SW_COUNTER_SET(context->sw_counters,
+				   CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_DEPTH,
+				   depth);
+		SPH_SW_COUNTER_SET(context->sw_counters,
+				   CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_MAX_DEPTH,
+				   context->cmdq.max_depth);
+		SPH_SW_COUNTER_SET(context->sw_counters,
+				   CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_OLDEST_AGE,
+				   oldest_age);
+	}
 }
 
 int inf_context_create(uint16_t             protocol_id,
@@ -49,6 +65,7 @@ int inf_context_create(uint16_t             protocol_id,
 	struct inf_context *context;
 	struct periodic_timer_data periodic_timer_data;
 	char slab_name[16];
+	int i;
 	int ret;
 
 	context = kzalloc(sizeof(*context), GFP_KERNEL);
@@ -74,6 +91,9 @@ int inf_context_create(uint16_t             protocol_id,
 	context->destroyed = 0;
 	context->runtime_detach_sent = false;
 	atomic_set(&context->sched_tick, 1);
+	spin_lock_init(&context->ready_lock_irq);
+	for (i = 0; i < INF_EXEC_REQ_NUM_PRIORITIES; ++i)
+		INIT_LIST_HEAD(&context->ready_reqs[i]);
 	spin_lock_init(&context->lock);
 	spin_lock_init(&context->sync_lock_irq);
 	spin_lock_init(&context->sw_counters_lock_irq);
@@ -119,6 +139,7 @@ int inf_context_create(uint16_t             protocol_id,
 free_counters:
 	nnp_remove_sw_counters_values_node(context->sw_counters);
 free_kmem_cache:
+	inf_exec_req_drop_ready(context);
 	kmem_cache_destroy(context->exec_req_slab_cache);
 freeCtx:
 	kfree(context);
@@ -214,6 +235,7 @@ static void release_context(struct kref *kref)
 
 	NNP_ASSERT(context->attached != 1);
 
+	inf_exec_req_drop_ready(context);
 	kmem_cache_destroy(context->exec_req_slab_cache);
 
 	inf_exec_error_list_fini(&context->error_list);
@@ -242,6 +264,9 @@ void inf_context_destroy_objects(struct inf_context *context)
 	bool found = true;
 	unsigned long flags;
 
+	/* ready requests hold a reference which blocks their release */
+	inf_exec_req_drop_ready(context);
+
 	do {
 		found = false;
 		NNP_SPIN_LOCK(&context->lock);
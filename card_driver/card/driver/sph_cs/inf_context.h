@@ -60,6 +60,8 @@ struct inf_context {
 	wait_queue_head_t    sched_waitq;
 	u32                  next_seq_id;
 	atomic_t             sched_tick;
+	spinlock_t           ready_lock_irq;
+	struct list_head     ready_reqs[INF_EXEC_REQ_NUM_PRIORITIES];
 	u32                  num_optimized_cmd_lists;
 
 	struct inf_exec_error_list error_list;
@@ -534,6 +534,7 @@ int inf_copy_req_sched(struct inf_exec_req *req)
 		req->time = 0;
 
 	inf_exec_req_get(req);
+	inf_exec_req_deps_init(req);
 
 	/* Add request to the queue */
 	err = inf_devres_add_req_to_queue(req->depend_devres, req, copy->card2Host);
@@ -545,7 +546,8 @@ int inf_copy_req_sched(struct inf_exec_req *req)
 
 	// First try to execute
 	req->last_sched_tick = 0;
-	inf_req_try_execute(req);
+	if (inf_exec_req_deps_commit(req))
+		inf_req_try_execute(req);
 
 	inf_exec_req_put(req);
 
@@ -441,6 +441,8 @@ static int inf_cpylst_req_sched(struct inf_exec_req *req)
 
 	inf_exec_req_get(req);
 
+	inf_exec_req_deps_init(req);
+
 	read = cpylst->copies[0]->card2Host;
 	for (i = 0; i < req->num_opt_depend_devres; ++i) {
 		err = inf_devres_add_req_to_queue(req->opt_depend_devres[i], req, read);
@@ -450,7 +452,8 @@ static int inf_cpylst_req_sched(struct inf_exec_req *req)
 
 	// First try to execute
 	req->last_sched_tick = 0;
-	inf_req_try_execute(req);
+	if (inf_exec_req_deps_commit(req))
+		inf_req_try_execute(req);
 
 	inf_exec_req_put(req);
 
@@ -459,6 +462,9 @@ static int inf_cpylst_req_sched(struct inf_exec_req *req)
 fail:
 	for (--i; i >= 0; --i)
 		inf_devres_del_req_from_queue(req->opt_depend_devres[i], req);
+	/* removed entries might have unblocked other requests */
+	atomic_add(2, &req->context->sched_tick);
+	inf_exec_req_run_ready(req->context);
 	inf_context_seq_id_fini(req->context, &req->seq);
 	inf_cmd_put(req->cmd);
 
@@ -338,12 +338,51 @@ int inf_devres_add_req_to_queue(struct inf_devres *devres, struct inf_exec_req *
 	queue_ent->read = read;
 
 	NNP_SPIN_LOCK_IRQSAVE(&devres->lock_irq, flags);
+	/*
+	 * The entry is granted if the queue is empty or
+	 * it is a read and all previous entries are granted reads.
+	 */
+	if (list_empty(&devres->exec_queue)) {
+		queue_ent->granted = true;
+	} else {
+		struct exec_queue_entry *last = list_last_entry(&devres->exec_queue,
+								struct exec_queue_entry,
+								node);
+
+		queue_ent->granted = (read && last->read && last->granted);
+	}
+	if (!queue_ent->granted)
+		atomic_inc(&req->num_unsatisfied_deps);
 	list_add_tail(&queue_ent->node, &devres->exec_queue);
 	NNP_SPIN_UNLOCK_IRQRESTORE(&devres->lock_irq, flags);
 
 	return 0;
 }
 
+/*
+ * Grants all queue entries which became allowed to access the devres,
+ * i.e. the first entry and all reads which follow a read head.
+ * Must be called with devres->lock_irq held.
+ */
+static void grant_queue_head(struct inf_devres *devres)
+{
+	struct exec_queue_entry *pos;
+
+	list_for_each_entry(pos, &devres->exec_queue, node) {
+		// write which is not the first in the queue cannot be granted
+		if (!pos->read && pos->node.prev != &devres->exec_queue)
+			break;
+
+		if (!pos->granted) {
+			pos->granted = true;
+			inf_exec_req_dep_satisfied(pos->req);
+		}
+
+		if (!pos->read)
+			break;
+	}
+}
+
 int inf_devres_send_release_credit(struct inf_devres *devres, struct inf_exec_req *req)
 {
 	int rc = 0;
@@ -376,6 +415,7 @@ void inf_devres_del_req_from_queue(struct inf_devres   *devres,
 	NNP_ASSERT(&pos->node != &devres->exec_queue);
 	list_del(&pos->node);
 	++devres->queue_version;
+	grant_queue_head(devres);
 
 	NNP_SPIN_UNLOCK_IRQRESTORE(&devres->lock_irq, flags);
 
@@ -390,15 +430,27 @@ void inf_devres_try_execute(struct inf_devres *devres)
 
 	NNP_ASSERT(devres != NULL);
 
-	// try all reads
+	/* first run requests which became ready by completed predecessors */
+	inf_exec_req_run_ready(devres->context);
+
+	/*
+	 * Retry granted requests, those may wait for a non-queue
+	 * condition (p2p buffer ready, dirty state).
+	 */
 	NNP_SPIN_LOCK_IRQSAVE(&devres->lock_irq, flags);
 	list_for_each_entry(pos, &devres->exec_queue, node) {
 		bool is_write = !pos->read;
 
-		// if pos is write and it is not the first in the queue exit
-		if (is_write && pos->node.prev != &devres->exec_queue)
+		if (!pos->granted)
 			break;
 
+		// request still waits for another devres
+		if (atomic_read(&pos->req->num_unsatisfied_deps) != 0) {
+			if (is_write)
+				break;
+			continue;
+		}
+
 		// if get in_use failed, the req is being destroyed
 		if (inf_exec_req_get(pos->req) == 0)
 			break;
@@ -429,13 +481,13 @@ enum DEV_RES_READINESS inf_devres_req_ready(struct inf_devres *devres, struct in
 	 */
 	NNP_SPIN_LOCK_IRQSAVE(&devres->lock_irq, flags);
 	list_for_each_entry(pos, &devres->exec_queue, node) {
+		if (!pos->granted)
+			break;
 		if (pos->req == req) {
 			NNP_ASSERT(pos->read == for_read);
 			res = DEV_RES_READINESS_READY;
 			break;
 		}
-		if (!pos->read || !for_read)
-			break;
 	}
 
 	if ((res == DEV_RES_READINESS_READY) && inf_devres_is_p2p(devres) && for_read) {
@@ -24,6 +24,8 @@ enum DEV_RES_READINESS {
 struct exec_queue_entry {
 	struct inf_exec_req *req;
 	bool                 read;
+	/* the request may access the devres (entry is in the queue head) */
+	bool                 granted;
 	struct list_head     node;
 };
 
@@ -21,6 +21,10 @@ void inf_req_try_execute(struct inf_exec_req *req)
 
 	NNP_ASSERT(req != NULL);
 
+	/* some devres dependency is still not satisfied */
+	if (atomic_read(&req->num_unsatisfied_deps) != 0)
+		return;
+
 	NNP_SPIN_LOCK_IRQSAVE(&req->lock_irq, flags);
 	curr_sched_tick = atomic_read(&req->context->sched_tick);
 	if (req->in_progress || req->last_sched_tick == curr_sched_tick) {
@@ -52,6 +56,111 @@ void inf_req_try_execute(struct inf_exec_req *req)
 
 }
 
+/*
+ * Prepares the request for being added to devres queues.
+ * The dependency counter starts with one extra reference which
+ * prevents the request from becoming ready while its queue entries
+ * are still being added, it is dropped by inf_exec_req_deps_commit.
+ */
+void inf_exec_req_deps_init(struct inf_exec_req *req)
+{
+	atomic_set(&req->num_unsatisfied_deps, 1);
+	INIT_LIST_HEAD(&req->ready_node);
+}
+
+/*
+ * Drops the extra dependency reference taken by inf_exec_req_deps_init.
+ * Returns true if all dependencies are already satisfied, in that case the
+ * request is not pushed to the ready list and the caller executes it.
+ */
+bool inf_exec_req_deps_commit(struct inf_exec_req *req)
+{
+	return atomic_dec_and_test(&req->num_unsatisfied_deps);
+}
+
+/*
+ * Called when one of the request dependencies become satisfied
+ * (its devres queue entry is granted).
+ * When the last dependency is satisfied the request is pushed
+ * to the context ready list of its priority.
+ */
+void inf_exec_req_dep_satisfied(struct inf_exec_req *req)
+{
+	struct inf_context *context = req->context;
+	unsigned long flags;
+	uint8_t prio;
+
+	if (!atomic_dec_and_test(&req->num_unsatisfied_deps))
+		return;
+
+	/* if get in_use failed, the req is being destroyed */
+	if (inf_exec_req_get(req) == 0)
+		return;
+
+	prio = req->priority < INF_EXEC_REQ_NUM_PRIORITIES ? req->priority : INF_EXEC_REQ_NUM_PRIORITIES - 1;
+
+	NNP_SPIN_LOCK_IRQSAVE(&context->ready_lock_irq, flags);
+	list_add_tail(&req->ready_node, &context->ready_reqs[prio]);
+	NNP_SPIN_UNLOCK_IRQRESTORE(&context->ready_lock_irq, flags);
+}
+
+/*
+ * Tries to execute all requests in the context ready lists,
+ * higher priority requests first.
+ */
+void inf_exec_req_run_ready(struct inf_context *context)
+{
+	struct inf_exec_req *req;
+	unsigned long flags;
+	int prio;
+
+	do {
+		req = NULL;
+		NNP_SPIN_LOCK_IRQSAVE(&context->ready_lock_irq, flags);
+		for (prio = INF_EXEC_REQ_NUM_PRIORITIES - 1; prio >= 0; --prio) {
+			req = list_first_entry_or_null(&context->ready_reqs[prio],
+						       struct inf_exec_req,
+						       ready_node);
+			if (req != NULL) {
+				list_del_init(&req->ready_node);
+				break;
+			}
+		}
+		NNP_SPIN_UNLOCK_IRQRESTORE(&context->ready_lock_irq, flags);
+
+		if (req != NULL) {
+			inf_req_try_execute(req);
+			inf_exec_req_put(req);
+		}
+	} while (req != NULL);
+}
+
+/*
+ * Removes all requests from the context ready lists without executing
+ * them, dropping the reference held by the ready list.
+ */
+void inf_exec_req_drop_ready(struct inf_context *context)
+{
+	struct inf_exec_req *req;
+	unsigned long flags;
+	int prio;
+
+	for (prio = 0; prio < INF_EXEC_REQ_NUM_PRIORITIES; ++prio) {
+		do {
+			NNP_SPIN_LOCK_IRQSAVE(&context->ready_lock_irq, flags);
+			req = list_first_entry_or_null(&context->ready_reqs[prio],
+						       struct inf_exec_req,
+						       ready_node);
+			if (req != NULL)
+				list_del_init(&req->ready_node);
+			NNP_SPIN_UNLOCK_IRQRESTORE(&context->ready_lock_irq, flags);
+
+			if (req != NULL)
+				inf_exec_req_put(req);
+		} while (req != NULL);
+	}
+}
+
 int inf_exec_req_get(struct inf_exec_req *req)
 {
 	return kref_get_unless_zero(&req->in_use);
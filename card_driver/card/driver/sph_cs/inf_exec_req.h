@@ -63,6 +63,17 @@ struct inf_exec_req {
 	//priority 0 == normal, 1 == high
 	uint8_t              priority;
 
+	/*
+	 * Dependency graph state:
+	 * num_unsatisfied_deps - number of devres queue entries of this request
+	 *                        which are not yet granted (plus one while the
+	 *                        request is being scheduled).
+	 * ready_node - links the request into its context ready list once
+	 *              all its dependencies are satisfied.
+	 */
+	atomic_t             num_unsatisfied_deps;
+	struct list_head     ready_node;
+
 	union {
 		struct {
 			struct inf_cpylst *cpylst;
@@ -88,12 +99,19 @@ struct inf_exec_req {
 			uint8_t           debugOn : 1;
 			uint8_t           collectInfo : 1;
 			uint8_t           reserved : 6;
+			u64               lat_ts[INF_REQ_LAT_NUM];
 		};
 	};
 };
 
 void inf_req_try_execute(struct inf_exec_req *req);
 
+void inf_exec_req_deps_init(struct inf_exec_req *req);
+bool inf_exec_req_deps_commit(struct inf_exec_req *req);
+void inf_exec_req_dep_satisfied(struct inf_exec_req *req);
+void inf_exec_req_run_ready(struct inf_context *context);
+void inf_exec_req_drop_ready(struct inf_context *context);
+
 int inf_exec_req_get(struct inf_exec_req *req);
 int inf_exec_req_put(struct inf_exec_req *req);
 
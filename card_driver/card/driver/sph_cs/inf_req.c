@@ -306,6 +306,10 @@ int infreq_req_sched(struct inf_exec_req *req)
 		req->time = nnp_time_us();
 	else
 		req->time = 0;
+	memset(req->lat_ts, 0, sizeof(req->lat_ts));
+	if (NNP_SW_GROUP_IS_ENABLE(infreq->devnet->sw_counters,
+				   NET_SPHCS_SW_COUNTERS_GROUP_LATENCY))
+		req->lat_ts[INF_REQ_LAT_SCHED] = nnp_time_us();
 	inf_req_get(req->infreq);
 	spin_lock_init(&req->lock_irq);
 	inf_context_seq_id_init(infreq->devnet->context, &req->seq);
@@ -317,6 +321,8 @@ int infreq_req_sched(struct inf_exec_req *req)
 					   infreq->protocol_id,
 					   req->cmd ? req->cmd->protocol_id : -1));
 
+	inf_exec_req_deps_init(req);
+
 	/* place write dependency on the network resource to prevent
 	 * two infer request of the same network to work in parallel.
 	 */
@@ -352,7 +358,8 @@ int infreq_req_sched(struct inf_exec_req *req)
 
 	// First try to execute
 	req->last_sched_tick = 0;
-	inf_req_try_execute(req);
+	if (inf_exec_req_deps_commit(req))
+		inf_req_try_execute(req);
 
 	inf_exec_req_put(req);
 	return 0;
@@ -363,6 +370,9 @@ fail:
 	for (k = 0; k < j; k++)
 		inf_devres_del_req_from_queue(req->o_opt_depend_devres[k], req);
 	inf_devres_del_req_from_queue(infreq->devnet->first_devres, req);
+	/* removed entries might have unblocked other requests */
+	atomic_add(2, &req->context->sched_tick);
+	inf_exec_req_run_ready(req->context);
 fail_first:
 	inf_context_seq_id_fini(infreq->devnet->context, &req->seq);
 	inf_req_put(infreq);
@@ -450,6 +460,9 @@ unsigned long inf_req_read_exec_command(char __user *buf,
 
 	if (offset < sizeof(req->infreq->exec_cmd)) {
 
+		if (offset == 0 && req->lat_ts[INF_REQ_LAT_SCHED] != 0)
+			req->lat_ts[INF_REQ_LAT_PICKED] = nnp_time_us();
+
 		NNP_ASSERT(n_to_read >= sizeof(req->infreq->exec_cmd)-offset);
 		n = sizeof(req->infreq->exec_cmd) - offset;
 
@@ -560,6 +573,9 @@ static int inf_req_execute(struct inf_exec_req *req)
 		req->time = 0;
 	}
 
+	if (req->lat_ts[INF_REQ_LAT_SCHED] != 0)
+		req->lat_ts[INF_REQ_LAT_READY] = nnp_time_us();
+
 	NNP_SPIN_LOCK_IRQSAVE(&infreq->lock_irq, flags);
 	infreq->exec_cmd.ready_flags = 1;
 	infreq->exec_cmd.sched_params_is_null = req->sched_params_is_null;
@@ -713,31 +729,53 @@ static void treat_infreq_failure(struct inf_exec_req *req,
 		inf_devres_set_dirty(infreq->outputs[i], true);
 }
 
-void inf_req_complete(struct inf_exec_req *req,
-		      int                  err,
-		      const void          *error_msg,
-		      int32_t              error_msg_size)
+static void infreq_lat_hist_add(struct inf_devnet *devnet,
+				u32                hist,
+				u64                start,
+				u64                end)
 {
-	struct inf_req *infreq;
-	struct inf_context *context;
-	struct inf_cmd_list *cmd;
-	unsigned long flags;
-	enum event_val event_val;
-	bool last_completed;
-	uint32_t i;
-	bool has_dirty_outputs = false;
+	u32 bucket;
 
-	NNP_ASSERT(req->cmd_type == CMDLIST_CMD_INFREQ);
-	NNP_ASSERT(req->in_progress);
+	/* stage not reached, or wall clock stepped back */
+	if (start == 0 || end < start)
+		return;
 
-	infreq = req->infreq;
-	context = infreq->devnet->context;
-	cmd = req->cmd;
+	bucket = fls64((end - start) >> 1);
+	if (bucket >= NET_SPHCS_LAT_HIST_BUCKETS)
+		bucket = NET_SPHCS_LAT_HIST_BUCKETS - 1;
+
+	SPH_SW_COUNTER_ATOMIC_INC(devnet->sw_counters, hist + bucket);
+}
+
+/* Fold the stages of a completed request into its network histograms */
+static void infreq_record_latency(struct inf_exec_req *req)
+{
+	struct inf_devnet *devnet = req->infreq->devnet;
+	u64 *ts = req->lat_ts;
+	u64 now = nnp_time_us();
+
+	infreq_lat_hist_add(devnet, NET_SPHCS_SW_COUNTERS_LAT_WAIT_HIST,
+			    ts[INF_REQ_LAT_SCHED], ts[INF_REQ_LAT_READY]);
+	infreq_lat_hist_add(devnet, NET_SPHCS_SW_COUNTERS_LAT_QUEUE_HIST,
+			    ts[INF_REQ_LAT_READY], ts[INF_REQ_LAT_PICKED]);
+	infreq_lat_hist_add(devnet, NET_SPHCS_SW_COUNTERS_LAT_EXEC_HIST,
+			    ts[INF_REQ_LAT_PICKED], ts[INF_REQ_LAT_DONE]);
+	infreq_lat_hist_add(devnet, NET_SPHCS_SW_COUNTERS_LAT_RESP_HIST,
+			    ts[INF_REQ_LAT_DONE], now);
+	infreq_lat_hist_add(devnet, NET_SPHCS_SW_COUNTERS_LAT_TOTAL_HIST,
+			    ts[INF_REQ_LAT_SCHED], now);
+}
+
+/* accounts n completed requests of the context */
+static void infreq_context_completed(struct inf_context *context, uint32_t n)
+{
+	unsigned long flags;
+	bool last_completed;
 
 	NNP_SPIN_LOCK_IRQSAVE(&context->sw_counters_lock_irq, flags);
-	context->infreq_counter--;
+	context->infreq_counter -= n;
 	last_completed = (context->infreq_counter == 0);
-	NNP_SW_COUNTER_INC(context->sw_counters, CTX_SPHCS_SW_COUNTERS_INFERENCE_COMPLETED_INF_REQ);
+	NNP_SW_COUNTER_ADD(context->sw_counters, CTX_SPHCS_SW_COUNTERS_INFERENCE_COMPLETED_INF_REQ, n);
 
 	if (last_completed &&
 	    NNP_SW_GROUP_IS_ENABLE(context->sw_counters, CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE) &&
@@ -749,6 +787,23 @@ void inf_req_complete(struct inf_exec_req *req,
 		context->runtime_busy_starttime = 0;
 	}
 	NNP_SPIN_UNLOCK_IRQRESTORE(&context->sw_counters_lock_irq, flags);
+}
+
+static void infreq_complete(struct inf_exec_req *req,
+			    int                  err,
+			    const void          *error_msg,
+			    int32_t              error_msg_size)
+{
+	struct inf_req *infreq;
+	struct inf_cmd_list *cmd;
+	unsigned long flags;
+	enum event_val event_val;
+	uint32_t i;
+	bool has_dirty_outputs = false;
+
+	infreq = req->infreq;
+	cmd = req->cmd;
+
 	SPH_SW_COUNTER_ATOMIC_INC(g_nnp_sw_counters, SPHCS_SW_COUNTERS_INFERENCE_COMPLETED_INF_REQ);
 
 	 DO_TRACE(trace_infreq(SPH_TRACE_OP_STATUS_COMPLETE,
@@ -876,12 +931,66 @@ void inf_req_complete(struct inf_exec_req *req,
 
 	ibecc_clean_error();
 
+	if (req->lat_ts[INF_REQ_LAT_SCHED] != 0)
+		infreq_record_latency(req);
+
 	inf_exec_req_put(req);
 
 	/* If command list execution completed, send completion event */
 	send_cmd_list_completed_event(cmd);
 }
 
+void inf_req_complete(struct inf_exec_req *req,
+		      int                  err,
+		      const void          *error_msg,
+		      int32_t              error_msg_size)
+{
+	NNP_ASSERT(req->cmd_type == CMDLIST_CMD_INFREQ);
+	NNP_ASSERT(req->in_progress);
+
+	if (req->lat_ts[INF_REQ_LAT_SCHED] != 0)
+		req->lat_ts[INF_REQ_LAT_DONE] = nnp_time_us();
+
+	infreq_context_completed(req->infreq->devnet->context, 1);
+	infreq_complete(req, err, error_msg, error_msg_size);
+}
+
+void inf_req_complete_batch(struct inf_req_completion *cpl, uint32_t n)
+{
+	struct inf_context *context;
+	uint32_t i, j, count;
+	u64 now = nnp_time_us();
+
+	for (i = 0; i < n; i++) {
+		NNP_ASSERT(cpl[i].req->cmd_type == CMDLIST_CMD_INFREQ);
+		NNP_ASSERT(cpl[i].req->in_progress);
+
+		if (cpl[i].req->lat_ts[INF_REQ_LAT_SCHED] != 0)
+			cpl[i].req->lat_ts[INF_REQ_LAT_DONE] = now;
+	}
+
+	/* account each context once, batches normally hold one context */
+	for (i = 0; i < n; i++) {
+		context = cpl[i].req->infreq->devnet->context;
+		for (j = 0; j < i; j++)
+			if (cpl[j].req->infreq->devnet->context == context)
+				break;
+		if (j < i)
+			continue;
+
+		count = 1;
+		for (j = i + 1; j < n; j++)
+			if (cpl[j].req->infreq->devnet->context == context)
+				count++;
+
+		infreq_context_completed(context, count);
+	}
+
+	for (i = 0; i < n; i++)
+		infreq_complete(cpl[i].req, cpl[i].err,
+				cpl[i].error_msg, cpl[i].error_msg_size);
+}
+
 static int inf_req_infreq_put(struct inf_exec_req *req)
 {
 	return inf_req_put(req->infreq);
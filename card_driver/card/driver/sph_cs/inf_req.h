@@ -86,4 +86,14 @@ void inf_req_complete(struct inf_exec_req *req,
 		      const void          *error_msg,
 		      int32_t              error_msg_size);
 
+struct inf_req_completion {
+	struct inf_exec_req *req;
+	int                  err;
+	const void          *error_msg;
+	int32_t              error_msg_size;
+};
+
+/* completes n requests, updating each context counters once */
+void inf_req_complete_batch(struct inf_req_completion *cpl, uint32_t n);
+
 #endif
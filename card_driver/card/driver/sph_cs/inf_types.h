@@ -11,6 +11,21 @@
 #include "nnp_types.h"
 #include "ipc_chan_protocol.h"
 
+/* number of per-context exec request ready lists, one per request priority */
+#define INF_EXEC_REQ_NUM_PRIORITIES 2
+
+/*
+ * Stages of an infer request execution, recorded in usec in
+ * inf_exec_req::lat_ts when the network latency group is enabled.
+ */
+enum inf_req_lat_stage {
+	INF_REQ_LAT_SCHED,	/* schedule request received */
+	INF_REQ_LAT_READY,	/* devres dependencies satisfied */
+	INF_REQ_LAT_PICKED,	/* runtime read the execute command */
+	INF_REQ_LAT_DONE,	/* runtime reported execution done */
+	INF_REQ_LAT_NUM
+};
+
 struct inf_req_sequence {
 	u32              seq_id;
 	struct list_head node;
@@ -0,0 +1,7 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+#include "../../kernel_mock.h"
@@ -0,0 +1,399 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Userspace unit test of the inference command queue. inf_cmdq.c is
+ * included to reach its static helpers and the ring benchmark. Queues are
+ * zeroed first, the driver embeds them in kzalloc()ed objects.
+ *
+ *   make test
+ *   ./inf_cmdq_test [ring_bench_commands]
+ */
+
+#include "inf_cmdq.c"
+
+__thread struct task_struct *kmock_current;
+
+#define CHECK(x)							\
+	do {								\
+		if (!(x)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__func__, __LINE__, #x);		\
+			return -1;					\
+		}							\
+	} while (0)
+
+#define HDR_SIZE  sizeof(struct inf_cmd_header)
+
+static uint32_t s_exe_count;
+static uint32_t s_exe_sum;
+
+static void count_exe(void *cmd_args)
+{
+	s_exe_count++;
+	s_exe_sum += *(uint32_t *)cmd_args;
+}
+
+static unsigned long fill_payload(char __user *buf,
+				  void        *ctx,
+				  uint32_t     offset,
+				  uint32_t     n_to_read)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_to_read; i++)
+		buf[i] = (char)(offset + i);
+
+	return 0;
+}
+
+static int test_size_classes(void)
+{
+	static u8 args[2048];
+	static const struct {
+		uint32_t size;
+		int      size_class;
+	} cases[] = {
+		{ 0, 0 }, { 64, 0 }, { 65, 1 }, { 256, 1 }, { 257, 2 },
+		{ 1024, 2 }, { 1025, INF_CMD_SIZE_CLASS_KMALLOC },
+		{ 2048, INF_CMD_SIZE_CLASS_KMALLOC }
+	};
+	struct inf_cmd_queue cmdq;
+	struct inf_command *cmd;
+	uint32_t i;
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+		CHECK(inf_cmd_queue_add(&cmdq, 1, args, cases[i].size, NULL, NULL) == 0);
+	/* payload is read on demand, nothing to copy */
+	CHECK(inf_cmd_queue_add(&cmdq, 1, NULL, 4096, fill_payload, NULL) == 0);
+
+	i = 0;
+	list_for_each_entry(cmd, &cmdq.pending_commands, node) {
+		if (i < sizeof(cases) / sizeof(cases[0]))
+			CHECK(cmd->size_class == cases[i].size_class);
+		else
+			CHECK(cmd->size_class == 0);
+		i++;
+	}
+	CHECK(i == sizeof(cases) / sizeof(cases[0]) + 1);
+
+	inf_cmd_queue_fini(&cmdq);
+	CHECK(list_empty(&cmdq.pending_commands));
+
+	return 0;
+}
+
+static int test_opcode_exe(void)
+{
+	struct inf_cmd_queue cmdq;
+	uint32_t i, val;
+	char buf[64];
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+
+	/* 3 and 19 share an opcode list */
+	for (i = 0; i < 8; i++) {
+		val = i;
+		CHECK(inf_cmd_queue_add(&cmdq, i % 2 ? 3 : 3 + INF_CMD_QUEUE_OPCODE_LISTS,
+					&val, sizeof(val), NULL, NULL) == 0);
+	}
+	val = 100;
+	CHECK(inf_cmd_queue_add(&cmdq, 5, &val, sizeof(val), NULL, NULL) == 0);
+
+	s_exe_count = s_exe_sum = 0;
+	inf_cmd_queue_exe(&cmdq, 3, count_exe);
+	CHECK(s_exe_count == 4 && s_exe_sum == 1 + 3 + 5 + 7);
+
+	s_exe_count = s_exe_sum = 0;
+	inf_cmd_queue_exe(&cmdq, 5, count_exe);
+	CHECK(s_exe_count == 1 && s_exe_sum == 100);
+
+	s_exe_count = 0;
+	inf_cmd_queue_exe(&cmdq, 4, count_exe);
+	CHECK(s_exe_count == 0);
+
+	/* read unlinks from the opcode list as well */
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == HDR_SIZE + sizeof(val));
+	s_exe_count = s_exe_sum = 0;
+	inf_cmd_queue_exe(&cmdq, 3 + INF_CMD_QUEUE_OPCODE_LISTS, count_exe);
+	CHECK(s_exe_count == 3 && s_exe_sum == 2 + 4 + 6);
+
+	inf_cmd_queue_fini(&cmdq);
+
+	return 0;
+}
+
+static int test_read(void)
+{
+	struct inf_cmd_queue cmdq;
+	struct inf_cmd_header *hdr;
+	u8 args[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+	char buf[256];
+	uint32_t i;
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+
+	CHECK(inf_cmd_queue_add(&cmdq, 7, args, sizeof(args), NULL, NULL) == 0);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == HDR_SIZE + sizeof(args));
+	hdr = (struct inf_cmd_header *)buf;
+	CHECK(hdr->opcode == 7 && hdr->size == sizeof(args));
+	CHECK(memcmp(hdr + 1, args, sizeof(args)) == 0);
+	CHECK(cmdq.depth == 0);
+
+	/* header and args in separate reads */
+	CHECK(inf_cmd_queue_add(&cmdq, 8, args, sizeof(args), NULL, NULL) == 0);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, HDR_SIZE, NULL) == HDR_SIZE);
+	CHECK(cmdq.depth == 1);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, 5, NULL) == 5);
+	CHECK(inf_cmd_queue_read(&cmdq, buf + 5, sizeof(buf), NULL) == sizeof(args) - 5);
+	CHECK(memcmp(buf, args, sizeof(args)) == 0);
+	CHECK(cmdq.depth == 0);
+
+	/* payload read through the callback at the running offset */
+	CHECK(inf_cmd_queue_add(&cmdq, 9, NULL, 100, fill_payload, NULL) == 0);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, HDR_SIZE + 40, NULL) == HDR_SIZE + 40);
+	CHECK(inf_cmd_queue_read(&cmdq, buf + HDR_SIZE + 40, sizeof(buf), NULL) == 60);
+	for (i = 0; i < 100; i++)
+		CHECK(buf[HDR_SIZE + i] == (char)i);
+
+	/* too small for the header */
+	CHECK(inf_cmd_queue_add(&cmdq, 10, args, sizeof(args), NULL, NULL) == 0);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, HDR_SIZE - 1, NULL) == -1);
+	CHECK(cmdq.depth == 1);
+
+	inf_cmd_queue_hangup(&cmdq);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == -1);
+	CHECK(inf_cmd_queue_poll(&cmdq, NULL, NULL) & POLLIN);
+
+	inf_cmd_queue_fini(&cmdq);
+
+	return 0;
+}
+
+static int test_bulk_read(void)
+{
+	struct inf_cmd_queue cmdq;
+	struct inf_cmd_header *hdr;
+	uint64_t val;
+	char buf[256];
+	size_t one = HDR_SIZE + sizeof(val);
+	uint32_t i;
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+
+	for (i = 0; i < 4; i++) {
+		val = i;
+		CHECK(inf_cmd_queue_add(&cmdq, 1, &val, sizeof(val), NULL, NULL) == 0);
+	}
+
+	/* not set, one command per read */
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == one);
+
+	/* whole commands only, the one that does not fit stays */
+	inf_cmd_queue_set_bulk_read(&cmdq, true);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, 2 * one + one / 2, NULL) == 2 * one);
+	for (i = 0; i < 2; i++) {
+		hdr = (struct inf_cmd_header *)(buf + i * one);
+		CHECK(hdr->opcode == 1 && hdr->size == sizeof(val));
+		CHECK(*(uint64_t *)(hdr + 1) == i + 1);
+	}
+	CHECK(cmdq.depth == 1);
+
+	/* stops before a command with payload callback */
+	val = 4;
+	CHECK(inf_cmd_queue_add(&cmdq, 1, NULL, 16, fill_payload, NULL) == 0);
+	CHECK(inf_cmd_queue_add(&cmdq, 1, &val, sizeof(val), NULL, NULL) == 0);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == one);
+	CHECK(cmdq.depth == 2);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == HDR_SIZE + 16 + one);
+	CHECK(cmdq.depth == 0);
+
+	inf_cmd_queue_fini(&cmdq);
+
+	return 0;
+}
+
+static int test_stats(void)
+{
+	struct inf_cmd_queue cmdq;
+	struct timespec ts = { 0, 20 * 1000 * 1000 };
+	uint32_t depth, val = 0, i;
+	u64 age;
+	char buf[64];
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+
+	inf_cmd_queue_get_stats(&cmdq, &depth, &age);
+	CHECK(depth == 0 && age == 0);
+
+	for (i = 0; i < 5; i++)
+		CHECK(inf_cmd_queue_add(&cmdq, 1, &val, sizeof(val), NULL, NULL) == 0);
+	nanosleep(&ts, NULL);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) > 0);
+
+	inf_cmd_queue_get_stats(&cmdq, &depth, &age);
+	CHECK(depth == 4 && cmdq.max_depth == 5);
+	CHECK(age >= 20 * 1000);
+
+	inf_cmd_queue_fini(&cmdq);
+
+	return 0;
+}
+
+static int test_ring(void)
+{
+	struct inf_cmd_queue cmdq;
+	struct inf_ring_hdr *ring;
+	struct inf_ring_cpl *cpl_entries;
+	struct inf_ring_cpl cpl;
+	struct inf_cmd_header *hdr;
+	struct vm_area_struct vma = { 0 };
+	u8 args[1000] = { 0 };
+	uint32_t mmap_size, pos, cons, n_pad = 0, n_cmds = 0, i;
+	char buf[64];
+
+	memset(&cmdq, 0, sizeof(cmdq));
+	inf_cmd_queue_init(&cmdq);
+
+	vma.vm_end = INF_RING_MMAP_SIZE;
+	CHECK(inf_cmd_queue_ring_mmap(&cmdq, &vma) == -ENODEV);
+	CHECK(inf_cmd_queue_ring_setup(&cmdq, &mmap_size) == 0);
+	CHECK(mmap_size == INF_RING_MMAP_SIZE);
+	CHECK(inf_cmd_queue_ring_setup(&cmdq, &mmap_size) == -EBUSY);
+	CHECK(inf_cmd_queue_ring_mmap(&cmdq, &vma) == 0);
+	vma.vm_end = PAGE_SIZE;
+	CHECK(inf_cmd_queue_ring_mmap(&cmdq, &vma) == -EINVAL);
+
+	ring = cmdq.ring;
+	CHECK(ring->cmd_size == INF_RING_CMD_SIZE);
+	CHECK(ring->cpl_entries == INF_RING_CPL_ENTRIES);
+
+	/* goes to the ring, read() leaves it to the runtime */
+	CHECK(inf_cmd_queue_add(&cmdq, 2, args, 10, NULL, NULL) == 0);
+	CHECK(cmdq.depth == 0);
+	CHECK(ring->cmd_prod == ALIGN(HDR_SIZE + 10, INF_RING_ALIGN));
+	CHECK(inf_cmd_queue_poll(&cmdq, NULL, NULL) & POLLIN);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == -EAGAIN);
+
+	/* payload commands and everything after them go to the list */
+	CHECK(inf_cmd_queue_add(&cmdq, 3, NULL, 8, fill_payload, NULL) == 0);
+	CHECK(inf_cmd_queue_add(&cmdq, 2, args, 10, NULL, NULL) == 0);
+	CHECK(cmdq.depth == 2);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == -EAGAIN);
+
+	ring->cmd_cons = ring->cmd_prod;
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == HDR_SIZE + 8);
+	CHECK(inf_cmd_queue_read(&cmdq, buf, sizeof(buf), NULL) == HDR_SIZE + 10);
+	CHECK(cmdq.depth == 0);
+
+	/* consume as the runtime does, across the ring end */
+	cons = ring->cmd_cons;
+	for (i = 0; i < 3 * INF_RING_CMD_SIZE / sizeof(args); i++) {
+		CHECK(inf_cmd_queue_add(&cmdq, 4, args, sizeof(args), NULL, NULL) == 0);
+		CHECK(cmdq.depth == 0);
+		while (cons != ring->cmd_prod) {
+			pos = cons % INF_RING_CMD_SIZE;
+			hdr = (struct inf_cmd_header *)((u8 *)ring + INF_RING_CMD_OFFSET + pos);
+			if (hdr->opcode == INF_RING_OPCODE_PAD) {
+				CHECK(pos + HDR_SIZE + hdr->size == INF_RING_CMD_SIZE);
+				n_pad++;
+			} else {
+				CHECK(hdr->opcode == 4 && hdr->size == sizeof(args));
+				CHECK(pos + HDR_SIZE + hdr->size <= INF_RING_CMD_SIZE);
+				n_cmds++;
+			}
+			cons += ALIGN(HDR_SIZE + hdr->size, INF_RING_ALIGN);
+		}
+		ring->cmd_cons = cons;
+	}
+	CHECK(n_cmds == i && n_pad >= 2);
+
+	/* full ring falls back to the list */
+	for (i = 0; i < INF_RING_CMD_SIZE / sizeof(args) + 1; i++)
+		CHECK(inf_cmd_queue_add(&cmdq, 4, args, sizeof(args), NULL, NULL) == 0);
+	CHECK(cmdq.depth > 0);
+	CHECK(ring->cmd_prod - ring->cmd_cons <= INF_RING_CMD_SIZE);
+
+	/* completions */
+	cpl_entries = (struct inf_ring_cpl *)((u8 *)ring + INF_RING_CPL_OFFSET);
+	mutex_lock(&cmdq.ring_cpl_lock);
+	CHECK(!inf_cmd_queue_ring_cpl_pop(&cmdq, &cpl));
+	for (i = 0; i < INF_RING_CPL_ENTRIES + 10; i++) {
+		cpl_entries[i % INF_RING_CPL_ENTRIES].infreq_drv_handle = i;
+		smp_store_release(&ring->cpl_prod, i + 1);
+		CHECK(inf_cmd_queue_ring_cpl_pop(&cmdq, &cpl));
+		CHECK(cpl.infreq_drv_handle == i);
+		CHECK(ring->cpl_cons == i + 1);
+	}
+	CHECK(!inf_cmd_queue_ring_cpl_pop(&cmdq, &cpl));
+
+	/* runtime index beyond the ring is ignored */
+	ring->cpl_prod = ring->cpl_cons + INF_RING_CPL_ENTRIES + 1;
+	CHECK(!inf_cmd_queue_ring_cpl_pop(&cmdq, &cpl));
+	mutex_unlock(&cmdq.ring_cpl_lock);
+
+	inf_cmd_queue_fini(&cmdq);
+	CHECK(cmdq.ring == NULL);
+
+	return 0;
+}
+
+static int test_ring_bench(uint32_t num_cmds)
+{
+	struct inode inode = { 0 };
+	struct file filp = { 0 };
+	char cmd[16], buf[256];
+	loff_t pos = 0;
+	ssize_t n;
+
+	snprintf(cmd, sizeof(cmd), "%u\n", num_cmds);
+	CHECK(ring_bench_fops.write(&filp, cmd, strlen(cmd), &pos) == strlen(cmd));
+	CHECK(s_ring_bench_res.err == 0);
+	CHECK(s_ring_bench_res.num_cmds == num_cmds);
+
+	CHECK(ring_bench_fops.open(&inode, &filp) == 0);
+	n = ring_bench_fops.read(&filp, buf, sizeof(buf) - 1, &pos);
+	ring_bench_fops.release(&inode, &filp);
+	CHECK(n > 0);
+	buf[n] = '\0';
+	printf("%s", buf);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t bench_cmds = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+	int failed = 0;
+
+	if (inf_cmd_queue_caches_init() != 0)
+		return 1;
+
+#define RUN(t) do { \
+		int r = (t); \
+		printf("%-20s %s\n", #t, r == 0 ? "PASS" : "FAIL"); \
+		failed |= r; \
+	} while (0)
+
+	RUN(test_size_classes());
+	RUN(test_opcode_exe());
+	RUN(test_read());
+	RUN(test_bulk_read());
+	RUN(test_stats());
+	RUN(test_ring());
+	if (bench_cmds > 0)
+		RUN(test_ring_bench(bench_cmds));
+
+	inf_cmd_queue_caches_fini();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,789 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Minimal kernel API for building card driver sources in userspace, used
+ * by the ring3 Makefiles of sph_cs, sph_power_balancer and
+ * sph_memory_allocator. The linux/ and asm/ headers of this directory all
+ * include this file.
+ *
+ * spinlocks and mutexes are pthread mutexes, a wait queue is a pthread
+ * condition and kthreads are pthreads. wait_event* re-checks its condition
+ * every WAITQ_POLL_MS as well, since kthread_stop does not know which
+ * queue the thread sleeps on. cpus, per cpu data, jiffies and timers are
+ * simulated on a single thread, see kmock_sys.
+ */
+
+#ifndef _SPHCS_KERNEL_MOCK_H
+#define _SPHCS_KERNEL_MOCK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+typedef int64_t  s64;
+typedef int64_t  time64_t;
+typedef unsigned int gfp_t;
+typedef uint64_t phys_addr_t;
+
+#define U64_MAX  UINT64_MAX
+#define S64_MAX  INT64_MAX
+
+#define __user
+#define __iomem
+
+#define GFP_KERNEL  0
+#define GFP_NOWAIT  0
+#define GFP_ATOMIC  0
+
+#define PAGE_SIZE      4096UL
+#define ALIGN(x, a)    (((x) + ((a) - 1)) & ~((__typeof__(x))(a) - 1))
+#define PAGE_ALIGN(x)  ALIGN(x, PAGE_SIZE)
+
+#define HZ            1000
+#define USEC_PER_SEC  1000000ULL
+#define NSEC_PER_SEC  1000000000L
+
+#define likely(x)    __builtin_expect(!!(x), 1)
+#define unlikely(x)  __builtin_expect(!!(x), 0)
+
+#define min(a, b)  ((a) < (b) ? (a) : (b))
+#define max(a, b)  ((a) > (b) ? (a) : (b))
+#define ARRAY_SIZE(a)  (sizeof(a) / sizeof((a)[0]))
+#define DIV_ROUND_UP(n, d)  (((n) + (d) - 1) / (d))
+#define min_t(type, a, b)  min((type)(a), (type)(b))
+#define max_t(type, a, b)  max((type)(a), (type)(b))
+
+#define mult_frac(x, numer, denom)				\
+	({							\
+		__typeof__(x) __q = (x) / (denom);		\
+		__typeof__(x) __r = (x) % (denom);		\
+		(__q * (numer)) + ((__r * (numer)) / (denom));	\
+	})
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define READ_ONCE(x)      (*(const volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, v)  (*(volatile __typeof__(x) *)&(x) = (v))
+#define smp_mb()                   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define wmb()                      asm volatile("sfence" ::: "memory")
+#define smp_store_release(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define smp_load_acquire(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+
+#define MAX_ERRNO  4095
+#define IS_ERR(p)   ((unsigned long)(p) >= (unsigned long)-MAX_ERRNO)
+#define IS_ERR_OR_NULL(p)  (!(p) || IS_ERR(p))
+#define PTR_ERR(p)  ((long)(p))
+#define ERR_PTR(e)  ((void *)(long)(e))
+
+#define pr_err(fmt, ...)    fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...)   fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)   fprintf(stdout, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...)  do { } while (0)
+#define BUG()               abort()
+
+/* strings equal up to a trailing newline of either */
+static inline bool sysfs_streq(const char *s1, const char *s2)
+{
+	while (*s1 && *s1 == *s2) {
+		s1++;
+		s2++;
+	}
+
+	if (*s1 == *s2)
+		return true;
+	if (!*s1 && *s2 == '\n' && !s2[1])
+		return true;
+	if (*s1 == '\n' && !s1[1] && !*s2)
+		return true;
+
+	return false;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+	return dividend / divisor;
+}
+
+/* atomics */
+typedef struct {
+	s64 counter;
+} atomic64_t;
+
+#define atomic64_read(v)        __atomic_load_n(&(v)->counter, __ATOMIC_RELAXED)
+#define atomic64_set(v, i)      __atomic_store_n(&(v)->counter, (i), __ATOMIC_RELAXED)
+#define atomic64_inc_return(v)  __atomic_add_fetch(&(v)->counter, 1, __ATOMIC_SEQ_CST)
+
+static inline s64 atomic64_cmpxchg(atomic64_t *v, s64 old, s64 new)
+{
+	__atomic_compare_exchange_n(&v->counter, &old, new, false,
+				    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return old;
+}
+
+/* userspace may use the FPU anywhere */
+#define kernel_fpu_begin()  do { } while (0)
+#define kernel_fpu_end()    do { } while (0)
+
+/* time */
+struct timespec64 {
+	time64_t tv_sec;
+	long     tv_nsec;
+};
+
+static inline void ktime_get_real_ts64(struct timespec64 *ts)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_REALTIME, &t);
+	ts->tv_sec = t.tv_sec;
+	ts->tv_nsec = t.tv_nsec;
+}
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void list_add_tail(struct list_head *entry, struct list_head *head)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return READ_ONCE(head->next) == head;
+}
+
+#define list_entry(ptr, type, member)  container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+	list_entry((ptr)->next, type, member)
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, __typeof__(*(pos)), member)
+#define list_for_each_entry(pos, head, member)			\
+	for (pos = list_first_entry(head, __typeof__(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_next_entry(pos, member))
+
+/* locks */
+typedef struct {
+	pthread_mutex_t m;
+} spinlock_t;
+
+#define spin_lock_init(l)  pthread_mutex_init(&(l)->m, NULL)
+#define spin_lock(l)       pthread_mutex_lock(&(l)->m)
+#define spin_unlock(l)     pthread_mutex_unlock(&(l)->m)
+#define spin_lock_bh(l)    spin_lock(l)
+#define spin_unlock_bh(l)  spin_unlock(l)
+#define spin_lock_irqsave(l, f) \
+	do { pthread_mutex_lock(&(l)->m); (f) = 0; } while (0)
+#define spin_unlock_irqrestore(l, f) \
+	do { pthread_mutex_unlock(&(l)->m); (void)(f); } while (0)
+
+struct mutex {
+	pthread_mutex_t m;
+};
+
+#define DEFINE_MUTEX(name)  struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+#define mutex_init(l)       pthread_mutex_init(&(l)->m, NULL)
+#define mutex_lock(l)       pthread_mutex_lock(&(l)->m)
+#define mutex_unlock(l)     pthread_mutex_unlock(&(l)->m)
+
+/* wait queues */
+#define WAITQ_POLL_MS  10
+
+typedef struct {
+	pthread_mutex_t m;
+	pthread_cond_t  c;
+} wait_queue_head_t;
+
+static inline void init_waitqueue_head(wait_queue_head_t *wq)
+{
+	pthread_mutex_init(&wq->m, NULL);
+	pthread_cond_init(&wq->c, NULL);
+}
+
+/* wakers change the condition before taking wq->m, so no wakeup is lost */
+static inline void wake_up_all(wait_queue_head_t *wq)
+{
+	pthread_mutex_lock(&wq->m);
+	pthread_cond_broadcast(&wq->c);
+	pthread_mutex_unlock(&wq->m);
+}
+
+#define wake_up(wq)  wake_up_all(wq)
+
+static inline void __timespec_add_ms(struct timespec *ts, long ms)
+{
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= NSEC_PER_SEC) {
+		ts->tv_sec++;
+		ts->tv_nsec -= NSEC_PER_SEC;
+	}
+}
+
+/* sleeps at most WAITQ_POLL_MS, called with wq->m held */
+static inline void __waitq_sleep(wait_queue_head_t *wq)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	__timespec_add_ms(&ts, WAITQ_POLL_MS);
+	pthread_cond_timedwait(&wq->c, &wq->m, &ts);
+}
+
+#define wait_event(wq, condition)				\
+	do {							\
+		pthread_mutex_lock(&(wq).m);			\
+		while (!(condition))				\
+			__waitq_sleep(&(wq));			\
+		pthread_mutex_unlock(&(wq).m);			\
+	} while (0)
+
+#define wait_event_interruptible(wq, condition)		\
+	({ wait_event(wq, condition); 0; })
+
+/* timeout in jiffies, which are ms here */
+#define wait_event_timeout(wq, condition, timeout)		\
+	({							\
+		struct timespec __end, __now;			\
+		long __left = (timeout);			\
+								\
+		clock_gettime(CLOCK_REALTIME, &__end);		\
+		__timespec_add_ms(&__end, __left);		\
+		pthread_mutex_lock(&(wq).m);			\
+		while (!(condition)) {				\
+			__waitq_sleep(&(wq));			\
+			clock_gettime(CLOCK_REALTIME, &__now);	\
+			if (__now.tv_sec > __end.tv_sec ||	\
+			    (__now.tv_sec == __end.tv_sec &&	\
+			     __now.tv_nsec >= __end.tv_nsec)) {	\
+				__left = (condition) ? 1 : 0;	\
+				break;				\
+			}					\
+		}						\
+		pthread_mutex_unlock(&(wq).m);			\
+		__left;						\
+	})
+
+/* kthreads */
+struct task_struct {
+	pthread_t  thread;
+	int      (*fn)(void *data);
+	void      *data;
+	int        should_stop;
+	int        ret;
+};
+
+extern __thread struct task_struct *kmock_current;
+
+static inline void *__kthread_main(void *arg)
+{
+	struct task_struct *t = (struct task_struct *)arg;
+
+	kmock_current = t;
+	t->ret = t->fn(t->data);
+
+	return NULL;
+}
+
+static inline struct task_struct *kthread_run(int (*fn)(void *data),
+					      void *data,
+					      const char *name, ...)
+{
+	struct task_struct *t = calloc(1, sizeof(*t));
+
+	if (t == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	t->fn = fn;
+	t->data = data;
+	if (pthread_create(&t->thread, NULL, __kthread_main, t) != 0) {
+		free(t);
+		return ERR_PTR(-EAGAIN);
+	}
+
+	return t;
+}
+
+static inline bool kthread_should_stop(void)
+{
+	return __atomic_load_n(&kmock_current->should_stop, __ATOMIC_ACQUIRE);
+}
+
+static inline int kthread_stop(struct task_struct *t)
+{
+	int ret;
+
+	__atomic_store_n(&t->should_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(t->thread, NULL);
+	ret = t->ret;
+	free(t);
+
+	return ret;
+}
+
+/* memory */
+struct kmem_cache {
+	size_t size;
+};
+
+static inline struct kmem_cache *kmem_cache_create(const char *name,
+						   size_t size,
+						   size_t align,
+						   unsigned long flags,
+						   void (*ctor)(void *))
+{
+	struct kmem_cache *c = malloc(sizeof(*c));
+
+	if (c != NULL)
+		c->size = size;
+
+	return c;
+}
+
+static inline void kmem_cache_destroy(struct kmem_cache *c)
+{
+	free(c);
+}
+
+static inline void *kmem_cache_alloc(struct kmem_cache *c, gfp_t flags)
+{
+	return malloc(c->size);
+}
+
+static inline void kmem_cache_free(struct kmem_cache *c, void *p)
+{
+	free(p);
+}
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	return calloc(1, size);
+}
+
+static inline void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+static inline void *vmalloc_user(unsigned long size)
+{
+	void *p = aligned_alloc(PAGE_SIZE, PAGE_ALIGN(size));
+
+	if (p != NULL)
+		memset(p, 0, PAGE_ALIGN(size));
+
+	return p;
+}
+
+static inline void vfree(const void *p)
+{
+	free((void *)p);
+}
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+};
+
+static inline int remap_vmalloc_range(struct vm_area_struct *vma,
+				      void *addr,
+				      unsigned long pgoff)
+{
+	return 0;
+}
+
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+					 unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long copy_from_user(void *to, const void __user *from,
+					   unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline int kstrtouint_from_user(const char __user *s, size_t count,
+				       unsigned int base, unsigned int *res)
+{
+	char buf[16];
+	char *end;
+
+	if (count == 0 || count >= sizeof(buf))
+		return -EINVAL;
+	memcpy(buf, s, count);
+	buf[count] = '\0';
+
+	errno = 0;
+	*res = strtoul(buf, &end, base);
+	if (errno != 0 || end == buf || (*end != '\0' && *end != '\n'))
+		return -EINVAL;
+
+	return 0;
+}
+
+/* files, seq_file and debugfs */
+struct dentry;
+
+struct inode {
+	void *i_private;
+};
+
+struct file {
+	void *private_data;
+};
+
+struct poll_table_struct;
+
+static inline void poll_wait(struct file *f, wait_queue_head_t *wq,
+			     struct poll_table_struct *pt)
+{
+}
+
+struct file_operations {
+	int     (*open)(struct inode *inode, struct file *filp);
+	ssize_t (*read)(struct file *filp, char __user *buf, size_t count,
+			loff_t *pos);
+	ssize_t (*write)(struct file *filp, const char __user *buf,
+			 size_t count, loff_t *pos);
+	loff_t  (*llseek)(struct file *filp, loff_t off, int whence);
+	int     (*release)(struct inode *inode, struct file *filp);
+};
+
+#define SEQ_MOCK_BUF_SIZE  4096
+
+struct seq_file {
+	char   buf[SEQ_MOCK_BUF_SIZE];
+	size_t count;
+	int  (*show)(struct seq_file *m, void *v);
+	void  *private;
+};
+
+static inline void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = vsnprintf(m->buf + m->count, sizeof(m->buf) - m->count, fmt, args);
+	va_end(args);
+	if (n > 0)
+		m->count = min(m->count + n, sizeof(m->buf) - 1);
+}
+
+static inline void seq_puts(struct seq_file *m, const char *s)
+{
+	seq_printf(m, "%s", s);
+}
+
+static inline int single_open(struct file *filp,
+			      int (*show)(struct seq_file *m, void *v),
+			      void *data)
+{
+	struct seq_file *m = calloc(1, sizeof(*m));
+
+	if (m == NULL)
+		return -ENOMEM;
+
+	m->show = show;
+	m->private = data;
+	filp->private_data = m;
+
+	return 0;
+}
+
+static inline int single_release(struct inode *inode, struct file *filp)
+{
+	free(filp->private_data);
+	filp->private_data = NULL;
+
+	return 0;
+}
+
+static inline ssize_t seq_read(struct file *filp, char __user *buf,
+			       size_t count, loff_t *pos)
+{
+	struct seq_file *m = (struct seq_file *)filp->private_data;
+	size_t n;
+	int ret;
+
+	if (*pos == 0) {
+		m->count = 0;
+		ret = m->show(m, NULL);
+		if (ret < 0)
+			return ret;
+	}
+
+	if ((size_t)*pos >= m->count)
+		return 0;
+
+	n = min(count, m->count - (size_t)*pos);
+	memcpy(buf, m->buf + *pos, n);
+	*pos += n;
+
+	return n;
+}
+
+static inline loff_t seq_lseek(struct file *filp, loff_t off, int whence)
+{
+	return off;
+}
+
+static inline struct dentry *debugfs_create_file(const char *name,
+						 unsigned short mode,
+						 struct dentry *parent,
+						 void *data,
+						 const struct file_operations *fops)
+{
+	return NULL;
+}
+
+static inline struct dentry *debugfs_create_dir(const char *name,
+						struct dentry *parent)
+{
+	return NULL;
+}
+
+static inline void debugfs_create_u32(const char *name,
+				      unsigned short mode,
+				      struct dentry *parent,
+				      u32 *value)
+{
+}
+
+static inline void debugfs_remove_recursive(struct dentry *dentry)
+{
+}
+
+/*
+ * cpus, jiffies and timers are simulated, the test defines kmock_sys and
+ * moves time with kmock_run_timers, which fires the expired timers on the
+ * cpu they were added on. Code runs on kmock_sys.cpu.
+ */
+#define KMOCK_NR_CPUS  8
+
+struct kmock_sys {
+	unsigned long ticks;
+	unsigned int cpu;
+	unsigned int tsc_khz;
+	struct list_head timers;
+	int (*cpuhp_offline)(unsigned int cpu);
+};
+
+extern struct kmock_sys kmock_sys;
+
+#define jiffies                    (kmock_sys.ticks)
+#define cpu_khz                    (kmock_sys.tsc_khz)
+#define msecs_to_jiffies(ms)       ((unsigned long)(ms))
+#define time_after(a, b)           ((long)((b) - (a)) < 0)
+#define time_after_eq(a, b)        ((long)((a) - (b)) >= 0)
+
+#define raw_smp_processor_id()     (kmock_sys.cpu)
+#define smp_processor_id()         (kmock_sys.cpu)
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < KMOCK_NR_CPUS; (cpu)++)
+#define for_each_online_cpu(cpu)   for_each_possible_cpu(cpu)
+
+#define DEFINE_PER_CPU(type, name) __typeof__(type) name[KMOCK_NR_CPUS]
+#define per_cpu_ptr(ptr, cpu)      (&(*(ptr))[cpu])
+
+#define local_irq_save(flags)      do { (flags) = 0; } while (0)
+#define local_irq_restore(flags)   do { (void)(flags); } while (0)
+#define local_bh_disable()         do { } while (0)
+#define local_bh_enable()          do { } while (0)
+
+#define MSR_IA32_MPERF  0x000000e7
+#define MSR_IA32_APERF  0x000000e8
+
+typedef struct {
+	unsigned int sequence;
+} seqcount_t;
+
+#define seqcount_init(s)  ((s)->sequence = 0)
+
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int read_seqcount_begin(const seqcount_t *s)
+{
+	unsigned int seq;
+
+	while ((seq = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE)) & 1)
+		;
+
+	return seq;
+}
+
+static inline int read_seqcount_retry(const seqcount_t *s, unsigned int seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(&s->sequence, __ATOMIC_RELAXED) != seq;
+}
+
+#define TIMER_DEFERRABLE  0x1
+#define TIMER_PINNED      0x2
+
+struct timer_list {
+	struct list_head entry;
+	unsigned long expires;
+	void (*function)(struct timer_list *timer);
+	unsigned int cpu;
+	bool pending;
+};
+
+#define from_timer(var, timer, field) \
+	container_of(timer, __typeof__(*var), field)
+
+static inline void timer_setup(struct timer_list *timer,
+			       void (*function)(struct timer_list *timer),
+			       unsigned int flags)
+{
+	memset(timer, 0, sizeof(*timer));
+	INIT_LIST_HEAD(&timer->entry);
+	timer->function = function;
+}
+
+static inline void add_timer_on(struct timer_list *timer, unsigned int cpu)
+{
+	timer->cpu = cpu;
+	timer->pending = true;
+	list_add_tail(&timer->entry, &kmock_sys.timers);
+}
+
+/* pinned - the timer stays on the cpu it runs on */
+static inline int mod_timer(struct timer_list *timer, unsigned long expires)
+{
+	bool pending = timer->pending;
+
+	timer->expires = expires;
+	if (!pending)
+		add_timer_on(timer, kmock_sys.cpu);
+
+	return pending;
+}
+
+static inline int del_timer_sync(struct timer_list *timer)
+{
+	bool pending = timer->pending;
+
+	if (pending) {
+		list_del(&timer->entry);
+		timer->pending = false;
+	}
+
+	return pending;
+}
+
+/* advance jiffies to now, firing timers which expire on the way in order */
+static inline void kmock_run_timers(unsigned long now)
+{
+	struct timer_list *timer, *next;
+	unsigned int cpu = kmock_sys.cpu;
+
+	for (;;) {
+		next = NULL;
+		list_for_each_entry(timer, &kmock_sys.timers, entry)
+			if (time_after_eq(now, timer->expires) &&
+			    (next == NULL || time_after(next->expires, timer->expires)))
+				next = timer;
+		if (next == NULL)
+			break;
+
+		if (time_after(next->expires, jiffies))
+			jiffies = next->expires;
+		del_timer_sync(next);
+		kmock_sys.cpu = next->cpu;
+		next->function(next);
+	}
+
+	jiffies = now;
+	kmock_sys.cpu = cpu;
+}
+
+/* cpus are all online, the online callback runs on each of them */
+enum cpuhp_state {
+	CPUHP_AP_ONLINE_DYN = 1,
+};
+
+static inline int cpuhp_setup_state(enum cpuhp_state state,
+				    const char *name,
+				    int (*online)(unsigned int cpu),
+				    int (*offline)(unsigned int cpu))
+{
+	unsigned int cpu, curr = kmock_sys.cpu;
+	int ret;
+
+	for_each_possible_cpu(cpu) {
+		kmock_sys.cpu = cpu;
+		ret = online(cpu);
+		if (ret < 0)
+			break;
+	}
+	kmock_sys.cpu = curr;
+	kmock_sys.cpuhp_offline = offline;
+
+	return ret < 0 ? ret : state;
+}
+
+static inline void cpuhp_remove_state(enum cpuhp_state state)
+{
+	unsigned int cpu, curr = kmock_sys.cpu;
+
+	for_each_possible_cpu(cpu) {
+		kmock_sys.cpu = cpu;
+		kmock_sys.cpuhp_offline(cpu);
+	}
+	kmock_sys.cpu = curr;
+}
+
+#endif
@@ -41,7 +41,23 @@ void IPC_OPCODE_HANDLER(CHAN_ETH_MSG_DSCR)(struct sphcs              *sphcs,
 #include <linux/netdevice.h>
 #include <linux/version.h>
 #include <linux/kmod.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/u64_stats_sync.h>
+#ifdef ULT
+#include <linux/jhash.h>
+#endif
 #include "sph_safe.h"
+#include "nnp_time.h"
+
+/* maximum number of tx/rx queues of the network device */
+#define SPHCS_NET_MAX_QUEUES 4
+#define SPHCS_NET_NAPI_WEIGHT 64
+/* max skbs of a tx queue sent to the host by one scatter-gather dma */
+#define SPHCS_NET_TX_BATCH 16
+/* max received packets waiting for the NAPI poll of a queue */
+#define SPHCS_NET_RX_BACKLOG 1024
 
 struct net_dma_command_data {
 	void *vptr;
@@ -53,6 +69,77 @@ struct net_dma_command_data {
 	dma_addr_t host_dma_addr;
 	u32 xfer_size;
 	int host_skb_handle;
+	bool loopback;
+};
+
+/*
+ * Transmit descriptor of a single skb,
+ * the linear part and each fragment are mapped separately
+ * and gathered into the host slot.
+ */
+struct net_tx_desc {
+	struct sk_buff *skb;
+	int host_skb_handle;
+	u32 n_maps;
+	struct {
+		dma_addr_t addr;
+		u32        size;
+		bool       is_page;
+	} maps[MAX_SKB_FRAGS + 1];
+	struct scatterlist src_sgl[MAX_SKB_FRAGS + 1];
+	struct scatterlist dst_sgl;
+	struct sg_table    src_sgt;
+	struct sg_table    dst_sgt;
+};
+
+/*
+ * skbs of a tx queue sent by a single dma,
+ * started when the stack has no more packets for the queue.
+ */
+struct net_tx_batch {
+	struct list_head       node;
+	struct sphcs_net_txq  *txq;
+	struct sphcs_cmd_chan *chan;
+	struct lli_desc        lli;
+	u32                    lli_alloc_size;
+	struct sphcs_dma_multi_xfer_handle multi_xfer_handle;
+	u32                    n;
+	u32                    iter;
+	u32                    bytes;
+	struct net_tx_desc    *desc[SPHCS_NET_TX_BATCH];
+};
+
+/* per queue counters, packets and bytes have a single writer */
+struct sphcs_net_stats {
+	struct u64_stats_sync syncp;
+	u64                   packets;
+	u64                   bytes;
+	atomic_long_t         dropped;
+	atomic_long_t         errors;
+};
+
+/*
+ * Each tx queue owns a contiguous range of the c2h ring buffer
+ * slots, so queues do not contend on slot allocation.
+ */
+struct sphcs_net_txq {
+	spinlock_t     lock_bh;
+	unsigned long *busy_map;
+	int            first_handle;
+	int            n_handles;
+	int            n_busy;
+	int            next_hint;
+	/* batch being filled, touched only by xmit */
+	struct net_tx_batch *batch;
+	struct list_head     free_batches;
+	struct sphcs_net_stats stats;
+};
+
+/* received packets are spread over the rx queues by flow hash */
+struct sphcs_net_rxq {
+	struct napi_struct  napi;
+	struct sk_buff_head queue;
+	struct sphcs_net_stats stats;
 };
 
 /*************************************************************************/
@@ -65,11 +152,120 @@ static int s_dev_id = -1;
 static unsigned char s_mac_addr[ETH_ALEN];
 static pool_handle   s_net_dma_page_pool;
 static int           s_c2h_handles;
-static uint8_t      *s_c2h_busy_handles;
+static unsigned int  s_num_queues;
+static struct sphcs_net_txq s_txq[SPHCS_NET_MAX_QUEUES];
+static struct sphcs_net_rxq s_rxq[SPHCS_NET_MAX_QUEUES];
+static struct dentry       *s_debugfs_status;
 
-static struct net_device_stats *sphcs_net_dev_get_stats(struct net_device *dev)
+/* used by the status debugfs file to report packet rates */
+static u64 s_stat_time_us;
+static u64 s_stat_tx_packets;
+static u64 s_stat_rx_packets;
+
+static void sphcs_net_stats_init(struct sphcs_net_stats *stats)
+{
+	u64_stats_init(&stats->syncp);
+	stats->packets = 0;
+	stats->bytes = 0;
+	atomic_long_set(&stats->dropped, 0);
+	atomic_long_set(&stats->errors, 0);
+}
+
+static void sphcs_net_stats_add(struct sphcs_net_stats *stats, u32 packets, u64 bytes)
 {
-	return &dev->stats;
+	u64_stats_update_begin(&stats->syncp);
+	stats->packets += packets;
+	stats->bytes += bytes;
+	u64_stats_update_end(&stats->syncp);
+}
+
+static void sphcs_net_stats_read(struct sphcs_net_stats *stats, u64 *packets, u64 *bytes)
+{
+	unsigned int start;
+
+	do {
+		start = u64_stats_fetch_begin(&stats->syncp);
+		*packets = stats->packets;
+		*bytes = stats->bytes;
+	} while (u64_stats_fetch_retry(&stats->syncp, start));
+}
+
+static inline struct sphcs_net_txq *handle_to_txq(int c2h_skb_handle)
+{
+	unsigned int q = c2h_skb_handle / s_txq[0].n_handles;
+
+	return &s_txq[min(q, s_num_queues - 1)];
+}
+
+/*
+ * Allocates a free c2h ring buffer slot for tx queue qidx.
+ * stops the queue when its last slot is taken.
+ */
+static int sphcs_net_get_c2h_handle(struct net_device *netdev, u16 qidx)
+{
+	struct sphcs_net_txq *txq = &s_txq[qidx];
+	int idx;
+
+	NNP_SPIN_LOCK_BH(&txq->lock_bh);
+	idx = find_next_zero_bit(txq->busy_map, txq->n_handles, txq->next_hint);
+	if (idx >= txq->n_handles)
+		idx = find_first_zero_bit(txq->busy_map, txq->n_handles);
+	if (idx >= txq->n_handles) {
+		NNP_SPIN_UNLOCK_BH(&txq->lock_bh);
+		return -1;
+	}
+	__set_bit(idx, txq->busy_map);
+	txq->next_hint = idx + 1;
+	if (++txq->n_busy == txq->n_handles)
+		netif_stop_subqueue(netdev, qidx);
+	NNP_SPIN_UNLOCK_BH(&txq->lock_bh);
+
+	return txq->first_handle + idx;
+}
+
+static void sphcs_net_put_c2h_handle(int c2h_skb_handle)
+{
+	struct sphcs_net_txq *txq;
+
+	if (s_net_dev == NULL || c2h_skb_handle < 0 || c2h_skb_handle >= s_c2h_handles)
+		return;
+
+	txq = handle_to_txq(c2h_skb_handle);
+	NNP_SPIN_LOCK_BH(&txq->lock_bh);
+	if (__test_and_clear_bit(c2h_skb_handle - txq->first_handle, txq->busy_map)) {
+		if (txq->n_busy-- == txq->n_handles)
+			netif_wake_subqueue(s_net_dev, txq - s_txq);
+	}
+	NNP_SPIN_UNLOCK_BH(&txq->lock_bh);
+}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)) /* SPH_IGNORE_STYLE_CHECK */
+static void sphcs_net_dev_get_stats64(struct net_device *dev,
+				      struct rtnl_link_stats64 *stats)
+#else
+static struct rtnl_link_stats64 *sphcs_net_dev_get_stats64(struct net_device *dev,
+							   struct rtnl_link_stats64 *stats)
+#endif
+{
+	u64 packets, bytes;
+	unsigned int q;
+
+	for (q = 0; q < s_num_queues; q++) {
+		sphcs_net_stats_read(&s_txq[q].stats, &packets, &bytes);
+		stats->tx_packets += packets;
+		stats->tx_bytes += bytes;
+		stats->tx_dropped += atomic_long_read(&s_txq[q].stats.dropped);
+		stats->tx_errors += atomic_long_read(&s_txq[q].stats.errors);
+
+		sphcs_net_stats_read(&s_rxq[q].stats, &packets, &bytes);
+		stats->rx_packets += packets;
+		stats->rx_bytes += bytes;
+		stats->rx_dropped += atomic_long_read(&s_rxq[q].stats.dropped);
+	}
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0)) /* SPH_IGNORE_STYLE_CHECK */
+
+	return stats;
+#endif
 }
 
 static int sphcs_net_dev_config(struct net_device *dev, struct ifmap *map)
@@ -93,16 +289,27 @@ static int sphcs_net_dev_change_mtu(struct net_device *dev, int new_mtu)
 
 static int sphcs_net_dev_open(struct net_device *dev)
 {
+	unsigned int q;
+
 	sph_log_debug(ETH_LOG, "SPH_NET - sphcs_net_dev_open(%s)\n", dev->name);
 
-	netif_start_queue(dev); //start up the transmission queue
+
+	for (q = 0; q < s_num_queues; q++)
+		napi_enable(&s_rxq[q].napi);
+	netif_tx_start_all_queues(dev); //start up the transmission queues
 	return 0;
 }
 
 static int sphcs_net_dev_close(struct net_device *dev)
 {
+	unsigned int q;
+
 	sph_log_debug(ETH_LOG, "SPH_NET - sphcs_net_dev_close(%s)\n", dev->name);
-	netif_stop_queue(dev); //shutdown the transmission queue
+	netif_tx_stop_all_queues(dev); //shutdown the transmission queues
+	for (q = 0; q < s_num_queues; q++) {
+		napi_disable(&s_rxq[q].napi);
+		skb_queue_purge(&s_rxq[q].queue);
+	}
 	return 0;
 }
 
@@ -113,135 +320,396 @@ static int sphcs_net_dev_do_ioctl(struct net_device *dev, struct ifreq *ifr,
 	return -1;
 }
 
-static int sphcs_net_out_msg_dma_complete_callback(struct sphcs *sphcs,
-						   void *ctx,
-						   const void *user_data,
-						   int status,
-						   u32 xferTimeUS)
+static void sphcs_net_tx_desc_unmap(struct net_tx_desc *desc)
+{
+	u32 i;
+
+	for (i = 0; i < desc->n_maps; i++) {
+		if (desc->maps[i].is_page)
+			dma_unmap_page(g_the_sphcs->hw_device,
+				       desc->maps[i].addr,
+				       desc->maps[i].size,
+				       DMA_TO_DEVICE);
+		else
+			dma_unmap_single(g_the_sphcs->hw_device,
+					 desc->maps[i].addr,
+					 desc->maps[i].size,
+					 DMA_TO_DEVICE);
+	}
+}
+
+#ifdef ULT
+static bool sphcs_net_loopback_tx_done(struct sphcs_cmd_chan *chan,
+				       struct net_tx_desc    *desc);
+#endif
+
+static void sphcs_net_tx_notify_host(struct sphcs_cmd_chan *chan,
+				     struct net_tx_desc    *desc)
 {
-	void *skb_data;
-	u32 skb_size_aligned;
-	u32 skb_data_offset;
-	struct net_dma_command_data *dma_data = (struct net_dma_command_data *)user_data;
 	union c2h_ChanEthernetMsgDscr msg;
 
 	msg.value = 0;
 	msg.opcode = NNP_IPC_C2H_OP_CHAN_ETH_MSG_DSCR;
-	msg.chan_id = dma_data->chan->protocol_id;
-	msg.size = dma_data->xfer_size - 1;
-	msg.skb_handle = dma_data->host_skb_handle;
+	msg.chan_id = chan->protocol_id;
+	msg.size = desc->skb->len - 1;
+	msg.skb_handle = desc->host_skb_handle;
 
-	sphcs_msg_scheduler_queue_add_msg(dma_data->chan->respq,
+	sphcs_msg_scheduler_queue_add_msg(chan->respq,
 					(u64 *)&msg.value,
 					sizeof(msg) / sizeof(u64));
+}
 
-	skb_data = dma_data->skb;
-	skb_data_offset = (uintptr_t)skb_data & 0x7F;
-	skb_size_aligned = ALIGN(dma_data->xfer_size+skb_data_offset, 0x80);
-	dma_unmap_single(g_the_sphcs->hw_device, dma_data->card_dma_addr, skb_size_aligned, DMA_TO_DEVICE);
+static void sphcs_net_tx_desc_done(struct sphcs_cmd_chan *chan,
+				   struct sphcs_net_txq  *txq,
+				   struct net_tx_desc    *desc,
+				   bool                   ok)
+{
+	sphcs_net_tx_desc_unmap(desc);
+
+	if (likely(ok)) {
+#ifdef ULT
+		if (!sphcs_net_loopback_tx_done(chan, desc))
+#endif
+			sphcs_net_tx_notify_host(chan, desc);
+	} else {
+		atomic_long_inc(&txq->stats.errors);
+		sphcs_net_put_c2h_handle(desc->host_skb_handle);
+	}
+
+	dev_kfree_skb_any(desc->skb);
+	kfree(desc);
+}
+
+static void sphcs_net_tx_batch_free(struct net_tx_batch *batch)
+{
+	if (batch->lli.vptr)
+		dma_free_coherent(g_the_sphcs->hw_device,
+				  batch->lli_alloc_size,
+				  batch->lli.vptr,
+				  batch->lli.dma_addr);
+	kfree(batch);
+}
+
+static struct net_tx_batch *sphcs_net_tx_batch_get(struct sphcs_net_txq *txq)
+{
+	struct net_tx_batch *batch = NULL;
+
+	NNP_SPIN_LOCK_BH(&txq->lock_bh);
+	if (!list_empty(&txq->free_batches)) {
+		batch = list_first_entry(&txq->free_batches, struct net_tx_batch, node);
+		list_del(&batch->node);
+	}
+	NNP_SPIN_UNLOCK_BH(&txq->lock_bh);
+
+	if (!batch)
+		batch = kzalloc(sizeof(*batch), GFP_ATOMIC);
+	if (batch)
+		batch->txq = txq;
+
+	return batch;
+}
 
-	s_net_dev->stats.tx_packets++;
-	s_net_dev->stats.tx_bytes += dma_data->xfer_size;
+/* reports the batch to BQL and keeps it with its lli for reuse */
+static void sphcs_net_tx_batch_put(struct sphcs_net_txq *txq, struct net_tx_batch *batch)
+{
+	bool keep = false;
 
-	dev_kfree_skb_any(dma_data->skb);
+	NNP_SPIN_LOCK_BH(&txq->lock_bh);
+	if (s_net_dev != NULL) {
+		netdev_tx_completed_queue(netdev_get_tx_queue(s_net_dev, txq - s_txq),
+					  batch->n,
+					  batch->bytes);
+		batch->n = 0;
+		batch->bytes = 0;
+		list_add(&batch->node, &txq->free_batches);
+		keep = true;
+	}
+	NNP_SPIN_UNLOCK_BH(&txq->lock_bh);
+
+	/* device was removed while the dma was in flight */
+	if (!keep)
+		sphcs_net_tx_batch_free(batch);
+}
+
+static int sphcs_net_tx_batch_complete_cb(struct sphcs *sphcs,
+					  void *ctx,
+					  const void *user_data,
+					  int status,
+					  u32 xferTimeUS)
+{
+	struct net_tx_batch *batch = (struct net_tx_batch *)ctx;
+	struct sphcs_net_txq *txq = batch->txq;
+	bool ok = (status == SPHCS_DMA_STATUS_DONE);
+	u32 i;
+
+	for (i = 0; i < batch->n; i++)
+		sphcs_net_tx_desc_done(batch->chan, txq, batch->desc[i], ok);
+
+	/* skbs of a failed batch are counted as errors */
+	if (ok)
+		sphcs_net_stats_add(&txq->stats, batch->n, batch->bytes);
+
+	sphcs_net_tx_batch_put(txq, batch);
 
 	return 0;
 }
 
-static int sphcs_net_dev_start_xmit(struct sk_buff *skb, struct net_device *netdev)
+static bool sphcs_net_tx_batch_get_next(void             *ctx,
+					struct sg_table **out_src,
+					struct sg_table **out_dst,
+					uint64_t         *out_max_size)
 {
-	struct net_dma_command_data dma_data;
-	dma_addr_t dma_addr;
-	dma_addr_t dma_addr_plus_offset;
+	struct net_tx_batch *batch = (struct net_tx_batch *)ctx;
+	struct net_tx_desc *desc;
+
+	if (batch->iter >= batch->n)
+		return false;
+
+	desc = batch->desc[batch->iter++];
+	*out_src = &desc->src_sgt;
+	*out_dst = &desc->dst_sgt;
+	*out_max_size = desc->skb->len;
+
+	return true;
+}
+
+/*
+ * Starts one dma for all skbs of the queue batch,
+ * called from xmit.
+ */
+static void sphcs_net_tx_flush(struct sphcs_net_txq *txq)
+{
+	struct net_tx_batch *batch = txq->batch;
+	struct lli_desc *lli;
+	uint64_t transfer_size = 0;
+	int ret;
+
+	if (!batch)
+		return;
+
+	txq->batch = NULL;
+	lli = &batch->lli;
+	batch->chan = s_net_cmd_chan;
+
+	batch->iter = 0;
+	ret = g_the_sphcs->hw_ops->dma.init_lli_vec(g_the_sphcs->hw_handle,
+						    lli,
+						    0,
+						    sphcs_net_tx_batch_get_next,
+						    batch);
+
+	/* lli buffer of the batch is kept and grows as needed */
+	if (ret == 0 && lli->size > batch->lli_alloc_size) {
+		if (lli->vptr)
+			dma_free_coherent(g_the_sphcs->hw_device,
+					  batch->lli_alloc_size,
+					  lli->vptr,
+					  lli->dma_addr);
+
+		batch->lli_alloc_size = 0;
+		lli->vptr = dma_alloc_coherent(g_the_sphcs->hw_device,
+					       lli->size,
+					       &lli->dma_addr,
+					       GFP_ATOMIC);
+		if (lli->vptr)
+			batch->lli_alloc_size = lli->size;
+	}
+
+	if (ret == 0 && lli->vptr) {
+		batch->iter = 0;
+		transfer_size = g_the_sphcs->hw_ops->dma.gen_lli_vec(g_the_sphcs->hw_handle,
+								     lli,
+								     0,
+								     sphcs_net_tx_batch_get_next,
+								     batch);
+	}
+
+	if (transfer_size != 0) {
+		sphcs_dma_multi_xfer_handle_init(&batch->multi_xfer_handle);
+		ret = sphcs_dma_sched_start_xfer_multi(g_the_sphcs->dmaSched,
+						       &batch->multi_xfer_handle,
+						       &g_dma_desc_c2h_normal,
+						       lli,
+						       transfer_size,
+						       sphcs_net_tx_batch_complete_cb,
+						       batch);
+		if (ret == 0)
+			return;
+	}
+
+	sph_log_debug(ETH_LOG, "SPH_NET - Failed to start tx dma of %u skbs\n", batch->n);
+	sphcs_net_tx_batch_complete_cb(g_the_sphcs, batch, NULL, SPHCS_DMA_STATUS_FAILED, 0);
+}
+
+/*
+ * Maps the skb linear part and all its fragments for DMA,
+ * and builds the source sg table of the mapped regions.
+ */
+static int sphcs_net_tx_desc_map(struct net_tx_desc *desc)
+{
+	struct sk_buff *skb = desc->skb;
 	void *skb_data = skb->data;
 	void *skb_data_aligned;
-	u32 skb_size = skb->len;
-	u32 skb_size_aligned;
 	u32 skb_data_offset;
-	int c2h_skb_handle;
+	dma_addr_t dma_addr;
+	u32 n_sg = 0;
+	int i;
+
+	desc->n_maps = 0;
+	sg_init_table(desc->src_sgl, ARRAY_SIZE(desc->src_sgl));
+
+	/* align to cacheline (128 bytes) */
+	skb_data_offset = (uintptr_t)skb_data & 0x7F;
+	skb_data_aligned = (void *)((uintptr_t)skb_data & ~((uintptr_t)0x7F));
+	dma_addr = dma_map_single(g_the_sphcs->hw_device,
+				  skb_data_aligned,
+				  ALIGN(skb_headlen(skb) + skb_data_offset, 0x80),
+				  DMA_TO_DEVICE);
+	if (dma_mapping_error(g_the_sphcs->hw_device, dma_addr))
+		return -ENOMEM;
+
+	desc->maps[0].addr = dma_addr;
+	desc->maps[0].size = ALIGN(skb_headlen(skb) + skb_data_offset, 0x80);
+	desc->maps[0].is_page = false;
+	desc->n_maps = 1;
+
+	if (skb_headlen(skb) > 0) {
+		sg_dma_address(&desc->src_sgl[n_sg]) = dma_addr + skb_data_offset;
+		desc->src_sgl[n_sg].length = skb_headlen(skb);
+		n_sg++;
+	}
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+
+		dma_addr = skb_frag_dma_map(g_the_sphcs->hw_device,
+					    frag,
+					    0,
+					    skb_frag_size(frag),
+					    DMA_TO_DEVICE);
+		if (dma_mapping_error(g_the_sphcs->hw_device, dma_addr)) {
+			sphcs_net_tx_desc_unmap(desc);
+			return -ENOMEM;
+		}
+		desc->maps[desc->n_maps].addr = dma_addr;
+		desc->maps[desc->n_maps].size = skb_frag_size(frag);
+		desc->maps[desc->n_maps].is_page = true;
+		desc->n_maps++;
+
+		sg_dma_address(&desc->src_sgl[n_sg]) = dma_addr;
+		desc->src_sgl[n_sg].length = skb_frag_size(frag);
+		n_sg++;
+	}
+
+	sg_mark_end(&desc->src_sgl[n_sg - 1]);
+	desc->src_sgt.sgl = desc->src_sgl;
+	desc->src_sgt.nents = n_sg;
+	desc->src_sgt.orig_nents = n_sg;
+
+	return 0;
+}
+
+static int sphcs_net_dev_start_xmit(struct sk_buff *skb, struct net_device *netdev)
+{
+	struct net_tx_desc *desc;
+	u16 qidx = skb_get_queue_mapping(skb);
+	struct sphcs_net_txq *txq = &s_txq[qidx];
+	struct netdev_queue *nq = netdev_get_tx_queue(netdev, qidx);
+	u32 skb_size = skb->len;
+	int c2h_skb_handle = -1;
 	dma_addr_t write_host_dma_addr;
 	uint32_t cont;
+	bool more;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)) /* SPH_IGNORE_STYLE_CHECK */
+	more = netdev_xmit_more();
+#else
+	more = skb->xmit_more;
+#endif
 
 	if (skb->len < 1 || skb->len > NNP_PAGE_SIZE) {
-		s_net_dev->stats.tx_errors++;
+		atomic_long_inc(&txq->stats.errors);
 		kfree_skb(skb);
-		return 0;
+		goto kick;
 	}
 
 	if (g_the_sphcs == NULL || !s_net_cmd_chan) {
 		sph_log_err(ETH_LOG, "SPH_NET - g_the_sphcs is NULL\n");
-		s_net_dev->stats.tx_dropped++;
-		kfree_skb(skb);
-		return 0;
+		goto drop;
 	}
 
 	if (!g_the_sphcs->host_connected) {
 		sph_log_err(ETH_LOG, "SPH_NET - host not connected\n");
-		s_net_dev->stats.tx_dropped++;
-		kfree_skb(skb);
-		return 0;
+		goto drop;
 	}
 
-	/* allocate page in the c2h ring buffer */
-	NNP_SPIN_LOCK_BH(&s_net_cmd_chan->c2h_rb[0].lock_bh);
-	for (c2h_skb_handle = 0; c2h_skb_handle < s_c2h_handles; c2h_skb_handle++)
-		if (!s_c2h_busy_handles[c2h_skb_handle]) {
-			s_c2h_busy_handles[c2h_skb_handle] = 1;
-			break;
-		}
-	NNP_SPIN_UNLOCK_BH(&s_net_cmd_chan->c2h_rb[0].lock_bh);
+	/* the host does not verify checksums, complete them here */
+	if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))
+		goto drop;
 
-	if (c2h_skb_handle >= s_c2h_handles) {
-		sph_log_err(ETH_LOG, "SPH_NET - c2h ringbuffer full\n");
-		s_net_dev->stats.tx_dropped++;
-		kfree_skb(skb);
-		return 0;
+	/* allocate page in the c2h ring buffer */
+	c2h_skb_handle = sphcs_net_get_c2h_handle(netdev, qidx);
+	if (c2h_skb_handle < 0) {
+		/* queue is stopped, the stack will retry when slots are released */
+		netif_stop_subqueue(netdev, qidx);
+		sphcs_net_tx_flush(txq);
+		return NETDEV_TX_BUSY;
 	}
 
 	write_host_dma_addr = host_rb_get_addr(&s_net_cmd_chan->c2h_rb[0],
 					       c2h_skb_handle * NNP_PAGE_SIZE,
 					       &cont);
-	if (!write_host_dma_addr || cont < skb_size) {
-		s_net_dev->stats.tx_dropped++;
-		kfree_skb(skb);
-		s_c2h_busy_handles[c2h_skb_handle] = 0;
-		return 0;
-	}
+	if (!write_host_dma_addr || cont < skb_size)
+		goto drop;
 
-	/* align to cacheline (128 bytes) */
-	skb_data_offset = (uintptr_t)skb_data & 0x7F;
-	skb_data_aligned = (void *)((uintptr_t)skb_data & ~((uintptr_t)0x7F));
-	skb_size_aligned = ALIGN(skb_size+skb_data_offset, 0x80);
-	dma_addr = dma_map_single(g_the_sphcs->hw_device, skb_data_aligned, skb_size_aligned, DMA_TO_DEVICE);
-	if (dma_mapping_error(g_the_sphcs->hw_device, dma_addr)) {
+	desc = kmalloc(sizeof(*desc), GFP_ATOMIC);
+	if (!desc)
+		goto drop;
+
+	desc->skb = skb;
+	desc->host_skb_handle = c2h_skb_handle;
+
+	if (sphcs_net_tx_desc_map(desc)) {
 		sph_log_debug(ETH_LOG, "SPH_NET - Failed to map skb for dma xfer\n");
-		s_net_dev->stats.tx_dropped++;
-		kfree_skb(skb);
-		s_c2h_busy_handles[c2h_skb_handle] = 0;
-		return 0;
+		kfree(desc);
+		goto drop;
 	}
 
-	dma_addr_plus_offset = dma_addr + (dma_addr_t)skb_data_offset;
+	/* the packet is gathered into its host slot */
+	sg_init_table(&desc->dst_sgl, 1);
+	sg_dma_address(&desc->dst_sgl) = write_host_dma_addr;
+	desc->dst_sgl.length = skb_size;
+	desc->dst_sgt.sgl = &desc->dst_sgl;
+	desc->dst_sgt.nents = 1;
+	desc->dst_sgt.orig_nents = 1;
+
+	if (!txq->batch)
+		txq->batch = sphcs_net_tx_batch_get(txq);
+	if (!txq->batch) {
+		sphcs_net_tx_desc_unmap(desc);
+		kfree(desc);
+		goto drop;
+	}
 
-	dma_data.xfer_size = skb_size;
-	dma_data.host_skb_handle = c2h_skb_handle;
-	dma_data.host_dma_addr = write_host_dma_addr;
-	dma_data.card_dma_addr = dma_addr;
-	dma_data.skb = skb;
-	dma_data.chan = s_net_cmd_chan;
+	txq->batch->desc[txq->batch->n++] = desc;
+	txq->batch->bytes += skb_size;
+	netdev_tx_sent_queue(nq, skb_size);
 
-	/* start DMA for transferring the copied packet to host */
-	sphcs_dma_sched_start_xfer_single(g_the_sphcs->dmaSched,
-					  &g_dma_desc_c2h_normal,
-					  dma_addr_plus_offset,
-					  write_host_dma_addr,
-					  dma_data.xfer_size,
-					  sphcs_net_out_msg_dma_complete_callback,
-					  NULL,
-					  &dma_data,
-					  sizeof(dma_data));
+	if (txq->batch->n == SPHCS_NET_TX_BATCH)
+		sphcs_net_tx_flush(txq);
 
-	return 0;
+kick:
+	/* defer the dma while the stack has more packets for this queue */
+	if (!more || netif_xmit_stopped(nq))
+		sphcs_net_tx_flush(txq);
+
+	return NETDEV_TX_OK;
+
+drop:
+	atomic_long_inc(&txq->stats.dropped);
+	kfree_skb(skb);
+	sphcs_net_put_c2h_handle(c2h_skb_handle);
+	goto kick;
 }
 
 static const struct net_device_ops ndo = {
@@ -249,7 +717,7 @@ static const struct net_device_ops ndo = {
 	.ndo_stop = sphcs_net_dev_close,
 	.ndo_start_xmit = sphcs_net_dev_start_xmit,
 	.ndo_do_ioctl = sphcs_net_dev_do_ioctl,
-	.ndo_get_stats = sphcs_net_dev_get_stats,
+	.ndo_get_stats64 = sphcs_net_dev_get_stats64,
 	.ndo_set_config = sphcs_net_dev_config,
 	.ndo_change_mtu = sphcs_net_dev_change_mtu};
 
@@ -261,23 +729,87 @@ static void sphcs_net_dev_setup(struct net_device *netdev)
 
 	ether_setup(netdev);
 	netdev->netdev_ops = &ndo;
+	/* SG requires a checksum feature, checksums are completed in xmit */
+	netdev->features |= NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_HIGHDMA;
+	netdev->hw_features |= NETIF_F_SG | NETIF_F_HW_CSUM;
+}
+
+static int sphcs_net_dev_poll(struct napi_struct *napi, int budget);
+static const struct file_operations net_status_fops;
+#ifdef ULT
+static const struct file_operations net_loopback_fops;
+static struct dentry *s_debugfs_loopback;
+static bool sphcs_net_loopback_rx(struct sk_buff *skb);
+#endif
+
+static void sphcs_net_free_txqs(void)
+{
+	struct net_tx_batch *batch, *tmp;
+	unsigned int q;
+
+	for (q = 0; q < SPHCS_NET_MAX_QUEUES; q++) {
+		kfree(s_txq[q].busy_map);
+		s_txq[q].busy_map = NULL;
+		list_for_each_entry_safe(batch, tmp, &s_txq[q].free_batches, node) {
+			list_del(&batch->node);
+			sphcs_net_tx_batch_free(batch);
+		}
+	}
+}
+
+/*
+ * Splits the c2h ring buffer slots between the tx queues
+ */
+static int sphcs_net_init_txqs(uint32_t c2h_pages)
+{
+	unsigned int q;
+	int per_queue = c2h_pages / s_num_queues;
+
+	for (q = 0; q < SPHCS_NET_MAX_QUEUES; q++) {
+		INIT_LIST_HEAD(&s_txq[q].free_batches);
+		s_txq[q].batch = NULL;
+	}
+
+	for (q = 0; q < s_num_queues; q++) {
+		spin_lock_init(&s_txq[q].lock_bh);
+		sphcs_net_stats_init(&s_txq[q].stats);
+		s_txq[q].first_handle = q * per_queue;
+		s_txq[q].n_handles = (q == s_num_queues - 1) ? c2h_pages - q * per_queue : per_queue;
+		s_txq[q].n_busy = 0;
+		s_txq[q].next_hint = 0;
+		s_txq[q].busy_map = kcalloc(BITS_TO_LONGS(s_txq[q].n_handles),
+					    sizeof(unsigned long),
+					    GFP_KERNEL);
+		if (!s_txq[q].busy_map) {
+			sphcs_net_free_txqs();
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
 }
 
 static int sphcs_net_dev_init(uint32_t h2c_pages, uint32_t c2h_pages)
 {
+	unsigned int q;
 	int ret;
 
 	sph_log_info(ETH_LOG, "SPH_NET - Loading sph network module:....");
 
-	if (s_net_dev != NULL)
+	if (s_net_dev != NULL || c2h_pages == 0)
 		return -1;
 
+	s_num_queues = min_t(unsigned int, SPHCS_NET_MAX_QUEUES, num_online_cpus());
+	s_num_queues = min_t(unsigned int, s_num_queues, c2h_pages);
+
 #if KERNEL_VERSION(3, 17, 0) > LINUX_VERSION_CODE  /* SPH_IGNORE_STYLE_CHECK */
-	s_net_dev = alloc_netdev(0, "sphcschan%d",
-					sphcs_net_dev_setup);
+	s_net_dev = alloc_netdev_mqs(0, "sphcschan%d",
+					sphcs_net_dev_setup,
+					s_num_queues, s_num_queues);
 #else
-	s_net_dev = alloc_netdev(0, "sphcschan%d", NET_NAME_UNKNOWN,
-					sphcs_net_dev_setup);
+	s_net_dev = alloc_netdev_mqs(0, "sphcschan%d", NET_NAME_UNKNOWN,
+					sphcs_net_dev_setup,
+					s_num_queues, s_num_queues);
 #endif
 
 	if (!s_net_dev) {
@@ -293,40 +825,94 @@ static int sphcs_net_dev_init(uint32_t h2c_pages, uint32_t c2h_pages)
 	if (ret < 0) {
 		sph_log_err(START_UP_LOG, "Failed to create net dma page pool\n");
 		free_netdev(s_net_dev);
+		s_net_dev = NULL;
 		return -1;
 	}
 
 	s_c2h_handles = c2h_pages;
-	s_c2h_busy_handles = kcalloc(c2h_pages, sizeof(uint8_t), GFP_KERNEL);
-	if (!s_c2h_busy_handles) {
-		sph_log_err(START_UP_LOG, "Failed to create net dma page pool\n");
+	if (sphcs_net_init_txqs(c2h_pages)) {
+		sph_log_err(START_UP_LOG, "Failed to create net tx queues\n");
 		free_netdev(s_net_dev);
+		s_net_dev = NULL;
 		dma_page_pool_destroy(s_net_dma_page_pool);
 		return -1;
 	}
 
+	for (q = 0; q < s_num_queues; q++) {
+		skb_queue_head_init(&s_rxq[q].queue);
+		sphcs_net_stats_init(&s_rxq[q].stats);
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)) /* SPH_IGNORE_STYLE_CHECK */
+		netif_napi_add_weight(s_net_dev, &s_rxq[q].napi, sphcs_net_dev_poll, SPHCS_NET_NAPI_WEIGHT);
+#else
+		netif_napi_add(s_net_dev, &s_rxq[q].napi, sphcs_net_dev_poll, SPHCS_NET_NAPI_WEIGHT);
+#endif
+	}
+
 	dma_page_pool_init_debugfs(s_net_dma_page_pool,
 				   g_the_sphcs->debugfs_dir,
 				   "chan_net_dma_page_pool");
 
 	if (register_netdev(s_net_dev)) {
 		sph_log_err(ETH_LOG, "SPH_NET - Failed to register sph net device\n");
+		for (q = 0; q < s_num_queues; q++)
+			netif_napi_del(&s_rxq[q].napi);
 		free_netdev(s_net_dev);
+		s_net_dev = NULL;
+		sphcs_net_free_txqs();
+		dma_page_pool_destroy(s_net_dma_page_pool);
 		return -1;
 	}
-	sph_log_info(ETH_LOG, "SPH_NET - Succeeded loading sph network module %s!\n\n",
-			dev_name(&s_net_dev->dev));
+
+	s_stat_time_us = nnp_time_us();
+	s_stat_tx_packets = 0;
+	s_stat_rx_packets = 0;
+	if (g_the_sphcs->debugfs_dir)
+		s_debugfs_status = debugfs_create_file("chan_net_status",
+						       0444,
+						       g_the_sphcs->debugfs_dir,
+						       NULL,
+						       &net_status_fops);
+#ifdef ULT
+	if (g_the_sphcs->debugfs_dir)
+		s_debugfs_loopback = debugfs_create_file("chan_net_loopback",
+							 0644,
+							 g_the_sphcs->debugfs_dir,
+							 NULL,
+							 &net_loopback_fops);
+#endif
+
+	sph_log_info(ETH_LOG, "SPH_NET - Succeeded loading sph network module %s with %u queues!\n\n",
+			dev_name(&s_net_dev->dev), s_num_queues);
 	return 0;
 }
 
 static void sphcs_net_dev_exit(void)
 {
+	struct net_tx_batch *batch;
+	unsigned int q;
+
 	sph_log_info(ETH_LOG, "SPH_NET - Unloading sph network module\n\n");
 	if (s_net_dev != NULL) {
+		debugfs_remove(s_debugfs_status);
+		s_debugfs_status = NULL;
+#ifdef ULT
+		debugfs_remove(s_debugfs_loopback);
+		s_debugfs_loopback = NULL;
+#endif
 		unregister_netdev(s_net_dev);
+		for (q = 0; q < s_num_queues; q++) {
+			netif_napi_del(&s_rxq[q].napi);
+			skb_queue_purge(&s_rxq[q].queue);
+			/* no xmit after unregister, fail the batch not started */
+			batch = s_txq[q].batch;
+			s_txq[q].batch = NULL;
+			if (batch)
+				sphcs_net_tx_batch_complete_cb(g_the_sphcs, batch, NULL,
+							       SPHCS_DMA_STATUS_FAILED, 0);
+		}
 		free_netdev(s_net_dev);
 		dma_page_pool_destroy(s_net_dma_page_pool);
-		kfree(s_c2h_busy_handles);
+		sphcs_net_free_txqs();
 		s_net_dev = NULL;
 		s_net_cmd_chan = NULL;
 		memset(s_mac_addr, 0, ETH_ALEN);
@@ -336,33 +922,144 @@ static void sphcs_net_dev_exit(void)
 
 /*
  * The packet has been retrieved from the transmission
- * medium. build an skb around it, so upper layers can handle it
+ * medium. build an skb around it and queue it for the NAPI poll,
+ * so upper layers can handle it
  */
 static void sphcs_net_dev_rx(struct net_device *netdev, int data_size,
 		unsigned char *buf)
 {
+	struct sphcs_net_rxq *rxq;
 	struct sk_buff *skb;
+	unsigned int q;
 
 	if (netdev == NULL)
 		return;
 
-	skb = dev_alloc_skb(data_size + 2);
+	/* NAPI is disabled while down, nothing would drain the queue */
+	if (!netif_running(netdev)) {
+		atomic_long_inc(&s_rxq[0].stats.dropped);
+		return;
+	}
+
+	skb = netdev_alloc_skb_ip_align(netdev, data_size);
 	if (!skb) {
-		netdev->stats.rx_dropped++;
+		atomic_long_inc(&s_rxq[0].stats.dropped);
 		return;
 	}
 
 	safe_c_memcpy(skb_put(skb, data_size), data_size, buf, data_size);
 
-	skb->dev = netdev;
+	/* keep packets of a flow on one queue to preserve their order */
 	skb->protocol = eth_type_trans(skb, netdev);
+	q = reciprocal_scale(skb_get_hash(skb), s_num_queues);
+	skb_record_rx_queue(skb, q);
+	rxq = &s_rxq[q];
+
+	if (skb_queue_len(&rxq->queue) >= SPHCS_NET_RX_BACKLOG) {
+		atomic_long_inc(&rxq->stats.dropped);
+		kfree_skb(skb);
+		return;
+	}
 
-	netdev->stats.rx_packets++;
-	netdev->stats.rx_bytes += data_size;
+	skb_queue_tail(&rxq->queue, skb);
 
-	netif_rx(skb); //pass to the receive level
+	/* called from DMA completion work, run the softirq when enabling bh */
+	local_bh_disable();
+	napi_schedule(&rxq->napi);
+	local_bh_enable();
 }
 
+static int sphcs_net_dev_poll(struct napi_struct *napi, int budget)
+{
+	struct sphcs_net_rxq *rxq = container_of(napi, struct sphcs_net_rxq, napi);
+	struct sk_buff *skb;
+	u64 bytes = 0;
+	int work_done = 0;
+
+	while (work_done < budget) {
+		skb = skb_dequeue(&rxq->queue);
+		if (!skb)
+			break;
+
+		bytes += skb->len;
+		work_done++;
+
+#ifdef ULT
+		if (sphcs_net_loopback_rx(skb))
+			continue;
+#endif
+		napi_gro_receive(napi, skb); //pass to the receive level
+	}
+
+	if (work_done > 0)
+		sphcs_net_stats_add(&rxq->stats, work_done, bytes);
+
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		/* packet may have been queued before completion */
+		if (!skb_queue_empty(&rxq->queue))
+			napi_schedule(napi);
+	}
+
+	return work_done;
+}
+
+static int net_status_show(struct seq_file *m, void *v)
+{
+	u64 now, elapsed_us;
+	u64 tx_packets = 0, rx_packets = 0, packets, bytes;
+	unsigned int q;
+
+	if (s_net_dev == NULL) {
+		seq_puts(m, "Network device is not loaded\n");
+		return 0;
+	}
+
+	now = nnp_time_us();
+	elapsed_us = now - s_stat_time_us;
+	for (q = 0; q < s_num_queues; q++) {
+		sphcs_net_stats_read(&s_txq[q].stats, &packets, &bytes);
+		tx_packets += packets;
+		sphcs_net_stats_read(&s_rxq[q].stats, &packets, &bytes);
+		rx_packets += packets;
+	}
+
+	seq_printf(m, "queues: %u\n", s_num_queues);
+	for (q = 0; q < s_num_queues; q++)
+		seq_printf(m, "txq %u: handles %d-%d busy=%d stopped=%d\n",
+			   q,
+			   s_txq[q].first_handle,
+			   s_txq[q].first_handle + s_txq[q].n_handles - 1,
+			   s_txq[q].n_busy,
+			   __netif_subqueue_stopped(s_net_dev, q));
+	for (q = 0; q < s_num_queues; q++)
+		seq_printf(m, "rxq %u: backlog %u\n", q, skb_queue_len(&s_rxq[q].queue));
+
+	/* rates since last read of this file */
+	if (elapsed_us > 0) {
+		seq_printf(m, "tx packets/s: %llu\n",
+			   div64_u64((tx_packets - s_stat_tx_packets) * USEC_PER_SEC, elapsed_us));
+		seq_printf(m, "rx packets/s: %llu\n",
+			   div64_u64((rx_packets - s_stat_rx_packets) * USEC_PER_SEC, elapsed_us));
+	}
+	s_stat_time_us = now;
+	s_stat_tx_packets = tx_packets;
+	s_stat_rx_packets = rx_packets;
+
+	return 0;
+}
+
+static int net_status_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, net_status_show, inode->i_private);
+}
+
+static const struct file_operations net_status_fops = {
+	.open		= net_status_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void sphcs_net_send_ack(struct sphcs_cmd_chan *cmd_chan, int skb_handle)
 {
 	// Send a ACK reply to host to free the xmited skb
@@ -387,7 +1084,11 @@ static int sphcs_net_in_msg_dma_complete_callback(struct sphcs *sphcs,
 	struct net_dma_command_data *dma_data =
 			(struct net_dma_command_data *)user_data;
 
-	sphcs_net_send_ack(dma_data->chan, dma_data->host_skb_handle);
+	/* a looped back packet was read from its c2h slot, no host skb to ack */
+	if (dma_data->loopback)
+		sphcs_net_put_c2h_handle(dma_data->host_skb_handle);
+	else
+		sphcs_net_send_ack(dma_data->chan, dma_data->host_skb_handle);
 
 	sphcs_net_dev_rx(s_net_dev, dma_data->xfer_size, dma_data->vptr);
 
@@ -398,23 +1099,19 @@ static int sphcs_net_in_msg_dma_complete_callback(struct sphcs *sphcs,
 }
 
 /*
- * called to process a
- * NNP_IPC_H2C_OP_ETH_MSG_DSCR message received from host.
+ * brings a packet of size bytes from host_dma_addr and receives it,
+ * the channel reference is released when done.
  */
-static int sphcs_net_process_command(struct sphcs              *sphcs,
-				     struct sphcs_cmd_chan     *cmd_chan,
-				     union h2c_ChanEthernetMsgDscr *req)
+static int sphcs_net_rx_from_host(struct sphcs          *sphcs,
+				  struct sphcs_cmd_chan *cmd_chan,
+				  dma_addr_t             host_dma_addr,
+				  u32                    size,
+				  int                    skb_handle,
+				  bool                   loopback)
 {
 	struct net_dma_command_data dma_data;
 	dma_addr_t dma_addr;
-	dma_addr_t host_dma_addr;
 	int ret;
-	uint32_t cont = 0;
-
-	host_dma_addr = host_rb_get_addr(&cmd_chan->h2c_rb[0],
-					 req->skb_handle * NNP_PAGE_SIZE,
-					 &cont);
-	NNP_ASSERT(cont >= req->size + 1);
 
 	ret = dma_page_pool_get_free_page(s_net_dma_page_pool,
 					  &dma_data.card_dma_page_hndl,
@@ -426,10 +1123,11 @@ static int sphcs_net_process_command(struct sphcs              *sphcs,
 		return ret;
 	}
 
-	dma_data.xfer_size = req->size + 1;
-	dma_data.host_skb_handle = req->skb_handle;
+	dma_data.xfer_size = size;
+	dma_data.host_skb_handle = skb_handle;
 	dma_data.host_dma_addr = host_dma_addr;
 	dma_data.chan = cmd_chan;
+	dma_data.loopback = loopback;
 
 	/* start DMA xfer to bring the packet */
 	ret = sphcs_dma_sched_start_xfer_single(sphcs->dmaSched,
@@ -452,6 +1150,219 @@ static int sphcs_net_process_command(struct sphcs              *sphcs,
 	return 0;
 }
 
+/*
+ * called to process a
+ * NNP_IPC_H2C_OP_ETH_MSG_DSCR message received from host.
+ */
+static int sphcs_net_process_command(struct sphcs              *sphcs,
+				     struct sphcs_cmd_chan     *cmd_chan,
+				     union h2c_ChanEthernetMsgDscr *req)
+{
+	dma_addr_t host_dma_addr;
+	uint32_t cont = 0;
+
+	host_dma_addr = host_rb_get_addr(&cmd_chan->h2c_rb[0],
+					 req->skb_handle * NNP_PAGE_SIZE,
+					 &cont);
+	NNP_ASSERT(cont >= req->size + 1);
+
+	return sphcs_net_rx_from_host(sphcs,
+				      cmd_chan,
+				      host_dma_addr,
+				      req->size + 1,
+				      req->skb_handle,
+				      false);
+}
+
+#ifdef ULT
+/*
+ * Loopback benchmark. Packets sent through the device are read back
+ * from their c2h slot by an h2c dma and received on the card instead
+ * of being handed to the host, through whichever pcie backend the
+ * driver is built with, e.g. sphcs_hw_sim.c.
+ *
+ *   echo "<packets> <size>" > chan_net_loopback
+ *   cat chan_net_loopback
+ */
+#define SPHCS_NET_LOOPBACK_PROTO      ETH_P_802_EX1
+#define SPHCS_NET_LOOPBACK_FLOWS      16
+#define SPHCS_NET_LOOPBACK_WINDOW     512
+#define SPHCS_NET_LOOPBACK_TIMEOUT_MS 10000
+
+static DEFINE_MUTEX(s_loopback_lock);
+static struct {
+	bool              running;
+	u32               size;
+	u32               sent;
+	atomic_t          received;
+	u64               elapsed_us;
+	int               status;
+	wait_queue_head_t waitq;
+} s_loopback;
+
+static inline bool is_loopback_skb(struct sk_buff *skb)
+{
+	return READ_ONCE(s_loopback.running) &&
+	       skb->protocol == htons(SPHCS_NET_LOOPBACK_PROTO);
+}
+
+/* called instead of notifying the host, returns false for other packets */
+static bool sphcs_net_loopback_tx_done(struct sphcs_cmd_chan *chan,
+				       struct net_tx_desc    *desc)
+{
+	dma_addr_t host_dma_addr;
+	uint32_t cont;
+
+	if (!is_loopback_skb(desc->skb))
+		return false;
+
+	host_dma_addr = host_rb_get_addr(&chan->c2h_rb[0],
+					 desc->host_skb_handle * NNP_PAGE_SIZE,
+					 &cont);
+
+	/* the c2h slot stays busy until the packet is read back */
+	sphcs_cmd_chan_get(chan);
+	if (sphcs_net_rx_from_host(g_the_sphcs,
+				   chan,
+				   host_dma_addr,
+				   desc->skb->len,
+				   desc->host_skb_handle,
+				   true))
+		sphcs_net_put_c2h_handle(desc->host_skb_handle);
+
+	return true;
+}
+
+/* consumes looped back packets in the NAPI poll */
+static bool sphcs_net_loopback_rx(struct sk_buff *skb)
+{
+	if (!is_loopback_skb(skb))
+		return false;
+
+	consume_skb(skb);
+	atomic_inc(&s_loopback.received);
+	wake_up(&s_loopback.waitq);
+
+	return true;
+}
+
+static int sphcs_net_loopback_run(u32 packets, u32 size)
+{
+	struct sk_buff *skb;
+	struct ethhdr *eth;
+	u64 start;
+	u32 i;
+	int ret = 0;
+
+	if (s_net_dev == NULL || !netif_running(s_net_dev))
+		return -ENETDOWN;
+
+	init_waitqueue_head(&s_loopback.waitq);
+	atomic_set(&s_loopback.received, 0);
+	s_loopback.sent = 0;
+	s_loopback.size = size;
+	WRITE_ONCE(s_loopback.running, true);
+
+	start = nnp_time_us();
+	for (i = 0; i < packets; i++) {
+		/* keep the qdisc from dropping */
+		if (!wait_event_timeout(s_loopback.waitq,
+					s_loopback.sent - atomic_read(&s_loopback.received) <
+					SPHCS_NET_LOOPBACK_WINDOW,
+					msecs_to_jiffies(SPHCS_NET_LOOPBACK_TIMEOUT_MS))) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+
+		skb = netdev_alloc_skb(s_net_dev, size);
+		if (!skb) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		eth = (struct ethhdr *)skb_put(skb, size);
+		memset(eth, 0, size);
+		ether_addr_copy(eth->h_dest, s_net_dev->dev_addr);
+		ether_addr_copy(eth->h_source, s_net_dev->dev_addr);
+		eth->h_proto = htons(SPHCS_NET_LOOPBACK_PROTO);
+		skb->protocol = eth->h_proto;
+		skb->dev = s_net_dev;
+		/* spread the flows over the tx queues */
+		skb_set_hash(skb, jhash_1word(i % SPHCS_NET_LOOPBACK_FLOWS, 0), PKT_HASH_TYPE_L4);
+
+		if (dev_queue_xmit(skb) == NET_XMIT_SUCCESS)
+			s_loopback.sent++;
+	}
+
+	if (!wait_event_timeout(s_loopback.waitq,
+				atomic_read(&s_loopback.received) >= s_loopback.sent,
+				msecs_to_jiffies(SPHCS_NET_LOOPBACK_TIMEOUT_MS)))
+		ret = -ETIMEDOUT;
+
+	s_loopback.elapsed_us = nnp_time_us() - start;
+	s_loopback.status = ret;
+	WRITE_ONCE(s_loopback.running, false);
+
+	return ret;
+}
+
+static ssize_t net_loopback_write(struct file       *f,
+				  const char __user *buf,
+				  size_t             count,
+				  loff_t            *off)
+{
+	char str[32];
+	u32 packets, size;
+	int ret;
+
+	if (count >= sizeof(str))
+		return -EINVAL;
+	if (copy_from_user(str, buf, count))
+		return -EFAULT;
+	str[count] = '\0';
+
+	if (sscanf(str, "%u %u", &packets, &size) != 2 ||
+	    packets == 0 || size < ETH_ZLEN || size > NNP_PAGE_SIZE)
+		return -EINVAL;
+
+	mutex_lock(&s_loopback_lock);
+	ret = sphcs_net_loopback_run(packets, size);
+	mutex_unlock(&s_loopback_lock);
+
+	return ret ? ret : count;
+}
+
+static int net_loopback_show(struct seq_file *m, void *v)
+{
+	u32 received;
+
+	mutex_lock(&s_loopback_lock);
+	received = atomic_read(&s_loopback.received);
+	seq_printf(m, "sent %u received %u size %u time %llu us status %d\n",
+		   s_loopback.sent, received, s_loopback.size,
+		   s_loopback.elapsed_us, s_loopback.status);
+	if (s_loopback.elapsed_us > 0)
+		seq_printf(m, "packets/s: %llu\n",
+			   div64_u64((u64)received * USEC_PER_SEC, s_loopback.elapsed_us));
+	mutex_unlock(&s_loopback_lock);
+
+	return 0;
+}
+
+static int net_loopback_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, net_loopback_show, inode->i_private);
+}
+
+static const struct file_operations net_loopback_fops = {
+	.open		= net_loopback_open,
+	.read		= seq_read,
+	.write		= net_loopback_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 struct netmsg_op_work {
 	struct work_struct work;
 	struct sphcs *sphcs;
@@ -468,7 +1379,7 @@ static void netmsg_op_work_handler(struct work_struct *work)
 						 work);
 
 	if (op->cmd.is_ack) {
-		s_c2h_busy_handles[op->cmd.skb_handle] = 0;
+		sphcs_net_put_c2h_handle(op->cmd.skb_handle);
 		sphcs_cmd_chan_put(op->chan);
 		goto free_op;
 	}
@@ -101,6 +101,8 @@ int sphcs_cmd_chan_create(uint16_t                protocol_id,
 static void cmd_chan_release(struct work_struct *work)
 {
 	struct sphcs_cmd_chan *cmd_chan;
+	struct sphcs_hostres_map *hostres;
+	struct hlist_node *tmp;
 	int i;
 
 	cmd_chan = container_of(work, struct sphcs_cmd_chan, work);
@@ -114,6 +116,13 @@ static void cmd_chan_release(struct work_struct *work)
 		sphcs_host_rb_init(&cmd_chan->c2h_rb[i], NULL, 0);
 	}
 
+	/* release host resources left mapped, their page lists may be freed */
+	hash_for_each_safe(cmd_chan->hostres_hash, i, tmp, hostres, hash_node) {
+		hash_del(&hostres->hash_node);
+		sphcs_put_hostres_pagetable(hostres->host_pgt_addr);
+		kfree(hostres);
+	}
+
 	sphcs_send_event_report(g_the_sphcs,
 				NNP_IPC_CHANNEL_DESTROYED,
 				0,
@@ -527,7 +536,7 @@ static int remove_hostres(struct sphcs_cmd_chan *chan, uint16_t protocol_id)
 		return -ENXIO;
 	}
 
-	sg_free_table(&hostres->host_sgt);
+	sphcs_put_hostres_pagetable(hostres->host_pgt_addr);
 	kfree(hostres);
 
 	return 0;
@@ -557,11 +566,12 @@ static void hostres_pagetable_complete_cb(void                  *cb_ctx,
 						    -1,
 						    op->cmd.chan_id,
 						    op->cmd.hostres_id);
-			sg_free_table(host_sgt);
+			sphcs_put_hostres_pagetable(NNP_IPC_DMA_PFN_TO_ADDR(op->cmd.host_ptr));
 			goto done;
 		}
 
 		memcpy(&hostres->host_sgt, host_sgt, sizeof(struct sg_table));
+		hostres->host_pgt_addr = NNP_IPC_DMA_PFN_TO_ADDR(op->cmd.host_ptr);
 		hostres->protocol_id = op->cmd.hostres_id;
 		hostres->size = total_size;
 
@@ -621,9 +631,9 @@ static void channel_hostres_op_work_handler(struct work_struct *work)
 						    op->cmd.chan_id,
 						    op->cmd.hostres_id);
 	} else {
-		ret = sphcs_retrieve_hostres_pagetable(NNP_IPC_DMA_PFN_TO_ADDR(op->cmd.host_ptr),
-						       hostres_pagetable_complete_cb,
-						       op);
+		ret = sphcs_get_hostres_pagetable(NNP_IPC_DMA_PFN_TO_ADDR(op->cmd.host_ptr),
+						  hostres_pagetable_complete_cb,
+						  op);
 		if (ret != 0) {
 			sphcs_send_event_report_ext(sphcs,
 						    NNP_IPC_CHANNEL_MAP_HOSTRES_FAILED,
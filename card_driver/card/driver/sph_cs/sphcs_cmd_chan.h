@@ -31,7 +31,8 @@ struct sphcs_host_rb {
 };
 
 struct sphcs_hostres_map {
-	struct sg_table host_sgt;
+	struct sg_table host_sgt; //shared, owned by the page table cache
+	uint64_t host_pgt_addr;
 	uint16_t protocol_id;
 	uint64_t user_handle; //host resource user handle
 	uint32_t size;
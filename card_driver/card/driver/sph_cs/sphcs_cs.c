@@ -8,6 +8,7 @@
 #include <linux/pci.h>
 #include <linux/jiffies.h>
 #include <linux/workqueue.h>
+#include <linux/mutex.h>
 #include <linux/sched/clock.h>
 #include "ipc_protocol.h"
 #include "ipc_chan_protocol.h"
@@ -870,6 +871,223 @@ free_dma_req_data:
 	return res;
 }
 
+/*
+ * Host resource page table cache
+ *
+ * The host builds the DMA page list of a host resource once per device and
+ * sends the same list address on every map of the resource to a channel.
+ * The list stays valid while the resource is mapped, so the sg table built
+ * from it is shared by all maps of the same list address, and is dropped
+ * on the last unmap since then the host may free the list.
+ */
+#define HOSTRES_PGT_HASH_BITS 6
+#define HOSTRES_PGT_MAX_SEG   round_down(UINT_MAX, NNP_PAGE_SIZE)
+
+struct hostres_pgt_waiter {
+	struct list_head     node;
+	hostres_pagetable_cb completion_cb;
+	void                *cb_ctx;
+};
+
+struct hostres_pgt_entry {
+	struct hlist_node  hash_node;
+	uint64_t           host_addr;
+	uint32_t           refcount;
+	bool               ready;
+	struct sg_table    host_sgt;
+	uint64_t           total_size;
+	uint32_t           list_bytes;
+	struct list_head   waiters;
+};
+
+static DEFINE_HASHTABLE(s_hostres_pgt_hash, HOSTRES_PGT_HASH_BITS);
+static DEFINE_MUTEX(s_hostres_pgt_lock);
+
+static struct hostres_pgt_entry *hostres_pgt_find(uint64_t host_addr)
+{
+	struct hostres_pgt_entry *entry;
+
+	hash_for_each_possible(s_hostres_pgt_hash, entry, hash_node, host_addr)
+		if (entry->host_addr == host_addr)
+			return entry;
+
+	return NULL;
+}
+
+/* merges physically contiguous host chunks into one sg entry */
+static inline bool hostres_pgt_can_merge(struct scatterlist *prev,
+					 struct scatterlist *sg)
+{
+	return prev->dma_address + prev->length == sg->dma_address &&
+	       (u64)prev->length + sg->length <= HOSTRES_PGT_MAX_SEG;
+}
+
+static void hostres_pgt_coalesce(struct sg_table *dst, struct sg_table *src)
+{
+	struct scatterlist *sg, *d;
+	struct scatterlist run;
+	uint32_t n = 0;
+	int i;
+
+	for_each_sg(src->sgl, sg, src->orig_nents, i) {
+		if (n > 0 && hostres_pgt_can_merge(&run, sg)) {
+			run.length += sg->length;
+			continue;
+		}
+		run.dma_address = sg->dma_address;
+		run.length = sg->length;
+		n++;
+	}
+
+	/* nothing to merge or no memory, keep the table as is */
+	if (n == src->orig_nents || sg_alloc_table(dst, n, GFP_KERNEL) != 0) {
+		memcpy(dst, src, sizeof(*dst));
+		return;
+	}
+
+	d = NULL;
+	for_each_sg(src->sgl, sg, src->orig_nents, i) {
+		if (d != NULL && hostres_pgt_can_merge(d, sg)) {
+			d->length += sg->length;
+			continue;
+		}
+		d = (d != NULL ? sg_next(d) : dst->sgl);
+		d->dma_address = sg->dma_address;
+		d->length = sg->length;
+		d->offset = sg->offset;
+	}
+
+	sg_free_table(src);
+}
+
+static void hostres_pgt_loaded_cb(void            *cb_ctx,
+				  int              status,
+				  struct sg_table *host_sgt,
+				  uint64_t         total_size)
+{
+	struct hostres_pgt_entry *entry = (struct hostres_pgt_entry *)cb_ctx;
+	struct hostres_pgt_waiter *w, *tmp;
+	LIST_HEAD(waiters);
+
+	if (status == 0) {
+		entry->list_bytes = DIV_ROUND_UP(host_sgt->orig_nents, NENTS_PER_PAGE) * NNP_PAGE_SIZE;
+		entry->total_size = total_size;
+		hostres_pgt_coalesce(&entry->host_sgt, host_sgt);
+	}
+
+	mutex_lock(&s_hostres_pgt_lock);
+	list_splice_init(&entry->waiters, &waiters);
+	if (status == 0)
+		entry->ready = true;
+	else
+		hash_del(&entry->hash_node);
+	mutex_unlock(&s_hostres_pgt_lock);
+
+	list_for_each_entry_safe(w, tmp, &waiters, node) {
+		w->completion_cb(w->cb_ctx,
+				 status,
+				 status == 0 ? &entry->host_sgt : NULL,
+				 entry->total_size);
+		kfree(w);
+	}
+
+	if (status != 0)
+		kfree(entry);
+}
+
+int sphcs_get_hostres_pagetable(uint64_t             hostDmaAddr,
+				hostres_pagetable_cb completion_cb,
+				void                *cb_ctx)
+{
+	struct hostres_pgt_entry *entry;
+	struct hostres_pgt_waiter *w;
+	struct sg_table *host_sgt;
+	uint64_t total_size;
+	int res;
+
+	w = kzalloc(sizeof(*w), GFP_KERNEL);
+	if (unlikely(w == NULL))
+		return -ENOMEM;
+	w->completion_cb = completion_cb;
+	w->cb_ctx = cb_ctx;
+
+	mutex_lock(&s_hostres_pgt_lock);
+	entry = hostres_pgt_find(hostDmaAddr);
+	if (entry != NULL) {
+		entry->refcount++;
+		SPH_SW_COUNTER_ATOMIC_INC(g_nnp_sw_counters, SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT);
+		if (!entry->ready) {
+			/* page list is being retrieved, complete when done */
+			list_add_tail(&w->node, &entry->waiters);
+			mutex_unlock(&s_hostres_pgt_lock);
+			return 0;
+		}
+		host_sgt = &entry->host_sgt;
+		total_size = entry->total_size;
+		NNP_SW_COUNTER_ATOMIC_ADD(g_nnp_sw_counters,
+					  SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_BYTES_SAVED,
+					  entry->list_bytes);
+		mutex_unlock(&s_hostres_pgt_lock);
+
+		kfree(w);
+		completion_cb(cb_ctx, 0, host_sgt, total_size);
+		return 0;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (unlikely(entry == NULL)) {
+		mutex_unlock(&s_hostres_pgt_lock);
+		kfree(w);
+		return -ENOMEM;
+	}
+	entry->host_addr = hostDmaAddr;
+	entry->refcount = 1;
+	INIT_LIST_HEAD(&entry->waiters);
+	list_add_tail(&w->node, &entry->waiters);
+	hash_add(s_hostres_pgt_hash, &entry->hash_node, hostDmaAddr);
+	mutex_unlock(&s_hostres_pgt_lock);
+
+	SPH_SW_COUNTER_ATOMIC_INC(g_nnp_sw_counters, SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS);
+
+	res = sphcs_retrieve_hostres_pagetable(hostDmaAddr,
+					       hostres_pgt_loaded_cb,
+					       entry);
+	if (unlikely(res < 0)) {
+		/* fail the waiters joined meanwhile, the caller gets res */
+		mutex_lock(&s_hostres_pgt_lock);
+		list_del(&w->node);
+		mutex_unlock(&s_hostres_pgt_lock);
+		kfree(w);
+		hostres_pgt_loaded_cb(entry, NNP_IPC_NO_MEMORY, NULL, 0);
+	}
+
+	return res;
+}
+
+void sphcs_put_hostres_pagetable(uint64_t hostDmaAddr)
+{
+	struct hostres_pgt_entry *entry;
+
+	mutex_lock(&s_hostres_pgt_lock);
+	entry = hostres_pgt_find(hostDmaAddr);
+	NNP_ASSERT(entry != NULL && entry->ready && entry->refcount > 0);
+	if (unlikely(entry == NULL)) {
+		mutex_unlock(&s_hostres_pgt_lock);
+		return;
+	}
+
+	if (--entry->refcount > 0) {
+		mutex_unlock(&s_hostres_pgt_lock);
+		return;
+	}
+
+	hash_del(&entry->hash_node);
+	mutex_unlock(&s_hostres_pgt_lock);
+
+	sg_free_table(&entry->host_sgt);
+	kfree(entry);
+}
+
 static void sphcs_host_disconnect_work_handler(struct work_struct *work);
 
 static int sphcs_create_sphcs(void                           *hw_handle,
@@ -124,5 +124,16 @@ int sphcs_retrieve_hostres_pagetable(uint64_t             hostDmaAddr,
 				     hostres_pagetable_cb completion_cb,
 				     void                *cb_ctx);
 
+/*
+ * Cached variant of sphcs_retrieve_hostres_pagetable, the sg table is shared
+ * by all users of the same host page list and must not be freed by them,
+ * each successful get is released by sphcs_put_hostres_pagetable.
+ */
+int sphcs_get_hostres_pagetable(uint64_t             hostDmaAddr,
+				hostres_pagetable_cb completion_cb,
+				void                *cb_ctx);
+
+void sphcs_put_hostres_pagetable(uint64_t hostDmaAddr);
+
 struct sphcs_cmd_chan *sphcs_find_channel(struct sphcs *sphcs, uint16_t protocol_id);
 #endif
@@ -24,6 +24,9 @@
 #include <linux/file.h>
 #include <linux/hashtable.h>
 #include <linux/atomic.h>
+#include <linux/mm.h>
+#include <linux/eventfd.h>
+#include <linux/dma-mapping.h>
 #include "dma_page_pool.h"
 #include "sphcs_cs.h"
 #include "ipc_protocol.h"
@@ -35,6 +38,11 @@
 
 #define SPH_MAX_GENERIC_SERVICES (32UL + 256UL)
 
+/* limits of the mmap-able channel write ring */
+#define SPH_GENMSG_RING_MAX_PAGES 256
+/* max number of pages transferred by a single ring DMA request */
+#define SPH_GENMSG_RING_MAX_SPAN_PAGES 16
+
 static struct cdev s_cdev;
 static dev_t       s_devnum;
 static struct class *s_class;
@@ -140,6 +148,13 @@ struct channel_data {
 	wait_queue_head_t write_waitq;
 	atomic_t          n_write_dma_req;
 	struct mutex      write_lock;
+
+	/* mmap-able write ring, user produces data directly into it */
+	void             *ring_vptr;
+	dma_addr_t        ring_dma_addr;
+	u32               ring_size;
+	struct eventfd_ctx *ring_eventfd;
+	atomic64_t        ring_completed_bytes;
 };
 
 struct service_data {
@@ -172,6 +187,11 @@ struct dma_req_user_data {
 	};
 };
 
+struct ring_dma_user_data {
+	struct channel_data *channel;
+	u32                  xfer_size;
+};
+
 static void sphcs_chan_genmsg_hangup(struct sphcs_cmd_chan *chan, void *cb_ctx);
 
 static void free_channel(struct kref *kref)
@@ -227,6 +247,29 @@ static int chan_response_dma_completed(struct sphcs *sphcs,
 				       int status,
 				       u32 timeUS);
 
+static int chan_ring_dma_completed(struct sphcs *sphcs,
+				   void *ctx,
+				   const void *user_data,
+				   int status,
+				   u32 timeUS);
+
+static void chan_ring_free(struct channel_data *channel)
+{
+	if (channel->ring_vptr) {
+		dma_free_coherent(g_the_sphcs->hw_device,
+				  channel->ring_size,
+				  channel->ring_vptr,
+				  channel->ring_dma_addr);
+		channel->ring_vptr = NULL;
+		channel->ring_size = 0;
+	}
+
+	if (channel->ring_eventfd) {
+		eventfd_ctx_put(channel->ring_eventfd);
+		channel->ring_eventfd = NULL;
+	}
+}
+
 /***************************************************************************
  * Connected Channel file descriptor operations
  ***************************************************************************/
@@ -276,6 +319,7 @@ static int sphcs_genmsg_chan_release(struct inode *inode, struct file *f)
 	if (channel->write_page_vptr)
 		dma_page_pool_set_page_free(g_the_sphcs->dma_page_pool, channel->write_page_hndl);
 
+	chan_ring_free(channel);
 	mutex_unlock(&channel->write_lock);
 
 	/*
@@ -586,6 +630,193 @@ static long chan_is_privileged(struct file *f, void __user *arg)
 	return 0;
 }
 
+static long chan_ring_create(struct file *f, void __user *arg)
+{
+	struct channel_data *channel = (struct channel_data *)f->private_data;
+	struct ioctl_genmsg_ring_create req;
+	struct eventfd_ctx *efd = NULL;
+	long ret = 0;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if (req.n_pages == 0 || req.n_pages > SPH_GENMSG_RING_MAX_PAGES)
+		return -EINVAL;
+
+	if (req.eventfd >= 0) {
+		efd = eventfd_ctx_fdget(req.eventfd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	mutex_lock(&channel->write_lock);
+	if (channel->ring_vptr) {
+		ret = -EEXIST;
+		goto unlock;
+	}
+
+	channel->ring_vptr = dma_alloc_coherent(g_the_sphcs->hw_device,
+						req.n_pages * NNP_PAGE_SIZE,
+						&channel->ring_dma_addr,
+						GFP_KERNEL);
+	if (!channel->ring_vptr) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	channel->ring_size = req.n_pages * NNP_PAGE_SIZE;
+	channel->ring_eventfd = efd;
+	efd = NULL;
+	atomic64_set(&channel->ring_completed_bytes, 0);
+
+unlock:
+	mutex_unlock(&channel->write_lock);
+	if (efd)
+		eventfd_ctx_put(efd);
+
+	return ret;
+}
+
+/*
+ * Sends a span of the write ring to host.
+ * The span is transferred in chunks of up to SPH_GENMSG_RING_MAX_SPAN_PAGES
+ * pages, each contiguous part of the host ring buffer is transferred by a
+ * single DMA request directly from the ring, no copy is made.
+ */
+static long chan_ring_submit(struct file *f, void __user *arg)
+{
+	struct channel_data *channel = (struct channel_data *)f->private_data;
+	struct sphcs_host_rb *resp_data_rb = &channel->cmd_chan->c2h_rb[0];
+	struct ioctl_genmsg_ring_submit req;
+	struct ring_dma_user_data dma_req_data;
+	dma_addr_t host_addr[SPH_GENMSG_RING_MAX_SPAN_PAGES];
+	uint32_t host_size[SPH_GENMSG_RING_MAX_SPAN_PAGES];
+	u32 n_sent = 0;
+	u32 n_pages, span_size, xfer_size;
+	int n, i;
+	long ret = 0;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if (channel->io_error)
+		return -EIO;
+
+	if (req.size == 0)
+		return 0;
+
+	mutex_lock(&channel->write_lock);
+
+	if (!channel->ring_vptr ||
+	    (req.offset % NNP_PAGE_SIZE) != 0 ||
+	    req.offset >= channel->ring_size ||
+	    req.size > channel->ring_size - req.offset) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	while (n_sent < req.size) {
+		if (channel->hanging_up) {
+			ret = -EPIPE;
+			break;
+		}
+
+		span_size = min_t(u32, req.size - n_sent,
+				  SPH_GENMSG_RING_MAX_SPAN_PAGES * NNP_PAGE_SIZE);
+
+		if (channel->write_host_page_valid) {
+			/* a host page is already reserved, it must be used first to keep order */
+			host_addr[0] = channel->write_host_page_addr;
+			host_size[0] = NNP_PAGE_SIZE;
+			span_size = min_t(u32, span_size, NNP_PAGE_SIZE);
+			n = 1;
+			channel->write_host_page_valid = 0;
+		} else {
+			n_pages = DIV_ROUND_UP(span_size, NNP_PAGE_SIZE);
+			n = host_rb_wait_free_space(resp_data_rb,
+						    n_pages * NNP_PAGE_SIZE,
+						    SPH_GENMSG_RING_MAX_SPAN_PAGES,
+						    host_addr,
+						    host_size);
+			if (n < 1) {
+				sph_log_err(SERVICE_LOG, "Failed to get host response pages for ring write n=%d\n", n);
+				ret = n < 0 ? n : -EFAULT;
+				break;
+			}
+			host_rb_update_free_space(resp_data_rb, n_pages * NNP_PAGE_SIZE);
+		}
+
+		for (i = 0; i < n && span_size > 0; i++) {
+			xfer_size = min_t(u32, span_size, host_size[i]);
+
+			dma_req_data.channel = channel;
+			dma_req_data.xfer_size = xfer_size;
+
+			atomic_inc(&channel->n_write_dma_req);
+			ret = sphcs_dma_sched_start_xfer_single(g_the_sphcs->dmaSched,
+								&channel->cmd_chan->c2h_dma_desc,
+								channel->ring_dma_addr + req.offset + n_sent,
+								host_addr[i],
+								xfer_size,
+								chan_ring_dma_completed,
+								NULL,
+								&dma_req_data,
+								sizeof(dma_req_data));
+			if (unlikely(ret < 0)) {
+				sph_log_err(SERVICE_LOG, "Failed to schedule ring DMA transfer\n");
+				atomic_dec(&channel->n_write_dma_req);
+				channel->io_error = true;
+				goto unlock;
+			}
+
+			n_sent += xfer_size;
+			span_size -= xfer_size;
+		}
+	}
+
+unlock:
+	mutex_unlock(&channel->write_lock);
+
+	return ret;
+}
+
+static long chan_ring_completed(struct file *f, void __user *arg)
+{
+	struct channel_data *channel = (struct channel_data *)f->private_data;
+	uint64_t completed = atomic64_read(&channel->ring_completed_bytes);
+
+	if (copy_to_user(arg, &completed, sizeof(completed)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int sphcs_genmsg_chan_mmap(struct file *f, struct vm_area_struct *vma)
+{
+	struct channel_data *channel = (struct channel_data *)f->private_data;
+	int ret;
+
+	if (unlikely(!is_channel_file(f)))
+		return -EINVAL;
+
+	mutex_lock(&channel->write_lock);
+	if (!channel->ring_vptr ||
+	    vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start > channel->ring_size) {
+		mutex_unlock(&channel->write_lock);
+		return -EINVAL;
+	}
+
+	ret = dma_mmap_coherent(g_the_sphcs->hw_device,
+				vma,
+				channel->ring_vptr,
+				channel->ring_dma_addr,
+				vma->vm_end - vma->vm_start);
+	mutex_unlock(&channel->write_lock);
+
+	return ret;
+}
+
 static long sphcs_genmsg_chan_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	long ret = 0;
@@ -600,6 +831,15 @@ static long sphcs_genmsg_chan_ioctl(struct file *f, unsigned int cmd, unsigned l
 	case IOCTL_GENMSG_IS_PRIVILEGED:
 		ret = chan_is_privileged(f, (void __user *)arg);
 		break;
+	case IOCTL_GENMSG_RING_CREATE:
+		ret = chan_ring_create(f, (void __user *)arg);
+		break;
+	case IOCTL_GENMSG_RING_SUBMIT:
+		ret = chan_ring_submit(f, (void __user *)arg);
+		break;
+	case IOCTL_GENMSG_RING_COMPLETED:
+		ret = chan_ring_completed(f, (void __user *)arg);
+		break;
 	default:
 		sph_log_err(SERVICE_LOG, "Unsupported genmsg chan IOCTL 0x%x\n", cmd);
 		ret = -EINVAL;
@@ -615,6 +855,7 @@ static const struct file_operations sphcs_genmsg_chan_fops = {
 	.write = sphcs_genmsg_chan_write,
 	.unlocked_ioctl = sphcs_genmsg_chan_ioctl,
 	.compat_ioctl = sphcs_genmsg_chan_ioctl,
+	.mmap = sphcs_genmsg_chan_mmap,
 	.poll = sphcs_genmsg_chan_poll
 };
 
@@ -1241,6 +1482,53 @@ static int chan_response_dma_completed(struct sphcs *sphcs,
 	return 0;
 }
 
+/*
+ * called when a C2H dma transfer of a write ring span is completed,
+ * sends a generic packet to host for each page of the span.
+ */
+static int chan_ring_dma_completed(struct sphcs *sphcs,
+				   void *ctx,
+				   const void *user_data,
+				   int status,
+				   u32 timeUS)
+{
+	const struct ring_dma_user_data *dma_req_user_data = (const struct ring_dma_user_data *)user_data;
+	struct channel_data *channel = dma_req_user_data->channel;
+	union c2h_ChanGenericMessaging msg2;
+	u32 left, pkt_size;
+
+	if (status == SPHCS_DMA_STATUS_FAILED) {
+		/* mark io_error on channel - next read/write will fail */
+		channel->io_error = true;
+	} else {
+		NNP_ASSERT(status == SPHCS_DMA_STATUS_DONE);
+
+		for (left = dma_req_user_data->xfer_size; left > 0; left -= pkt_size) {
+			pkt_size = min_t(u32, left, NNP_PAGE_SIZE);
+
+			msg2.value = 0LL;
+			msg2.opcode = NNP_IPC_C2H_OP_CHAN_GENERIC_MSG_PACKET;
+			msg2.chan_id = channel->cmd_chan->protocol_id;
+			msg2.rb_id = 0;
+			msg2.size = pkt_size - 1;
+			msg2.card_client_id = channel->channel_id;
+
+			sphcs_msg_scheduler_queue_add_msg(channel->cmd_chan->respq,
+							  &msg2.value, 1);
+		}
+
+		atomic64_add(dma_req_user_data->xfer_size, &channel->ring_completed_bytes);
+		if (channel->ring_eventfd)
+			eventfd_signal(channel->ring_eventfd, 1);
+	}
+
+	/* Decrement pending write dma requests - wake threads waiting for it */
+	atomic_dec_if_positive(&channel->n_write_dma_req);
+	wake_up_all(&channel->write_waitq);
+
+	return 0;
+}
+
 static void handle_cmd_dma_failed(struct genmsg_dma_command_data *dma_data)
 {
 	if (dma_data->msg.connect) {
@@ -54,6 +54,17 @@
 
 #define HWTRACE_STATE_RESOURCES_BUSY(flag)	((flag) & (HWTRACE_STATE_NPK_RESOURCE_BUSY | HWTRACE_STATE_HOST_RESOURCE_BUSY | HWTRACE_STATE_DMA_INFO_DIRTY))
 
+//max windows sent in one scatter-gather dma
+static uint32_t hwtrace_batch_windows = 4;
+module_param(hwtrace_batch_windows, uint, 0644);
+
+//max batched dmas in flight, windows getting ready meanwhile
+//wait for the next batch
+static uint32_t hwtrace_dma_depth = 2;
+module_param(hwtrace_dma_depth, uint, 0644);
+
+//max wait for in flight batches on stream fini
+#define HWTRACE_STREAM_DRAIN_TIMEOUT_MS	5000
 
 //dtf channel config for dma engine
 const struct sphcs_dma_desc g_dma_desc_c2h_dtf_nowait = {
@@ -87,7 +98,6 @@ struct dma_res_info {
 	struct page		*pages;
 	uint32_t		nr_pages;
 	struct lli_desc         lli;
-	struct sphcs_dma_multi_xfer_handle multi_xfer_handle;
 };
 
 
@@ -99,6 +109,7 @@ struct sphcs_dma_res_info {
 	struct dma_res_info		*dma_res;
 	size_t				bytes_to_copy;
 	uint32_t			state;
+	uint64_t			ready_seq;
 };
 
 //structure contain information for new resource
@@ -348,8 +359,6 @@ struct dma_res_info *sphcs_hwtrace_alloc_dma_info(struct sphcs_dma_res_info *r)
 		goto cleanup_dma_map;
 	}
 
-	sphcs_dma_multi_xfer_handle_init(&dma->multi_xfer_handle);
-
 	r->dma_res = dma;
 
 	r->state &= ~HWTRACE_STATE_DMA_INFO_DIRTY;
@@ -373,6 +382,11 @@ cleanup_dma_res_info:
 	return NULL;
 }
 
+static void sphcs_hwtrace_stream_kick(struct sphcs_hwtrace_data *hw_tracing)
+{
+	if (hw_tracing->cmd_wq)
+		queue_work(hw_tracing->cmd_wq, &hw_tracing->stream_work);
+}
 
 void sphcs_hwtrace_update_state(void)
 {
@@ -476,6 +490,9 @@ void sphcs_hwtrace_update_state(void)
 					r->state &= ~HWTRACE_STATE_NO_CLEANUP_RESOURCE;
 
 					NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+					//window may have got ready before binding
+					sphcs_hwtrace_stream_kick(hw_tracing);
 				}
 			}
 
@@ -511,12 +528,13 @@ static void sphcs_hwtrace_window_header_cleanup(struct npk_res_info *r)
 	}
 }
 
-//callback from dma engine when NPK resource to host copy via pep ended
-static int sphcs_hwtrace_dma_stream_complete_cb(struct sphcs *sphcs, void *ctx, const void *user_data, int status, u32 timeUS)
+//release window after its copy to host ended and notify host
+static void sphcs_hwtrace_window_stream_done(struct sphcs *sphcs,
+					     struct sphcs_dma_res_info *r,
+					     int status)
 {
 	struct sphcs_hwtrace_data *hw_tracing = &sphcs->hw_tracing;
 	struct sphcs_cmd_chan *chan = hw_tracing->chan;
-	struct sphcs_dma_res_info *r = (struct sphcs_dma_res_info *)ctx;
 	unsigned long flags;
 	union c2h_ChanHwTraceState chan_response_msg;
 	int hwtrace_err = NNP_HWTRACE_ERR_NO_ERR;
@@ -556,6 +574,14 @@ static int sphcs_hwtrace_dma_stream_complete_cb(struct sphcs *sphcs, void *ctx,
 
 	bytes = r->bytes_to_copy;
 
+	if (status == SPHCS_DMA_STATUS_DONE) {
+		hw_tracing->stats.windows_done++;
+		hw_tracing->stats.bytes_done += bytes;
+	} else {
+		hw_tracing->stats.windows_failed++;
+		hw_tracing->stats.bytes_failed += bytes;
+	}
+
 	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
 
 	//if status != 0 report error to host
@@ -567,7 +593,7 @@ static int sphcs_hwtrace_dma_stream_complete_cb(struct sphcs *sphcs, void *ctx,
 			sph_log_err(HWTRACE_LOG, "hwtrace dma failed for resource unknown\n");
 		}
 
-		return -EINVAL;
+		return;
 	}
 
 	//send notification to host that resource is ready for read.
@@ -587,52 +613,339 @@ static int sphcs_hwtrace_dma_stream_complete_cb(struct sphcs *sphcs, void *ctx,
 	chan_response_msg.err	= hwtrace_err;
 
 	sphcs_msg_scheduler_queue_add_msg(chan->respq, chan_response_msg.value, 2);
+}
 
-	return 0;
+//callback from dma engine when a batch of NPK resources to host copy via pep ended
+static int sphcs_hwtrace_dma_stream_complete_cb(struct sphcs *sphcs, void *ctx, const void *user_data, int status, u32 timeUS)
+{
+	struct sphcs_hwtrace_data *hw_tracing = &sphcs->hw_tracing;
+	struct sphcs_hwtrace_batch *batch = (struct sphcs_hwtrace_batch *)ctx;
+	unsigned long flags;
+	uint32_t i;
+
+	NNP_ASSERT(batch != NULL);
+
+	//windows are reported in the order they got ready
+	for (i = 0; i < batch->n; i++)
+		sphcs_hwtrace_window_stream_done(sphcs, batch->res[i], status);
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+
+	batch->n = 0;
+	batch->used = false;
+	hw_tracing->batches_in_flight--;
+
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+	wake_up(&hw_tracing->waitq);
+
+	//windows which got ready during the dma go in the next batch
+	sphcs_hwtrace_stream_kick(hw_tracing);
+
+	return status == SPHCS_DMA_STATUS_DONE ? 0 : -EINVAL;
 }
 
-//function handle streaming NPK resource to host
-void do_stream_hwtrace(struct sphcs_dma_res_info *r)
+static inline bool hwtrace_window_streamable(struct sphcs_dma_res_info *r)
+{
+	if (!r->host_res || !r->npk_res || !r->dma_res)
+		return false;
+
+	if (HWTRACE_STATE_RESOURCES_BUSY(r->state))
+		return false;
+
+	//if there is no NPK RESOURCE ready - no need to send dma to host
+	return (r->state & HWTRACE_STATE_NPK_RESOURCE_READY) != 0;
+}
+
+//pick ready windows in the order they got ready, called with lock_irq held
+static uint32_t hwtrace_batch_collect(struct sphcs_hwtrace_data *hw_tracing,
+				      struct sphcs_hwtrace_batch *batch,
+				      uint32_t max_windows)
+{
+	struct sphcs_dma_res_info *r, *next;
+
+	batch->n = 0;
+	batch->bytes = 0;
+
+	while (batch->n < max_windows) {
+		next = NULL;
+		list_for_each_entry(r,
+				    &hw_tracing->dma_stream_list,
+				    node) {
+			if (!hwtrace_window_streamable(r))
+				continue;
+			if (!next || r->ready_seq < next->ready_seq)
+				next = r;
+		}
+
+		if (!next)
+			break;
+
+		//remove NPK RESOURCE READY, and change to NPK RESOURCE BUSY
+		next->state &= ~HWTRACE_STATE_NPK_RESOURCE_READY;
+
+		//set NPK RESOURCE BUSY and HOST RESOURCE BUSY during dma
+		//once dma is completed npk resource busy is unset
+		//host resource busy is unset after unlock from host
+		next->state |= (HWTRACE_STATE_NPK_RESOURCE_BUSY |
+				HWTRACE_STATE_HOST_RESOURCE_BUSY);
+
+		if (next->bytes_to_copy > next->host_res->resource_size)
+			next->bytes_to_copy = next->host_res->resource_size;
+
+		hw_tracing->requests_in_flight++;
+
+		batch->res[batch->n++] = next;
+		batch->bytes += next->bytes_to_copy;
+	}
+
+	return batch->n;
+}
+
+//return windows beyond n to ready state, called with lock_irq held
+static void hwtrace_batch_trim(struct sphcs_hwtrace_data *hw_tracing,
+			       struct sphcs_hwtrace_batch *batch,
+			       uint32_t n)
+{
+	struct sphcs_dma_res_info *r;
+
+	while (batch->n > n) {
+		r = batch->res[--batch->n];
+		r->state &= ~(HWTRACE_STATE_NPK_RESOURCE_BUSY |
+			      HWTRACE_STATE_HOST_RESOURCE_BUSY);
+		r->state |= HWTRACE_STATE_NPK_RESOURCE_READY;
+		hw_tracing->requests_in_flight--;
+		batch->bytes -= r->bytes_to_copy;
+	}
+}
+
+static bool hwtrace_batch_get_next(void             *ctx,
+				   struct sg_table **out_src,
+				   struct sg_table **out_dst,
+				   uint64_t         *out_max_size)
 {
+	struct sphcs_hwtrace_batch *batch = (struct sphcs_hwtrace_batch *)ctx;
+	struct sphcs_dma_res_info *r;
+
+	if (batch->iter >= batch->n)
+		return false;
+
+	r = batch->res[batch->iter++];
+
+	//copy only the part of the window filled with trace data
+	*out_src = r->dma_res->sgt;
+	*out_dst = &r->host_res->sgt;
+	*out_max_size = r->bytes_to_copy ? r->bytes_to_copy : r->host_res->resource_size;
+
+	return true;
+}
+
+static int hwtrace_batch_start_dma(struct sphcs_hwtrace_data *hw_tracing,
+				   struct sphcs_hwtrace_batch *batch)
+{
+	struct lli_desc *lli = &batch->lli;
+	uint64_t transfer_size = 0;
+	unsigned long flags;
 	int ret;
+
+	batch->iter = 0;
+	ret = g_the_sphcs->hw_ops->dma.init_lli_vec(g_the_sphcs->hw_handle,
+						    lli,
+						    0,
+						    hwtrace_batch_get_next,
+						    batch);
+
+	//lli buffer of the batch is kept and grows as needed
+	if (ret == 0 && lli->size > batch->lli_alloc_size) {
+		if (lli->vptr)
+			dma_free_coherent(g_the_sphcs->hw_device,
+					  batch->lli_alloc_size,
+					  lli->vptr,
+					  lli->dma_addr);
+
+		batch->lli_alloc_size = 0;
+		lli->vptr = dma_alloc_coherent(g_the_sphcs->hw_device,
+					       lli->size,
+					       &lli->dma_addr,
+					       GFP_KERNEL);
+		if (lli->vptr)
+			batch->lli_alloc_size = lli->size;
+	}
+
+	if (ret == 0 && lli->vptr) {
+		batch->iter = 0;
+		transfer_size = g_the_sphcs->hw_ops->dma.gen_lli_vec(g_the_sphcs->hw_handle,
+								     lli,
+								     0,
+								     hwtrace_batch_get_next,
+								     batch);
+	}
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+
+	//unable to batch - send first window with its own lli,
+	//the rest are picked by the next batch
+	if (transfer_size == 0) {
+		hwtrace_batch_trim(hw_tracing, batch, 1);
+		lli = &batch->res[0]->dma_res->lli;
+		transfer_size = batch->res[0]->host_res->resource_size;
+		hw_tracing->stats.batch_fallback++;
+	}
+
+	hw_tracing->stats.batches++;
+	hw_tracing->stats.windows_dma += batch->n;
+	hw_tracing->stats.bytes_dma += transfer_size;
+	if (batch->n > hw_tracing->stats.max_batch)
+		hw_tracing->stats.max_batch = batch->n;
+
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+	sphcs_dma_multi_xfer_handle_init(&batch->multi_xfer_handle);
+
+	//now we start dma transaction from card to host.
+	return sphcs_dma_sched_start_xfer_multi(g_the_sphcs->dmaSched,
+						&batch->multi_xfer_handle,
+						&g_dma_desc_c2h_dtf_nowait,
+						lli,
+						transfer_size,
+						sphcs_hwtrace_dma_stream_complete_cb,
+						batch);
+}
+
+//stream ready windows to host, several windows per dma
+//and up to hwtrace_dma_depth dmas in flight
+static void hwtrace_stream_work_handler(struct work_struct *work)
+{
+	struct sphcs_hwtrace_data *hw_tracing = container_of(work,
+							     struct sphcs_hwtrace_data,
+							     stream_work);
+	uint32_t depth = clamp_t(uint32_t, hwtrace_dma_depth, 1, SPHCS_HWTRACE_MAX_DMA_DEPTH);
+	uint32_t max_windows = clamp_t(uint32_t, hwtrace_batch_windows, 1, SPHCS_HWTRACE_MAX_BATCH);
+	struct sphcs_hwtrace_batch *batch;
+	unsigned long flags;
+	int i, ret;
+
+	while (true) {
+		batch = NULL;
+
+		NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+
+		if (!hw_tracing->stream_stopped &&
+		    hw_tracing->batches_in_flight < depth) {
+			for (i = 0; i < SPHCS_HWTRACE_MAX_DMA_DEPTH; i++) {
+				if (!hw_tracing->batch[i].used) {
+					batch = &hw_tracing->batch[i];
+					break;
+				}
+			}
+		}
+
+		if (batch && hwtrace_batch_collect(hw_tracing, batch, max_windows) > 0) {
+			batch->used = true;
+			hw_tracing->batches_in_flight++;
+		} else {
+			batch = NULL;
+		}
+
+		NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+		if (!batch)
+			break;
+
+		ret = hwtrace_batch_start_dma(hw_tracing, batch);
+		if (ret) {
+			sph_log_err(HWTRACE_LOG, "dma from card to host failed\n err = %d", ret);
+			sphcs_hwtrace_dma_stream_complete_cb(g_the_sphcs, batch, NULL, SPHCS_DMA_STATUS_FAILED, 0);
+		}
+	}
+}
+
+//function handle streaming NPK resource to host, called with lock_irq held.
+//the dma itself is started by the stream work
+void do_stream_hwtrace(struct sphcs_dma_res_info *r)
+{
 	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
 
 	NNP_ASSERT(r != NULL);
 	if (unlikely(r == NULL))
 		return;
 
-	if (!r->host_res || !r->npk_res || !r->dma_res)
+	if (!hwtrace_window_streamable(r))
 		return;
 
-	if (HWTRACE_STATE_RESOURCES_BUSY(r->state))
-		return;
+	sphcs_hwtrace_stream_kick(hw_tracing);
+}
 
-	//if there is no NPK RESOURCE ready - no need to send dma to host
-	if (!(r->state & HWTRACE_STATE_NPK_RESOURCE_READY))
-		return;
+void sphcs_hwtrace_stream_init(struct sphcs_hwtrace_data *hw_tracing)
+{
+	int i;
 
-	//remove NPK RESOURCE READY, and change to NPK RESOURCE BUSY
-	r->state &= ~HWTRACE_STATE_NPK_RESOURCE_READY;
+	INIT_WORK(&hw_tracing->stream_work, hwtrace_stream_work_handler);
 
-	//set NPK RESOURCE BUSY and HOST RESOURCE BUSY during dma
-	//once dma is completed npk resource busy is unset
-	//host resource busy is unset after unlock from host
-	r->state |= (HWTRACE_STATE_NPK_RESOURCE_BUSY |
-		     HWTRACE_STATE_HOST_RESOURCE_BUSY);
+	hw_tracing->batches_in_flight = 0;
+	hw_tracing->stream_stopped = false;
+	hw_tracing->ready_seq = 0;
+	memset(&hw_tracing->stats, 0, sizeof(hw_tracing->stats));
 
-	hw_tracing->requests_in_flight++;
+	for (i = 0; i < SPHCS_HWTRACE_MAX_DMA_DEPTH; i++) {
+		memset(&hw_tracing->batch[i], 0, sizeof(hw_tracing->batch[i]));
+		sphcs_dma_multi_xfer_handle_init(&hw_tracing->batch[i].multi_xfer_handle);
+	}
+}
 
-	//now we start dma transaction from card to host.
-	ret = sphcs_dma_sched_start_xfer_multi(g_the_sphcs->dmaSched,
-					       &r->dma_res->multi_xfer_handle,
-					       &g_dma_desc_c2h_dtf_nowait,
-					       &r->dma_res->lli,
-					       r->host_res->resource_size,
-					       sphcs_hwtrace_dma_stream_complete_cb,
-					       r);
-	if (ret)
-		sph_log_err(HWTRACE_LOG, "dma from card to host failed\n err = %d", ret);
+static bool hwtrace_stream_idle(struct sphcs_hwtrace_data *hw_tracing)
+{
+	unsigned long flags;
+	bool idle;
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+	idle = (hw_tracing->batches_in_flight == 0);
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+	return idle;
+}
+
+//the trace source must be stopped first, no new windows get ready.
+//stops batching and waits for the batches in flight before
+//the lli buffers are freed. returns -ETIMEDOUT if dma is still
+//running, windows and workqueue must then be kept
+int sphcs_hwtrace_stream_fini(struct sphcs_hwtrace_data *hw_tracing)
+{
+	struct sphcs_hwtrace_batch *batch;
+	unsigned long flags;
+	int i, ret = 0;
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+	hw_tracing->stream_stopped = true;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
 
+	cancel_work_sync(&hw_tracing->stream_work);
+
+	if (!wait_event_timeout(hw_tracing->waitq,
+				hwtrace_stream_idle(hw_tracing),
+				msecs_to_jiffies(HWTRACE_STREAM_DRAIN_TIMEOUT_MS))) {
+		sph_log_err(HWTRACE_LOG, "%u hwtrace batches still in flight\n",
+			    hw_tracing->batches_in_flight);
+		ret = -ETIMEDOUT;
+	}
+
+	//completions of the last batches may have queued the stream work
+	cancel_work_sync(&hw_tracing->stream_work);
+
+	for (i = 0; i < SPHCS_HWTRACE_MAX_DMA_DEPTH; i++) {
+		batch = &hw_tracing->batch[i];
+		if (!batch->lli.vptr || batch->used)
+			continue;
+
+		dma_free_coherent(g_the_sphcs->hw_device,
+				  batch->lli_alloc_size,
+				  batch->lli.vptr,
+				  batch->lli.dma_addr);
+		batch->lli.vptr = NULL;
+		batch->lli_alloc_size = 0;
+	}
+
+	return ret;
 }
 
 
@@ -857,15 +1170,24 @@ int intel_th_window_ready(void *priv, struct sg_table *sgt, size_t bytes)
 		if (r->npk_res &&
 		    r->npk_res->sgt == sgt) {
 			bFound = true;
+			//window reported again before it was streamed
+			if (r->state & (HWTRACE_STATE_NPK_RESOURCE_READY |
+					HWTRACE_STATE_NPK_RESOURCE_BUSY))
+				hw_tracing->stats.windows_overrun++;
 			r->state |= HWTRACE_STATE_NPK_RESOURCE_READY;
 			r->bytes_to_copy = bytes;
+			r->ready_seq = hw_tracing->ready_seq++;
 			break;
 		}
 	}
 
 	if (bFound) {
 		hw_tracing->npk_resources_ready++;
+		hw_tracing->stats.windows_ready++;
+		hw_tracing->stats.bytes_ready += bytes;
 		do_stream_hwtrace(r);
+	} else {
+		hw_tracing->stats.windows_unknown++;
 	}
 
 	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
@@ -1432,6 +1754,21 @@ static int debug_status_show(struct seq_file *m, void *v)
 	seq_printf(m, "number of host resources mapped to npk resource  %u\n", host_res_count);
 	seq_printf(m, "npk resources count  %u\n", dma_stream_list_count);
 	seq_printf(m, "npk nr_pool_pages %u\n", hw_tracing->nr_pool_pages);
+	seq_printf(m, "stream ready windows %llu bytes %llu\n",
+		   hw_tracing->stats.windows_ready, hw_tracing->stats.bytes_ready);
+	seq_printf(m, "stream dropped unknown windows %llu\n",
+		   hw_tracing->stats.windows_unknown);
+	seq_printf(m, "stream overrun windows %llu\n",
+		   hw_tracing->stats.windows_overrun);
+	seq_printf(m, "stream dma windows %llu bytes %llu batches %llu fallback %llu max batch %u\n",
+		   hw_tracing->stats.windows_dma, hw_tracing->stats.bytes_dma,
+		   hw_tracing->stats.batches, hw_tracing->stats.batch_fallback,
+		   hw_tracing->stats.max_batch);
+	seq_printf(m, "stream done windows %llu bytes %llu\n",
+		   hw_tracing->stats.windows_done, hw_tracing->stats.bytes_done);
+	seq_printf(m, "stream dropped failed windows %llu bytes %llu\n",
+		   hw_tracing->stats.windows_failed, hw_tracing->stats.bytes_failed);
+	seq_printf(m, "stream batches in flight %u\n", hw_tracing->batches_in_flight);
 
 	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
 	return 0;
@@ -23,10 +23,16 @@
 #include "ipc_protocol.h"
 #include "ipc_chan_protocol.h"
 #include <linux/wait.h>
+#include <linux/workqueue.h>
+#include "sphcs_dma_sched.h"
 
 #define HWTRACING_POOL_MEMORY_SIZE ((uint32_t)(1U<<20))
 #define SPHCS_HWTRACING_MAX_POOL_LENGTH 10
 
+//max windows batched into one dma and max dma batches in flight
+#define SPHCS_HWTRACE_MAX_BATCH		SPHCS_HWTRACING_MAX_POOL_LENGTH
+#define SPHCS_HWTRACE_MAX_DMA_DEPTH	4
+
 
 struct sphcs;
 struct device;
@@ -36,6 +42,37 @@ struct sphcs_hwtrace_mem_pool {
 	uint32_t	used;
 };
 
+struct sphcs_dma_res_info;
+
+//several ready windows streamed to host in one scatter-gather dma
+struct sphcs_hwtrace_batch {
+	struct sphcs_dma_res_info	*res[SPHCS_HWTRACE_MAX_BATCH];
+	uint32_t			n;
+	uint32_t			iter;
+	uint64_t			bytes;
+	bool				used;
+	struct lli_desc			lli;
+	uint32_t			lli_alloc_size;
+	struct sphcs_dma_multi_xfer_handle multi_xfer_handle;
+};
+
+//per stage counters of the streaming pipeline
+struct sphcs_hwtrace_stream_stats {
+	uint64_t	windows_ready;
+	uint64_t	bytes_ready;
+	uint64_t	windows_unknown;
+	uint64_t	windows_overrun;
+	uint64_t	windows_dma;
+	uint64_t	bytes_dma;
+	uint64_t	windows_done;
+	uint64_t	bytes_done;
+	uint64_t	windows_failed;
+	uint64_t	bytes_failed;
+	uint64_t	batches;
+	uint64_t	batch_fallback;
+	uint32_t	max_batch;
+};
+
 struct sphcs_hwtrace_data {
 	struct list_head	dma_stream_list;
 	struct sphcs_cmd_chan	*chan;
@@ -50,6 +87,12 @@ struct sphcs_hwtrace_data {
 	wait_queue_head_t waitq;
 	struct workqueue_struct *cmd_wq;
 	spinlock_t lock_irq;
+	struct work_struct	stream_work;
+	uint32_t		batches_in_flight;
+	bool			stream_stopped;
+	uint64_t		ready_seq;
+	struct sphcs_hwtrace_batch batch[SPHCS_HWTRACE_MAX_DMA_DEPTH];
+	struct sphcs_hwtrace_stream_stats stats;
 };
 
 void *intel_th_assign_mode(struct device *intel_th_dev, int *mode);
@@ -66,6 +109,10 @@ void intel_th_deactivate(void *priv);
 
 int intel_th_window_ready(void *priv, struct sg_table *sgt, size_t bytes);
 
+void sphcs_hwtrace_stream_init(struct sphcs_hwtrace_data *hw_tracing);
+
+int sphcs_hwtrace_stream_fini(struct sphcs_hwtrace_data *hw_tracing);
+
 void hwtrace_init_debugfs(struct sphcs_hwtrace_data *hw_tracing,
 				struct dentry *parent,
 				const char    *dirname);
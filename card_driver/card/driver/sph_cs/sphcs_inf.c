@@ -685,6 +685,141 @@ fail_attach:
 	return ret;
 }
 
+static long infreq_exec_done_check(struct file *f,
+				   const struct inf_infreq_exec_done *reply,
+				   struct inf_req_completion *cpl)
+{
+	struct inf_req *infreq;
+	struct inf_exec_req *req;
+	int err = 0;
+
+	infreq = (struct inf_req *)id2ptr(reply->infreq_drv_handle);
+	if (unlikely(!is_inf_req_ptr(infreq)))
+		return -EINVAL;
+
+	if (reply->i_error_msg_size > 2*NNP_PAGE_SIZE)
+		return -EINVAL;
+
+	req = infreq->active_req;
+	NNP_ASSERT(req != NULL);
+	if (unlikely(req == NULL))
+		return -EINVAL;
+
+#ifdef _DEBUG
+	if (unlikely(!is_inf_context_ptr(f->private_data)))
+		return -EINVAL;
+	if (unlikely(reply->infreq_ctx_id !=
+	    ((struct inf_context *)f->private_data)->protocol_id))
+		return -EINVAL;
+#endif
+
+	switch (reply->i_sphcs_err) {
+	case IOCTL_SPHCS_NO_ERROR: {
+		err = 0;
+		break;
+	}
+	case IOCTL_SPHCS_NOT_SUPPORTED: {
+		err = -NNPER_NOT_SUPPORTED;
+		break;
+	}
+	case IOCTL_SPHCS_INFER_EXEC_ERROR: {
+		err = -NNPER_INFER_EXEC_ERROR;
+		break;
+	}
+	case IOCTL_SPHCS_INFER_ICEDRV_ERROR: {
+		err = -NNPER_INFER_ICEDRV_ERROR;
+		break;
+	}
+	case IOCTL_SPHCS_INFER_ICEDRV_ERROR_RESET: {
+		err = -NNPER_INFER_ICEDRV_ERROR_RESET;
+		break;
+	}
+	case IOCTL_SPHCS_INFER_ICEDRV_ERROR_CARD_RESET: {
+		err = -NNPER_INFER_ICEDRV_ERROR_CARD_RESET;
+		break;
+	}
+	case IOCTL_SPHCS_INFER_SCHEDULE_ERROR: {
+		err = -NNPER_INFER_SCHEDULE_ERROR;
+		break;
+	}
+	default:
+		err = -EFAULT;
+	}
+	cpl->req = req;
+	cpl->err = err;
+	cpl->error_msg = reply->i_error_msg;
+	cpl->error_msg_size = (reply->i_error_msg_size > 0 ? -reply->i_error_msg_size : 0);
+
+	return 0;
+}
+
+static long infreq_exec_done(struct file *f,
+			     const struct inf_infreq_exec_done *reply)
+{
+	struct inf_req_completion cpl;
+	long ret;
+
+	ret = infreq_exec_done_check(f, reply, &cpl);
+	if (unlikely(ret < 0))
+		return ret;
+
+	inf_req_complete(cpl.req, cpl.err, cpl.error_msg, cpl.error_msg_size);
+
+	return 0;
+}
+
+static long infreq_exec_done_batch(struct file *f, void __user *arg)
+{
+	struct inf_infreq_exec_done_batch batch;
+	struct inf_infreq_exec_done *replies;
+	struct inf_req_completion *cpl;
+	uint32_t i, j;
+	long ret;
+
+	ret = copy_from_user(&batch, arg, sizeof(batch));
+	if (unlikely(ret != 0))
+		return -EIO;
+
+	if (unlikely(batch.num_completions == 0 ||
+		     batch.num_completions > INF_EXEC_DONE_BATCH_MAX))
+		return -EINVAL;
+
+	replies = kmalloc_array(batch.num_completions,
+				sizeof(*replies) + sizeof(*cpl),
+				GFP_KERNEL);
+	if (unlikely(replies == NULL))
+		return -ENOMEM;
+	cpl = (struct inf_req_completion *)(replies + batch.num_completions);
+
+	ret = copy_from_user(replies,
+			     (void __user *)batch.completions,
+			     batch.num_completions * sizeof(*replies));
+	if (unlikely(ret != 0)) {
+		ret = -EIO;
+		goto done;
+	}
+
+	for (i = 0; i < batch.num_completions; i++) {
+		ret = infreq_exec_done_check(f, &replies[i], &cpl[i]);
+		if (unlikely(ret < 0))
+			goto done;
+
+		/* a request may be completed only once */
+		for (j = 0; j < i; j++) {
+			if (unlikely(cpl[j].req == cpl[i].req)) {
+				ret = -EINVAL;
+				goto done;
+			}
+		}
+	}
+
+	inf_req_complete_batch(cpl, batch.num_completions);
+
+done:
+	kfree(replies);
+	return ret;
+}
+
 static long sphcs_inf_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	long ret;
@@ -1032,72 +1167,58 @@ failed_infreq:
 	}
 	case IOCTL_INF_INFREQ_EXEC_DONE: {
 		struct inf_infreq_exec_done reply;
-		struct inf_req *infreq;
-		struct inf_exec_req *req;
-		int err = 0;
 
 		ret = copy_from_user(&reply,
 				     (void __user *)arg,
 				     sizeof(reply));
 		if (unlikely(ret != 0))
 			return -EIO;
-		infreq = (struct inf_req *)id2ptr(reply.infreq_drv_handle);
-		if (unlikely(!is_inf_req_ptr(infreq)))
-			return -EINVAL;
 
-		if (reply.i_error_msg_size > 2*NNP_PAGE_SIZE)
-			return -EINVAL;
+		return infreq_exec_done(f, &reply);
+	}
+	case IOCTL_INF_INFREQ_EXEC_DONE_BATCH:
+		return infreq_exec_done_batch(f, (void __user *)arg);
+	case IOCTL_INF_SETUP_RING: {
+		struct inf_ring_setup setup;
 
-		req = infreq->active_req;
-		NNP_ASSERT(req != NULL);
-		if (unlikely(req == NULL))
+		if (unlikely(!is_inf_context_ptr(f->private_data)))
 			return -EINVAL;
+		context = (struct inf_context *)f->private_data;
+
+		ret = inf_cmd_queue_ring_setup(&context->cmdq, &setup.mmap_size);
+		if (unlikely(ret < 0))
+			return ret;
+
+		ret = copy_to_user((void __user *)arg, &setup, sizeof(setup));
+		if (unlikely(ret != 0))
+			return -EIO;
+		break;
+	}
+	case IOCTL_INF_RING_KICK: {
+		struct inf_infreq_exec_done reply;
+		struct inf_ring_cpl cpl;
+		long err = 0;
 
-#ifdef _DEBUG
 		if (unlikely(!is_inf_context_ptr(f->private_data)))
 			return -EINVAL;
-		if (unlikely(reply.infreq_ctx_id !=
-		    ((struct inf_context *)f->private_data)->protocol_id))
-			return -EINVAL;
-#endif
-
-		switch (reply.i_sphcs_err) {
-		case IOCTL_SPHCS_NO_ERROR: {
-			err = 0;
-			break;
-		}
-		case IOCTL_SPHCS_NOT_SUPPORTED: {
-			err = -NNPER_NOT_SUPPORTED;
-			break;
-		}
-		case IOCTL_SPHCS_INFER_EXEC_ERROR: {
-			err = -NNPER_INFER_EXEC_ERROR;
-			break;
-		}
-		case IOCTL_SPHCS_INFER_ICEDRV_ERROR: {
-			err = -NNPER_INFER_ICEDRV_ERROR;
-			break;
-		}
-		case IOCTL_SPHCS_INFER_ICEDRV_ERROR_RESET: {
-			err = -NNPER_INFER_ICEDRV_ERROR_RESET;
-			break;
+		context = (struct inf_context *)f->private_data;
+
+		/* completions in the ring carry no error message */
+		reply.i_error_msg = NULL;
+		reply.i_error_msg_size = 0;
+
+		mutex_lock(&context->cmdq.ring_cpl_lock);
+		while (inf_cmd_queue_ring_cpl_pop(&context->cmdq, &cpl)) {
+			reply.infreq_drv_handle = cpl.infreq_drv_handle;
+			reply.infreq_ctx_id = cpl.infreq_ctx_id;
+			reply.i_sphcs_err = cpl.i_sphcs_err;
+			ret = infreq_exec_done(f, &reply);
+			if (unlikely(ret < 0 && err == 0))
+				err = ret;
 		}
-		case IOCTL_SPHCS_INFER_ICEDRV_ERROR_CARD_RESET: {
-			err = -NNPER_INFER_ICEDRV_ERROR_CARD_RESET;
-			break;
-		}
-		case IOCTL_SPHCS_INFER_SCHEDULE_ERROR: {
-			err = -NNPER_INFER_SCHEDULE_ERROR;
-			break;
-		}
-		default:
-			err = -EFAULT;
-		}
-		inf_req_complete(req, err,
-				 reply.i_error_msg,
-				 (reply.i_error_msg_size > 0 ? -reply.i_error_msg_size : 0));
+		mutex_unlock(&context->cmdq.ring_cpl_lock);
 
-		break;
+		return err;
 	}
 	case IOCTL_INF_ERROR_EVENT: {
 		struct inf_error_ioctl err_ioctl;
@@ -1199,6 +1320,23 @@ failed_infreq:
 		}
 		break;
 	}
+	case IOCTL_INF_CMDQ_BULK_READ: {
+		uint32_t enable;
+
+		ret = copy_from_user(&enable,
+				     (void __user *)arg,
+				     sizeof(enable));
+		if (unlikely(ret != 0))
+			return -EIO;
+
+		if (f->private_data == g_the_sphcs->inf_data->daemon)
+			inf_cmd_queue_set_bulk_read(&g_the_sphcs->inf_data->daemon->cmdq, enable != 0);
+		else if (likely(is_inf_context_ptr(f->private_data)))
+			inf_cmd_queue_set_bulk_read(&((struct inf_context *)f->private_data)->cmdq, enable != 0);
+		else
+			return -EINVAL;
+		break;
+	}
 	case IOCTL_INF_GET_ALLOC_PGT:
 		return handle_get_alloc_pgt((void __user *)arg);
 	default:
@@ -1231,6 +1369,20 @@ static unsigned int sphcs_inf_poll(struct file *f, struct poll_table_struct *pt)
 
 }
 
+static int sphcs_inf_mmap(struct file *f, struct vm_area_struct *vma)
+{
+	struct inf_context *context;
+
+	if (unlikely(!is_inf_file(f)))
+		return -EINVAL;
+
+	if (unlikely(!is_inf_context_ptr(f->private_data)))
+		return -EINVAL;
+	context = (struct inf_context *)f->private_data;
+
+	return inf_cmd_queue_ring_mmap(&context->cmdq, vma);
+}
+
 
 static ssize_t sphcs_inf_read(struct file *f,
 			      char __user *buf,
@@ -4051,7 +4203,8 @@ static const struct file_operations sphcs_inf_fops = {
 	.unlocked_ioctl = sphcs_inf_ioctl,
 	.compat_ioctl = sphcs_inf_ioctl,
 	.poll = sphcs_inf_poll,
-	.read = sphcs_inf_read
+	.read = sphcs_inf_read,
+	.mmap = sphcs_inf_mmap
 };
 
 static inline int is_inf_file(struct file *f)
@@ -4241,10 +4394,14 @@ int inference_init(struct sphcs *sphcs)
 		goto free_mutex;
 	}
 
+	ret = inf_cmd_queue_caches_init();
+	if (ret)
+		goto free_ctx_uids;
+
 	inf_data->inf_wq = create_singlethread_workqueue("sphcs_inf_wq");
 	if (!inf_data->inf_wq) {
 		sph_log_err(START_UP_LOG, "Failed to initialize ctx create/destroy workqueue");
-		goto free_ctx_uids;
+		goto free_cmd_caches;
 	}
 
 	sphcs->inf_data = inf_data;
@@ -4259,6 +4416,8 @@ int inference_init(struct sphcs *sphcs)
 
 destroy_wq:
 	destroy_workqueue(sphcs->inf_data->inf_wq);
+free_cmd_caches:
+	inf_cmd_queue_caches_fini();
 free_ctx_uids:
 	sphcs_ctx_uids_fini();
 free_mutex:
@@ -4282,6 +4441,7 @@ int inference_fini(struct sphcs *sphcs)
 	sphcs_p2p_fini(sphcs);
 	sphcs_ctx_uids_fini();
 	destroy_workqueue(sphcs->inf_data->inf_wq);
+	inf_cmd_queue_caches_fini();
 	device_destroy(s_class, s_devnum);
 	class_destroy(s_class);
 	cdev_del(&s_cdev);
@@ -4476,6 +4636,102 @@ static const struct file_operations ctx_status_fops = {
 	.release	= single_release,
 };
 
+static void exec_graph_show_req(struct seq_file *m, struct inf_exec_req *req)
+{
+	if (req->cmd_type == CMDLIST_CMD_INFREQ)
+		seq_printf(m, "infreq %d network %d", req->infreq->protocol_id, req->infreq->devnet->protocol_id);
+	else if (req->cmd_type == CMDLIST_CMD_COPY)
+		seq_printf(m, "copy %d", req->copy->protocol_id);
+	else if (req->cmd_type == CMDLIST_CMD_COPYLIST)
+		seq_printf(m, "copylist idx=%d", req->cpylst->idx_in_cmd);
+	else
+		seq_printf(m, "UNKNWON COMMAND TYPE %d", req->cmd_type);
+
+	if (req->cmd != NULL)
+		seq_printf(m, " cmdlist %d", req->cmd->protocol_id);
+	seq_printf(m, " unsatisfied_deps=%d in_progress=%d priority=%d\n",
+		   atomic_read(&req->num_unsatisfied_deps),
+		   req->in_progress,
+		   req->priority);
+}
+
+static int exec_graph_show(struct seq_file *m, void *v)
+{
+	struct inf_data *inf_data;
+	struct inf_context *context;
+	struct inf_devres *devres;
+	struct exec_queue_entry *pos;
+	struct inf_exec_req *req;
+	unsigned long flags;
+	unsigned int n_entries, n_granted, n_ready;
+	int i, j, prio;
+	int num_contexts = 0;
+
+	if (!g_the_sphcs)
+		return -1;
+
+	inf_data = g_the_sphcs->inf_data;
+	NNP_SPIN_LOCK_BH(&inf_data->lock_bh);
+	hash_for_each(inf_data->context_hash, i, context, hash_node) {
+		num_contexts++;
+		seq_printf(m, "Context %d:\n", context->protocol_id);
+
+		NNP_SPIN_LOCK_IRQSAVE(&context->ready_lock_irq, flags);
+		for (prio = INF_EXEC_REQ_NUM_PRIORITIES - 1; prio >= 0; --prio) {
+			n_ready = 0;
+			list_for_each_entry(req, &context->ready_reqs[prio], ready_node)
+				n_ready++;
+			seq_printf(m, "\tready list priority %d: %u requests\n", prio, n_ready);
+		}
+		NNP_SPIN_UNLOCK_IRQRESTORE(&context->ready_lock_irq, flags);
+
+		NNP_SPIN_LOCK(&context->lock);
+		hash_for_each(context->devres_hash, j, devres, hash_node) {
+			NNP_SPIN_LOCK_IRQSAVE(&devres->lock_irq, flags);
+			if (list_empty(&devres->exec_queue)) {
+				NNP_SPIN_UNLOCK_IRQRESTORE(&devres->lock_irq, flags);
+				continue;
+			}
+
+			n_entries = 0;
+			n_granted = 0;
+			list_for_each_entry(pos, &devres->exec_queue, node) {
+				n_entries++;
+				if (pos->granted)
+					n_granted++;
+			}
+			seq_printf(m, "\tdevres %d: %u queued, %u granted\n",
+				   devres->protocol_id, n_entries, n_granted);
+			list_for_each_entry(pos, &devres->exec_queue, node) {
+				seq_printf(m, "\t\t%c%c ",
+					   pos->read ? 'R' : 'W',
+					   pos->granted ? '+' : '-');
+				exec_graph_show_req(m, pos->req);
+			}
+			NNP_SPIN_UNLOCK_IRQRESTORE(&devres->lock_irq, flags);
+		}
+		NNP_SPIN_UNLOCK(&context->lock);
+	}
+	NNP_SPIN_UNLOCK_BH(&inf_data->lock_bh);
+
+	if (num_contexts == 0)
+		seq_puts(m, "No active contexts\n");
+
+	return 0;
+}
+
+static int exec_graph_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, exec_graph_show, inode->i_private);
+}
+
+static const struct file_operations exec_graph_fops = {
+	.open		= exec_graph_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int ids_map_trace_show(struct seq_file *m, void *v)
 {
 	struct inf_data *inf_data;
@@ -4575,4 +4831,14 @@ void sphcs_inf_init_debugfs(struct dentry *parent)
 			    parent,
 			    NULL,
 			    &ids_map_trace_fops);
+
+	debugfs_create_file("exec_graph",
+			    0444,
+			    parent,
+			    NULL,
+			    &exec_graph_fops);
+
+#ifdef ULT
+	inf_cmd_queue_init_debugfs(parent);
+#endif
 }
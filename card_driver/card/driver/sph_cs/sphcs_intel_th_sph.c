@@ -137,6 +137,13 @@ int sphcs_init_th_driver(void)
 	hw_tracing->resource_max_size = 0;
 	hw_tracing->hwtrace_status = NNPCS_HWTRACE_NOT_SUPPORTED;
 
+	sphcs_hwtrace_stream_init(hw_tracing);
+
+	init_waitqueue_head(&hw_tracing->waitq);
+	spin_lock_init(&hw_tracing->lock_irq);
+	INIT_LIST_HEAD(&(hw_tracing->dma_stream_list));
+	hw_tracing->host_resource_count = 0;
+
 	//try to allocate page pool
 	do {
 		ret = npk_page_pool_alloc(alloc_size);
@@ -169,10 +176,6 @@ int sphcs_init_th_driver(void)
 
 	hw_tracing->hwtrace_status = NNPCS_HWTRACE_REGISTERED;
 
-	init_waitqueue_head(&hw_tracing->waitq);
-	spin_lock_init(&hw_tracing->lock_irq);
-	INIT_LIST_HEAD(&(hw_tracing->dma_stream_list));
-	hw_tracing->host_resource_count = 0;
 	return ret;
 
 cmd_wq_cleanup:
@@ -190,6 +193,13 @@ void sphcs_deinit_th_driver(void)
 {
 	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
 
+	//dma may still read the pool pages and kick the workqueue, leak them
+	if (sphcs_hwtrace_stream_fini(hw_tracing)) {
+		sph_log_err(HWTRACE_LOG, "hwtrace stream not drained, npk pool leaked\n");
+		intel_th_msu_buffer_unregister(&g_msu);
+		return;
+	}
+
 	npk_page_pool_cleanup();
 
 	destroy_workqueue(hw_tracing->cmd_wq);
@@ -10,15 +10,337 @@
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/uaccess.h>
+#include <linux/math64.h>
 
 #include "nnp_hwtrace_protocol.h"
 #include "sphcs_hwtrace.h"
 #include "sphcs_cs.h"
+#include "sph_log.h"
+#include "nnp_debug.h"
+
+//must be above the 54 pages split by sphcs_hwtrace_create_sg_table_from_pages
+#define HWTRACE_STUB_PAGE_COUNT ((uint32_t)(128))
+
+//number of fake intel_th windows, 0 - hwtrace is not supported
+static uint32_t hwtrace_stub_windows;
+module_param(hwtrace_stub_windows, uint, 0444);
+MODULE_PARM_DESC(hwtrace_stub_windows, "number of fake trace hub windows to stream (0 - disabled, max 10)");
+
+//fake trace hub producer, reports every free window as full
+//so the batched window streaming to host can be measured
+struct hwtrace_stub {
+	struct device		parent;
+	struct device		dev;
+	void			*priv;
+	struct sg_table		*sgt[SPHCS_HWTRACING_MAX_POOL_LENGTH];
+	bool			armed[SPHCS_HWTRACING_MAX_POOL_LENGTH];
+	uint32_t		nr_windows;
+	size_t			window_size;
+	bool			running;
+	spinlock_t		lock_irq;
+	struct work_struct	produce_work;
+	struct dentry		*debugfs_dir;
+
+	//measurement of the last run
+	ktime_t			start_time;
+	ktime_t			stop_time;
+	uint64_t		base_bytes_done;
+	uint64_t		base_windows_done;
+	uint64_t		base_windows_dma;
+	uint64_t		base_batches;
+};
+
+static struct hwtrace_stub s_stub;
 
 void sphcs_assign_intel_th_mode(int *mode)
 {
 }
 
+static void hwtrace_stub_dev_release(struct device *dev)
+{
+}
+
+static void hwtrace_stub_pool_cleanup(void)
+{
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+	int i;
+
+	for (i = 0; i < SPHCS_HWTRACING_MAX_POOL_LENGTH; i++) {
+		struct sphcs_hwtrace_mem_pool *pages_pool = &hw_tracing->mem_pool[i];
+
+		if (!pages_pool->pages)
+			continue;
+
+		__free_pages(pages_pool->pages, get_order(hw_tracing->nr_pool_pages * PAGE_SIZE));
+
+		memset(pages_pool, 0x0, sizeof(struct sphcs_hwtrace_mem_pool));
+	}
+
+	hw_tracing->nr_pool_pages = 0;
+}
+
+static int hwtrace_stub_pool_alloc(uint32_t nr_windows)
+{
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+	uint32_t i;
+
+	hw_tracing->nr_pool_pages = HWTRACE_STUB_PAGE_COUNT;
+
+	for (i = 0; i < nr_windows; i++) {
+		struct sphcs_hwtrace_mem_pool *pages_pool = &hw_tracing->mem_pool[i];
+
+		memset(pages_pool, 0x0, sizeof(struct sphcs_hwtrace_mem_pool));
+
+		pages_pool->pages = alloc_pages(GFP_DMA32, get_order(hw_tracing->nr_pool_pages * PAGE_SIZE));
+		if (unlikely(pages_pool->pages == NULL)) {
+			hwtrace_stub_pool_cleanup();
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+//report all armed windows as full to the streaming code
+static void hwtrace_stub_produce_work_handler(struct work_struct *work)
+{
+	struct sg_table *sgt;
+	unsigned long flags;
+	uint32_t i;
+
+	for (i = 0; i < s_stub.nr_windows; i++) {
+		sgt = NULL;
+
+		NNP_SPIN_LOCK_IRQSAVE(&s_stub.lock_irq, flags);
+		if (s_stub.running && s_stub.armed[i]) {
+			s_stub.armed[i] = false;
+			sgt = s_stub.sgt[i];
+		}
+		NNP_SPIN_UNLOCK_IRQRESTORE(&s_stub.lock_irq, flags);
+
+		if (sgt)
+			intel_th_window_ready(s_stub.priv, sgt, s_stub.window_size);
+	}
+}
+
+static void hwtrace_stub_start(void)
+{
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+	unsigned long flags;
+	uint32_t i;
+
+	if (s_stub.running)
+		return;
+
+	//host must have initialized tracing and added resources
+	intel_th_activate(s_stub.priv);
+	if (hw_tracing->hwtrace_status != NNPCS_HWTRACE_ACTIVATED)
+		return;
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+	s_stub.base_bytes_done = hw_tracing->stats.bytes_done;
+	s_stub.base_windows_done = hw_tracing->stats.windows_done;
+	s_stub.base_windows_dma = hw_tracing->stats.windows_dma;
+	s_stub.base_batches = hw_tracing->stats.batches;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+	NNP_SPIN_LOCK_IRQSAVE(&s_stub.lock_irq, flags);
+	for (i = 0; i < s_stub.nr_windows; i++)
+		s_stub.armed[i] = true;
+	s_stub.start_time = ktime_get();
+	s_stub.running = true;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&s_stub.lock_irq, flags);
+
+	queue_work(hw_tracing->cmd_wq, &s_stub.produce_work);
+}
+
+static void hwtrace_stub_stop(void)
+{
+	unsigned long flags;
+
+	NNP_SPIN_LOCK_IRQSAVE(&s_stub.lock_irq, flags);
+	if (!s_stub.running) {
+		NNP_SPIN_UNLOCK_IRQRESTORE(&s_stub.lock_irq, flags);
+		return;
+	}
+	s_stub.running = false;
+	s_stub.stop_time = ktime_get();
+	NNP_SPIN_UNLOCK_IRQRESTORE(&s_stub.lock_irq, flags);
+
+	cancel_work_sync(&s_stub.produce_work);
+
+	intel_th_deactivate(s_stub.priv);
+}
+
+static ssize_t debug_run_write(struct file *filp,
+			       const char __user *buf,
+			       size_t count,
+			       loff_t *pos)
+{
+	bool run;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &run);
+	if (ret)
+		return ret;
+
+	if (run)
+		hwtrace_stub_start();
+	else
+		hwtrace_stub_stop();
+
+	return count;
+}
+
+static const struct file_operations debug_run_fops = {
+	.open		= simple_open,
+	.write		= debug_run_write,
+	.llseek		= default_llseek,
+};
+
+static int debug_throughput_show(struct seq_file *m, void *v)
+{
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+	uint64_t bytes, windows, windows_dma, batches;
+	unsigned long flags;
+	ktime_t end;
+	s64 elapsed_us;
+
+	NNP_SPIN_LOCK_IRQSAVE(&hw_tracing->lock_irq, flags);
+	bytes = hw_tracing->stats.bytes_done - s_stub.base_bytes_done;
+	windows = hw_tracing->stats.windows_done - s_stub.base_windows_done;
+	windows_dma = hw_tracing->stats.windows_dma - s_stub.base_windows_dma;
+	batches = hw_tracing->stats.batches - s_stub.base_batches;
+	NNP_SPIN_UNLOCK_IRQRESTORE(&hw_tracing->lock_irq, flags);
+
+	end = s_stub.running ? ktime_get() : s_stub.stop_time;
+	elapsed_us = ktime_us_delta(end, s_stub.start_time);
+	if (elapsed_us <= 0)
+		elapsed_us = 1;
+
+	seq_printf(m, "running %d windows %u window size %zu\n",
+		   s_stub.running, s_stub.nr_windows, s_stub.window_size);
+	seq_printf(m, "elapsed us %lld\n", elapsed_us);
+	seq_printf(m, "done windows %llu bytes %llu\n", windows, bytes);
+	seq_printf(m, "throughput MB/s %llu\n", div64_u64(bytes, elapsed_us));
+	seq_printf(m, "dma batches %llu windows per batch %llu\n",
+		   batches, batches ? div64_u64(windows_dma, batches) : 0);
+
+	return 0;
+}
+
+static int debug_throughput_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, debug_throughput_show, inode->i_private);
+}
+
+static const struct file_operations debug_throughput_fops = {
+	.open		= debug_throughput_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int hwtrace_stub_init(struct sphcs_hwtrace_data *hw_tracing)
+{
+	int mode = 0;
+	uint32_t i;
+	int ret;
+
+	s_stub.nr_windows = min_t(uint32_t, hwtrace_stub_windows, SPHCS_HWTRACING_MAX_POOL_LENGTH);
+	s_stub.window_size = (size_t)HWTRACE_STUB_PAGE_COUNT * PAGE_SIZE;
+	spin_lock_init(&s_stub.lock_irq);
+	INIT_WORK(&s_stub.produce_work, hwtrace_stub_produce_work_handler);
+
+	ret = hwtrace_stub_pool_alloc(s_stub.nr_windows);
+	if (ret) {
+		sph_log_err(HWTRACE_LOG, "unable to allocate pool for stub windows - err %d", ret);
+		return ret;
+	}
+
+	hw_tracing->resource_max_size = hw_tracing->nr_pool_pages;
+	hw_tracing->cmd_wq = create_singlethread_workqueue("hwtrace_cmd_wq");
+	if (!hw_tracing->cmd_wq) {
+		sph_log_err(START_UP_LOG, "Failed to initialize hwtrace commands workqueue");
+		ret = -ENOMEM;
+		goto pool_cleanup;
+	}
+
+	//intel_th windows are mapped for the device two levels above the msc device
+	device_initialize(&s_stub.parent);
+	dev_set_name(&s_stub.parent, "hwtrace_stub_parent");
+	s_stub.parent.parent = g_the_sphcs->hw_device;
+	s_stub.parent.release = hwtrace_stub_dev_release;
+
+	device_initialize(&s_stub.dev);
+	dev_set_name(&s_stub.dev, "hwtrace_stub");
+	s_stub.dev.parent = &s_stub.parent;
+	s_stub.dev.release = hwtrace_stub_dev_release;
+
+	hw_tracing->hwtrace_status = NNPCS_HWTRACE_REGISTERED;
+
+	s_stub.priv = intel_th_assign_mode(&s_stub.dev, &mode);
+
+	for (i = 0; i < s_stub.nr_windows; i++) {
+		ret = intel_th_alloc_window(s_stub.priv, &s_stub.sgt[i], s_stub.window_size);
+		if (ret) {
+			sph_log_err(HWTRACE_LOG, "unable to allocate stub window %u - err %d", i, ret);
+			s_stub.nr_windows = i;
+			break;
+		}
+	}
+
+	if (g_the_sphcs->debugfs_dir) {
+		s_stub.debugfs_dir = debugfs_create_dir("hwtrace_stub", g_the_sphcs->debugfs_dir);
+		if (!IS_ERR_OR_NULL(s_stub.debugfs_dir)) {
+			debugfs_create_file("run", 0200, s_stub.debugfs_dir, NULL, &debug_run_fops);
+			debugfs_create_file("throughput", 0444, s_stub.debugfs_dir, NULL, &debug_throughput_fops);
+		}
+	}
+
+	sph_log_info(HWTRACE_LOG, "hwtrace stub registered %u windows of %zu bytes\n",
+		     s_stub.nr_windows, s_stub.window_size);
+
+	return 0;
+
+pool_cleanup:
+	hwtrace_stub_pool_cleanup();
+
+	return ret;
+}
+
+//no run file to restart it, no window gets ready after this
+static void hwtrace_stub_quiesce(void)
+{
+	debugfs_remove_recursive(s_stub.debugfs_dir);
+	s_stub.debugfs_dir = NULL;
+
+	hwtrace_stub_stop();
+}
+
+//windows are freed, call after the stream is drained
+static void hwtrace_stub_fini(struct sphcs_hwtrace_data *hw_tracing)
+{
+	uint32_t i;
+
+	for (i = 0; i < s_stub.nr_windows; i++)
+		intel_th_free_window(s_stub.priv, s_stub.sgt[i]);
+
+	intel_th_unassign(s_stub.priv);
+
+	put_device(&s_stub.dev);
+	put_device(&s_stub.parent);
+
+	hwtrace_stub_pool_cleanup();
+
+	destroy_workqueue(hw_tracing->cmd_wq);
+	hw_tracing->cmd_wq = NULL;
+}
 
 int sphcs_init_th_driver(void)
 {
@@ -26,21 +348,56 @@ int sphcs_init_th_driver(void)
 
 	hw_tracing->hwtrace_status = NNPCS_HWTRACE_NOT_SUPPORTED;
 
+	sphcs_hwtrace_stream_init(hw_tracing);
+
 	init_waitqueue_head(&hw_tracing->waitq);
 	spin_lock_init(&hw_tracing->lock_irq);
 	INIT_LIST_HEAD(&(hw_tracing->dma_stream_list));
 	hw_tracing->host_resource_count = 0;
 
-	return 0;
+	//without windows there is no trace source, keep hwtrace not supported
+	if (hwtrace_stub_windows == 0)
+		return 0;
+
+	return hwtrace_stub_init(hw_tracing);
 }
 
 void sphcs_deinit_th_driver(void)
 {
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+
+	if (hw_tracing->cmd_wq)
+		hwtrace_stub_quiesce();
+
+	//dma may still read the windows and kick the workqueue, leak them
+	if (sphcs_hwtrace_stream_fini(hw_tracing)) {
+		sph_log_err(HWTRACE_LOG, "hwtrace stream not drained, trace windows leaked\n");
+		return;
+	}
+
+	if (hw_tracing->cmd_wq)
+		hwtrace_stub_fini(hw_tracing);
 }
 
 
+//window was streamed to host, trace hub may fill it again
 void sphcs_intel_th_window_unlock(struct device *dev, struct sg_table *sgt)
 {
-}
+	struct sphcs_hwtrace_data *hw_tracing = &g_the_sphcs->hw_tracing;
+	unsigned long flags;
+	bool kick = false;
+	uint32_t i;
 
+	NNP_SPIN_LOCK_IRQSAVE(&s_stub.lock_irq, flags);
+	for (i = 0; i < s_stub.nr_windows; i++) {
+		if (s_stub.sgt[i] == sgt) {
+			s_stub.armed[i] = true;
+			kick = s_stub.running;
+			break;
+		}
+	}
+	NNP_SPIN_UNLOCK_IRQRESTORE(&s_stub.lock_irq, flags);
 
+	if (kick)
+		queue_work(hw_tracing->cmd_wq, &s_stub.produce_work);
+}
@@ -10,6 +10,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/bits.h>
+#include <linux/wait.h>
+#include <linux/delay.h>
 #include "sphcs_p2p.h"
 #include "sph_log.h"
 #include "sphcs_cs.h"
@@ -19,6 +21,9 @@
 #define MAX_NUM_OF_P2P_BUFS_SHIFT 8
 #define MAX_NUM_OF_P2P_BUFS BIT(MAX_NUM_OF_P2P_BUFS_SHIFT)
 #define CR_FIFO_DEPTH MAX_NUM_OF_P2P_BUFS
+/* Max credits moved to a peer by one dma and doorbell */
+#define CR_BATCH_MAX 16
+#define CR_LOOPBACK_TIMEOUT_MS 5000
 
 struct sphcs_p2p_peer_db {
 	dma_addr_t dma_addr;
@@ -34,7 +39,7 @@ struct sphcs_p2p_peer_fifo {
 	u32 elem_size;
 	u32 depth;
 
-	/* for wr_ptr */
+	/* for wr_ptr, pending, inflight and busy */
 	spinlock_t lock;
 
 	/* index of next element to be written */
@@ -44,8 +49,17 @@ struct sphcs_p2p_peer_fifo {
 	dma_addr_t buf_dma_addr;
 	void *buf_vaddr;
 
-	/* Preallocated LLIs*/
+	/* Preallocated LLIs, llis[n - 1] moves n credits and rings the doorbell */
 	struct lli_desc *llis;
+
+	/* Credits waiting for the dma in flight to complete */
+	struct list_head pending;
+	/* Credits moved by the dma in flight */
+	struct list_head inflight;
+	bool busy;
+
+	/* Number of credit dmas sent, each rings the doorbell once */
+	u32 nr_batches;
 };
 
 struct sphcs_p2p_peer_dev {
@@ -53,6 +67,14 @@ struct sphcs_p2p_peer_dev {
 	struct sphcs_p2p_peer_fifo peer_cr_fifo;
 };
 
+/* Credit queued to a peer device */
+struct sphcs_p2p_cr {
+	struct list_head node;
+	struct sphcs_p2p_buf *buf;
+	sphcs_dma_sched_completion_callback callback;
+	void *callback_ctx;
+};
+
 /* 64 bit forward credit message */
 struct sphcs_p2p_fw_cr_fifo_elem {
 	u64 sbid :MAX_NUM_OF_P2P_BUFS_SHIFT;
@@ -95,6 +117,9 @@ DEFINE_IDA(p2p_sbid_ida);
 
 static struct sphcs_p2p_cbs *s_p2p_cbs;
 
+/* Peer id whose credit fifos are read by the loopback test, or -1 */
+static int s_loopback_dev = -1;
+
 /* Describes the PAGE_SIZE bytes to be used for LLIs*/
 struct sphcs_p2p_allocated_page {
 	struct list_head list;
@@ -205,73 +230,183 @@ void sphcs_p2p_remove_buffer(struct sphcs_p2p_buf *buf)
 
 }
 
-int sphcs_p2p_send_fw_cr_and_ring_db(struct sphcs_p2p_buf *buf,
-				     sphcs_dma_sched_completion_callback callback,
-				     void *callback_ctx)
+static int sphcs_p2p_cr_batch_complete_cb(struct sphcs *sphcs,
+					  void *ctx,
+					  const void *user_data,
+					  int status,
+					  u32 xferTimeUS);
+
+static void sphcs_p2p_complete_crs(struct list_head *crs, int status, u32 xferTimeUS)
+{
+	struct sphcs_p2p_cr *cr, *tmp;
+
+	list_for_each_entry_safe(cr, tmp, crs, node) {
+		list_del(&cr->node);
+		if (cr->callback)
+			cr->callback(g_the_sphcs, cr->callback_ctx, NULL, status, xferTimeUS);
+		kfree(cr);
+	}
+}
+
+/*
+ * Moves the pending credits to the peer fifo in one dma, which rings
+ * the doorbell once. Credits queued while the dma is in flight are sent
+ * together on its completion, so the batch grows with the dma latency.
+ * Called with peer_cr_fifo.lock held. On failure the credits of the batch
+ * and those queued behind it are moved to failed, as no completion would
+ * restart them.
+ */
+static int sphcs_p2p_start_cr_batch(struct sphcs_p2p_peer_dev *peer_dev,
+				    struct list_head *failed)
 {
-	struct sphcs_p2p_fw_cr_fifo_elem *fifo_elem;
+	struct sphcs_p2p_peer_fifo *fifo = &peer_dev->peer_cr_fifo;
+	struct sphcs_p2p_fw_cr_fifo_elem *fw_elem;
+	struct sphcs_p2p_rel_cr_fifo_elem *rel_elem;
+	struct sphcs_p2p_cr *cr, *tmp;
+	struct lli_desc *lli;
+	u32 n = 0;
 	u32 off;
-	int ret = 0;
+	int ret;
 
-	sph_log_debug(GENERAL_LOG, "Forward credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
+	list_for_each_entry_safe(cr, tmp, &fifo->pending, node) {
+		/* The batch is contiguous in the fifo */
+		if (n == CR_BATCH_MAX || fifo->wr_ptr + n == fifo->depth)
+			break;
+
+		off = (fifo->wr_ptr + n) * fifo->elem_size;
+		if (cr->buf->is_src_buf) {
+			fw_elem = (struct sphcs_p2p_fw_cr_fifo_elem *)(fifo->buf_vaddr + off);
+			fw_elem->sbid = cr->buf->buf_id;
+			fw_elem->dbid = cr->buf->peer_buf_id;
+			fw_elem->is_new = 1;
+		} else {
+			rel_elem = (struct sphcs_p2p_rel_cr_fifo_elem *)(fifo->buf_vaddr + off);
+			rel_elem->sbid = cr->buf->peer_buf_id;
+			rel_elem->is_new = 1;
+		}
 
-	NNP_SPIN_LOCK(&buf->peer_dev->peer_cr_fifo.lock);
-	off = buf->peer_dev->peer_cr_fifo.wr_ptr * buf->peer_dev->peer_cr_fifo.elem_size;
-	fifo_elem = (struct sphcs_p2p_fw_cr_fifo_elem *)(buf->peer_dev->peer_cr_fifo.buf_vaddr + off);
-	fifo_elem->sbid = buf->buf_id;
-	fifo_elem->dbid = buf->peer_buf_id;
-	fifo_elem->is_new = 1;
+		list_move_tail(&cr->node, &fifo->inflight);
+		n++;
+	}
+
+	if (n == 0)
+		return 0;
+
+	/* Edit lli template - credits and db */
+	off = fifo->wr_ptr * fifo->elem_size;
+	lli = &fifo->llis[n - 1];
+	g_the_sphcs->hw_ops->dma.edit_lli_elem(lli, 0, fifo->buf_dma_addr + off, fifo->dma_addr + off);
+	g_the_sphcs->hw_ops->dma.edit_lli_elem(lli, 1, peer_dev->peer_db.buf_dma_addr, peer_dev->peer_db.dma_addr);
 
 	ret = sphcs_dma_sched_start_xfer_multi(g_the_sphcs->dmaSched,
 					       NULL,
 					       &g_dma_desc_c2h_high_nowait,
-					       &buf->peer_dev->peer_cr_fifo.llis[buf->peer_dev->peer_cr_fifo.wr_ptr],
-					       buf->peer_dev->peer_cr_fifo.elem_size + 1,
-					       callback,
-					       callback_ctx);
-	if (unlikely(ret))
-		sph_log_err(GENERAL_LOG, "Failed to forward credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
-	else
-		buf->peer_dev->peer_cr_fifo.wr_ptr = inc_fifo_ptr(buf->peer_dev->peer_cr_fifo.depth, buf->peer_dev->peer_cr_fifo.wr_ptr);
+					       lli,
+					       n * fifo->elem_size + 1,
+					       sphcs_p2p_cr_batch_complete_cb,
+					       peer_dev);
+	if (unlikely(ret)) {
+		sph_log_err(GENERAL_LOG, "Failed to send %u credits\n", n);
+		list_splice_tail_init(&fifo->inflight, failed);
+		list_splice_tail_init(&fifo->pending, failed);
+		return ret;
+	}
 
-	NNP_SPIN_UNLOCK(&buf->peer_dev->peer_cr_fifo.lock);
+	fifo->busy = true;
+	fifo->wr_ptr = (fifo->wr_ptr + n) % fifo->depth;
+	fifo->nr_batches++;
 
-	return ret;
+	return 0;
+}
 
+static int sphcs_p2p_cr_batch_complete_cb(struct sphcs *sphcs,
+					  void *ctx,
+					  const void *user_data,
+					  int status,
+					  u32 xferTimeUS)
+{
+	struct sphcs_p2p_peer_dev *peer_dev = (struct sphcs_p2p_peer_dev *)ctx;
+	struct sphcs_p2p_peer_fifo *fifo = &peer_dev->peer_cr_fifo;
+	LIST_HEAD(done);
+	LIST_HEAD(failed);
+
+	NNP_SPIN_LOCK(&fifo->lock);
+	list_splice_init(&fifo->inflight, &done);
+	fifo->busy = false;
+	sphcs_p2p_start_cr_batch(peer_dev, &failed);
+	NNP_SPIN_UNLOCK(&fifo->lock);
+
+	/* Callbacks may send new credits */
+	sphcs_p2p_complete_crs(&done, status, xferTimeUS);
+	sphcs_p2p_complete_crs(&failed, SPHCS_DMA_STATUS_FAILED, 0);
+
+	return 0;
 }
 
-int sphcs_p2p_send_rel_cr_and_ring_db(struct sphcs_p2p_buf *buf,
-				      sphcs_dma_sched_completion_callback callback,
-				      void *callback_ctx)
+static int sphcs_p2p_send_cr_and_ring_db(struct sphcs_p2p_buf *buf,
+					 sphcs_dma_sched_completion_callback callback,
+					 void *callback_ctx)
 {
-	struct sphcs_p2p_rel_cr_fifo_elem *fifo_elem;
-	u32 off;
+	struct sphcs_p2p_peer_fifo *fifo = &buf->peer_dev->peer_cr_fifo;
+	struct sphcs_p2p_cr *cr, *pos;
+	LIST_HEAD(failed);
 	int ret = 0;
 
-	sph_log_debug(GENERAL_LOG, "Release credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
+	cr = kmalloc(sizeof(*cr), GFP_NOWAIT);
+	if (unlikely(!cr))
+		return -ENOMEM;
 
-	NNP_SPIN_LOCK(&buf->peer_dev->peer_cr_fifo.lock);
-	off = buf->peer_dev->peer_cr_fifo.wr_ptr * buf->peer_dev->peer_cr_fifo.elem_size;
-	fifo_elem = (struct sphcs_p2p_rel_cr_fifo_elem *)(buf->peer_dev->peer_cr_fifo.buf_vaddr + off);
-	fifo_elem->sbid = buf->peer_buf_id;
-	fifo_elem->is_new = 1;
+	cr->buf = buf;
+	cr->callback = callback;
+	cr->callback_ctx = callback_ctx;
+
+	NNP_SPIN_LOCK(&fifo->lock);
+	list_add_tail(&cr->node, &fifo->pending);
+	if (!fifo->busy)
+		ret = sphcs_p2p_start_cr_batch(buf->peer_dev, &failed);
+	NNP_SPIN_UNLOCK(&fifo->lock);
+
+	if (unlikely(ret)) {
+		/* Own credit failure is reported by the return value */
+		list_for_each_entry(pos, &failed, node) {
+			if (pos == cr) {
+				list_del(&cr->node);
+				kfree(cr);
+				break;
+			}
+		}
+		sphcs_p2p_complete_crs(&failed, SPHCS_DMA_STATUS_FAILED, 0);
+	}
 
-	ret = sphcs_dma_sched_start_xfer_multi(g_the_sphcs->dmaSched,
-					       NULL,
-					       &g_dma_desc_c2h_high_nowait,
-					       &buf->peer_dev->peer_cr_fifo.llis[buf->peer_dev->peer_cr_fifo.wr_ptr],
-					       buf->peer_dev->peer_cr_fifo.elem_size + 1,
-					       callback,
-					       callback_ctx);
+	return ret;
+}
 
-	buf->peer_dev->peer_cr_fifo.wr_ptr = inc_fifo_ptr(buf->peer_dev->peer_cr_fifo.depth, buf->peer_dev->peer_cr_fifo.wr_ptr);
+int sphcs_p2p_send_fw_cr_and_ring_db(struct sphcs_p2p_buf *buf,
+				     sphcs_dma_sched_completion_callback callback,
+				     void *callback_ctx)
+{
+	int ret;
 
-	NNP_SPIN_UNLOCK(&buf->peer_dev->peer_cr_fifo.lock);
+	sph_log_debug(GENERAL_LOG, "Forward credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
+
+	ret = sphcs_p2p_send_cr_and_ring_db(buf, callback, callback_ctx);
+	if (unlikely(ret))
+		sph_log_err(GENERAL_LOG, "Failed to forward credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
 
 	return ret;
 
 }
 
+int sphcs_p2p_send_rel_cr_and_ring_db(struct sphcs_p2p_buf *buf,
+				      sphcs_dma_sched_completion_callback callback,
+				      void *callback_ctx)
+{
+	sph_log_debug(GENERAL_LOG, "Release credit (src buf id %u, dst buf id %u)\n", buf->buf_id, buf->peer_buf_id);
+
+	return sphcs_p2p_send_cr_and_ring_db(buf, callback, callback_ctx);
+
+}
+
 void IPC_OPCODE_HANDLER(CHAN_P2P_GET_CR_FIFO)(struct sphcs *sphcs, union h2c_ChanGetCrFIFO *cmd)
 {
 	struct sphcs_p2p_cr_fifo *fifo;
@@ -317,6 +452,7 @@ static int _sphcs_p2p_create_lli_templates(struct sphcs *sphcs,
 	u32 lli_idx, dev_idx;
 	struct  lli_desc *lli;
 	u64 transfer_size;
+	u32 cr_size;
 	int ret;
 	struct sphcs_p2p_allocated_page *current_page;
 	u32 page_off = 0;
@@ -328,9 +464,14 @@ static int _sphcs_p2p_create_lli_templates(struct sphcs *sphcs,
 
 	/* Prepare LLIs */
 	for (dev_idx = 0; dev_idx < MAX_NUM_OF_P2P_DEVS; dev_idx++) {
-		for (lli_idx = 0; lli_idx < CR_FIFO_DEPTH; lli_idx++) {
+		for (lli_idx = 0; lli_idx < CR_BATCH_MAX; lli_idx++) {
 			lli = &peer_devs[dev_idx].peer_cr_fifo.llis[lli_idx];
 
+			/* Template lli_idx moves lli_idx + 1 credits */
+			cr_size = (lli_idx + 1) * peer_devs[dev_idx].peer_cr_fifo.elem_size;
+			to_sgt->sgl[0].length = cr_size;
+			from_sgt->sgl[0].length = cr_size;
+
 			/* The LLI can't be transferred over different DMA channels */
 			ret = sphcs->hw_ops->dma.init_lli(sphcs->hw_handle,
 							  lli,
@@ -361,7 +502,7 @@ static int _sphcs_p2p_create_lli_templates(struct sphcs *sphcs,
 
 			/* Generate LLI */
 			transfer_size = sphcs->hw_ops->dma.gen_lli(sphcs->hw_handle, from_sgt, to_sgt, lli, 0);
-			if (transfer_size != (peer_devs[dev_idx].peer_cr_fifo.elem_size + 1)) {
+			if (transfer_size != (cr_size + 1)) {
 				sph_log_err(GENERAL_LOG, "Failed to generate lli\n");
 				ret = -ENOMEM;
 				goto failed_to_generate_lli;
@@ -390,11 +531,10 @@ static int sphcs_p2p_create_lli_templates(struct sphcs *sphcs)
 	if (rc)
 		goto failed_to_alloc_src_sgt;
 
-	to_sgt.sgl[0].length = p2p_producers[0].peer_cr_fifo.elem_size;
+	/* Credits length is set per template */
 	to_sgt.sgl[0].dma_address = 0;
 	to_sgt.sgl[1].length = 1;
 	to_sgt.sgl[1].dma_address = 0;
-	from_sgt.sgl[0].length = p2p_producers[0].peer_cr_fifo.elem_size;
 	from_sgt.sgl[0].dma_address =  0;
 	from_sgt.sgl[1].length = 1;
 	from_sgt.sgl[1].dma_address = 0;
@@ -404,9 +544,6 @@ static int sphcs_p2p_create_lli_templates(struct sphcs *sphcs)
 	if (rc)
 		goto failed_to_create_prod_template;
 
-	to_sgt.sgl[0].length = p2p_consumers[0].peer_cr_fifo.elem_size;
-	from_sgt.sgl[0].length = p2p_consumers[0].peer_cr_fifo.elem_size;
-
 	/* Create LLI templates for consumers */
 	rc = _sphcs_p2p_create_lli_templates(sphcs, p2p_consumers, &consumer_allocated_pages, &to_sgt, &from_sgt);
 	if (rc)
@@ -431,10 +568,6 @@ void IPC_OPCODE_HANDLER(CHAN_P2P_UPDATE_PEER_DEV)(struct sphcs *sphcs, union h2c
 {
 	struct sphcs_p2p_peer_dev *peer_dev;
 	char *dev_role;
-	u32 i, off;
-	dma_addr_t src;
-	dma_addr_t dst;
-	struct lli_desc *lli;
 
 	if (cmd->is_producer) {
 		peer_dev = &p2p_producers[cmd->dev_id];
@@ -453,21 +586,7 @@ void IPC_OPCODE_HANDLER(CHAN_P2P_UPDATE_PEER_DEV)(struct sphcs *sphcs, union h2c
 			&peer_dev->peer_db.dma_addr,
 			&peer_dev->peer_cr_fifo.dma_addr);
 
-	/* Edit lli templates */
-	for (i = 0; i < peer_dev->peer_cr_fifo.depth; i++) {
-		off = i * peer_dev->peer_cr_fifo.elem_size;
-		lli = &peer_dev->peer_cr_fifo.llis[i];
-
-		/* Edit first lli element - credit*/
-		src = peer_dev->peer_cr_fifo.buf_dma_addr + off;
-		dst = peer_dev->peer_cr_fifo.dma_addr + off;
-		g_the_sphcs->hw_ops->dma.edit_lli_elem(lli, 0, src, dst);
-
-		/* Edit second lli element - db*/
-		src = peer_dev->peer_db.buf_dma_addr;
-		dst = peer_dev->peer_db.dma_addr;
-		g_the_sphcs->hw_ops->dma.edit_lli_elem(lli, 1, src, dst);
-	}
+	/* lli templates are edited when credits are sent */
 
 	sphcs_send_event_report(sphcs, NNP_IPC_P2P_PEER_DEV_UPDATED, 0, NULL, cmd->chan_id, cmd->p2p_tr_id);
 }
@@ -482,6 +601,9 @@ int sphcs_p2p_new_message_arrived(void)
 
 	/* Check all FIFOs managed by this device */
 	for (i = 0; i < MAX_NUM_OF_P2P_DEVS; i++) {
+		if (i == READ_ONCE(s_loopback_dev))
+			continue;
+
 		do {
 			/* Check whether the new element has been written to the fw credit fifo */
 			fw_fifo_elem = fw_fifos[i].vaddr + fw_fifos[i].rd_ptr * fw_fifos[i].elem_size;
@@ -514,6 +636,203 @@ int sphcs_p2p_new_message_arrived(void)
 	return 0;
 }
 
+struct sphcs_p2p_loopback {
+	wait_queue_head_t waitq;
+	atomic_t completed;
+	atomic_t failed;
+	struct sphcs_p2p_buf bufs[];
+};
+
+static int sphcs_p2p_loopback_cr_cb(struct sphcs *sphcs,
+				    void *ctx,
+				    const void *user_data,
+				    int status,
+				    u32 xferTimeUS)
+{
+	struct sphcs_p2p_loopback *lb = (struct sphcs_p2p_loopback *)ctx;
+
+	if (status == SPHCS_DMA_STATUS_FAILED)
+		atomic_inc(&lb->failed);
+	atomic_inc(&lb->completed);
+	wake_up(&lb->waitq);
+
+	return 0;
+}
+
+/*
+ * Fails the credits not yet given to the dma engine. Returns false if a
+ * dma is still in flight, its completion will reference the test.
+ */
+static bool sphcs_p2p_loopback_cancel(struct sphcs_p2p_peer_dev *peer_dev)
+{
+	struct sphcs_p2p_peer_fifo *fifo = &peer_dev->peer_cr_fifo;
+	LIST_HEAD(cancelled);
+	bool idle;
+
+	NNP_SPIN_LOCK(&fifo->lock);
+	list_splice_init(&fifo->pending, &cancelled);
+	idle = !fifo->busy;
+	NNP_SPIN_UNLOCK(&fifo->lock);
+
+	sphcs_p2p_complete_crs(&cancelled, SPHCS_DMA_STATUS_FAILED, 0);
+
+	return idle;
+}
+
+/* Waits for num_crs credits to land in fifo, checks their ids and consumes them */
+static int sphcs_p2p_loopback_check_fifo(struct sphcs_p2p_cr_fifo *fifo,
+					 struct sphcs_p2p_buf *bufs,
+					 u32 num_crs)
+{
+	struct sphcs_p2p_fw_cr_fifo_elem *fw_elem;
+	struct sphcs_p2p_rel_cr_fifo_elem *rel_elem;
+	void *elem;
+	u32 i, timeout_ms;
+
+	for (i = 0; i < num_crs; i++) {
+		elem = fifo->vaddr + fifo->rd_ptr * fifo->elem_size;
+		fw_elem = (struct sphcs_p2p_fw_cr_fifo_elem *)elem;
+		rel_elem = (struct sphcs_p2p_rel_cr_fifo_elem *)elem;
+
+		/* dma completion may precede the posted write to our bar */
+		for (timeout_ms = 0; timeout_ms < 1000; timeout_ms++) {
+			if (bufs[i].is_src_buf ? READ_ONCE(fw_elem->is_new) : READ_ONCE(rel_elem->is_new))
+				break;
+			usleep_range(1000, 1100);
+		}
+
+		if (bufs[i].is_src_buf) {
+			if (!fw_elem->is_new ||
+			    fw_elem->sbid != bufs[i].buf_id ||
+			    fw_elem->dbid != bufs[i].peer_buf_id) {
+				sph_log_err(GENERAL_LOG, "Loopback fw credit %u mismatch\n", i);
+				return -EIO;
+			}
+			fw_elem->is_new = 0;
+		} else {
+			if (!rel_elem->is_new ||
+			    rel_elem->sbid != bufs[i].peer_buf_id) {
+				sph_log_err(GENERAL_LOG, "Loopback rel credit %u mismatch\n", i);
+				return -EIO;
+			}
+			rel_elem->is_new = 0;
+		}
+
+		fifo->rd_ptr = inc_fifo_ptr(fifo->depth, fifo->rd_ptr);
+	}
+
+	return 0;
+}
+
+/*
+ * Loopback test of the credit path. The consumer and producer slots of
+ * peer dev_id are pointed at this device's own fw and rel credit fifos,
+ * which the host exposes at the given bus addresses, and num_crs
+ * forward and num_crs release credits are sent back to back. The test
+ * checks every credit landed in order and reports the number of dmas,
+ * hence doorbells, each direction took. Must run while dev_id is not
+ * connected to a real peer.
+ */
+int sphcs_p2p_cr_loopback(u32 dev_id,
+			   dma_addr_t fw_fifo_addr,
+			   dma_addr_t rel_fifo_addr,
+			   dma_addr_t db_addr,
+			   u32 num_crs,
+			   u32 *o_fw_batches,
+			   u32 *o_rel_batches)
+{
+	struct sphcs_p2p_peer_dev *consumer, *producer;
+	struct sphcs_p2p_loopback *lb;
+	struct sphcs_p2p_buf *bufs;
+	bool idle;
+	u32 i, sent = 0;
+	int ret = 0;
+
+	if (dev_id >= MAX_NUM_OF_P2P_DEVS || num_crs == 0 || num_crs > CR_FIFO_DEPTH)
+		return -EINVAL;
+
+	consumer = &p2p_consumers[dev_id];
+	producer = &p2p_producers[dev_id];
+	if (consumer->peer_cr_fifo.dma_addr || producer->peer_cr_fifo.dma_addr)
+		return -EBUSY;
+
+	if (cmpxchg(&s_loopback_dev, -1, dev_id) != -1)
+		return -EBUSY;
+
+	lb = kzalloc(sizeof(*lb) + 2 * num_crs * sizeof(*bufs), GFP_KERNEL);
+	if (!lb) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	bufs = lb->bufs;
+
+	init_waitqueue_head(&lb->waitq);
+	atomic_set(&lb->completed, 0);
+	atomic_set(&lb->failed, 0);
+
+	/* Writers continue where the reader of our own fifos is */
+	consumer->peer_db.dma_addr = db_addr;
+	consumer->peer_cr_fifo.dma_addr = fw_fifo_addr;
+	consumer->peer_cr_fifo.wr_ptr = fw_fifos[dev_id].rd_ptr;
+	consumer->peer_cr_fifo.nr_batches = 0;
+	producer->peer_db.dma_addr = db_addr;
+	producer->peer_cr_fifo.dma_addr = rel_fifo_addr;
+	producer->peer_cr_fifo.wr_ptr = rel_fifos[dev_id].rd_ptr;
+	producer->peer_cr_fifo.nr_batches = 0;
+
+	for (i = 0; i < 2 * num_crs; i++) {
+		bufs[i].is_src_buf = (i < num_crs);
+		bufs[i].buf_id = i;
+		bufs[i].peer_buf_id = ~i;
+		bufs[i].peer_dev = bufs[i].is_src_buf ? consumer : producer;
+	}
+
+	/* Back to back, so credits queue behind the dma in flight */
+	for (i = 0; i < 2 * num_crs; i++) {
+		ret = sphcs_p2p_send_cr_and_ring_db(&bufs[i], sphcs_p2p_loopback_cr_cb, lb);
+		if (ret)
+			break;
+		sent++;
+	}
+
+	if (!wait_event_timeout(lb->waitq, atomic_read(&lb->completed) == sent,
+				msecs_to_jiffies(CR_LOOPBACK_TIMEOUT_MS))) {
+		sph_log_err(GENERAL_LOG, "Loopback credits not completed, %u of %u\n",
+			    atomic_read(&lb->completed), sent);
+		ret = -ETIMEDOUT;
+		idle = sphcs_p2p_loopback_cancel(consumer);
+		idle = sphcs_p2p_loopback_cancel(producer) && idle;
+		if (idle) {
+			/* Completions already taken from the fifo are still running */
+			wait_event(lb->waitq, atomic_read(&lb->completed) == sent);
+		} else {
+			/* A stuck dma may still complete, the test memory is left to it */
+			sph_log_err(GENERAL_LOG, "Loopback dma stuck on dev %u\n", dev_id);
+			lb = NULL;
+		}
+	}
+
+	if (!ret && atomic_read(&lb->failed))
+		ret = -EIO;
+	if (!ret)
+		ret = sphcs_p2p_loopback_check_fifo(&fw_fifos[dev_id], bufs, num_crs);
+	if (!ret)
+		ret = sphcs_p2p_loopback_check_fifo(&rel_fifos[dev_id], &bufs[num_crs], num_crs);
+
+	*o_fw_batches = consumer->peer_cr_fifo.nr_batches;
+	*o_rel_batches = producer->peer_cr_fifo.nr_batches;
+
+	consumer->peer_db.dma_addr = 0;
+	consumer->peer_cr_fifo.dma_addr = 0;
+	producer->peer_db.dma_addr = 0;
+	producer->peer_cr_fifo.dma_addr = 0;
+
+	kfree(lb);
+out:
+	WRITE_ONCE(s_loopback_dev, -1);
+	return ret;
+}
+
 int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 {
 	u32 i;
@@ -532,6 +851,9 @@ int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 		p2p_producers[i].peer_cr_fifo.depth = CR_FIFO_DEPTH;
 		p2p_producers[i].peer_cr_fifo.wr_ptr = 0;
 		spin_lock_init(&p2p_producers[i].peer_cr_fifo.lock);
+		INIT_LIST_HEAD(&p2p_producers[i].peer_cr_fifo.pending);
+		INIT_LIST_HEAD(&p2p_producers[i].peer_cr_fifo.inflight);
+		p2p_producers[i].peer_cr_fifo.busy = false;
 		/* We send release credit messages to producers */
 		p2p_producers[i].peer_cr_fifo.elem_size = sizeof(struct sphcs_p2p_rel_cr_fifo_elem);
 		p2p_producers[i].peer_cr_fifo.buf_vaddr = dma_alloc_coherent(sphcs->hw_device,
@@ -544,7 +866,7 @@ int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 			goto err;
 		}
 
-		p2p_producers[i].peer_cr_fifo.llis = kcalloc(CR_FIFO_DEPTH, sizeof(struct lli_desc), GFP_KERNEL);
+		p2p_producers[i].peer_cr_fifo.llis = kcalloc(CR_BATCH_MAX, sizeof(struct lli_desc), GFP_KERNEL);
 		if (p2p_producers[i].peer_cr_fifo.llis == NULL) {
 			sph_log_err(GENERAL_LOG, "couldn't allocate memory\n");
 			rc = -ENOMEM;
@@ -562,6 +884,9 @@ int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 		p2p_consumers[i].peer_cr_fifo.depth = CR_FIFO_DEPTH;
 		p2p_consumers[i].peer_cr_fifo.wr_ptr = 0;
 		spin_lock_init(&p2p_consumers[i].peer_cr_fifo.lock);
+		INIT_LIST_HEAD(&p2p_consumers[i].peer_cr_fifo.pending);
+		INIT_LIST_HEAD(&p2p_consumers[i].peer_cr_fifo.inflight);
+		p2p_consumers[i].peer_cr_fifo.busy = false;
 		/* We send forward credit messages to consumers */
 		p2p_consumers[i].peer_cr_fifo.elem_size = sizeof(struct sphcs_p2p_fw_cr_fifo_elem);
 		p2p_consumers[i].peer_cr_fifo.buf_vaddr = dma_alloc_coherent(sphcs->hw_device,
@@ -574,7 +899,7 @@ int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 			goto err;
 		}
 
-		p2p_consumers[i].peer_cr_fifo.llis = kcalloc(CR_FIFO_DEPTH, sizeof(struct lli_desc), GFP_KERNEL);
+		p2p_consumers[i].peer_cr_fifo.llis = kcalloc(CR_BATCH_MAX, sizeof(struct lli_desc), GFP_KERNEL);
 		if (p2p_consumers[i].peer_cr_fifo.llis == NULL) {
 			sph_log_err(GENERAL_LOG, "couldn't allocate memory\n");
 			rc = -ENOMEM;
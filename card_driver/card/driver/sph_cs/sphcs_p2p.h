@@ -65,6 +65,15 @@ int sphcs_p2p_send_rel_cr_and_ring_db(struct sphcs_p2p_buf *buf,
 int sphcs_p2p_new_message_arrived(void);
 
 u8 sphcs_p2p_get_peer_dev_id(struct sphcs_p2p_buf *buf);
+
+/* Credit path loopback test, see sphcs_p2p_test.c */
+int sphcs_p2p_cr_loopback(u32 dev_id,
+			   dma_addr_t fw_fifo_addr,
+			   dma_addr_t rel_fifo_addr,
+			   dma_addr_t db_addr,
+			   u32 num_crs,
+			   u32 *o_fw_batches,
+			   u32 *o_rel_batches);
 #else
 static inline int sphcs_p2p_init(struct sphcs *sphcs, struct sphcs_p2p_cbs *p2p_cbs)
 {
@@ -122,5 +131,16 @@ static inline u8 sphcs_p2p_get_peer_dev_id(struct sphcs_p2p_buf *buf)
 {
 	return 0;
 }
+
+static inline int sphcs_p2p_cr_loopback(u32 dev_id,
+					 dma_addr_t fw_fifo_addr,
+					 dma_addr_t rel_fifo_addr,
+					 dma_addr_t db_addr,
+					 u32 num_crs,
+					 u32 *o_fw_batches,
+					 u32 *o_rel_batches)
+{
+	return -ENODEV;
+}
 #endif
 #endif
@@ -18,12 +18,14 @@
 #include "sph_log.h"
 #include "ioctl_p2p_test.h"
 #include "sphcs_cs.h"
+#include "sphcs_p2p.h"
 
 DECLARE_WAIT_QUEUE_HEAD(dma_wait);
 static bool dma_completed;
 
 union sph_p2p_test_ioctl_param {
 	struct ioctl_p2p_test_dma test_dma;
+	struct ioctl_p2p_test_cr_loopback cr_loopback;
 };
 
 static int dma_complete_callback(struct sphcs *sphcs,
@@ -143,6 +145,29 @@ failed_to_start_dma:
 	return rc;
 }
 
+static int ioctl_test_cr_loopback(struct ioctl_p2p_test_cr_loopback *param)
+{
+	int rc;
+
+	rc = sphcs_p2p_cr_loopback(param->dev_id,
+				   param->fw_fifo_host_addr,
+				   param->rel_fifo_host_addr,
+				   param->db_host_addr,
+				   param->num_credits,
+				   &param->o_fw_batches,
+				   &param->o_rel_batches);
+	if (rc != 0) {
+		sph_log_err(GENERAL_LOG, "Credit loopback failed %d\n", rc);
+		return rc;
+	}
+
+	sph_log_info(GENERAL_LOG, "Credit loopback: %u fw credits in %u dmas, %u rel credits in %u dmas\n",
+		     param->num_credits, param->o_fw_batches,
+		     param->num_credits, param->o_rel_batches);
+
+	return 0;
+}
+
 static long ioctl_misc(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	union sph_p2p_test_ioctl_param ioctl_param;
@@ -164,6 +189,10 @@ static long ioctl_misc(struct file *file, unsigned int cmd, unsigned long arg)
 	case IOCTL_P2P_DMA_RD:
 		rc = ioctl_test_dma_read(&ioctl_param.test_dma);
 		break;
+
+	case IOCTL_P2P_CR_LOOPBACK:
+		rc = ioctl_test_cr_loopback(&ioctl_param.cr_loopback);
+		break;
 	}
 
 	if (cmd & IOC_OUT) {
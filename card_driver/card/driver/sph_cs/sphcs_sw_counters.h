@@ -62,6 +62,9 @@ enum SPHCS_SW_COUNTERS_GLOBAL {
 	SPHCS_SW_COUNTERS_ECC_CORRECTABLE_ERROR,
 	SPHCS_SW_COUNTERS_ECC_UNCORRECTABLE_ERROR,
 	SPHCS_SW_COUNTERS_MCE_UNCORRECTABLE_ERROR,
+	SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT,
+	SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS,
+	SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_BYTES_SAVED,
 };
 
 #define SPHCS_SW_DMA_GLOBAL_COUNTER_H2C_COUNT(channel) (SPHCS_SW_COUNTERS_DMA_0_H2C_COUNT + (channel) * 6)
@@ -177,6 +180,15 @@ static const struct nnp_sw_counter_info g_sphcs_sw_counters_info[] = {
 	 /* SPHCS_SW_COUNTERS_MCE_UNCORRECTABLE_ERROR */
 	 {SPHCS_SW_COUNTERS_GROUP_MCE, "uncorrectable",
 	 "[r]number of uncorrectable general MCE event (not ecc related)"},
+	/* SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT */
+	{SPHCS_SW_COUNTERS_GROUP_DMA, "hostres_pgt_cache.hit",
+	 "Number of host resource maps which reused a cached page table"},
+	/* SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS */
+	{SPHCS_SW_COUNTERS_GROUP_DMA, "hostres_pgt_cache.miss",
+	 "Number of host resource maps which retrieved the page list from host"},
+	/* SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_BYTES_SAVED */
+	{SPHCS_SW_COUNTERS_GROUP_DMA, "hostres_pgt_cache.bytes_saved",
+	 "Total bytes of host page list not DMA'ed thanks to the page table cache"},
 };
 
 static const struct nnp_sw_counters_set g_sw_counters_set_global = {
@@ -185,7 +197,8 @@ static const struct nnp_sw_counters_set g_sw_counters_set_global = {
 	g_sphcs_sw_counters_info,
 	ARRAY_SIZE(g_sphcs_sw_counters_info),
 	g_sphcs_sw_counters_groups_info,
-	ARRAY_SIZE(g_sphcs_sw_counters_groups_info)};
+	ARRAY_SIZE(g_sphcs_sw_counters_groups_info),
+	true};
 
 enum CTX_SPHCS_SW_COUNTERS_GROUPS {
 	CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE
@@ -201,7 +214,10 @@ enum  CTX_SPHCS_SW_COUNTERS {
 	CTX_SPHCS_SW_COUNTERS_INFERENCE_COMPLETED_INF_REQ,
 	CTX_SPHCS_SW_COUNTERS_INFERENCE_SUBMITTED_INF_REQ,
 	CTX_SPHCS_SW_COUNTERS_INFERENCE_RUNTIME_BUSY_TIME,
-	CTX_SPHCS_SW_COUNTERS_INFERENCE_DEVICE_RESOURCE_SIZE
+	CTX_SPHCS_SW_COUNTERS_INFERENCE_DEVICE_RESOURCE_SIZE,
+	CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_DEPTH,
+	CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_MAX_DEPTH,
+	CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_OLDEST_AGE
 };
 
 static const struct nnp_sw_counter_info g_ctx_sphcs_sw_counters_info[] = {
@@ -219,7 +235,16 @@ static const struct nnp_sw_counter_info g_ctx_sphcs_sw_counters_info[] = {
 	 "Total time in which the runtime has some request in its request queue which did not finished per context"},
 	/*CTX_SPHCS_SW_COUNTERS_INFERENCE_DEVICE_RESOURCE_SIZE*/
 	{CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE, "deviceResourceSize",
-	 "Size (in bytes) occupied by blob, input and output device resources"}
+	 "Size (in bytes) occupied by blob, input and output device resources"},
+	/*CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_DEPTH*/
+	{CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE, "cmdq_depth",
+	 "Number of commands waiting to be read by the runtime"},
+	/*CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_MAX_DEPTH*/
+	{CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE, "cmdq_max_depth",
+	 "Max number of commands waited to be read by the runtime"},
+	/*CTX_SPHCS_SW_COUNTERS_INFERENCE_CMDQ_OLDEST_AGE*/
+	{CTX_SPHCS_SW_COUNTERS_GROUP_INFERENCE, "cmdq_oldest_age",
+	 "Time (in usec) the oldest command waits to be read by the runtime"}
 };
 
 static const struct nnp_sw_counters_set g_sw_counters_set_context = {
@@ -231,21 +256,63 @@ static const struct nnp_sw_counters_set g_sw_counters_set_context = {
 	ARRAY_SIZE(g_ctx_sphcs_sw_counters_groups_info)};
 
 enum NET_SPHCS_SW_COUNTERS_GROUPS {
-	NET_SPHCS_SW_COUNTERS_GROUP
+	NET_SPHCS_SW_COUNTERS_GROUP,
+	NET_SPHCS_SW_COUNTERS_GROUP_LATENCY
 };
 
 static const struct nnp_sw_counters_group_info g_net_sphcs_sw_counters_groups_info[] = {
 	/*NET_SPHCS_SW_COUNTERS_GROUP*/
-	{"-net_global", "group for per-network counters"}
+	{"-net_global", "group for per-network counters"},
+	/*NET_SPHCS_SW_COUNTERS_GROUP_LATENCY*/
+	{"-net_latency", "group for per-network infer request latency histograms"}
 };
 
+/*
+ * Bucket i of a latency histogram counts [2^i, 2^(i+1)) usec, except
+ * bucket 0 which starts at 0 and the last bucket which is open ended.
+ */
+#define NET_SPHCS_LAT_HIST_BUCKETS 16
+
 enum  NET_SPHCS_SW_COUNTERS {
-	NET_SPHCS_SW_COUNTERS_NUM_INFER_CMDS
+	NET_SPHCS_SW_COUNTERS_NUM_INFER_CMDS,
+	NET_SPHCS_SW_COUNTERS_LAT_WAIT_HIST,
+	NET_SPHCS_SW_COUNTERS_LAT_QUEUE_HIST = NET_SPHCS_SW_COUNTERS_LAT_WAIT_HIST + NET_SPHCS_LAT_HIST_BUCKETS,
+	NET_SPHCS_SW_COUNTERS_LAT_EXEC_HIST = NET_SPHCS_SW_COUNTERS_LAT_QUEUE_HIST + NET_SPHCS_LAT_HIST_BUCKETS,
+	NET_SPHCS_SW_COUNTERS_LAT_RESP_HIST = NET_SPHCS_SW_COUNTERS_LAT_EXEC_HIST + NET_SPHCS_LAT_HIST_BUCKETS,
+	NET_SPHCS_SW_COUNTERS_LAT_TOTAL_HIST = NET_SPHCS_SW_COUNTERS_LAT_RESP_HIST + NET_SPHCS_LAT_HIST_BUCKETS
 };
 
+#define NET_SPHCS_LAT_HIST_INFO(_name, _desc) \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_2us", _desc " < 2us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_4us", _desc " < 4us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_8us", _desc " < 8us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_16us", _desc " < 16us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_32us", _desc " < 32us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_64us", _desc " < 64us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_128us", _desc " < 128us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_256us", _desc " < 256us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_512us", _desc " < 512us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_1ms", _desc " < 1024us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_2ms", _desc " < 2048us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_4ms", _desc " < 4096us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_8ms", _desc " < 8192us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_16ms", _desc " < 16384us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_lt_32ms", _desc " < 32768us"}, \
+	{NET_SPHCS_SW_COUNTERS_GROUP_LATENCY, _name "_ge_32ms", _desc " >= 32768us"}
+
 static const struct nnp_sw_counter_info g_net_sphcs_sw_counters_info[] = {
 	/* NET_SPHCS_SW_COUNTERS_NUM_INFER_CMDS */
 	{NET_SPHCS_SW_COUNTERS_GROUP, "num_infcmds", "Number of infer command objects"},
+	/* NET_SPHCS_SW_COUNTERS_LAT_WAIT_HIST */
+	NET_SPHCS_LAT_HIST_INFO("lat_wait", "Infer requests blocked on resource dependency"),
+	/* NET_SPHCS_SW_COUNTERS_LAT_QUEUE_HIST */
+	NET_SPHCS_LAT_HIST_INFO("lat_queue", "Infer requests waiting in runtime command queue"),
+	/* NET_SPHCS_SW_COUNTERS_LAT_EXEC_HIST */
+	NET_SPHCS_LAT_HIST_INFO("lat_exec", "Infer requests executing in runtime and ICE driver"),
+	/* NET_SPHCS_SW_COUNTERS_LAT_RESP_HIST */
+	NET_SPHCS_LAT_HIST_INFO("lat_resp", "Infer requests completion handling and response"),
+	/* NET_SPHCS_SW_COUNTERS_LAT_TOTAL_HIST */
+	NET_SPHCS_LAT_HIST_INFO("lat_total", "Infer requests from schedule to response"),
 };
 
 static const struct nnp_sw_counters_set g_sw_counters_set_network = {
@@ -18,7 +18,9 @@
 #include <linux/workqueue.h>
 #include <linux/scatterlist.h>
 #include <linux/atomic.h>
+#include <linux/completion.h>
 #include "sphcs_cmd_chan.h"
+#include "sphcs_sw_counters.h"
 
 
 struct ult_cmd_entry {
@@ -190,9 +192,117 @@ static int ult2_process_dma_ping(struct sphcs *sphcs, struct sphcs_cmd_chan *cha
 	return 0;
 }
 
+struct ult2_pgt_wait {
+	struct completion done;
+	int               status;
+	struct sg_table  *sgt;
+};
+
+static void ult2_pgt_loaded_cb(void            *cb_ctx,
+			       int              status,
+			       struct sg_table *host_sgt,
+			       uint64_t         total_size)
+{
+	struct ult2_pgt_wait *w = (struct ult2_pgt_wait *)cb_ctx;
+
+	w->status = status;
+	w->sgt = host_sgt;
+	complete(&w->done);
+}
+
+static int ult2_pgt_get(uint64_t host_addr, struct ult2_pgt_wait *w)
+{
+	int rc;
+
+	init_completion(&w->done);
+	rc = sphcs_get_hostres_pagetable(host_addr, ult2_pgt_loaded_cb, w);
+	if (rc)
+		return rc;
+
+	wait_for_completion(&w->done);
+
+	return w->status;
+}
+
+static inline u64 ult2_pgt_counter(int index)
+{
+	return SPH_SW_COUNTER_GET(g_nnp_sw_counters, index);
+}
+
+/*
+ * Checks the host resource page table cache: the first map of a page
+ * list misses, a second one hits and shares its table, contiguous host
+ * chunks are merged, and the entry is dropped on the last unmap.
+ * Assumes no other map of the same list runs meanwhile.
+ */
+static int ult2_process_hostres_pgt(struct sphcs *sphcs, struct sphcs_cmd_chan *chan, u64 *msg, u32 size)
+{
+	union ULT2HostresPgtMsg *cmd = (union ULT2HostresPgtMsg *)msg;
+	uint64_t host_addr = NNP_IPC_DMA_PFN_TO_ADDR(cmd->hostPfn);
+	struct ult2_pgt_wait w1, w2;
+	struct scatterlist *sg, *prev = NULL;
+	u64 hit, miss;
+	int step, i;
+
+	hit = ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT);
+	miss = ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS);
+
+	/* 1: first map retrieves the list */
+	step = 1;
+	if (ult2_pgt_get(host_addr, &w1) ||
+	    ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS) != miss + 1 ||
+	    ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT) != hit)
+		goto out;
+
+	/* 2: no two entries left that are contiguous on the host */
+	step = 2;
+	for_each_sg(w1.sgt->sgl, sg, w1.sgt->orig_nents, i) {
+		if (prev != NULL &&
+		    prev->dma_address + prev->length == sg->dma_address &&
+		    (u64)prev->length + sg->length <= round_down(UINT_MAX, NNP_PAGE_SIZE))
+			goto put1;
+		prev = sg;
+	}
+
+	/* 3: second map hits and shares the table */
+	step = 3;
+	if (ult2_pgt_get(host_addr, &w2))
+		goto put1;
+	if (w2.sgt != w1.sgt ||
+	    ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_HIT) != hit + 1)
+		goto put2;
+
+	/* 4: last unmap drops the entry, next map misses again */
+	step = 4;
+	sphcs_put_hostres_pagetable(host_addr);
+	sphcs_put_hostres_pagetable(host_addr);
+	if (ult2_pgt_get(host_addr, &w1))
+		goto out;
+	if (ult2_pgt_counter(SPHCS_SW_COUNTERS_HOSTRES_PGT_CACHE_MISS) != miss + 2)
+		goto put1;
+
+	step = 0;
+	goto put1;
+
+put2:
+	sphcs_put_hostres_pagetable(host_addr);
+put1:
+	sphcs_put_hostres_pagetable(host_addr);
+out:
+	if (step)
+		sph_log_err(GENERAL_LOG, "hostres pgt cache test failed at step %d\n", step);
+
+	cmd->opcode = C2H_OPCODE_NAME(ULT2_OP);
+	cmd->result = step;
+	sphcs_msg_scheduler_queue_add_msg(chan->respq, &cmd->value, 1);
+
+	return 0;
+}
+
 static sphcs_chan_command_handler s_dispatch2[NNP_IPC_ULT2_NUM_OPCODES] = {
 	ult2_process_host_hwQ_msg,  /* NNP_IPC_ULT2_OP_CARD_HWQ_MSG */
 	ult2_process_dma_ping, /* NNP_IPC_ULT2_OP_DMA_PING */
+	ult2_process_hostres_pgt, /* NNP_IPC_ULT2_OP_HOSTRES_PGT */
 };
 
 /*
@@ -19,6 +19,8 @@
 #include <linux/anon_inodes.h>
 #include <linux/uaccess.h>
 #include <linux/fcntl.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 #include "sph_log.h"
 
 
@@ -30,6 +32,9 @@
 
 #define MAX_STALE_ATTR_NAME_LEN    32
 
+/* period for folding changed per-CPU counters into the mmap-ed values page */
+#define NNP_SW_COUNTERS_FOLD_PERIOD_MS	100
+
 #define SW_COUNTERS_ASSERT(x)						\
 	do {							\
 		if (likely(x))					\
@@ -47,6 +52,8 @@ struct nnp_sw_counters_group_file_attr {
 	u32	*enable;
 };
 
+struct nnp_internal_sw_counters;
+
 /* file attribute for binary file */
 struct nnp_sw_counters_bin_file_attr {
 	struct bin_attribute		attr;
@@ -55,6 +62,7 @@ struct nnp_sw_counters_bin_file_attr {
 	char				*info_buf;
 	ssize_t				info_size;
 	u64                             dirty_at_remove;
+	struct nnp_internal_sw_counters *pcpu_owner; /* fold before read */
 };
 
 struct bin_stale_node {
@@ -103,10 +111,102 @@ struct nnp_internal_sw_counters {
 	struct nnp_sw_counters				sw_counters;
 	struct nnp_internal_sw_counters			*parent;
 	struct gen_sync_attr			        *gen_sync_attr;
+	u32						pcpu_count;
+	struct delayed_work				fold_work;
 };
 
 static DEFINE_MUTEX(values_tree_sync_mutex);
 
+u64 nnp_sw_counter_fold(struct nnp_sw_counters *counters, u32 index)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu_ptr(counters->pcpu_values, cpu)[index];
+
+	return sum;
+}
+
+/*
+ * Set is not atomic against concurrent updates on other CPUs,
+ * it is only meant for counters with a single writer (min/max times)
+ */
+void nnp_sw_counter_percpu_set(struct nnp_sw_counters *counters, u32 index, u64 val)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		per_cpu_ptr(counters->pcpu_values, cpu)[index] = 0;
+
+	this_cpu_write(counters->pcpu_values[index], val);
+	NNP_SW_COUNTER_PCPU_KICK(counters);
+}
+
+/* returns true if any value of the values page changed */
+static bool fold_pcpu_counters(struct nnp_internal_sw_counters *sw_counters_values)
+{
+	struct nnp_sw_counters *counters = &sw_counters_values->sw_counters;
+	bool changed = false;
+	u64 val;
+	u32 i;
+
+	for (i = 0; i < sw_counters_values->pcpu_count; i++) {
+		val = nnp_sw_counter_fold(counters, i);
+		if (val != READ_ONCE(counters->values[i])) {
+			WRITE_ONCE(counters->values[i], val);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+static void fold_pcpu_counters_work(struct work_struct *work)
+{
+	struct nnp_internal_sw_counters *sw_counters_values =
+		container_of(to_delayed_work(work),
+			     struct nnp_internal_sw_counters,
+			     fold_work);
+	struct nnp_sw_counters *counters = &sw_counters_values->sw_counters;
+
+	if (fold_pcpu_counters(sw_counters_values))
+		goto rearm;
+
+	/* nothing changed for a period, next update restarts the work */
+	if (cmpxchg(&counters->pcpu_fold_state,
+		    NNP_SW_COUNTERS_FOLD_ACTIVE,
+		    NNP_SW_COUNTERS_FOLD_IDLE) != NNP_SW_COUNTERS_FOLD_ACTIVE)
+		return;
+
+	/*
+	 * an update that raced going idle saw the work active, fold it now.
+	 * Writers have no barrier, so such an update may still be published
+	 * only by the next update or read() of the values file.
+	 */
+	if (!fold_pcpu_counters(sw_counters_values) ||
+	    cmpxchg(&counters->pcpu_fold_state,
+		    NNP_SW_COUNTERS_FOLD_IDLE,
+		    NNP_SW_COUNTERS_FOLD_ACTIVE) != NNP_SW_COUNTERS_FOLD_IDLE)
+		return;
+
+rearm:
+	schedule_delayed_work(&sw_counters_values->fold_work,
+			      msecs_to_jiffies(NNP_SW_COUNTERS_FOLD_PERIOD_MS));
+}
+
+void nnp_sw_counter_fold_kick(struct nnp_sw_counters *counters)
+{
+	struct nnp_internal_sw_counters *sw_counters_values =
+		container_of(counters, struct nnp_internal_sw_counters, sw_counters);
+
+	if (cmpxchg(&counters->pcpu_fold_state,
+		    NNP_SW_COUNTERS_FOLD_IDLE,
+		    NNP_SW_COUNTERS_FOLD_ACTIVE) == NNP_SW_COUNTERS_FOLD_IDLE)
+		schedule_delayed_work(&sw_counters_values->fold_work,
+				      msecs_to_jiffies(NNP_SW_COUNTERS_FOLD_PERIOD_MS));
+}
+
 /* create counters description buffer object */
 int create_sw_counters_description_data(const  struct nnp_sw_counters_set *counters_set,
 					bool isRoot,
@@ -228,6 +328,10 @@ static ssize_t read_nnp_counter_bin_values(struct file *f,
 
 	struct nnp_sw_counters_bin_file_attr *counters_att = (struct nnp_sw_counters_bin_file_attr *)attr;
 
+	/* readers through the file get exact values, mmap readers see the periodic fold */
+	if (counters_att->pcpu_owner)
+		fold_pcpu_counters(counters_att->pcpu_owner);
+
 	if (!counters_att->bin_page || !counters_att->page_count)
 		ret = -1;
 	else
@@ -1130,6 +1234,26 @@ int nnp_create_sw_counters_values_node(void *hInfoNode,
 		sw_counters_values->sw_counters.spinlocks = NULL;
 	}
 
+	/* hot counters sets are updated per-CPU and folded lazily into the values page */
+	if (sw_counters_info->counters_set->perCPU &&
+	    sw_counters_info->counters_set->counters_count > 0) {
+		sw_counters_values->pcpu_count = sw_counters_info->counters_set->counters_count;
+		sw_counters_values->sw_counters.pcpu_values =
+			__alloc_percpu(sw_counters_values->pcpu_count * NNP_COUNTER_SIZE,
+				       __alignof__(u64));
+		if (sw_counters_values->sw_counters.pcpu_values == NULL) {
+			sph_log_err(GENERAL_LOG, "unable to allocate per-CPU counters\n");
+			kfree(sw_counters_values->sw_counters.spinlocks);
+			ret = -ENOMEM;
+			goto cleanup_sw_counters_children_kobject_list;
+		}
+
+		sw_counters_values->bin_file.pcpu_owner = sw_counters_values;
+		/* the fold work starts idle, the first update schedules it */
+		INIT_DELAYED_WORK(&sw_counters_values->fold_work, fold_pcpu_counters_work);
+		sw_counters_values->sw_counters.pcpu_fold_state = NNP_SW_COUNTERS_FOLD_IDLE;
+	}
+
 	/* set the external buffer to user */
 	*counters = &(sw_counters_values->sw_counters);
 
@@ -1195,6 +1319,15 @@ int nnp_sw_counters_release_values_node(struct nnp_internal_sw_counters *sw_coun
 
 	remove_group_files(sw_counters_values);
 
+	/* publish final per-CPU values, stale copies must not fold */
+	if (sw_counters_values->sw_counters.pcpu_values) {
+		/* late updates must not schedule the work again */
+		xchg(&sw_counters_values->sw_counters.pcpu_fold_state,
+		     NNP_SW_COUNTERS_FOLD_DEAD);
+		cancel_delayed_work_sync(&sw_counters_values->fold_work);
+		fold_pcpu_counters(sw_counters_values);
+		sw_counters_values->bin_file.pcpu_owner = NULL;
+	}
 
 	/* in case removing root values node - driver need to clean dirty info pointer */
 	/* so, info dirty counter will stop getting updated */
@@ -1241,6 +1374,8 @@ int nnp_sw_counters_release_values_node(struct nnp_internal_sw_counters *sw_coun
 		kfree(sw_counters_values->sw_counters.groups);
 
 	kfree(sw_counters_values->sw_counters.spinlocks);
+	/* values file already removed - no reader can fold anymore */
+	free_percpu(sw_counters_values->sw_counters.pcpu_values);
 
 	mutex_destroy(&sw_counters_values->list_lock);
 	kfree(sw_counters_values);
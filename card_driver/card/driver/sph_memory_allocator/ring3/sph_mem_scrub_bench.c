@@ -0,0 +1,243 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Memory scrub engine benchmark. Runs the fill and verify passes of
+ * sph_mem_scrub.c over an mmap'd buffer with one pthread per worker,
+ * the way scrub_run queues a work per CPU, and reports GB/s per pattern
+ * and compare kernel.
+ *
+ * With -f, single bit faults are injected at random words after each
+ * fill, and verify must report the lowest of them. The exit code is
+ * non zero if it does not.
+ *
+ *   ./sph_mem_scrub_bench [-m MB] [-t threads] [-p patterns] [-f faults] [-F file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "sph_mem_scrub.h"
+
+#define BENCH_MAX_THREADS 256
+
+struct bench_cfg {
+	uint64_t size;
+	uint32_t threads;
+	uint32_t patterns;
+	uint32_t faults;
+	const char *file;
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *scrub_thread(void *data)
+{
+	scrub_job_work((struct scrub_job *)data);
+
+	return NULL;
+}
+
+/* returns run time in seconds, negative on error */
+static double scrub_run(struct scrub_job *job, bool verify, uint32_t threads)
+{
+	pthread_t tid[BENCH_MAX_THREADS];
+	double start;
+	uint32_t i;
+
+	scrub_job_start(job, verify);
+
+	start = now_sec();
+	for (i = 0; i < threads; i++)
+		if (pthread_create(&tid[i], NULL, scrub_thread, job) != 0)
+			break;
+	threads = i;
+	for (i = 0; i < threads; i++)
+		pthread_join(tid[i], NULL);
+
+	return threads > 0 ? now_sec() - start : -1.0;
+}
+
+/* flips one bit of faults random words, returns the lowest word index */
+static s64 inject_faults(struct scrub_job *job, uint32_t faults)
+{
+	s64 lowest = S64_MAX;
+	u64 idx;
+	uint32_t i;
+
+	for (i = 0; i < faults; i++) {
+		idx = (((u64)rand() << 31) | rand()) % job->count;
+		job->buf[idx] ^= 1ULL << (rand() & 63);
+		if ((s64)idx < lowest)
+			lowest = idx;
+	}
+
+	return lowest;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-m MB] [-t threads] [-p patterns] [-f faults] [-F file]\n", prog);
+	printf("  -m  buffer size in MB (default 256)\n");
+	printf("  -t  worker threads (default online cpus)\n");
+	printf("  -p  pattern mask, 0x1 zeros, 0x2 ones, 0x4 walking ones, 0x8 address (default 0xf)\n");
+	printf("  -f  single bit faults injected after each fill (default 0)\n");
+	printf("  -F  map this file instead of anonymous memory, e.g. on hugetlbfs\n");
+}
+
+static int parse_args(int argc, char **argv, struct bench_cfg *cfg)
+{
+	int opt;
+
+	cfg->size = 256ULL << 20;
+	cfg->threads = sysconf(_SC_NPROCESSORS_ONLN);
+	cfg->patterns = (1u << SCRUB_PATTERN_NUM) - 1;
+	cfg->faults = 0;
+	cfg->file = NULL;
+
+	while ((opt = getopt(argc, argv, "m:t:p:f:F:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			cfg->size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 't':
+			cfg->threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg->patterns = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			cfg->faults = strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			cfg->file = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (cfg->size == 0 || cfg->threads == 0 || cfg->threads > BENCH_MAX_THREADS) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	return 0;
+}
+
+static u64 *map_buffer(const struct bench_cfg *cfg)
+{
+	void *p;
+	int fd;
+
+	if (cfg->file == NULL) {
+		p = mmap(NULL, cfg->size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	} else {
+		fd = open(cfg->file, O_RDWR | O_CREAT, 0600);
+		if (fd < 0)
+			return NULL;
+		if (ftruncate(fd, cfg->size) != 0) {
+			close(fd);
+			return NULL;
+		}
+		p = mmap(NULL, cfg->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, fd, 0);
+		close(fd);
+	}
+
+	return p == MAP_FAILED ? NULL : p;
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_cfg cfg;
+	struct scrub_job job;
+	enum scrub_pattern pattern;
+	double fill_sec, verify_sec, gb;
+	char verify_rate[16];
+	s64 expected, found;
+	bool has_avx2;
+	int avx2, failed = 0;
+	u64 *buf;
+
+	if (parse_args(argc, argv, &cfg))
+		return 1;
+
+	buf = map_buffer(&cfg);
+	if (buf == NULL) {
+		fprintf(stderr, "failed to map %llu bytes\n", (unsigned long long)cfg.size);
+		return 1;
+	}
+
+	has_avx2 = __builtin_cpu_supports("avx2");
+	gb = cfg.size / 1e9;
+	srand(1);
+
+	printf("size %llu MB threads %u faults %u avx2 %s\n",
+	       (unsigned long long)(cfg.size >> 20), cfg.threads, cfg.faults,
+	       has_avx2 ? "yes" : "no");
+	printf("%-13s %-7s %10s %12s %9s\n", "pattern", "compare", "fill_GB/s", "verify_GB/s", "detect");
+
+	for (pattern = 0; pattern < SCRUB_PATTERN_NUM; pattern++) {
+		if (!(cfg.patterns & (1u << pattern)))
+			continue;
+
+		for (avx2 = 0; avx2 <= 1; avx2++) {
+			/* AVX2 kernel compares constant patterns only */
+			if (avx2 && (!has_avx2 || pattern > SCRUB_PATTERN_ONES))
+				continue;
+
+			memset(&job, 0, sizeof(job));
+			job.buf = buf;
+			job.count = cfg.size / sizeof(u64);
+			job.phys = (uintptr_t)buf;
+			job.pattern = pattern;
+			job.use_avx2 = avx2;
+
+			fill_sec = scrub_run(&job, false, cfg.threads);
+			expected = inject_faults(&job, cfg.faults);
+			verify_sec = scrub_run(&job, true, cfg.threads);
+			if (fill_sec < 0 || verify_sec < 0) {
+				fprintf(stderr, "failed to start workers\n");
+				munmap(buf, cfg.size);
+				return 1;
+			}
+
+			found = atomic64_read(&job.first_bad);
+			if (found != expected)
+				failed = 1;
+
+			/* verify stops at the first bad chunk, rate only counts without faults */
+			if (cfg.faults)
+				snprintf(verify_rate, sizeof(verify_rate), "-");
+			else
+				snprintf(verify_rate, sizeof(verify_rate), "%.2f", gb / verify_sec);
+
+			printf("%-13s %-7s %10.2f %12s %9s\n",
+			       scrub_pattern_names[pattern], avx2 ? "avx2" : "scalar",
+			       gb / fill_sec, verify_rate,
+			       found == expected ? "ok" : "MISSED");
+		}
+	}
+
+	munmap(buf, cfg.size);
+
+	return failed;
+}
@@ -0,0 +1,150 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Memory test fill/verify engine. The caller runs scrub_job_work on each
+ * of its workers, see scrub_run in sph_memory_allocator_main.c.
+ * It uses no kernel services beside atomics and the FPU section, so it
+ * is also built in userspace by ring3/Makefile.
+ */
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/fpu/api.h>
+#include "sph_mem_scrub.h"
+
+/* AVX2 compare block - 4 ymm registers */
+#define SCRUB_BLOCK_WORDS 16
+
+const char * const scrub_pattern_names[SCRUB_PATTERN_NUM] = {
+	"zeros", "ones", "walking ones", "address"
+};
+
+static inline u64 scrub_value(const struct scrub_job *job, u64 idx)
+{
+	switch (job->pattern) {
+	case SCRUB_PATTERN_ONES:
+		return -1ULL;
+	case SCRUB_PATTERN_WALKING_ONES:
+		return 1ULL << (idx & 63);
+	case SCRUB_PATTERN_ADDRESS:
+		return job->phys + idx * sizeof(u64);
+	default:
+		return 0;
+	}
+}
+
+static inline bool scrub_constant(const struct scrub_job *job)
+{
+	return job->pattern == SCRUB_PATTERN_ZEROS || job->pattern == SCRUB_PATTERN_ONES;
+}
+
+/* Non temporal stores, the data goes to memory and not to the cache,
+ * so verify reads back memory without flushing the range
+ */
+static void scrub_fill(const struct scrub_job *job, u64 start, u64 count)
+{
+	u64 i;
+
+	for (i = start; i < start + count; i++)
+		asm volatile("movnti %1, %0" : "=m" (job->buf[i]) : "r" (scrub_value(job, i)));
+	wmb();
+}
+
+static u64 scrub_check_scalar(const struct scrub_job *job, u64 start, u64 count)
+{
+	u64 i;
+
+	for (i = start; i < start + count; i++)
+		if (job->buf[i] != scrub_value(job, i))
+			return i;
+
+	return U64_MAX;
+}
+
+/* Constant patterns only, 128 bytes compared per iteration */
+static u64 scrub_check_avx2(const struct scrub_job *job, u64 start, u64 count)
+{
+	u64 value = scrub_value(job, start);
+	u64 end = start + count;
+	u64 i, bad = U64_MAX;
+	u8 diff;
+
+	kernel_fpu_begin();
+	for (i = start; i + SCRUB_BLOCK_WORDS <= end; i += SCRUB_BLOCK_WORDS) {
+		asm volatile("vpbroadcastq %[val], %%ymm0\n\t"
+			     "vpxor 0(%[p]), %%ymm0, %%ymm1\n\t"
+			     "vpxor 32(%[p]), %%ymm0, %%ymm2\n\t"
+			     "vpxor 64(%[p]), %%ymm0, %%ymm3\n\t"
+			     "vpxor 96(%[p]), %%ymm0, %%ymm4\n\t"
+			     "vpor %%ymm2, %%ymm1, %%ymm1\n\t"
+			     "vpor %%ymm4, %%ymm3, %%ymm3\n\t"
+			     "vpor %%ymm3, %%ymm1, %%ymm1\n\t"
+			     "vptest %%ymm1, %%ymm1\n\t"
+			     "setnz %[diff]\n\t"
+			     : [diff] "=qm" (diff)
+			     : [p] "r" (&job->buf[i]), [val] "m" (value)
+			     : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4");
+		if (unlikely(diff)) {
+			bad = scrub_check_scalar(job, i, SCRUB_BLOCK_WORDS);
+			break;
+		}
+	}
+	asm volatile("vzeroupper" ::: "memory");
+	kernel_fpu_end();
+
+	if (bad == U64_MAX && i < end)
+		bad = scrub_check_scalar(job, i, end - i);
+
+	return bad;
+}
+
+static void scrub_set_bad(struct scrub_job *job, u64 idx)
+{
+	s64 cur = atomic64_read(&job->first_bad);
+	s64 old;
+
+	while ((s64)idx < cur) {
+		old = atomic64_cmpxchg(&job->first_bad, cur, idx);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+}
+
+void scrub_job_start(struct scrub_job *job, bool verify)
+{
+	job->verify = verify;
+	job->nr_chunks = DIV_ROUND_UP(job->count, SCRUB_CHUNK_WORDS);
+	atomic64_set(&job->next_chunk, 0);
+	atomic64_set(&job->first_bad, S64_MAX);
+}
+
+void scrub_job_work(struct scrub_job *job)
+{
+	u64 chunk, start, count, bad;
+
+	while ((chunk = atomic64_inc_return(&job->next_chunk) - 1) < job->nr_chunks) {
+		start = chunk * SCRUB_CHUNK_WORDS;
+		count = min_t(u64, SCRUB_CHUNK_WORDS, job->count - start);
+
+		if (!job->verify) {
+			scrub_fill(job, start, count);
+			continue;
+		}
+
+		/* lower bad word already found */
+		if ((s64)start > atomic64_read(&job->first_bad))
+			break;
+
+		if (job->use_avx2 && scrub_constant(job))
+			bad = scrub_check_avx2(job, start, count);
+		else
+			bad = scrub_check_scalar(job, start, count);
+		if (bad != U64_MAX)
+			scrub_set_bad(job, bad);
+	}
+}
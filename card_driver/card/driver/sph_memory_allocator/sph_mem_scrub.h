@@ -0,0 +1,49 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+#ifndef _SPH_MEM_SCRUB_H
+#define _SPH_MEM_SCRUB_H
+
+#include <linux/types.h>
+#include <linux/atomic.h>
+
+enum scrub_pattern {
+	SCRUB_PATTERN_ZEROS,
+	SCRUB_PATTERN_ONES,
+	SCRUB_PATTERN_WALKING_ONES,
+	SCRUB_PATTERN_ADDRESS,
+	SCRUB_PATTERN_NUM
+};
+
+extern const char * const scrub_pattern_names[SCRUB_PATTERN_NUM];
+
+/* Segment is filled/verified in chunks taken by the workers in turn,
+ * so a slow CPU does not hold back the others
+ */
+#define SCRUB_CHUNK_WORDS ((256 * 1024) / sizeof(u64))
+
+struct scrub_job {
+	u64 *buf;
+	u64 count;
+	/* physical address of buf, for address in address pattern */
+	phys_addr_t phys;
+	enum scrub_pattern pattern;
+	/* compare constant patterns with AVX2, caller checks cpu support */
+	bool use_avx2;
+	bool verify;
+	u64 nr_chunks;
+	atomic64_t next_chunk;
+	/* lowest mismatching word index, S64_MAX if none */
+	atomic64_t first_bad;
+};
+
+/* resets job for a fill or verify pass, before the workers start */
+void scrub_job_start(struct scrub_job *job, bool verify);
+
+/* worker body, takes chunks until none is left */
+void scrub_job_work(struct scrub_job *job);
+
+#endif
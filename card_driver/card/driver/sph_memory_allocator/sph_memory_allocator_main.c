@@ -15,12 +15,15 @@
 #include <linux/bitops.h>
 #include <linux/workqueue.h>
 #include <linux/cpumask.h>
+#include <linux/atomic.h>
+#include <asm/cpufeature.h>
 
 #include "sph_log.h"
 #include "sph_version.h"
 #include "sph_mem_alloc_defs.h"
 #include "sw_counters.h"
 #include "sph_ibecc.h"
+#include "sph_mem_scrub.h"
 
 /* The sph_mem module parameter defines physically contiguous
  * memory regions that will be managed by Memory Allocator
@@ -29,8 +32,11 @@
  */
 static char *sph_mem;
 static int test;
+static uint test_patterns = 0x3;
 module_param(sph_mem, charp, 0400);
 module_param(test, int, 0400);
+module_param(test_patterns, uint, 0400);
+MODULE_PARM_DESC(test_patterns, "Memory test patterns mask: 0x1 zeros, 0x2 ones, 0x4 walking ones, 0x8 address in address (default 0x3)");
 
 #ifdef CARD_PLATFORM_BR
 
@@ -81,42 +87,74 @@ LIST_HEAD(protected_managed_regions);
 struct page *pages[NUM_OF_PAGES];
 
 static struct workqueue_struct *wq;
-static void do_mem_set_work(struct work_struct *work);
 
 struct mem_work {
 	struct work_struct work;
-	uint64_t *buf;
-	uint64_t value;
-	uint64_t count;
-	bool res;
+	struct scrub_job *job;
 };
 static struct mem_work *mem_works;
 static int num_of_mem_works;
+static bool scrub_use_avx2;
+#ifdef INJECT_ERR
+/* page of the current segment to corrupt after fill, -1 if none */
+static s64 inject_bad_page_index = -1;
+#endif
 
-static void do_mem_set_work(struct work_struct *work)
+static void do_scrub_work(struct work_struct *work)
 {
-	struct mem_work *mem_set_work = container_of(work, struct mem_work, work);
+	struct mem_work *mem_work = container_of(work, struct mem_work, work);
 
-	memset64(mem_set_work->buf, mem_set_work->value, mem_set_work->count);
-	clflush_cache_range(mem_set_work->buf,  mem_set_work->count * sizeof(u64));
+	scrub_job_work(mem_work->job);
 }
 
-static bool memcmp64(u64 *buf, u64 value, u64 count)
+static void scrub_run(struct scrub_job *job, bool verify)
 {
-	u64 i;
+	int cpu;
+	int i = 0;
 
-	for (i = 0; i < count; i++)
-		if (buf[i] != value)
-			return false;
-	return true;
+	scrub_job_start(job, verify);
+
+	for_each_cpu(cpu, cpu_online_mask) {
+		if (i == num_of_mem_works)
+			break;
+		mem_works[i].job = job;
+		INIT_WORK(&mem_works[i].work, do_scrub_work);
+		queue_work_on(cpu, wq, &mem_works[i].work);
+		i++;
+	}
+
+	flush_workqueue(wq);
 }
 
-static void do_mem_cmp_work(struct work_struct *work)
+/* returns index of the first bad page in buf, or -1 if all good */
+static s64 scrub_segment(u64 *buf, phys_addr_t phys, u64 num_pages, enum scrub_pattern pattern)
 {
-	struct mem_work *mem_cmp_work = container_of(work, struct mem_work, work);
+	struct scrub_job job = {
+		.buf = buf,
+		.count = num_pages * PAGE_SIZE / sizeof(u64),
+		.phys = phys,
+		.pattern = pattern,
+		.use_avx2 = scrub_use_avx2,
+	};
+	phys_addr_t bad_addr;
+	s64 bad;
 
-	mem_cmp_work->res = memcmp64(mem_cmp_work->buf, mem_cmp_work->value, mem_cmp_work->count);
+	scrub_run(&job, false);
+#ifdef INJECT_ERR
+	if (inject_bad_page_index >= 0 && inject_bad_page_index < num_pages)
+		memset((u8 *)buf + inject_bad_page_index * PAGE_SIZE, 1, PAGE_SIZE);
+#endif
+	scrub_run(&job, true);
+
+	bad = atomic64_read(&job.first_bad);
+	if (bad == S64_MAX)
+		return -1;
 
+	bad_addr = phys + bad * sizeof(u64);
+	sph_log_err(GENERAL_LOG, "Pattern %s mismatch at %pa\n",
+		    scrub_pattern_names[pattern], &bad_addr);
+
+	return bad * sizeof(u64) / PAGE_SIZE;
 }
 
 static bool overlapped_region(struct mem_region *reg1, struct mem_region *reg2)
@@ -202,63 +240,20 @@ static int update_regions(struct mem_region *reg, struct mem_region **tmp, u64 b
 	return 0;
 }
 
-static void memset64_mt(u64 *buf, u64 value, u64 count)
-{
-	int cpu;
-	u64 i;
-	uint64_t count_per_thread = count / num_of_mem_works;
-
-	i = 0;
-	for_each_cpu(cpu, cpu_online_mask) {
-		mem_works[i].value = value;
-		mem_works[i].count = count_per_thread;
-		mem_works[i].buf = buf + i*count_per_thread;
-		INIT_WORK(&mem_works[i].work, do_mem_set_work);
-		queue_work_on(cpu, wq,  &mem_works[i].work);
-		i++;
-	}
-
-	flush_workqueue(wq);
-}
-
-static bool memcmp64_mt(u64 *buf, u64 value, u64 count)
-{
-	u64 i;
-	int cpu;
-	bool ret = true;
-	uint64_t count_per_thread = count / num_of_mem_works;
-
-	i = 0;
-	for_each_cpu(cpu, cpu_online_mask) {
-		mem_works[i].value = value;
-		mem_works[i].count = count_per_thread;
-		mem_works[i].buf = buf + i*count_per_thread;
-		mem_works[i].res = false;
-		INIT_WORK(&mem_works[i].work, do_mem_cmp_work);
-		queue_work_on(cpu, wq,  &mem_works[i].work);
-		i++;
-	}
-
-	flush_workqueue(wq);
-
-	for (i = 0; i < num_of_mem_works; i++)
-		ret = ret && mem_works[i].res;
-	return ret;
-}
-
 static int test_list(struct list_head *head, bool is_protected)
 {
 	struct mem_region *reg, *tmp;
 	u64 num_of_pages, num_of_tested_pages, pages_to_test;
+	phys_addr_t seg_start;
+	enum scrub_pattern pattern;
 	u32 i;
 	void *reg_virt_addr;
 	bool bad_page_detected;
+	s64 bad_page;
 	int rc;
 
 #ifdef INJECT_ERR
 	bool inject = true;
-	bool inject_current_reg = false;
-	u64 injected_bad_page_index;
 	phys_addr_t injected_bad_page_addr = 0x20000F000;
 #endif
 
@@ -275,22 +270,13 @@ static int test_list(struct list_head *head, bool is_protected)
 
 		sph_log_debug(GENERAL_LOG, "Start scan memory region %pad\t0x%zX\n", &reg->start, reg->size);
 
-#ifdef INJECT_ERR
-		if (inject) {
-			if ((injected_bad_page_addr >= reg->start) && (injected_bad_page_addr < (reg->start + reg->size))) {
-				injected_bad_page_index = (injected_bad_page_addr - reg->start) >> PAGE_SHIFT;
-				sph_log_debug(GENERAL_LOG, "injected_bad_page_index = 0x%llX\n", injected_bad_page_index);
-				inject_current_reg = true;
-			} else
-				inject_current_reg = false;
-		}
-#endif
 		/* scan the region by segments of NUM_OF_PAGES pages */
 		while ((num_of_pages > num_of_tested_pages) && (!bad_page_detected)) {
 
 			pages_to_test = (num_of_pages - num_of_tested_pages > NUM_OF_PAGES) ? NUM_OF_PAGES : num_of_pages - num_of_tested_pages;
+			seg_start = reg->start + num_of_tested_pages * PAGE_SIZE;
 			for (i = 0; i < pages_to_test; i++)
-				pages[i] = pfn_to_page(PHYS_PFN(reg->start + num_of_tested_pages*PAGE_SIZE + i*PAGE_SIZE));
+				pages[i] = pfn_to_page(PHYS_PFN(seg_start + i*PAGE_SIZE));
 
 			reg_virt_addr = vm_map_ram(pages, pages_to_test, -1, PAGE_KERNEL);
 			if (reg_virt_addr == NULL) {
@@ -299,57 +285,39 @@ static int test_list(struct list_head *head, bool is_protected)
 				goto err;
 			}
 
-			memset64_mt(reg_virt_addr, 0, pages_to_test * PAGE_SIZE / sizeof(u64));
 #ifdef INJECT_ERR
-			if (inject_current_reg) {
-				if (injected_bad_page_index >= num_of_tested_pages && injected_bad_page_index <= num_of_tested_pages + pages_to_test)
-					memset(reg_virt_addr + (injected_bad_page_index - num_of_tested_pages)*PAGE_SIZE, 1, PAGE_SIZE);
+			inject_bad_page_index = -1;
+			if (inject && injected_bad_page_addr >= seg_start &&
+			    injected_bad_page_addr < seg_start + pages_to_test * PAGE_SIZE) {
+				inject_bad_page_index = (injected_bad_page_addr - seg_start) >> PAGE_SHIFT;
+				sph_log_debug(GENERAL_LOG, "injected_bad_page_index = 0x%llX\n", inject_bad_page_index);
 			}
 #endif
-			/* More likely that there is no faulty pages, so we try to compare all in once */
-			if (unlikely(!memcmp64_mt(reg_virt_addr, 0, pages_to_test * PAGE_SIZE / sizeof(u64)))) {
-				/* Find the faulty page */
-				for (i = 0; i < pages_to_test; i++) {
-					if (!memcmp64_mt(reg_virt_addr + i*PAGE_SIZE, 0x0, PAGE_SIZE / sizeof(u64))) {
-						sph_log_err(GENERAL_LOG, "Bad page detected - bad page index %llu\n", num_of_tested_pages + i);
-						if (is_protected)
-							NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_PROT_BYTES_BAD_INDEX, PAGE_SIZE);
-						else
-							NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_BYTES_BAD_INDEX, PAGE_SIZE);
-						rc = update_regions(reg, &tmp, num_of_tested_pages + i);
-						if (rc != 0)
-							goto err;
-						bad_page_detected = true;
-						goto out;
-					}
-
+			for (pattern = 0; pattern < SCRUB_PATTERN_NUM; pattern++) {
+				if (!(test_patterns & BIT(pattern)))
+					continue;
+
+				bad_page = scrub_segment(reg_virt_addr, seg_start, pages_to_test, pattern);
+				if (likely(bad_page < 0))
+					continue;
+
+				sph_log_err(GENERAL_LOG, "Bad page detected - bad page index %llu\n", num_of_tested_pages + bad_page);
+				if (is_protected)
+					NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_PROT_BYTES_BAD_INDEX, PAGE_SIZE);
+				else
+					NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_BYTES_BAD_INDEX, PAGE_SIZE);
+				rc = update_regions(reg, &tmp, num_of_tested_pages + bad_page);
+				if (rc != 0) {
+					vm_unmap_ram(reg_virt_addr, pages_to_test);
+					goto err;
 				}
+				bad_page_detected = true;
+				break;
 			}
 
-			memset64_mt(reg_virt_addr, -1ULL, pages_to_test * PAGE_SIZE / sizeof(u64));
-
-			/* More likely that there is no faulty pages, so we try to compare all in once */
-			if (unlikely(!memcmp64_mt(reg_virt_addr, -1ULL, pages_to_test * PAGE_SIZE / sizeof(u64)))) {
-				/* Find the faulty page */
-				for (i = 0; i < pages_to_test; i++) {
-					if (!memcmp64(reg_virt_addr + i*PAGE_SIZE, -1ULL, PAGE_SIZE / sizeof(u64))) {
-						sph_log_err(GENERAL_LOG, "Bad page detected - bad page index %llu\n", num_of_tested_pages + i);
-						if (is_protected)
-							NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_PROT_BYTES_BAD_INDEX, PAGE_SIZE);
-						else
-							NNP_SW_COUNTER_ADD(sw_counters, SW_COUNTER_BYTES_BAD_INDEX, PAGE_SIZE);
-						rc = update_regions(reg, &tmp, num_of_tested_pages + i);
-						if (rc != 0)
-							goto err;
-						bad_page_detected = true;
-						goto out;
-					}
-
-				}
-			}
+			if (!bad_page_detected)
+				num_of_tested_pages += pages_to_test;
 
-			num_of_tested_pages += pages_to_test;
-out:
 			vm_unmap_ram(reg_virt_addr, pages_to_test);
 		}
 
@@ -600,8 +568,10 @@ static int test_memory(void)
 	int rc;
 
 	num_of_mem_works = num_online_cpus();
+	scrub_use_avx2 = boot_cpu_has(X86_FEATURE_AVX2) && boot_cpu_has(X86_FEATURE_OSXSAVE);
 
-	sph_log_info(START_UP_LOG, "Number of online cpus - %d\n", num_of_mem_works);
+	sph_log_info(START_UP_LOG, "Number of online cpus - %d, avx2 compare %s, patterns 0x%x\n",
+		     num_of_mem_works, scrub_use_avx2 ? "on" : "off", test_patterns);
 
 	mem_works = kmalloc_array(num_of_mem_works, sizeof(struct mem_work), GFP_KERNEL);
 	if (mem_works == NULL) {
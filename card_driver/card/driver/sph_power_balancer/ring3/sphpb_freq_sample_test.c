@@ -0,0 +1,181 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Userspace unit test of the per cpu frequency sampler over the MSR stub.
+ * Every simulated millisecond each cpu's APERF advances by its frequency
+ * from a synthetic trace and MPERF by the TSC frequency, both through
+ * sphpb_msr_stub_set(), then the expired sample timers fire on their cpu.
+ * A cpu in a C state advances neither.
+ *
+ *   make test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sphpb.h"
+#include "sphpb_msr.h"
+
+#define CHECK(x)							\
+	do {								\
+		if (!(x)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__func__, __LINE__, #x);		\
+			return -1;					\
+		}							\
+	} while (0)
+
+#define TEST_TSC_KHZ	2000000
+/* a cpu in a C state */
+#define TEST_IDLE	0
+
+struct kmock_sys kmock_sys;
+
+static uint64_t s_aperf[KMOCK_NR_CPUS];
+static uint64_t s_mperf[KMOCK_NR_CPUS];
+
+static void test_reset(void)
+{
+	memset(&kmock_sys, 0, sizeof(kmock_sys));
+	INIT_LIST_HEAD(&kmock_sys.timers);
+	cpu_khz = TEST_TSC_KHZ;
+	/* start near the wrap, time_after must hold across it */
+	jiffies = -1000UL;
+	memset(s_aperf, 0, sizeof(s_aperf));
+	memset(s_mperf, 0, sizeof(s_mperf));
+}
+
+/* run ms milliseconds with cpu at freq_khz[cpu] */
+static void run_trace(const uint32_t *freq_khz, uint32_t ms)
+{
+	uint32_t cpu, i;
+
+	for (i = 0; i < ms; i++) {
+		for (cpu = 0; cpu < KMOCK_NR_CPUS; cpu++) {
+			if (freq_khz[cpu] == TEST_IDLE)
+				continue;
+			s_aperf[cpu] += freq_khz[cpu];
+			s_mperf[cpu] += TEST_TSC_KHZ;
+			sphpb_msr_stub_set(cpu, MSR_IA32_APERF, s_aperf[cpu]);
+			sphpb_msr_stub_set(cpu, MSR_IA32_MPERF, s_mperf[cpu]);
+		}
+		kmock_run_timers(jiffies + 1);
+	}
+}
+
+static int check_freqs(const uint32_t *freq_khz)
+{
+	uint32_t cpu;
+
+	for (cpu = 0; cpu < KMOCK_NR_CPUS; cpu++)
+		CHECK(sphpb_freq_sample_get_khz(cpu) == freq_khz[cpu]);
+
+	return 0;
+}
+
+static int test_msr_stub(void)
+{
+	uint64_t val;
+
+	test_reset();
+
+	CHECK(sphpb_msr_stub_set(3, MSR_IA32_APERF, 1234) == 0);
+	CHECK(sphpb_msr_stub_set(1024, MSR_IA32_APERF, 1) == -EINVAL);
+	CHECK(sphpb_msr_stub_set(0, 0x10, 1) == -EINVAL);
+
+	kmock_sys.cpu = 3;
+	CHECK(sphpb_msr_read(MSR_IA32_APERF, &val) == 0 && val == 1234);
+	kmock_sys.cpu = 2;
+	CHECK(sphpb_msr_read(MSR_IA32_APERF, &val) == 0 && val == 0);
+	CHECK(sphpb_msr_read(0x10, &val) == -EIO);
+
+	CHECK(sphpb_msr_write(SPH_MSR_CORE_PERF_LIMIT_REASONS, 0x5) == 0);
+	CHECK(sphpb_msr_read(SPH_MSR_CORE_PERF_LIMIT_REASONS, &val) == 0 && val == 0x5);
+	kmock_sys.cpu = 0;
+	CHECK(sphpb_msr_read(SPH_MSR_CORE_PERF_LIMIT_REASONS, &val) == 0 && val == 0);
+
+	return 0;
+}
+
+/* each cpu reports its own frequency, and follows a step */
+static int test_per_cpu_freq(void)
+{
+	uint32_t freq[KMOCK_NR_CPUS], none[KMOCK_NR_CPUS] = { 0 };
+	uint32_t cpu;
+
+	test_reset();
+	for (cpu = 0; cpu < KMOCK_NR_CPUS; cpu++)
+		freq[cpu] = 400000 * (cpu + 1);
+
+	CHECK(sphpb_freq_sample_init() == 0);
+
+	/* first sample is the baseline, nothing published */
+	run_trace(freq, 10);
+	CHECK(check_freqs(none) == 0);
+
+	run_trace(freq, 10);
+	CHECK(check_freqs(freq) == 0);
+
+	/* throttled to 400MHz, published on the first full sample after */
+	freq[0] = 400000;
+	run_trace(freq, 10);
+	CHECK(check_freqs(freq) == 0);
+
+	sphpb_freq_sample_deinit();
+	CHECK(list_empty(&kmock_sys.timers));
+
+	return 0;
+}
+
+/* a cpu in a C state publishes nothing and goes stale */
+static int test_idle_cpu(void)
+{
+	uint32_t freq[KMOCK_NR_CPUS];
+	uint32_t cpu;
+
+	test_reset();
+	for (cpu = 0; cpu < KMOCK_NR_CPUS; cpu++)
+		freq[cpu] = 1600000;
+
+	CHECK(sphpb_freq_sample_init() == 0);
+	run_trace(freq, 20);
+	CHECK(check_freqs(freq) == 0);
+
+	freq[5] = TEST_IDLE;
+	run_trace(freq, 30);
+	CHECK(sphpb_freq_sample_get_khz(5) == 1600000);
+	run_trace(freq, 20);
+	CHECK(sphpb_freq_sample_get_khz(5) == 0);
+	CHECK(sphpb_freq_sample_get_khz(4) == 1600000);
+
+	/* counters stopped in the C state, the first sample after wake up is exact */
+	freq[5] = 800000;
+	run_trace(freq, 10);
+	CHECK(sphpb_freq_sample_get_khz(5) == 800000);
+
+	sphpb_freq_sample_deinit();
+	CHECK(list_empty(&kmock_sys.timers));
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int failed = 0;
+
+#define RUN(t) do { \
+		int r = (t); \
+		printf("%-20s %s\n", #t, r == 0 ? "PASS" : "FAIL"); \
+		failed |= r; \
+	} while (0)
+
+	RUN(test_msr_stub());
+	RUN(test_per_cpu_freq());
+	RUN(test_idle_cpu());
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Userspace unit test of the workload perf model. Jobs of synthetic
+ * networks report cycles per job at each icebo ratio as
+ *
+ *   cycles(r) = compute + stall * r
+ *
+ * compute cycles are fixed, memory stall time costs more cycles the
+ * higher the clock. The ratio the model picks must be the one of least
+ * energy per job of that network, whatever else ran on the icebo.
+ *
+ *   make test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sphpb.h"
+
+#define CHECK(x)							\
+	do {								\
+		if (!(x)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__func__, __LINE__, #x);		\
+			return -1;					\
+		}							\
+	} while (0)
+
+#define TEST_MIN_RATIO	8
+#define TEST_MAX_RATIO	48
+#define TEST_RATIO_STEP	4
+
+struct test_ntw {
+	uint64_t ntw_id;
+	uint64_t compute;
+	uint64_t stall;
+};
+
+/* compute bound, and memory bound which does best at low clocks */
+static const struct test_ntw s_compute = { 0x100, 1000000, 0 };
+static const struct test_ntw s_memory = { 0x200, 200000, 40000 };
+
+static struct sphpb_pb s_sphpb;
+
+static void test_reset(void)
+{
+	memset(&s_sphpb, 0, sizeof(s_sphpb));
+	sphpb_perf_model_init(&s_sphpb);
+}
+
+static uint64_t ntw_cycles(const struct test_ntw *ntw, uint8_t ratio)
+{
+	return ntw->compute + ntw->stall * ratio;
+}
+
+static void report_all_ratios(const struct test_ntw *ntw, uint32_t icebo)
+{
+	uint8_t ratio;
+
+	for (ratio = TEST_MIN_RATIO; ratio <= TEST_MAX_RATIO; ratio += TEST_RATIO_STEP)
+		sphpb_perf_model_add(&s_sphpb, icebo, ratio, ntw->ntw_id, ntw_cycles(ntw, ratio));
+}
+
+/* ratio up to max_ratio of least E(r) = cycles(r) * (static + r^3) / r */
+static uint8_t expected_best_ratio(const struct test_ntw *ntw, uint8_t max_ratio)
+{
+	double energy, best_energy = 0;
+	uint8_t ratio, best_ratio = 0;
+
+	for (ratio = TEST_MIN_RATIO; ratio <= max_ratio; ratio += TEST_RATIO_STEP) {
+		energy = (double)ntw_cycles(ntw, ratio) *
+			 (s_sphpb.perf_static_pwr + (double)ratio * ratio * ratio) / ratio;
+		if (!best_ratio || energy < best_energy) {
+			best_energy = energy;
+			best_ratio = ratio;
+		}
+	}
+
+	return best_ratio;
+}
+
+/* networks taking turns on an icebo keep their own models */
+static int test_interleaved(void)
+{
+	uint8_t ratio, compute_best, memory_best;
+	int round;
+
+	test_reset();
+
+	for (round = 0; round < 4; round++)
+		for (ratio = TEST_MIN_RATIO; ratio <= TEST_MAX_RATIO; ratio += TEST_RATIO_STEP) {
+			sphpb_perf_model_add(&s_sphpb, 0, ratio, s_compute.ntw_id,
+					     ntw_cycles(&s_compute, ratio));
+			sphpb_perf_model_add(&s_sphpb, 0, ratio, s_memory.ntw_id,
+					     ntw_cycles(&s_memory, ratio));
+		}
+
+	compute_best = sphpb_perf_model_best_ratio(&s_sphpb, 0, s_compute.ntw_id, TEST_MAX_RATIO);
+	memory_best = sphpb_perf_model_best_ratio(&s_sphpb, 0, s_memory.ntw_id, TEST_MAX_RATIO);
+
+	printf("  compute bound best ratio %u, memory bound best ratio %u\n",
+	       compute_best, memory_best);
+
+	CHECK(compute_best == expected_best_ratio(&s_compute, TEST_MAX_RATIO));
+	CHECK(memory_best == expected_best_ratio(&s_memory, TEST_MAX_RATIO));
+	CHECK(memory_best < compute_best);
+
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 0, s_compute.ntw_id, 24) ==
+	      ntw_cycles(&s_compute, 24) * (s_sphpb.perf_static_pwr + 24 * 24 * 24) / 24);
+
+	return 0;
+}
+
+/* ranking asks for the requesting network, other icebos stay unknown */
+static int test_per_icebo(void)
+{
+	test_reset();
+
+	report_all_ratios(&s_compute, 1);
+	report_all_ratios(&s_memory, 2);
+
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 1, s_compute.ntw_id, 24) != 0);
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 2, s_compute.ntw_id, 24) == 0);
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 1, s_memory.ntw_id, 24) == 0);
+	CHECK(sphpb_perf_model_best_ratio(&s_sphpb, 2, s_compute.ntw_id, TEST_MAX_RATIO) == 0);
+	CHECK(sphpb_perf_model_best_ratio(&s_sphpb, 2, s_memory.ntw_id, TEST_MAX_RATIO) ==
+	      expected_best_ratio(&s_memory, TEST_MAX_RATIO));
+
+	return 0;
+}
+
+static int test_max_ratio(void)
+{
+	uint8_t max_ratio;
+
+	test_reset();
+	report_all_ratios(&s_compute, 3);
+
+	for (max_ratio = TEST_MIN_RATIO; max_ratio <= TEST_MAX_RATIO; max_ratio += TEST_RATIO_STEP)
+		CHECK(sphpb_perf_model_best_ratio(&s_sphpb, 3, s_compute.ntw_id, max_ratio) ==
+		      expected_best_ratio(&s_compute, max_ratio));
+
+	return 0;
+}
+
+/* a full table drops the least recently updated model */
+static int test_eviction(void)
+{
+	struct test_ntw ntw = s_compute;
+	uint32_t i;
+
+	test_reset();
+
+	for (i = 1; i <= SPHPB_PERF_MODEL_COUNT; i++) {
+		ntw.ntw_id = i;
+		report_all_ratios(&ntw, 4);
+	}
+	for (i = 1; i <= SPHPB_PERF_MODEL_COUNT; i++)
+		CHECK(sphpb_perf_model_energy(&s_sphpb, 4, i, 24) != 0);
+
+	/* refresh the oldest, the second oldest goes */
+	ntw.ntw_id = 1;
+	report_all_ratios(&ntw, 4);
+	ntw.ntw_id = SPHPB_PERF_MODEL_COUNT + 1;
+	report_all_ratios(&ntw, 4);
+
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 4, 1, 24) != 0);
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 4, 2, 24) == 0);
+	CHECK(sphpb_perf_model_energy(&s_sphpb, 4, SPHPB_PERF_MODEL_COUNT + 1, 24) != 0);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int failed = 0;
+
+#define RUN(t) do { \
+		int r = (t); \
+		printf("%-20s %s\n", #t, r == 0 ? "PASS" : "FAIL"); \
+		failed |= r; \
+	} while (0)
+
+	RUN(test_interleaved());
+	RUN(test_per_icebo());
+	RUN(test_max_ratio());
+	RUN(test_eviction());
+
+	sphpb_perf_model_deinit(&s_sphpb);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,369 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/*
+ * Throttle policy simulator. Replays a power trace through the policies of
+ * sphpb_throttle_policy.c and reports, per policy, the time spent above
+ * PL1 against the throughput kept.
+ *
+ * Trace lines are "time_us,avg_power_mW,power_limit1_mW", i.e. what the
+ * power daemon writes to overshoot/protection with a timestamp. Lines
+ * starting with '#' are skipped. Trace power is taken as the unthrottled
+ * power of ICEs running at the max ICEBO ratio. The policy decisions are
+ * replayed on a simple model:
+ *  - ICEBO dynamic power scales with the cube of the capped ratio (clock
+ *    times voltage squared) and linearly with clock squash, level 1
+ *    (SPHPB_THROTTLE_TO_MIN) keeps 15/16 of the clocks and level 15
+ *    (SPHPB_THROTTLE_TO_MAX) keeps 1/16
+ *  - ring dynamic power scales linearly with the capped ring divisor
+ *  - throughput scales with the capped ratio and the squashed clocks
+ * The other domains are taken to be at minimum once the ICEBO ratio cap
+ * reaches its minimum, which gives all_min of do_throttle.
+ *
+ *   ./sphpb_sim [-p policy] [-s static_permille] [-g ring_permille]
+ *               [-r max_ratio] [trace]
+ *
+ * Without a trace, a synthetic bursty trace is replayed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sphpb.h"
+
+#define SIM_CLOCK_STEPS		(SPHPB_THROTTLE_TO_MIN + 1)
+
+/* default model: 1.2GHz max ICEBO frequency, 1.0 icebo to ring divisor */
+#define SIM_MAX_ICEBO_RATIO	48
+#define SIM_RING_DIVISOR	0x8000
+
+/* synthetic trace: 60s of 10ms ticks, 300ms bursts every second */
+#define SIM_GEN_TICK_US		10000
+#define SIM_GEN_TICKS		6000
+#define SIM_GEN_PL1_MW		15000
+#define SIM_GEN_BASE_MW		12000
+#define SIM_GEN_BURST_MW	20000
+#define SIM_GEN_NOISE_MW	1000
+
+struct sim_sample {
+	uint64_t time_us;
+	uint32_t power_mW;
+	uint32_t power_limit1_mW;
+};
+
+struct sim_trace {
+	struct sim_sample *samples;
+	uint32_t count;
+	uint32_t size;
+};
+
+struct sim_model {
+	/* part of the power not scaled by throttling, permille */
+	uint32_t static_permille;
+	/* part of the dynamic power drawn by the ring, permille */
+	uint32_t ring_permille;
+	uint8_t max_icebo_ratio;
+	uint16_t ring_divisor;
+};
+
+struct sim_result {
+	uint64_t total_us;
+	uint64_t overshoot_us;
+	/* mW * us above PL1 */
+	uint64_t overshoot_energy;
+	/* ratio * clock steps * us, out of max ratio * SIM_CLOCK_STEPS * total_us */
+	uint64_t work;
+	/* mW * us */
+	uint64_t energy;
+	uint32_t transitions;
+	uint32_t max_level;
+	uint8_t min_icebo_ratio;
+	uint16_t min_ring_divisor;
+};
+
+static int trace_append(struct sim_trace *trace,
+			uint64_t time_us,
+			uint32_t power_mW,
+			uint32_t power_limit1_mW)
+{
+	struct sim_sample *s;
+
+	if (trace->count == trace->size) {
+		trace->size = trace->size ? trace->size * 2 : 1024;
+		s = realloc(trace->samples, trace->size * sizeof(*s));
+		if (s == NULL)
+			return -ENOMEM;
+		trace->samples = s;
+	}
+
+	s = &trace->samples[trace->count++];
+	s->time_us = time_us;
+	s->power_mW = power_mW;
+	s->power_limit1_mW = power_limit1_mW;
+
+	return 0;
+}
+
+static int trace_load(struct sim_trace *trace, const char *path)
+{
+	unsigned long long time_us, prev_us = 0;
+	unsigned int power_mW, power_limit1_mW;
+	char line[256];
+	uint32_t line_no = 0;
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return -ENOENT;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		line_no++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "%llu,%u,%u", &time_us, &power_mW, &power_limit1_mW) != 3 ||
+		    (trace->count > 0 && time_us <= prev_us)) {
+			fprintf(stderr, "%s:%u: bad sample\n", path, line_no);
+			ret = -EINVAL;
+			break;
+		}
+		prev_us = time_us;
+
+		ret = trace_append(trace, time_us, power_mW, power_limit1_mW);
+		if (ret < 0)
+			break;
+	}
+
+	fclose(f);
+
+	return ret;
+}
+
+static int trace_generate(struct sim_trace *trace)
+{
+	uint32_t i, power_mW;
+	int ret;
+
+	srand(1);
+	for (i = 0; i < SIM_GEN_TICKS; i++) {
+		power_mW = (i % 100) < 30 ? SIM_GEN_BURST_MW : SIM_GEN_BASE_MW;
+		power_mW += rand() % (2 * SIM_GEN_NOISE_MW) - SIM_GEN_NOISE_MW;
+
+		ret = trace_append(trace, (uint64_t)(i + 1) * SIM_GEN_TICK_US,
+				   power_mW, SIM_GEN_PL1_MW);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* clock steps left running out of SIM_CLOCK_STEPS */
+static uint32_t state_clock_steps(uint8_t state)
+{
+	if (state == SPHPB_NO_THROTTLE)
+		return SIM_CLOCK_STEPS;
+
+	return state;
+}
+
+static uint32_t icebo_ratio(const struct sim_model *m, const struct sphpb_throttle_output *t)
+{
+	return t->icebo_ratio ? t->icebo_ratio : m->max_icebo_ratio;
+}
+
+static uint32_t ring_divisor(const struct sim_model *m, const struct sphpb_throttle_output *t)
+{
+	return t->ring_divisor ? t->ring_divisor : m->ring_divisor;
+}
+
+static uint32_t throttled_power(const struct sim_model *m,
+				uint32_t power_mW,
+				const struct sphpb_throttle_output *t)
+{
+	uint64_t static_mW = (uint64_t)power_mW * m->static_permille / 1000;
+	uint64_t dynamic_mW = power_mW - static_mW;
+	uint64_t ring_mW = dynamic_mW * m->ring_permille / 1000;
+	uint64_t icebo_mW = dynamic_mW - ring_mW;
+	uint64_t ratio = icebo_ratio(m, t);
+	uint64_t max_ratio = m->max_icebo_ratio;
+
+	icebo_mW = icebo_mW * ratio * ratio * ratio / (max_ratio * max_ratio * max_ratio);
+	icebo_mW = icebo_mW * state_clock_steps(t->state) / SIM_CLOCK_STEPS;
+	ring_mW = ring_mW * ring_divisor(m, t) / m->ring_divisor;
+
+	return static_mW + icebo_mW + ring_mW;
+}
+
+static void simulate(const struct sim_trace *trace,
+		     const struct sphpb_throttle_policy *policy,
+		     const struct sim_model *m,
+		     struct sim_result *res)
+{
+	struct sphpb_throttle_ctl ctl;
+	struct sphpb_throttle_input in;
+	struct sphpb_throttle_output t = { SPHPB_NO_THROTTLE, 0, 0 };
+	struct sphpb_throttle_output next;
+	const struct sim_sample *s;
+	uint64_t prev_us = 0, dt_us;
+	uint32_t i, power_mW, level;
+
+	memset(res, 0, sizeof(*res));
+	res->min_icebo_ratio = m->max_icebo_ratio;
+	res->min_ring_divisor = m->ring_divisor;
+	memset(&ctl, 0, sizeof(ctl));
+	sphpb_throttle_policy_set(&ctl, policy);
+
+	for (i = 0; i < trace->count; i++) {
+		s = &trace->samples[i];
+		dt_us = i > 0 ? s->time_us - prev_us : 0;
+		prev_us = s->time_us;
+
+		/* the tick power is what the past interval drew at the applied decision */
+		power_mW = throttled_power(m, s->power_mW, &t);
+
+		res->total_us += dt_us;
+		res->energy += (uint64_t)power_mW * dt_us;
+		res->work += (uint64_t)icebo_ratio(m, &t) * state_clock_steps(t.state) * dt_us;
+		if (power_mW > s->power_limit1_mW) {
+			res->overshoot_us += dt_us;
+			res->overshoot_energy += (uint64_t)(power_mW - s->power_limit1_mW) * dt_us;
+		}
+
+		in.avg_power_mW = power_mW;
+		in.power_limit1_mW = s->power_limit1_mW;
+		in.delta_t_us = dt_us;
+		in.all_min = icebo_ratio(m, &t) <= SPHPB_THROTTLE_MIN_ICEBO_RATIO;
+		in.max_icebo_ratio = m->max_icebo_ratio;
+		in.max_ring_divisor = m->ring_divisor;
+		in.curr = t;
+
+		policy->next(&ctl, &in, &next);
+		if (memcmp(&next, &t, sizeof(t)) != 0) {
+			res->transitions++;
+			t = next;
+		}
+
+		level = t.state == SPHPB_NO_THROTTLE ? 0 : SPHPB_THROTTLE_TO_MIN + 1 - t.state;
+		if (level > res->max_level)
+			res->max_level = level;
+		if (icebo_ratio(m, &t) < res->min_icebo_ratio)
+			res->min_icebo_ratio = icebo_ratio(m, &t);
+		if (ring_divisor(m, &t) < res->min_ring_divisor)
+			res->min_ring_divisor = ring_divisor(m, &t);
+	}
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-p policy] [-s static_permille] [-g ring_permille] [-r max_ratio] [trace]\n", prog);
+	printf("  -p  replay through this policy only (default all)\n");
+	printf("  -s  part of the power not scaled by throttling, permille (default 300)\n");
+	printf("  -g  part of the dynamic power drawn by the ring, permille (default 200)\n");
+	printf("  -r  max ICEBO ratio in 25MHz units (default %u)\n", SIM_MAX_ICEBO_RATIO);
+	printf("  trace lines are time_us,avg_power_mW,power_limit1_mW\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct sphpb_throttle_policy *policy;
+	struct sim_trace trace = { 0 };
+	struct sim_model model = {
+		.static_permille = 300,
+		.ring_permille = 200,
+		.max_icebo_ratio = SIM_MAX_ICEBO_RATIO,
+		.ring_divisor = SIM_RING_DIVISOR,
+	};
+	struct sim_result res;
+	const char *policy_name = NULL;
+	char names[256], *name, *save;
+	int opt, ret, max_ratio = SIM_MAX_ICEBO_RATIO;
+
+	while ((opt = getopt(argc, argv, "p:s:g:r:h")) != -1) {
+		switch (opt) {
+		case 'p':
+			policy_name = optarg;
+			break;
+		case 's':
+			model.static_permille = atoi(optarg);
+			break;
+		case 'g':
+			model.ring_permille = atoi(optarg);
+			break;
+		case 'r':
+			max_ratio = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (model.static_permille > 1000 || model.ring_permille > 1000 ||
+	    max_ratio < SPHPB_THROTTLE_MIN_ICEBO_RATIO || max_ratio > 0xff) {
+		usage(argv[0]);
+		return 1;
+	}
+	model.max_icebo_ratio = max_ratio;
+
+	if (optind < argc) {
+		ret = trace_load(&trace, argv[optind]);
+	} else {
+		printf("# no trace given, replaying a synthetic bursty trace\n");
+		ret = trace_generate(&trace);
+	}
+	if (ret < 0 || trace.count < 2) {
+		fprintf(stderr, "no samples to replay\n");
+		free(trace.samples);
+		return 1;
+	}
+
+	if (policy_name != NULL) {
+		policy = sphpb_throttle_policy_find(policy_name);
+		if (policy == NULL) {
+			fprintf(stderr, "unknown policy %s\n", policy_name);
+			free(trace.samples);
+			return 1;
+		}
+		snprintf(names, sizeof(names), "%s", policy->name);
+	} else {
+		sphpb_throttle_policy_list(NULL, names);
+	}
+
+	printf("# max ICEBO ratio %u, ring divisor 0x%x, static %u permille, ring %u permille\n",
+	       model.max_icebo_ratio, model.ring_divisor,
+	       model.static_permille, model.ring_permille);
+	printf("%-10s %12s %10s %14s %11s %10s %11s %9s %9s %8s\n",
+	       "policy", "overshoot_ms", "overshoot%", "over_PL1_mJ",
+	       "throughput%", "avg_mW", "transitions", "max_level",
+	       "min_ratio", "min_ring");
+
+	for (name = strtok_r(names, " \n", &save); name != NULL;
+	     name = strtok_r(NULL, " \n", &save)) {
+		policy = sphpb_throttle_policy_find(name);
+		simulate(&trace, policy, &model, &res);
+
+		printf("%-10s %12llu %10.2f %14.1f %11.2f %10llu %11u %9u %9u %#8x\n",
+		       policy->name,
+		       (unsigned long long)(res.overshoot_us / 1000),
+		       100.0 * res.overshoot_us / res.total_us,
+		       res.overshoot_energy / 1e6,
+		       100.0 * res.work / ((uint64_t)model.max_icebo_ratio * SIM_CLOCK_STEPS * res.total_us),
+		       (unsigned long long)(res.energy / res.total_us),
+		       res.transitions,
+		       res.max_level,
+		       res.min_icebo_ratio,
+		       res.min_ring_divisor);
+	}
+
+	free(trace.samples);
+
+	return 0;
+}
@@ -18,6 +18,7 @@
 
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include "intel_sphpb.h"
 #include "sphpb_punit.h"
 
@@ -27,7 +28,25 @@
 
 #define SPHPB_MIN_RING_POSSIBLE_VALUE	8195
 
+/*
+ * throttle states:
+ *  - SPHPB_NO_THROTTLE - indicates  that throttling is not active/required
+ *  - SPHPB_THROTTLE_TO_MAX - indicates the pcode will try to throttle the system to maximum
+ *  - SPHPB_THROTTLE_TO_MIN - indicates the pcode will try to throttle the system to minimum ( first level of throttling)
+ * - 14 steps are between SPHPB_THROTTLE_TO_MIN to SPHPB_THROTTLE_TO_MAX (0xf, 0xe, ... , 0x2, 0x1)
+ */
+#define SPHPB_NO_THROTTLE	0x0
+#define	SPHPB_THROTTLE_TO_MAX	0x1
+#define	SPHPB_THROTTLE_TO_MIN	0xf
+
+#define SPHPB_THROTTLE_DEFAULT_POLICY	"threshold"
+
+/* perf model keeps one entry per 4 consecutive icebo ratios */
+#define SPHPB_PERF_RATIO_SHIFT		2
+#define SPHPB_PERF_RATIO_BUCKETS	(256 >> SPHPB_PERF_RATIO_SHIFT)
+
 struct kobject;
+struct dentry;
 
 /*
  * struct used for sorting ices
@@ -36,6 +55,8 @@ struct sphpb_ice_node {
 	struct list_head		node;
 	uint32_t			ice_index;
 	uint32_t			score;
+	/* modelled energy per job, 0 if unknown */
+	uint64_t			energy;
 };
 
 struct sphpb_ice_info {
@@ -65,11 +86,89 @@ struct sphpb_icebo_info {
 	struct sphpb_ice_info ice[SPHPB_MAX_ICE_PER_ICEBO];
 };
 
+struct sphpb_perf_entry {
+	/* ewma of ice cycles per job */
+	uint64_t cycles;
+	uint32_t samples;
+	/* icebo ratio of last sample */
+	uint8_t ratio;
+};
+
+/* perf models kept, the least recently updated one is reused */
+#define SPHPB_PERF_MODEL_COUNT		(4 * SPHPB_MAX_ICEBO_COUNT)
+
+/* measured cycles per job by ratio of a network running on an icebo */
+struct sphpb_perf_model {
+	uint64_t ntw_id;
+	uint32_t icebo;
+	/* perf_stamp of the last sample, 0 if unused */
+	uint64_t stamp;
+	struct sphpb_perf_entry entry[SPHPB_PERF_RATIO_BUCKETS];
+};
+
+/*
+ * throttle ladder below clock squash: ICEBO ratios are capped down from
+ * the highest requested ratio in steps of 100MHz to 200MHz, and the ring
+ * divisor with them, before clock squash is engaged
+ */
+#define SPHPB_THROTTLE_ICEBO_RATIO_STEP	4
+#define SPHPB_THROTTLE_MIN_ICEBO_RATIO	8
+
+/* decision of a throttle policy */
+struct sphpb_throttle_output {
+	/* clock squash state */
+	uint8_t state;
+	/* cap on ICEBO ratios, 0 if not capped */
+	uint8_t icebo_ratio;
+	/* cap on icebo to ring divisor, fixed point U1.15, 0 if not capped */
+	uint16_t ring_divisor;
+};
+
+/* sample given to throttle policy on each power overshoot tick */
+struct sphpb_throttle_input {
+	uint32_t avg_power_mW;
+	uint32_t power_limit1_mW;
+	uint64_t delta_t_us;
+	/* ring, IA cores and active ICEBOs are all at minimum frequency */
+	bool all_min;
+	/* highest ICEBO ratio requested, no ratio caps if 0 */
+	uint8_t max_icebo_ratio;
+	/* icebo to ring divisor when not throttled, fixed point U1.15 */
+	uint16_t max_ring_divisor;
+	/* decision applied on the previous tick */
+	struct sphpb_throttle_output curr;
+};
+
+struct sphpb_throttle_ctl;
+
+struct sphpb_throttle_policy {
+	const char *name;
+	void (*reset)(struct sphpb_throttle_ctl *ctl);
+	/* fills the throttle state and caps to move to */
+	void (*next)(struct sphpb_throttle_ctl *ctl,
+		     const struct sphpb_throttle_input *in,
+		     struct sphpb_throttle_output *out);
+};
+
+struct sphpb_throttle_ctl {
+	const struct sphpb_throttle_policy *policy;
+
+	/* pi - accumulated overshoot, permille * ms */
+	int64_t integral;
+
+	/* ewma - smoothed power and its previous value, fixed point mW */
+	int64_t ewma;
+	int64_t prev_ewma;
+};
+
 struct sphpb_throttle_info {
+	struct sphpb_throttle_ctl ctl;
 	uint64_t ring_clock_ticks;
-	struct cpu_perfstat *cpu_stat;
 	uint64_t time_us;
 	uint8_t curr_state;
+	/* caps applied by the throttle policy, 0 if not capped */
+	uint8_t icebo_ratio_cap;
+	uint16_t ring_divisor_cap;
 };
 
 
@@ -100,6 +199,15 @@ struct sphpb_pb {
 	uint32_t request_ddr_value;
 
 	struct sphpb_throttle_info throttle_data;
+
+	/* workload perf models by icebo and network, updated from ice driver reports */
+	struct sphpb_perf_model perf_model[SPHPB_PERF_MODEL_COUNT];
+	uint64_t perf_stamp;
+	spinlock_t perf_lock;
+	/* static power in units of dynamic power at ratio 1 */
+	uint32_t perf_static_pwr;
+	struct dentry *debugfs_dir;
+
 	struct kobject *kobj;
 	struct kobject *ia_kobj_root;
 	struct kobject **ia_kobj;
@@ -130,6 +238,18 @@ struct cpu_perfstat {
 
 void aperfmperf_snapshot_khz(void *dummy);
 
+/* per cpu frequency sampling, see sphpb_freq_sample.c */
+int sphpb_freq_sample_init(void);
+void sphpb_freq_sample_deinit(void);
+/* frequency of cpu in KHz over its last sample, 0 if not sampled lately */
+uint64_t sphpb_freq_sample_get_khz(uint32_t cpu);
+
+/* throttle policies, see sphpb_throttle_policy.c */
+const struct sphpb_throttle_policy *sphpb_throttle_policy_find(const char *name);
+ssize_t sphpb_throttle_policy_list(const struct sphpb_throttle_policy *curr, char *buf);
+void sphpb_throttle_policy_set(struct sphpb_throttle_ctl *ctl,
+			       const struct sphpb_throttle_policy *policy);
+
 int do_throttle(struct sphpb_pb *sphpb,
 		uint32_t avg_power_mW,
 		uint32_t power_limit1_mW);
@@ -138,9 +258,50 @@ int sphpb_mng_get_efficient_ice_list(struct sphpb_pb *sphpb,
 				     uint32_t ice_mask,
 				     uint16_t ice_to_ring_ratio,
 				     uint16_t fx_ice_ice_ratio,
+				     uint64_t ntw_id,
 				     uint8_t *o_ice_array,
 				     ssize_t array_size);
 
+/* ratio an icebo runs at, requested or max, under the throttle cap */
+static inline uint8_t sphpb_icebo_ratio(struct sphpb_pb *sphpb, uint32_t icebo)
+{
+	uint8_t ratio = sphpb->icebo[icebo].ratio ? sphpb->icebo[icebo].ratio : sphpb->max_icebo_ratio;
+	uint8_t cap = sphpb->throttle_data.icebo_ratio_cap;
+
+	return cap && ratio > cap ? cap : ratio;
+}
+
+/* power limited - clock squash or ratio caps applied */
+static inline bool sphpb_throttled(struct sphpb_pb *sphpb)
+{
+	return sphpb->throttle_data.curr_state != SPHPB_NO_THROTTLE ||
+	       sphpb->throttle_data.icebo_ratio_cap != 0;
+}
+
+/* workload perf model, see sphpb_perf_model.c */
+void sphpb_perf_model_init(struct sphpb_pb *sphpb);
+void sphpb_perf_model_deinit(struct sphpb_pb *sphpb);
+void sphpb_perf_model_add(struct sphpb_pb *sphpb,
+			  uint32_t icebo,
+			  uint8_t ratio,
+			  uint64_t ntw_id,
+			  uint64_t cycles);
+/* modelled energy per job of ntw_id on icebo at ratio, 0 if not measured */
+uint64_t sphpb_perf_model_energy(struct sphpb_pb *sphpb,
+				 uint32_t icebo,
+				 uint64_t ntw_id,
+				 uint8_t ratio);
+/* measured ratio up to max_ratio with least energy per job, 0 if none */
+uint8_t sphpb_perf_model_best_ratio(struct sphpb_pb *sphpb,
+				    uint32_t icebo,
+				    uint64_t ntw_id,
+				    uint8_t max_ratio);
+
+int sphpb_mng_report_ice_perf(struct sphpb_pb *sphpb,
+			      uint32_t ice_index,
+			      uint64_t ntw_id,
+			      uint64_t cycles);
+
 int sphpb_mng_set_icebo_enable(struct sphpb_pb *sphpb,
 			       uint32_t ice_index,
 			       bool bEnable);
@@ -149,7 +310,8 @@ int sphpb_mng_request_ice_dvfs_values(struct sphpb_pb *sphpb,
 				      uint32_t ice_index,
 				      uint32_t ddr_bw_req,
 				      uint16_t ring_divisor,
-				      uint8_t ice_ratio);
+				      uint8_t ice_ratio,
+				      uint64_t ntw_id);
 
 /* sysfs interfaces */
 int sphpb_iccp_table_sysfs_init(struct sphpb_pb *sphpb);
@@ -0,0 +1,172 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+/*
+ * [Desciption]: per CPU frequency sampling.
+ * Every CPU samples its own APERF/MPERF from a pinned timer and publishes
+ * the deltas in a seqcount protected per CPU slot, which the throttle loop
+ * reads lock free instead of sending an IPI to each CPU.
+ * The timer is deferrable so it does not wake an idle CPU; the slot of
+ * such CPU goes stale and is skipped like a CPU which was not sampled yet.
+ */
+
+#include <linux/kernel.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <linux/cpuhotplug.h>
+#include <asm/msr-index.h>
+#include <asm/tsc.h>
+#include "sph_log.h"
+#include "sphpb.h"
+#include "sphpb_msr.h"
+
+#define SPHPB_FREQ_SAMPLE_MS	10
+#define SPHPB_FREQ_STALE_MS	(4 * SPHPB_FREQ_SAMPLE_MS)
+
+struct sphpb_freq_slot {
+	seqcount_t seq;
+	/* last sampled counters, accessed by owning cpu only */
+	uint64_t aperf;
+	uint64_t mperf;
+	/* published under seq */
+	uint64_t delta_aperf;
+	uint64_t delta_mperf;
+	unsigned long stamp;
+
+	struct timer_list timer;
+	bool active;
+};
+
+static DEFINE_PER_CPU(struct sphpb_freq_slot, sphpb_freq_slots);
+static enum cpuhp_state sphpb_freq_hp_state;
+
+#ifdef setup_timer
+static void sphpb_freq_sample(unsigned long cb_data)
+#else  // timer_setup starting linux kernel V4.15
+static void sphpb_freq_sample(struct timer_list *timer)
+#endif
+{
+	struct sphpb_freq_slot *slot;
+	uint64_t aperf, mperf;
+	unsigned long flags;
+	int ret;
+
+#ifdef setup_timer
+	slot = (struct sphpb_freq_slot *)(uintptr_t)cb_data;
+#else  // timer_setup starting linux kernel V4.15
+	slot = from_timer(slot, timer, timer);
+#endif
+
+	local_irq_save(flags);
+	ret = sphpb_msr_read(MSR_IA32_APERF, &aperf);
+	if (!ret)
+		ret = sphpb_msr_read(MSR_IA32_MPERF, &mperf);
+	local_irq_restore(flags);
+
+	if (!ret) {
+		write_seqcount_begin(&slot->seq);
+		if (slot->mperf != 0 && mperf != slot->mperf) {
+			slot->delta_aperf = aperf - slot->aperf;
+			slot->delta_mperf = mperf - slot->mperf;
+			slot->stamp = jiffies;
+		}
+		write_seqcount_end(&slot->seq);
+
+		slot->aperf = aperf;
+		slot->mperf = mperf;
+	}
+
+	if (READ_ONCE(slot->active))
+		mod_timer(&slot->timer, jiffies + msecs_to_jiffies(SPHPB_FREQ_SAMPLE_MS));
+}
+
+/* called on the cpu going online */
+static int sphpb_freq_cpu_online(unsigned int cpu)
+{
+	struct sphpb_freq_slot *slot = per_cpu_ptr(&sphpb_freq_slots, cpu);
+
+	local_bh_disable();
+	write_seqcount_begin(&slot->seq);
+	slot->delta_aperf = 0;
+	slot->delta_mperf = 0;
+	write_seqcount_end(&slot->seq);
+	slot->aperf = 0;
+	slot->mperf = 0;
+	WRITE_ONCE(slot->active, true);
+	local_bh_enable();
+
+	slot->timer.expires = jiffies + msecs_to_jiffies(SPHPB_FREQ_SAMPLE_MS);
+	add_timer_on(&slot->timer, cpu);
+
+	return 0;
+}
+
+static int sphpb_freq_cpu_offline(unsigned int cpu)
+{
+	struct sphpb_freq_slot *slot = per_cpu_ptr(&sphpb_freq_slots, cpu);
+
+	WRITE_ONCE(slot->active, false);
+	del_timer_sync(&slot->timer);
+
+	return 0;
+}
+
+uint64_t sphpb_freq_sample_get_khz(uint32_t cpu)
+{
+	struct sphpb_freq_slot *slot = per_cpu_ptr(&sphpb_freq_slots, cpu);
+	uint64_t delta_aperf, delta_mperf;
+	unsigned long stamp;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&slot->seq);
+		delta_aperf = slot->delta_aperf;
+		delta_mperf = slot->delta_mperf;
+		stamp = slot->stamp;
+	} while (read_seqcount_retry(&slot->seq, seq));
+
+	if (delta_mperf == 0 ||
+	    time_after(jiffies, stamp + msecs_to_jiffies(SPHPB_FREQ_STALE_MS)))
+		return 0;
+
+	//aperf_delta / mperf_delta * cpu_khz = frequency in KHz
+	return (delta_aperf * cpu_khz) / delta_mperf;
+}
+
+int sphpb_freq_sample_init(void)
+{
+	struct sphpb_freq_slot *slot;
+	unsigned int cpu;
+	int ret;
+
+	for_each_possible_cpu(cpu) {
+		slot = per_cpu_ptr(&sphpb_freq_slots, cpu);
+		seqcount_init(&slot->seq);
+#ifdef setup_timer
+		__setup_timer(&slot->timer, sphpb_freq_sample, (unsigned long)(uintptr_t)slot,
+			      TIMER_PINNED | TIMER_DEFERRABLE);
+#else // timer_setup starting linux kernel V4.15
+		timer_setup(&slot->timer, sphpb_freq_sample, TIMER_PINNED | TIMER_DEFERRABLE);
+#endif
+	}
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "sphpb/freq_sample:online",
+				sphpb_freq_cpu_online, sphpb_freq_cpu_offline);
+	if (ret < 0) {
+		sph_log_err(POWER_BALANCER_LOG, "Failed to start frequency sampling - Err(%d)\n", ret);
+		return ret;
+	}
+
+	sphpb_freq_hp_state = ret;
+
+	return 0;
+}
+
+void sphpb_freq_sample_deinit(void)
+{
+	cpuhp_remove_state(sphpb_freq_hp_state);
+}
@@ -27,6 +27,7 @@
 #include "sphpb.h"
 #include "sphpb_punit.h"
 #include "sphpb_bios_mailbox.h"
+#include "sphpb_msr.h"
 
 struct sphpb_pb *g_the_sphpb;
 void *g_hSwCountersInfo_global;
@@ -62,6 +63,7 @@ static int sphpb_get_efficient_ice_list(uint64_t ice_mask,
 					uint32_t ddr_bw,
 					uint16_t ring_divisor_fx,
 					uint8_t ratio_fx,
+					uint64_t ntw_id,
 					uint8_t *o_ice_array,
 					ssize_t array_size)
 {
@@ -69,13 +71,14 @@ static int sphpb_get_efficient_ice_list(uint64_t ice_mask,
 
 	if (g_the_sphpb->debug_log)
 		sph_log_info(POWER_BALANCER_LOG,
-			     "request list of ices - ice mask - %llu  ddr_bw = %uMB/s ring_divisor = 0x%x(U1.15) ratio = %u\n",
-			     ice_mask, ddr_bw, ring_divisor_fx, ratio_fx);
+			     "request list of ices - ice mask - %llu  ddr_bw = %uMB/s ring_divisor = 0x%x(U1.15) ratio = %u ntw 0x%llx\n",
+			     ice_mask, ddr_bw, ring_divisor_fx, ratio_fx, ntw_id);
 
 	ret = sphpb_mng_get_efficient_ice_list(g_the_sphpb,
 					       ice_mask,
 					       ring_divisor_fx,
 					       ratio_fx,
+					       ntw_id,
 					       o_ice_array,
 					       array_size);
 
@@ -87,7 +90,8 @@ static int sphpb_get_efficient_ice_list(uint64_t ice_mask,
 int sphpb_request_ice_dvfs_values(uint32_t ice_index,
 				  uint32_t ddr_bw,
 				  uint16_t ring_divisor_fx,
-				  uint8_t ratio_fx)
+				  uint8_t ratio_fx,
+				  uint64_t ntw_id)
 {
 	int ret;
 
@@ -97,14 +101,15 @@ int sphpb_request_ice_dvfs_values(uint32_t ice_index,
 
 	if (g_the_sphpb->debug_log)
 		sph_log_info(POWER_BALANCER_LOG,
-			     "Got request for ICE %u - ddr_bw=%uMB/s ring_divisor=0x%x(U1.15) ratio=%u\n",
-			     ice_index, ddr_bw, ring_divisor_fx, ratio_fx);
+			     "Got request for ICE %u - ddr_bw=%uMB/s ring_divisor=0x%x(U1.15) ratio=%u ntw 0x%llx\n",
+			     ice_index, ddr_bw, ring_divisor_fx, ratio_fx, ntw_id);
 
 	ret = sphpb_mng_request_ice_dvfs_values(g_the_sphpb,
 						ice_index,
 						ddr_bw,
 						ring_divisor_fx,
-						ratio_fx);
+						ratio_fx,
+						ntw_id);
 
 	return ret;
 }
@@ -126,28 +131,33 @@ int sphpb_set_power_state(uint32_t ice_index, bool bOn)
 	return ret;
 }
 
+/* report ice cycles of a completed job */
+static int sphpb_report_ice_perf(uint32_t ice_index, uint64_t ntw_id, uint64_t cycles)
+{
+	return sphpb_mng_report_ice_perf(g_the_sphpb, ice_index, ntw_id, cycles);
+}
+
 int sphpb_throttle_init(struct sphpb_pb *sphpb)
 {
-	int ret = 0;
-	sphpb->throttle_data.curr_state = 0x0/*SPHPB_NO_THROTTLE*/;
+	sphpb->throttle_data.curr_state = SPHPB_NO_THROTTLE;
+	sphpb->throttle_data.icebo_ratio_cap = 0;
+	sphpb->throttle_data.ring_divisor_cap = 0;
+	sphpb_throttle_policy_set(&sphpb->throttle_data.ctl,
+				  sphpb_throttle_policy_find(SPHPB_THROTTLE_DEFAULT_POLICY));
 
-	sphpb->throttle_data.cpu_stat = kmalloc_array(num_possible_cpus(), sizeof(struct cpu_perfstat), GFP_KERNEL);
-	if (unlikely(sphpb->throttle_data.cpu_stat == NULL)) {
-		ret = -ENOMEM;
-		sph_log_err(POWER_BALANCER_LOG, "Throttling init failure: Out of memory.\n");
-	}
-	return ret;
+	return sphpb_freq_sample_init();
 }
 
 void sphpb_throttle_deinit(struct sphpb_pb *sphpb)
 {
 	sphpb->throttle_data.curr_state = 0x0;
-	kfree(sphpb->throttle_data.cpu_stat);
+	sphpb->throttle_data.icebo_ratio_cap = 0;
+	sphpb->throttle_data.ring_divisor_cap = 0;
+	sphpb_freq_sample_deinit();
 }
 
 static void sphpb_throttle_prepare(void)
 {
-	uint32_t cpu;
 	int ret;
 
 	if (unlikely(g_the_sphpb->icedrv_cb == NULL ||
@@ -170,11 +180,8 @@ static void sphpb_throttle_prepare(void)
 		sph_log_err(POWER_BALANCER_LOG, "Throttling failure: Unable to set Dynamic DRAM frequency. Err(%d)\n", ret);
 
 	g_the_sphpb->throttle_data.time_us = nnp_time_us();
-	rdmsrl(MSR_UNC_PERF_UNCORE_CLOCK_TICKS, g_the_sphpb->throttle_data.ring_clock_ticks);
-	if (unlikely(g_the_sphpb->throttle_data.cpu_stat == NULL))
-		return;
-	for (cpu = 0; cpu < num_possible_cpus(); ++cpu)
-		smp_call_function_single(cpu, aperfmperf_snapshot_khz, &g_the_sphpb->throttle_data.cpu_stat[cpu], true);
+	if (sphpb_msr_read(MSR_UNC_PERF_UNCORE_CLOCK_TICKS, &g_the_sphpb->throttle_data.ring_clock_ticks))
+		g_the_sphpb->throttle_data.ring_clock_ticks = 0;
 err:
 	return;
 
@@ -382,6 +389,7 @@ int create_sphpb(void)
 	sphpb->callbacks.request_ice_dvfs_values	= sphpb_request_ice_dvfs_values;
 	sphpb->callbacks.set_power_state		= sphpb_set_power_state;
 	sphpb->callbacks.unregister_driver		= sphpb_unregister_driver;
+	sphpb->callbacks.report_ice_perf		= sphpb_report_ice_perf;
 
 	for (icebo = 0; icebo < SPHPB_MAX_ICEBO_COUNT; icebo++)
 		sphpb->icebo[icebo].ring_divisor_idx = -1;
@@ -436,6 +444,8 @@ int create_sphpb(void)
 		goto cleanup_power_overshoot_sysfs;
 	}
 
+	sphpb_perf_model_init(sphpb);
+
 	sphpb_trace_init();
 
 	g_the_sphpb = sphpb;
@@ -478,6 +488,8 @@ void destroy_sphpb(void)
 	if (unlikely(g_the_sphpb == NULL))
 		return;
 
+	sphpb_perf_model_deinit(g_the_sphpb);
+
 	sphpb_throttle_deinit(g_the_sphpb);
 
 	sphpb_power_overshoot_sysfs_deinit(g_the_sphpb);
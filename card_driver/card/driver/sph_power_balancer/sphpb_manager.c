@@ -27,6 +27,7 @@
 #include "sphpb_punit.h"
 #include "sphpb_bios_mailbox.h"
 #include "sphpb_trace.h"
+#include "sphpb_msr.h"
 
 /* power throttling threasholds*/
 #define RING_FREQ_SETP 100llu //MHz
@@ -37,11 +38,6 @@
 #define ICEBO_THRESHOLD (200u + ICEBO_FREQ_SETP / 2u) //MHz
 
 
-#define SPHPB_NO_THROTTLE	0x0
-#define	SPHPB_THROTTLE_TO_MAX	0x1
-#define	SPHPB_THROTTLE_TO_MIN	0xf
-
-
 const uint32_t grade_active_icebo_higer_ring_divisor	= 40;
 const uint32_t grade_active_icebo_lower_divisor		= 55;
 const uint32_t grade_active_icebo_same_ring_divisor	= 65;
@@ -72,6 +68,7 @@ int sphpb_mng_get_efficient_ice_list(struct sphpb_pb *sphpb,
 				     uint32_t ice_mask,
 				     uint16_t ice_to_ring_ratio,
 				     uint16_t fx_ice_ice_ratio,
+				     uint64_t ntw_id,
 				     uint8_t *o_ice_array,
 				     ssize_t array_size)
 {
@@ -157,15 +154,20 @@ int sphpb_mng_get_efficient_ice_list(struct sphpb_pb *sphpb,
 
 				ice_select->score = score;
 				ice_select->ice_index = ice_index;
+				ice_select->energy = sphpb_perf_model_energy(sphpb, icebo_number, ntw_id,
+									     sphpb_icebo_ratio(sphpb, icebo_number));
 
 
 				/*
-				 * add at higher loaction possible
+				 * add at higher loaction possible, on same score
+				 * prefer icebo with lower measured energy per job
 				 */
 				list_for_each_entry(r,
 						    &ice_power_efficiency_list,
 						    node) {
-					if (score >= r->score) {
+					if (score > r->score ||
+					    (score == r->score &&
+					     (!r->energy || (ice_select->energy && ice_select->energy <= r->energy)))) {
 						list_add_tail(&ice_select->node, &r->node);
 						bNodeAddedToList = true;
 						break;
@@ -274,20 +276,15 @@ end_func:
 
 
 
-static int update_ring_divisor(struct sphpb_pb *sphpb,
-			       uint32_t         ice_index,
-			       uint16_t         ring_divisor)
+/* set the max ring divisor of active icebos, under the throttle cap */
+static int sync_ring_divisor(struct sphpb_pb *sphpb)
 {
-	uint32_t icebo_number = (ice_index / SPHPB_MAX_ICE_PER_ICEBO);
-	uint32_t ice_in_icebo = (ice_index % SPHPB_MAX_ICE_PER_ICEBO);
 	uint32_t i;
 	int ret = 0;
 	uint16_t max_ring_ratio_value = SPHPB_MIN_RING_POSSIBLE_VALUE;
 	uint16_t current_ring_ratio_value = sphpb->icebo_ring_divisor;
 	bool bActiveIce = false;
 
-	sphpb->icebo[icebo_number].ice[ice_in_icebo].ring_divisor = ring_divisor;
-
 	for (i = 0; i < SPHPB_MAX_ICEBO_COUNT; i++) {
 		struct sphpb_icebo_info *icebo = &(sphpb->icebo[i]);
 		uint32_t tmp_ring_ratio_value = SPHPB_MIN_RING_POSSIBLE_VALUE;
@@ -331,6 +328,10 @@ static int update_ring_divisor(struct sphpb_pb *sphpb,
 	if (!bActiveIce)
 		max_ring_ratio_value = sphpb->orig_icebo_ring_divisor;
 
+	if (sphpb->throttle_data.ring_divisor_cap &&
+	    max_ring_ratio_value > sphpb->throttle_data.ring_divisor_cap)
+		max_ring_ratio_value = sphpb->throttle_data.ring_divisor_cap;
+
 	if (max_ring_ratio_value != sphpb->icebo_ring_divisor) {
 		if (sphpb->icedrv_cb->set_icebo_to_ring_ratio) {
 			ret = sphpb->icedrv_cb->set_icebo_to_ring_ratio(max_ring_ratio_value);
@@ -373,6 +374,41 @@ end_func:
 	return ret;
 }
 
+static int update_ring_divisor(struct sphpb_pb *sphpb,
+			       uint32_t         ice_index,
+			       uint16_t         ring_divisor)
+{
+	uint32_t icebo_number = (ice_index / SPHPB_MAX_ICE_PER_ICEBO);
+	uint32_t ice_in_icebo = (ice_index % SPHPB_MAX_ICE_PER_ICEBO);
+
+	sphpb->icebo[icebo_number].ice[ice_in_icebo].ring_divisor = ring_divisor;
+
+	return sync_ring_divisor(sphpb);
+}
+
+/* set icebo ratios, requested or max, under the throttle cap */
+static int sync_icebo_ratios(struct sphpb_pb *sphpb)
+{
+	int ret;
+
+	//update all 64 bit
+	sphpb->current_cores_ratios.freqRatio.icebo0 = sphpb_icebo_ratio(sphpb, 0);
+	sphpb->current_cores_ratios.freqRatio.icebo1 = sphpb_icebo_ratio(sphpb, 1);
+	sphpb->current_cores_ratios.freqRatio.icebo2 = sphpb_icebo_ratio(sphpb, 2);
+	sphpb->current_cores_ratios.freqRatio.icebo3 = sphpb_icebo_ratio(sphpb, 3);
+	sphpb->current_cores_ratios.freqRatio.icebo4 = sphpb_icebo_ratio(sphpb, 4);
+	sphpb->current_cores_ratios.freqRatio.icebo5 = sphpb_icebo_ratio(sphpb, 5);
+
+	if (sphpb->debug_log)
+		sph_log_info(POWER_BALANCER_LOG, "lets update IA and cores ratio value: 0x%llX\n", sphpb->current_cores_ratios.val);
+
+	ret = sphpb->icedrv_cb->set_icebo_to_icebo_ratio(sphpb->current_cores_ratios);
+	if (ret)
+		sph_log_err(POWER_BALANCER_LOG, "failed to set set_icebo_to_icebo_ratio (0x%llx)", sphpb->current_cores_ratios.val);
+
+	return ret;
+}
+
 static int update_icebo_ratio(struct sphpb_pb *sphpb,
 			       uint32_t       ice_index,
 			       uint8_t        ratio_fx,
@@ -457,22 +493,8 @@ static int update_icebo_ratio(struct sphpb_pb *sphpb,
 		}
 	}
 
-	if (need_to_update_ice_driver) {
-		//update all 64 bit
-		sphpb->current_cores_ratios.freqRatio.icebo0 = sphpb->icebo[0].ratio ? sphpb->icebo[0].ratio : sphpb->max_icebo_ratio;
-		sphpb->current_cores_ratios.freqRatio.icebo1 = sphpb->icebo[1].ratio ? sphpb->icebo[1].ratio : sphpb->max_icebo_ratio;
-		sphpb->current_cores_ratios.freqRatio.icebo2 = sphpb->icebo[2].ratio ? sphpb->icebo[2].ratio : sphpb->max_icebo_ratio;
-		sphpb->current_cores_ratios.freqRatio.icebo3 = sphpb->icebo[3].ratio ? sphpb->icebo[3].ratio : sphpb->max_icebo_ratio;
-		sphpb->current_cores_ratios.freqRatio.icebo4 = sphpb->icebo[4].ratio ? sphpb->icebo[4].ratio : sphpb->max_icebo_ratio;
-		sphpb->current_cores_ratios.freqRatio.icebo5 = sphpb->icebo[5].ratio ? sphpb->icebo[5].ratio : sphpb->max_icebo_ratio;
-
-		if (sphpb->debug_log)
-			sph_log_info(POWER_BALANCER_LOG, "lets update IA and cores ratio value: 0x%llX\n", sphpb->current_cores_ratios.val);
-
-		ret = sphpb->icedrv_cb->set_icebo_to_icebo_ratio(sphpb->current_cores_ratios);
-		if (ret)
-			sph_log_err(POWER_BALANCER_LOG, "failed to set set_icebo_to_icebo_ratio (0x%llx)", sphpb->current_cores_ratios.val);
-	}
+	if (need_to_update_ice_driver)
+		ret = sync_icebo_ratios(sphpb);
 
 	return ret;
 }
@@ -522,12 +544,37 @@ int sphpb_mng_set_icebo_enable(struct sphpb_pb *sphpb,
 }
 
 
+int sphpb_mng_report_ice_perf(struct sphpb_pb *sphpb,
+			      uint32_t ice_index,
+			      uint64_t ntw_id,
+			      uint64_t cycles)
+{
+	uint32_t icebo_number = (ice_index / SPHPB_MAX_ICE_PER_ICEBO);
+	uint8_t ratio;
+
+	if (icebo_number >= SPHPB_MAX_ICEBO_COUNT)
+		return -EINVAL;
+
+	/* clock squash distorts cycles per job, keep model of unthrottled runs */
+	if (!cycles || sphpb->throttle_data.curr_state != SPHPB_NO_THROTTLE)
+		return 0;
+
+	ratio = sphpb_icebo_ratio(sphpb, icebo_number);
+	if (!ratio)
+		return 0;
+
+	sphpb_perf_model_add(sphpb, icebo_number, ratio, ntw_id, cycles);
+
+	return 0;
+}
+
 /* request from sphpb to set ice to ring and ice ratio */
 int sphpb_mng_request_ice_dvfs_values(struct sphpb_pb *sphpb,
 				      uint32_t ice_index,
 				      uint32_t ddr_bw_req,
 				      uint16_t ring_divisor,
-				      uint8_t ice_ratio)
+				      uint8_t ice_ratio,
+				      uint64_t ntw_id)
 {
 	uint32_t icebo_number = (ice_index / SPHPB_MAX_ICE_PER_ICEBO);
 	uint32_t ice_in_icebo = (ice_index % SPHPB_MAX_ICE_PER_ICEBO);
@@ -539,6 +586,21 @@ int sphpb_mng_request_ice_dvfs_values(struct sphpb_pb *sphpb,
 		return -EINVAL;
 	}
 
+	/*
+	 * while power limited, run at the measured ratio up to the requested
+	 * one which gives most inferences per joule
+	 */
+	if (ice_ratio && sphpb_throttled(sphpb)) {
+		uint8_t best_ratio = sphpb_perf_model_best_ratio(sphpb, icebo_number, ntw_id, ice_ratio);
+
+		if (best_ratio && best_ratio < ice_ratio) {
+			if (sphpb->debug_log)
+				sph_log_info(POWER_BALANCER_LOG, "ice %d ratio 0x%x lowered to 0x%x by perf model\n",
+					     ice_index, ice_ratio, best_ratio);
+			ice_ratio = best_ratio;
+		}
+	}
+
 	/* update icebo core max ratio */
 	ret = update_icebo_ratio(sphpb, ice_index, ice_ratio, 0);
 	if (ret) {
@@ -573,7 +635,9 @@ static void update_counters(struct sphpb_pb *sphpb, uint64_t delta_t_us)
 		any_throttle = true;
 	}
 
-	rdmsrl(SPH_MSR_CORE_PERF_LIMIT_REASONS, freq_reason.value);
+	if (sphpb_msr_read(SPH_MSR_CORE_PERF_LIMIT_REASONS, &freq_reason.value))
+		return;
+
 	if (freq_reason.BitField.prochot_log != 0) {
 		freq_reason.BitField.prochot_log = 0;
 		NNP_SW_COUNTER_ADD(g_sph_sw_pb_counters, SPHCS_SW_COUNTERS_IPC_PROCHOT_TIME, delta_t_us);
@@ -621,7 +685,7 @@ static void update_counters(struct sphpb_pb *sphpb, uint64_t delta_t_us)
 	if (any_throttle) {
 		NNP_SW_COUNTER_ADD(g_sph_sw_pb_counters,
 				   SPHCS_SW_COUNTERS_IPC_THROTTLING_TIME, delta_t_us);
-		wrmsrl(SPH_MSR_CORE_PERF_LIMIT_REASONS, freq_reason.value);
+		sphpb_msr_write(SPH_MSR_CORE_PERF_LIMIT_REASONS, freq_reason.value);
 	}
 }
 
@@ -630,8 +694,11 @@ int do_throttle(struct sphpb_pb *sphpb,
 		uint32_t power_limit1_mW)
 {
 	uint64_t ring_clock_ticks, ring_freq, time_us, delta_t_us;
+	struct sphpb_throttle_input in;
+	struct sphpb_throttle_output out;
 	uint32_t cpu, icebo, ice_freq;
-	uint8_t new_state;
+	uint16_t old_ring_cap;
+	uint8_t new_state, old_ratio_cap;
 	bool all_min = true;
 	int ret = 0;
 
@@ -645,38 +712,23 @@ int do_throttle(struct sphpb_pb *sphpb,
 	 * RING
 	 * check if ring frequency is set at minimum.
 	 */
-	rdmsrl(MSR_UNC_PERF_UNCORE_CLOCK_TICKS, ring_clock_ticks);
-	ring_freq = (ring_clock_ticks - sphpb->throttle_data.ring_clock_ticks) /
-		    delta_t_us;
-	if (ring_freq > RING_THRESHOLD) //400MHz
-		all_min = false;
-	sphpb->throttle_data.ring_clock_ticks = ring_clock_ticks;
+	if (sphpb_msr_read(MSR_UNC_PERF_UNCORE_CLOCK_TICKS, &ring_clock_ticks) == 0) {
+		ring_freq = (ring_clock_ticks - sphpb->throttle_data.ring_clock_ticks) /
+			    delta_t_us;
+		if (ring_freq > RING_THRESHOLD) //400MHz
+			all_min = false;
+		sphpb->throttle_data.ring_clock_ticks = ring_clock_ticks;
+	}
 
 	/*
 	 * IA
-	 * check if ia cores frequency are set at minimum
+	 * check if ia cores frequency are set at minimum,
+	 * each cpu publishes its own frequency sample.
 	 */
-	for (cpu = 0; cpu < num_possible_cpus(); ++cpu) {
-		if (!cpu_online(cpu)) {
-			sphpb->throttle_data.cpu_stat[cpu].aperf = 0;
-			sphpb->throttle_data.cpu_stat[cpu].mperf = 0;
-		} else {
-			uint64_t aperf, mperf, cpu_freq;
-
-			aperf = sphpb->throttle_data.cpu_stat[cpu].aperf;
-			mperf = sphpb->throttle_data.cpu_stat[cpu].mperf;
-
-			smp_call_function_single(cpu,
-						 aperfmperf_snapshot_khz,
-						 &sphpb->throttle_data.cpu_stat[cpu],
-						 true);
-			if (aperf == 0 || mperf == 0)
-				continue;
-
-			cpu_freq = (sphpb->throttle_data.cpu_stat[cpu].aperf - aperf) /
-					(sphpb->throttle_data.cpu_stat[cpu].mperf - mperf);
-			if (cpu_freq > IA_THRESHOLD) //400000KHz = 400MHz
-				all_min = false;
+	for_each_online_cpu(cpu) {
+		if (sphpb_freq_sample_get_khz(cpu) > IA_THRESHOLD) { //400000KHz = 400MHz
+			all_min = false;
+			break;
 		}
 	}
 
@@ -713,31 +765,47 @@ int do_throttle(struct sphpb_pb *sphpb,
 
 
 	/*
-	 * Decide on throttle state:
-	 * supported states:
-	 *  - SPHPB_NO_THROTTLE - indicates  that throttling is not active/required
-	 *  - SPHPB_THROTTLE_TO_MAX - indicates the pcode will try to throttle the system to maximum
-	 *  - SPHPB_THROTTLE_TO_MIN - indicates the pcode will try to throttle the system to minimum ( first level of throttling)
-	 * - 14 steps are between SPHPB_THROTTLE_TO_MIN to SPHPB_THROTTLE_TO_MAX (0xf, 0xe, ... , 0x2, 0x1)
+	 * Decide on ratio caps and throttle state by the selected policy,
+	 * see sphpb_throttle_policy.c for the supported states.
 	 */
-
-	if (all_min && (avg_power_mW > mult_frac(power_limit1_mW, 103llu, 100llu))) {
-		// throttle more
-		if (sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE)
-			new_state = SPHPB_THROTTLE_TO_MIN;
-		else if (sphpb->throttle_data.curr_state > SPHPB_THROTTLE_TO_MAX)
-			new_state = sphpb->throttle_data.curr_state - 1;
-		else
+	in.avg_power_mW = avg_power_mW;
+	in.power_limit1_mW = power_limit1_mW;
+	in.delta_t_us = delta_t_us;
+	in.all_min = all_min;
+	/* no ratio caps without the ice driver ratio callback */
+	in.max_icebo_ratio = sphpb->icedrv_cb->set_icebo_to_icebo_ratio ? sphpb->max_icebo_ratio : 0;
+	in.max_ring_divisor = sphpb->orig_icebo_ring_divisor;
+	in.curr.state = sphpb->throttle_data.curr_state;
+	in.curr.icebo_ratio = sphpb->throttle_data.icebo_ratio_cap;
+	in.curr.ring_divisor = sphpb->throttle_data.ring_divisor_cap;
+
+	sphpb->throttle_data.ctl.policy->next(&sphpb->throttle_data.ctl, &in, &out);
+
+	/* caps are applied to the ratios and ring divisor requested by ICEs */
+	if (out.icebo_ratio != sphpb->throttle_data.icebo_ratio_cap) {
+		old_ratio_cap = sphpb->throttle_data.icebo_ratio_cap;
+		sphpb->throttle_data.icebo_ratio_cap = out.icebo_ratio;
+		ret = sync_icebo_ratios(sphpb);
+		if (unlikely(ret < 0)) {
+			sph_log_err(POWER_BALANCER_LOG, "Throttling failure: icebo ratio cap 0x%x failed with err(%d)\n", out.icebo_ratio, ret);
+			sphpb->throttle_data.icebo_ratio_cap = old_ratio_cap;
 			goto end_func;
-	} else if (!all_min || (avg_power_mW <= power_limit1_mW)) {
-		// throttle less
-		if (sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE)
+		}
+	}
+
+	if (out.ring_divisor != sphpb->throttle_data.ring_divisor_cap) {
+		old_ring_cap = sphpb->throttle_data.ring_divisor_cap;
+		sphpb->throttle_data.ring_divisor_cap = out.ring_divisor;
+		ret = sync_ring_divisor(sphpb);
+		if (unlikely(ret < 0)) {
+			sph_log_err(POWER_BALANCER_LOG, "Throttling failure: ring divisor cap 0x%x failed with err(%d)\n", out.ring_divisor, ret);
+			sphpb->throttle_data.ring_divisor_cap = old_ring_cap;
 			goto end_func;
-		else if (sphpb->throttle_data.curr_state < SPHPB_THROTTLE_TO_MIN)
-			new_state = sphpb->throttle_data.curr_state + 1;
-		else
-			new_state = SPHPB_NO_THROTTLE;
-	} else
+		}
+	}
+
+	new_state = out.state;
+	if (new_state == sphpb->throttle_data.curr_state)
 		goto end_func;
 
 	if (sphpb->request_ddr_value != SAGV_POLICY_FIXED_LOW) {
@@ -747,7 +815,7 @@ int do_throttle(struct sphpb_pb *sphpb,
 				sph_log_err(POWER_BALANCER_LOG, "Throttling failure: set_sagv_freq dynamic failed with err:%d.\n", ret);
 				goto end_func;
 			}
-		} else if (new_state == SPHPB_THROTTLE_TO_MIN && sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE) {
+		} else if (sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE) {
 			ret = set_sagv_freq(SAGV_POLICY_FIXED_LOW, SAGV_POLICY_DYNAMIC);
 			if (unlikely(ret < 0)) {
 				sph_log_err(POWER_BALANCER_LOG, "Throttling failure: set_sagv_freq fixed failed with err:%d.\n", ret);
@@ -797,7 +865,7 @@ cleanup_ddr_value:
 	if (sphpb->request_ddr_value != SAGV_POLICY_FIXED_LOW) {
 		if (new_state == SPHPB_NO_THROTTLE)
 			set_sagv_freq(SAGV_POLICY_FIXED_LOW, SAGV_POLICY_DYNAMIC);
-		else if (new_state == SPHPB_THROTTLE_TO_MIN && sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE)
+		else if (sphpb->throttle_data.curr_state == SPHPB_NO_THROTTLE)
 			set_sagv_freq(sphpb->request_ddr_value, SAGV_POLICY_DYNAMIC);
 	}
 
@@ -0,0 +1,18 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+#include <linux/kernel.h>
+#include <asm/msr.h>
+#include "sphpb_msr.h"
+
+int sphpb_msr_read(uint32_t msr, uint64_t *val)
+{
+	return rdmsrl_safe(msr, val);
+}
+
+int sphpb_msr_write(uint32_t msr, uint64_t val)
+{
+	return wrmsrl_safe(msr, val);
+}
@@ -0,0 +1,30 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+/**
+ * @file sphpb_msr.h
+ *
+ * @brief Header file defining sphpb MSR access
+ *
+ * MSRs are accessed on the calling CPU. sphpb_msr.c accesses the
+ * hardware, sphpb_msr_stub.c replaces it where MSRs are not available
+ * and returns the values set by sphpb_msr_stub_set(), so the throttle
+ * policy can be driven by synthetic frequency traces.
+ *
+ */
+
+#ifndef _SPHPB_MSR_H_
+#define _SPHPB_MSR_H_
+
+#include <linux/types.h>
+
+int sphpb_msr_read(uint32_t msr, uint64_t *val);
+int sphpb_msr_write(uint32_t msr, uint64_t val);
+
+/* stub backend only - set value of msr as seen by cpu */
+int sphpb_msr_stub_set(uint32_t cpu, uint32_t msr, uint64_t val);
+
+#endif //_SPHPB_MSR_H_
@@ -0,0 +1,64 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+#include <linux/kernel.h>
+#include <linux/smp.h>
+#include <asm/msr-index.h>
+#include "sphpb_msr.h"
+#include "sphpb_punit.h"
+
+#define SPHPB_MSR_STUB_MAX_CPUS 64
+
+static const uint32_t stub_msrs[] = {
+	MSR_IA32_APERF,
+	MSR_IA32_MPERF,
+	MSR_UNC_PERF_UNCORE_CLOCK_TICKS,
+	SPH_MSR_CORE_PERF_LIMIT_REASONS
+};
+
+static uint64_t stub_vals[SPHPB_MSR_STUB_MAX_CPUS][ARRAY_SIZE(stub_msrs)];
+
+static uint64_t *stub_val(uint32_t cpu, uint32_t msr)
+{
+	uint32_t i;
+
+	if (cpu >= SPHPB_MSR_STUB_MAX_CPUS)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(stub_msrs); ++i)
+		if (stub_msrs[i] == msr)
+			return &stub_vals[cpu][i];
+
+	return NULL;
+}
+
+int sphpb_msr_stub_set(uint32_t cpu, uint32_t msr, uint64_t val)
+{
+	uint64_t *p = stub_val(cpu, msr);
+
+	if (!p)
+		return -EINVAL;
+
+	WRITE_ONCE(*p, val);
+
+	return 0;
+}
+
+int sphpb_msr_read(uint32_t msr, uint64_t *val)
+{
+	uint64_t *p = stub_val(raw_smp_processor_id(), msr);
+
+	if (!p)
+		return -EIO;
+
+	*val = READ_ONCE(*p);
+
+	return 0;
+}
+
+int sphpb_msr_write(uint32_t msr, uint64_t val)
+{
+	return sphpb_msr_stub_set(raw_smp_processor_id(), msr, val) ? -EIO : 0;
+}
@@ -0,0 +1,222 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+/*
+ * [Desciption]: workload perf model.
+ * The ice driver reports the ice cycles every completed job took. Per icebo
+ * and network the balancer keeps an ewma of cycles per job by icebo ratio,
+ * and derives the relative energy per job at each measured ratio:
+ *
+ *   E(r) = cycles(r) * P(r) / r,  P(r) = static + r^3
+ *
+ * dynamic power scaling with f * V^2 and V roughly with f. Models live in
+ * a small table, a network new to an icebo takes over the least recently
+ * updated model, so networks sharing an icebo keep their own models.
+ */
+
+#include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include "sph_log.h"
+#include "sphpb.h"
+
+/* static power equal to dynamic power at ratio 16 (400MHz) */
+#define SPHPB_PERF_DEFAULT_STATIC_PWR	(16u * 16u * 16u)
+/* ewma weight of new sample is 1/(1 << SHIFT) */
+#define SPHPB_PERF_EWMA_SHIFT		3
+
+static uint64_t entry_energy(struct sphpb_pb *sphpb, struct sphpb_perf_entry *e)
+{
+	uint64_t r = e->ratio;
+
+	if (!e->samples || !r)
+		return 0;
+
+	return e->cycles * (sphpb->perf_static_pwr + r * r * r) / r;
+}
+
+/* model of ntw_id on icebo, NULL if not measured, called under perf_lock */
+static struct sphpb_perf_model *model_find(struct sphpb_pb *sphpb,
+					   uint32_t icebo,
+					   uint64_t ntw_id)
+{
+	struct sphpb_perf_model *model;
+	uint32_t i;
+
+	for (i = 0; i < SPHPB_PERF_MODEL_COUNT; i++) {
+		model = &sphpb->perf_model[i];
+		if (model->stamp && model->icebo == icebo && model->ntw_id == ntw_id)
+			return model;
+	}
+
+	return NULL;
+}
+
+/* model of ntw_id on icebo, a new one replaces the least recently updated */
+static struct sphpb_perf_model *model_get(struct sphpb_pb *sphpb,
+					  uint32_t icebo,
+					  uint64_t ntw_id)
+{
+	struct sphpb_perf_model *model = model_find(sphpb, icebo, ntw_id);
+	uint32_t i;
+
+	if (model)
+		return model;
+
+	model = &sphpb->perf_model[0];
+	for (i = 1; i < SPHPB_PERF_MODEL_COUNT; i++)
+		if (sphpb->perf_model[i].stamp < model->stamp)
+			model = &sphpb->perf_model[i];
+
+	memset(model->entry, 0, sizeof(model->entry));
+	model->icebo = icebo;
+	model->ntw_id = ntw_id;
+
+	return model;
+}
+
+void sphpb_perf_model_add(struct sphpb_pb *sphpb,
+			  uint32_t icebo,
+			  uint8_t ratio,
+			  uint64_t ntw_id,
+			  uint64_t cycles)
+{
+	struct sphpb_perf_model *model;
+	struct sphpb_perf_entry *e;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sphpb->perf_lock, flags);
+
+	model = model_get(sphpb, icebo, ntw_id);
+	model->stamp = ++sphpb->perf_stamp;
+	e = &model->entry[ratio >> SPHPB_PERF_RATIO_SHIFT];
+
+	if (!e->samples)
+		e->cycles = cycles;
+	else
+		e->cycles = e->cycles - (e->cycles >> SPHPB_PERF_EWMA_SHIFT) +
+			    (cycles >> SPHPB_PERF_EWMA_SHIFT);
+	e->ratio = ratio;
+	e->samples++;
+
+	spin_unlock_irqrestore(&sphpb->perf_lock, flags);
+}
+
+uint64_t sphpb_perf_model_energy(struct sphpb_pb *sphpb,
+				 uint32_t icebo,
+				 uint64_t ntw_id,
+				 uint8_t ratio)
+{
+	struct sphpb_perf_model *model;
+	unsigned long flags;
+	uint64_t energy = 0;
+
+	spin_lock_irqsave(&sphpb->perf_lock, flags);
+	model = model_find(sphpb, icebo, ntw_id);
+	if (model)
+		energy = entry_energy(sphpb, &model->entry[ratio >> SPHPB_PERF_RATIO_SHIFT]);
+	spin_unlock_irqrestore(&sphpb->perf_lock, flags);
+
+	return energy;
+}
+
+uint8_t sphpb_perf_model_best_ratio(struct sphpb_pb *sphpb,
+				    uint32_t icebo,
+				    uint64_t ntw_id,
+				    uint8_t max_ratio)
+{
+	struct sphpb_perf_model *model;
+	struct sphpb_perf_entry *e;
+	uint64_t energy, best_energy = 0;
+	uint8_t best_ratio = 0;
+	unsigned long flags;
+	uint32_t i;
+
+	spin_lock_irqsave(&sphpb->perf_lock, flags);
+
+	model = model_find(sphpb, icebo, ntw_id);
+	for (i = 0; model && i <= (max_ratio >> SPHPB_PERF_RATIO_SHIFT); i++) {
+		e = &model->entry[i];
+		if (e->ratio > max_ratio)
+			continue;
+
+		energy = entry_energy(sphpb, e);
+		if (energy && (!best_energy || energy < best_energy)) {
+			best_energy = energy;
+			best_ratio = e->ratio;
+		}
+	}
+
+	spin_unlock_irqrestore(&sphpb->perf_lock, flags);
+
+	return best_ratio;
+}
+
+static int perf_model_show(struct seq_file *m, void *v)
+{
+	struct sphpb_pb *sphpb = m->private;
+	struct sphpb_perf_model *model;
+	struct sphpb_perf_entry *e;
+	unsigned long flags;
+	uint32_t n, i;
+
+	seq_puts(m, "icebo ntw_id ratio samples cycles energy\n");
+
+	spin_lock_irqsave(&sphpb->perf_lock, flags);
+
+	for (n = 0; n < SPHPB_PERF_MODEL_COUNT; n++) {
+		model = &sphpb->perf_model[n];
+		if (!model->stamp)
+			continue;
+
+		for (i = 0; i < SPHPB_PERF_RATIO_BUCKETS; i++) {
+			e = &model->entry[i];
+			if (!e->samples)
+				continue;
+
+			seq_printf(m, "%u 0x%llx %u %u %llu %llu\n",
+				   model->icebo, model->ntw_id, e->ratio, e->samples,
+				   e->cycles, entry_energy(sphpb, e));
+		}
+	}
+
+	spin_unlock_irqrestore(&sphpb->perf_lock, flags);
+
+	return 0;
+}
+
+static int perf_model_open(struct inode *inode, struct file *f)
+{
+	return single_open(f, perf_model_show, inode->i_private);
+}
+
+static const struct file_operations perf_model_fops = {
+	.open = perf_model_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void sphpb_perf_model_init(struct sphpb_pb *sphpb)
+{
+	spin_lock_init(&sphpb->perf_lock);
+	sphpb->perf_static_pwr = SPHPB_PERF_DEFAULT_STATIC_PWR;
+
+	sphpb->debugfs_dir = debugfs_create_dir("sphpb", NULL);
+	if (IS_ERR_OR_NULL(sphpb->debugfs_dir)) {
+		sph_log_info(POWER_BALANCER_LOG, "sphpb debugfs not available, perf model not exposed\n");
+		sphpb->debugfs_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("perf_model", 0444, sphpb->debugfs_dir, sphpb, &perf_model_fops);
+	debugfs_create_u32("perf_static_pwr", 0644, sphpb->debugfs_dir, &sphpb->perf_static_pwr);
+}
+
+void sphpb_perf_model_deinit(struct sphpb_pb *sphpb)
+{
+	debugfs_remove_recursive(sphpb->debugfs_dir);
+	sphpb->debugfs_dir = NULL;
+}
@@ -21,6 +21,7 @@
 #include <linux/smp.h>
 #include "sph_log.h"
 #include "sphpb.h"
+#include "sphpb_msr.h"
 
 /* IA SYSFS */
 
@@ -132,8 +133,8 @@ void aperfmperf_snapshot_khz(void *ptr)
 	unsigned long flags;
 
 	local_irq_save(flags);
-	rdmsrl(MSR_IA32_APERF, cpu_stat->aperf);
-	rdmsrl(MSR_IA32_MPERF, cpu_stat->mperf);
+	sphpb_msr_read(MSR_IA32_APERF, &cpu_stat->aperf);
+	sphpb_msr_read(MSR_IA32_MPERF, &cpu_stat->mperf);
 	local_irq_restore(flags);
 
 	cpu_stat->aperf *= cpu_khz;
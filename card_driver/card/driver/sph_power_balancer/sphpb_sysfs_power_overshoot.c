@@ -28,11 +28,22 @@ static ssize_t store_power_overshoot_protection(struct kobject *kobj,
 					  struct kobj_attribute *attr,
 					  const char *buf, size_t count);
 
+static ssize_t show_power_overshoot_policy(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   char *buf);
+static ssize_t store_power_overshoot_policy(struct kobject *kobj,
+					    struct kobj_attribute *attr,
+					    const char *buf, size_t count);
+
 static struct kobj_attribute power_overshoot_protection_attr =
 __ATTR(protection, 0664, NULL, store_power_overshoot_protection);
 
+static struct kobj_attribute power_overshoot_policy_attr =
+__ATTR(policy, 0664, show_power_overshoot_policy, store_power_overshoot_policy);
+
 static struct attribute *power_overshoot_attrs[] = {
 	&power_overshoot_protection_attr.attr,
+	&power_overshoot_policy_attr.attr,
 	NULL,	/* need to NULL terminate the list of attributes */
 };
 
@@ -63,6 +74,38 @@ static ssize_t store_power_overshoot_protection(struct kobject *kobj,
 	return count;
 }
 
+static ssize_t show_power_overshoot_policy(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   char *buf)
+{
+	ssize_t ret;
+
+	mutex_lock(&g_the_sphpb->mutex_lock);
+	ret = sphpb_throttle_policy_list(g_the_sphpb->throttle_data.ctl.policy, buf);
+	mutex_unlock(&g_the_sphpb->mutex_lock);
+
+	return ret;
+}
+
+static ssize_t store_power_overshoot_policy(struct kobject *kobj,
+					    struct kobj_attribute *attr,
+					    const char *buf, size_t count)
+{
+	const struct sphpb_throttle_policy *policy;
+
+	policy = sphpb_throttle_policy_find(buf);
+	if (unlikely(policy == NULL)) {
+		sph_log_err(POWER_BALANCER_LOG, "Unknown throttle policy: %s\n", buf);
+		return -EINVAL;
+	}
+
+	mutex_lock(&g_the_sphpb->mutex_lock);
+	sphpb_throttle_policy_set(&g_the_sphpb->throttle_data.ctl, policy);
+	mutex_unlock(&g_the_sphpb->mutex_lock);
+
+	return count;
+}
+
 int sphpb_power_overshoot_sysfs_init(struct sphpb_pb *sphpb)
 {
 	int ret = 0;
@@ -0,0 +1,260 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+/*
+ * [Desciption]: throttle policies of the power overshoot protection.
+ * A policy maps the power sample of each overshoot tick to a throttle
+ * level. The first levels cap the ICEBO ratios one step each, with the
+ * ring divisor scaled by the square of the capped ratio the way
+ * update_ring_divisor scales it, and the next levels are the clock squash
+ * states. Clock squash is only taken once all domains are at minimum.
+ * do_throttle applies the caps, clock squash and DDR SAGV policy.
+ * Policies use no kernel services beside the math helpers, so they can
+ * be replayed against recorded power traces.
+ *
+ *  - threshold - step one level per tick once power is 3% above PL1
+ *  - pi        - proportional-integral on power overshoot relative to PL1
+ *  - ewma      - steps on EWMA smoothed power extrapolated by its trend
+ */
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include "sphpb.h"
+
+#define SPHPB_THROTTLE_LEVELS	(SPHPB_THROTTLE_TO_MIN - SPHPB_THROTTLE_TO_MAX + 1)
+
+/* pi - one level per 2% overshoot, and per 2% overshoot held for 1 second */
+#define SPHPB_PI_KP_PERMILLE	20
+#define SPHPB_PI_KI_PERMILLE_MS	(20 * 1000)
+/* limit integration of the first tick after a long pause */
+#define SPHPB_PI_MAX_DT_MS	1000
+
+/* ewma - alpha is 1/(1 << SHIFT), trend extrapolated HORIZON ticks ahead */
+#define SPHPB_EWMA_SHIFT	2
+#define SPHPB_EWMA_FRAC		8
+#define SPHPB_EWMA_HORIZON	2
+
+/* level 0 is no throttle, SPHPB_THROTTLE_LEVELS is throttle to max */
+static uint32_t state_to_level(uint8_t state)
+{
+	if (state == SPHPB_NO_THROTTLE)
+		return 0;
+
+	return SPHPB_THROTTLE_TO_MIN + 1 - state;
+}
+
+static uint8_t level_to_state(int64_t level)
+{
+	if (level <= 0)
+		return SPHPB_NO_THROTTLE;
+	if (level > SPHPB_THROTTLE_LEVELS)
+		level = SPHPB_THROTTLE_LEVELS;
+
+	return SPHPB_THROTTLE_TO_MIN + 1 - level;
+}
+
+/* ICEBO ratio cap levels before clock squash */
+static int64_t ratio_levels(const struct sphpb_throttle_input *in)
+{
+	if (in->max_icebo_ratio <= SPHPB_THROTTLE_MIN_ICEBO_RATIO)
+		return 0;
+
+	return DIV_ROUND_UP(in->max_icebo_ratio - SPHPB_THROTTLE_MIN_ICEBO_RATIO,
+			    SPHPB_THROTTLE_ICEBO_RATIO_STEP);
+}
+
+static int64_t curr_level(const struct sphpb_throttle_input *in)
+{
+	int64_t levels = ratio_levels(in);
+
+	if (in->curr.state != SPHPB_NO_THROTTLE)
+		return levels + state_to_level(in->curr.state);
+
+	if (in->curr.icebo_ratio == 0 || in->curr.icebo_ratio >= in->max_icebo_ratio)
+		return 0;
+
+	return min_t(int64_t, levels,
+		     DIV_ROUND_UP(in->max_icebo_ratio - in->curr.icebo_ratio,
+				  SPHPB_THROTTLE_ICEBO_RATIO_STEP));
+}
+
+/*
+ * clock squash is the last step - while other domains are not at minimum
+ * it is released one state per tick, ratio caps are not limited
+ */
+static int64_t limit_level(const struct sphpb_throttle_input *in, int64_t level)
+{
+	int64_t levels = ratio_levels(in);
+	int64_t curr = curr_level(in);
+
+	if (!in->all_min && level > levels)
+		level = curr > levels ? curr - 1 : levels;
+
+	return level;
+}
+
+static void level_to_output(const struct sphpb_throttle_input *in,
+			    int64_t level,
+			    struct sphpb_throttle_output *out)
+{
+	int64_t levels = ratio_levels(in);
+	uint32_t ratio, max_ratio = in->max_icebo_ratio;
+	uint64_t ring_divisor;
+
+	out->state = level_to_state(level - levels);
+	out->icebo_ratio = 0;
+	out->ring_divisor = 0;
+
+	level = min(level, levels);
+	if (level <= 0)
+		return;
+
+	ratio = max_t(int64_t, max_ratio - level * SPHPB_THROTTLE_ICEBO_RATIO_STEP,
+		      SPHPB_THROTTLE_MIN_ICEBO_RATIO);
+	out->icebo_ratio = ratio;
+
+	if (in->max_ring_divisor) {
+		ring_divisor = (uint64_t)in->max_ring_divisor * ratio * ratio /
+			       (max_ratio * max_ratio);
+		out->ring_divisor = max_t(uint64_t, ring_divisor, SPHPB_MIN_RING_POSSIBLE_VALUE);
+	}
+}
+
+static void ctl_reset(struct sphpb_throttle_ctl *ctl)
+{
+	ctl->integral = 0;
+	ctl->ewma = 0;
+	ctl->prev_ewma = 0;
+}
+
+static void threshold_next(struct sphpb_throttle_ctl *ctl,
+			   const struct sphpb_throttle_input *in,
+			   struct sphpb_throttle_output *out)
+{
+	int64_t level = curr_level(in);
+
+	if (in->avg_power_mW > mult_frac(in->power_limit1_mW, 103llu, 100llu))
+		// throttle more
+		level++;
+	else if (in->avg_power_mW <= in->power_limit1_mW)
+		// throttle less
+		level--;
+
+	level_to_output(in, limit_level(in, level), out);
+}
+
+static void pi_next(struct sphpb_throttle_ctl *ctl,
+		    const struct sphpb_throttle_input *in,
+		    struct sphpb_throttle_output *out)
+{
+	int64_t err, level, max_integral;
+	uint64_t dt_ms;
+
+	/* no limit to follow, release one level */
+	if (in->power_limit1_mW == 0) {
+		ctl->integral = 0;
+		level_to_output(in, curr_level(in) - 1, out);
+		return;
+	}
+
+	dt_ms = in->delta_t_us / 1000;
+	if (dt_ms > SPHPB_PI_MAX_DT_MS)
+		dt_ms = SPHPB_PI_MAX_DT_MS;
+
+	err = ((int64_t)in->avg_power_mW - in->power_limit1_mW) * 1000 /
+	      in->power_limit1_mW;
+
+	/*
+	 * anti windup - integral alone never exceeds the level range, which
+	 * ends at the ratio caps while clock squash is not allowed
+	 */
+	max_integral = ratio_levels(in);
+	if (in->all_min)
+		max_integral += SPHPB_THROTTLE_LEVELS;
+	max_integral *= SPHPB_PI_KI_PERMILLE_MS;
+
+	ctl->integral += err * (int64_t)dt_ms;
+	if (ctl->integral < 0)
+		ctl->integral = 0;
+	else if (ctl->integral > max_integral)
+		ctl->integral = max_integral;
+
+	level = err / SPHPB_PI_KP_PERMILLE +
+		ctl->integral / SPHPB_PI_KI_PERMILLE_MS;
+
+	level_to_output(in, limit_level(in, level), out);
+}
+
+static void ewma_next(struct sphpb_throttle_ctl *ctl,
+		      const struct sphpb_throttle_input *in,
+		      struct sphpb_throttle_output *out)
+{
+	int64_t power = (int64_t)in->avg_power_mW << SPHPB_EWMA_FRAC;
+	int64_t predicted_mW, level;
+
+	if (ctl->ewma == 0) {
+		ctl->ewma = power;
+		ctl->prev_ewma = power;
+	} else {
+		ctl->prev_ewma = ctl->ewma;
+		ctl->ewma += (power - ctl->ewma) / (1 << SPHPB_EWMA_SHIFT);
+	}
+
+	predicted_mW = (ctl->ewma +
+			(ctl->ewma - ctl->prev_ewma) * SPHPB_EWMA_HORIZON) >>
+		       SPHPB_EWMA_FRAC;
+
+	level = curr_level(in);
+
+	if (predicted_mW > mult_frac(in->power_limit1_mW, 103llu, 100llu)) {
+		// throttle more, faster on a large predicted overshoot
+		level += predicted_mW > mult_frac(in->power_limit1_mW, 110llu, 100llu) ? 2 : 1;
+	} else if (predicted_mW <= in->power_limit1_mW) {
+		// throttle less
+		level--;
+	}
+
+	level_to_output(in, limit_level(in, level), out);
+}
+
+static const struct sphpb_throttle_policy sphpb_throttle_policies[] = {
+	{ .name = "threshold", .reset = ctl_reset, .next = threshold_next },
+	{ .name = "pi", .reset = ctl_reset, .next = pi_next },
+	{ .name = "ewma", .reset = ctl_reset, .next = ewma_next },
+};
+
+const struct sphpb_throttle_policy *sphpb_throttle_policy_find(const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(sphpb_throttle_policies); ++i)
+		if (sysfs_streq(name, sphpb_throttle_policies[i].name))
+			return &sphpb_throttle_policies[i];
+
+	return NULL;
+}
+
+ssize_t sphpb_throttle_policy_list(const struct sphpb_throttle_policy *curr, char *buf)
+{
+	ssize_t ret = 0;
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(sphpb_throttle_policies); ++i)
+		ret += sprintf(buf + ret,
+			       &sphpb_throttle_policies[i] == curr ? "[%s] " : "%s ",
+			       sphpb_throttle_policies[i].name);
+
+	buf[ret - 1] = '\n';
+
+	return ret;
+}
+
+void sphpb_throttle_policy_set(struct sphpb_throttle_ctl *ctl,
+			       const struct sphpb_throttle_policy *policy)
+{
+	ctl->policy = policy;
+	if (policy->reset)
+		policy->reset(ctl);
+}
@@ -19,9 +19,32 @@
 #define IOCTL_GENMSG_ACCEPT_CLIENT	_IOR('G', 1, int)
 #define IOCTL_GENMSG_WRITE_RESPONSE_WAIT _IO('G', 2)
 #define IOCTL_GENMSG_IS_PRIVILEGED      _IOR('G', 3, int)
+#define IOCTL_GENMSG_RING_CREATE        _IOW('G', 4, struct ioctl_genmsg_ring_create)
+#define IOCTL_GENMSG_RING_SUBMIT        _IOW('G', 5, struct ioctl_genmsg_ring_submit)
+#define IOCTL_GENMSG_RING_COMPLETED     _IOR('G', 6, uint64_t)
 
 struct ioctl_register_service {
 	uint32_t name_len;
 };
 
+/*
+ * Creates a DMA-coherent write ring on a connected channel.
+ * The ring is mapped to user space with mmap on the channel fd.
+ * eventfd, if not -1, is signaled each time submitted data
+ * has been transferred to host.
+ */
+struct ioctl_genmsg_ring_create {
+	uint32_t n_pages;
+	int32_t  eventfd;
+};
+
+/*
+ * Sends size bytes starting at page aligned offset of the
+ * write ring to host.
+ */
+struct ioctl_genmsg_ring_submit {
+	uint32_t offset;
+	uint32_t size;
+};
+
 #endif
@@ -28,6 +28,10 @@
 #define IOCTL_INF_DEVNET_RESOURCES_RESERVATION_REPLY _IOW('I', 8, struct inf_devnet_resource_reserve_reply)
 #define IOCTL_INF_GET_ALLOC_PGT          _IOWR('I', 10, struct inf_get_alloc_pgt)
 #define IOCTL_INF_DEVNET_RESET_REPLY      _IOW('I', 11, struct inf_devnet_reset_reply)
+#define IOCTL_INF_SETUP_RING              _IOR('I', 12, struct inf_ring_setup)
+#define IOCTL_INF_RING_KICK               _IO('I', 13)
+#define IOCTL_INF_CMDQ_BULK_READ          _IOW('I', 14, uint32_t)
+#define IOCTL_INF_INFREQ_EXEC_DONE_BATCH  _IOW('I', 15, struct inf_infreq_exec_done_batch)
 #ifdef ULT
 #define IOCTL_INF_SWITCH_DAEMON            _IO('I', 9)
 #endif
@@ -185,6 +189,17 @@ struct inf_infreq_exec_done {
 	IoctlSphcsError i_sphcs_err;
 };
 
+/*
+ * All completions are validated before any of them is completed, on failure
+ * none is completed.
+ */
+#define INF_EXEC_DONE_BATCH_MAX 64
+
+struct inf_infreq_exec_done_batch {
+	const struct inf_infreq_exec_done *completions;
+	uint32_t                           num_completions;
+};
+
 struct inf_alloc_resource {
 	uint64_t drv_handle;
 	uint32_t size;
@@ -238,4 +253,53 @@ struct inf_devnet_reset_reply {
 	IoctlSphcsError i_sphcs_err;
 };
 
+/*
+ * Shared memory rings of a context, mapped by mmap of the context file
+ * after IOCTL_INF_SETUP_RING. Indices are free running, the position in
+ * the ring is the index modulo the ring size.
+ *
+ * cmd ring - commands to the runtime with the read() framing, struct
+ * inf_cmd_header followed by the args, each entry aligned to 8 bytes.
+ * An INF_RING_OPCODE_PAD entry continues at the ring start. Commands which
+ * do not fit in the ring are read by read(), which fails with EAGAIN while
+ * the cmd ring is not empty so the order is kept. poll() wakes up only when
+ * a command is added to an empty ring.
+ *
+ * cpl ring - completions from the runtime, replacing
+ * IOCTL_INF_INFREQ_EXEC_DONE for completions without error message. The
+ * runtime calls IOCTL_INF_RING_KICK only if cpl_cons is equal to the
+ * cpl_prod it replaced, i.e. the driver has drained the ring.
+ */
+#define INF_RING_CMD_SIZE     (64 * 1024)
+#define INF_RING_CPL_ENTRIES  1024
+#define INF_RING_OPCODE_PAD   0xffffffff
+#define INF_RING_ALIGN        8
+
+struct inf_ring_hdr {
+	/* producer and consumer indices in separate cache lines */
+	uint32_t cmd_prod;
+	uint32_t reserved0[15];
+	uint32_t cmd_cons;
+	uint32_t reserved1[15];
+	uint32_t cpl_prod;
+	uint32_t reserved2[15];
+	uint32_t cpl_cons;
+	uint32_t reserved3[15];
+	/* ring sizes and offsets from mapping start */
+	uint32_t cmd_size;
+	uint32_t cmd_offset;
+	uint32_t cpl_entries;
+	uint32_t cpl_offset;
+};
+
+struct inf_ring_cpl {
+	uint64_t        infreq_drv_handle;
+	uint32_t        infreq_ctx_id;
+	IoctlSphcsError i_sphcs_err;
+};
+
+struct inf_ring_setup {
+	uint32_t mmap_size;
+};
+
 #endif
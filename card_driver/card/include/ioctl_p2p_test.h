@@ -15,8 +15,25 @@ struct ioctl_p2p_test_dma {
 	__u64 user_buffer;
 };
 
+/*
+ * Sends num_credits forward and num_credits release credits to peer
+ * dev_id, whose credit fifos and doorbell are this device's own, given
+ * by their host bus addresses. Returns the number of dmas, each ringing
+ * the doorbell once, the credits of each direction took.
+ */
+struct ioctl_p2p_test_cr_loopback {
+	__u64 fw_fifo_host_addr;
+	__u64 rel_fifo_host_addr;
+	__u64 db_host_addr;
+	__u32 dev_id;
+	__u32 num_credits;
+	__u32 o_fw_batches;
+	__u32 o_rel_batches;
+};
+
 #define IOCTL_P2P_DMA_WR _IOW('H', 0, struct ioctl_p2p_test_dma)
 #define IOCTL_P2P_DMA_RD _IOW('H', 1, struct ioctl_p2p_test_dma)
+#define IOCTL_P2P_CR_LOOPBACK _IOWR('H', 2, struct ioctl_p2p_test_cr_loopback)
 
 
 #endif
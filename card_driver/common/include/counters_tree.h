@@ -358,6 +358,28 @@ public:
 		return (const uint64_t *)((uintptr_t)m_values + offset);
 	};
 
+	/**
+	 * @brief read a set of counters as one consistent snapshot
+	 *
+	 * Copies the counters at the given offsets into out_vals. For
+	 * user-mode values blocks the copy is retried while the block owner
+	 * is in the middle of an update, no semaphore is taken.
+	 */
+	void snapshot(const uint32_t *offsets,
+		      uint32_t        count,
+		      uint64_t       *out_vals) const
+	{
+		const uint32_t *seq = m_shm_block ? &m_shm_block->values_seq : nullptr;
+		uint32_t start = 0;
+
+		do {
+			if (seq)
+				start = um_shm_seq_read_begin(seq);
+			for (uint32_t i = 0; i < count; i++)
+				out_vals[i] = *get_ptr(offsets[i]);
+		} while (seq && um_shm_seq_read_retry(seq, start));
+	};
+
 	bool is_stale(void) const
 	{
 		return m_is_stale;
@@ -496,11 +518,66 @@ public:
 	 */
 	const uint64_t *find_counter(const std::string &name);
 
+	/**
+	 * @brief start a lock-less read of the um values block lists
+	 *
+	 * Records the sequence count of the block list of every values
+	 * shm object mapped under this node and its children, in tree
+	 * order, into out_seqs.
+	 */
+	void um_lists_read_begin(std::vector<uint32_t> &out_seqs) const
+	{
+		for (const shm_values_map_info::ptr &map : m_shm_maps)
+			out_seqs.push_back(um_shm_list_read_begin(&um_block_list(map)));
+
+		for (const auto &child : m_childs)
+			child.second->um_lists_read_begin(out_seqs);
+
+		for (const auto &id_childs : m_childs_vec)
+			for (const auto &child : id_childs.second)
+				child.second->um_lists_read_begin(out_seqs);
+	};
+
+	/**
+	 * @brief check if a block list changed since um_lists_read_begin
+	 */
+	bool um_lists_read_retry(const std::vector<uint32_t> &seqs) const
+	{
+		size_t idx = 0;
+
+		return um_lists_read_retry(seqs, idx);
+	};
+
 private:
 	counters_values_node(counters_info_node::ptr info) :
 		m_info(info)
 	{};
 
+	static const struct um_shm_list &um_block_list(const shm_values_map_info::ptr &map)
+	{
+		return ((const struct um_shm_values_header *)map->shm_ptr)->block_list;
+	};
+
+	bool um_lists_read_retry(const std::vector<uint32_t> &seqs,
+				 size_t                      &idx) const
+	{
+		for (const shm_values_map_info::ptr &map : m_shm_maps)
+			if (idx >= seqs.size() ||
+			    um_shm_list_read_retry(&um_block_list(map), seqs[idx++]))
+				return true;
+
+		for (const auto &child : m_childs)
+			if (child.second->um_lists_read_retry(seqs, idx))
+				return true;
+
+		for (const auto &id_childs : m_childs_vec)
+			for (const auto &child : id_childs.second)
+				if (child.second->um_lists_read_retry(seqs, idx))
+					return true;
+
+		return false;
+	};
+
 	static void traverse_cb(const std::string &dirpath,
 				const std::string &dirname,
 				void              *ctx);
@@ -641,8 +718,31 @@ public:
 			m_last_dirty_info != *m_dirty_info_ptr);
 	};
 
+	/**
+	 * @brief re-scan the values tree if it changed
+	 *
+	 * For user-mode trees the scan walks the values block lists
+	 * without taking their semaphores, it is repeated if a block was
+	 * allocated or deleted while it ran.
+	 */
 	bool update_values_set(bool force,
-			       bool is_auto_refresh = false);
+			       bool is_auto_refresh = false)
+	{
+		std::vector<uint32_t> seqs;
+		counters_values_node::ptr values;
+		bool ret;
+
+		do {
+			seqs.clear();
+			values = m_values;
+			if (values.get() != nullptr)
+				values->um_lists_read_begin(seqs);
+
+			ret = load_values_set(force, is_auto_refresh);
+		} while (values.get() != nullptr && values->um_lists_read_retry(seqs));
+
+		return ret;
+	};
 
 	const std::string &dirname(void) const
 	{
@@ -665,6 +765,9 @@ public:
 	void      sync_handle_refreshed(uintptr_t sync_handle);
 
 private:
+	bool load_values_set(bool force,
+			     bool is_auto_refresh);
+
 	counters_tree(const std::string &dirname,
 		      const std::string &base_name) :
 		m_dirname(dirname),
@@ -89,6 +89,8 @@ struct um_shm_values_block {
 		uint32_t reserved     :29;
 	}                flags;
 
+	uint32_t         values_seq;  // odd while the owner updates values
+
 	uint64_t         changed_count_at_remove;
 	sem_t            lock;
 	struct um_shm_list_head node;
@@ -110,3 +112,17 @@ struct um_shm_values_header {
 	// structs of the same ngroups and nvals values.
 	struct um_shm_list block_list;
 };
+
+//
+// A values block owner brackets multi-counter updates with these so
+// that reporters can take consistent snapshots without the block lock.
+//
+inline void um_shm_values_write_begin(struct um_shm_values_block *block)
+{
+	um_shm_seq_write_begin(&block->values_seq);
+}
+
+inline void um_shm_values_write_end(struct um_shm_values_block *block)
+{
+	um_shm_seq_write_end(&block->values_seq);
+}
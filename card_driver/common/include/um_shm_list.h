@@ -32,14 +32,106 @@ struct um_shm_list_head {
 	uintptr_t prev_off;
 };
 
+//
+// The free list is a lock-free stack, its top is kept as the offset
+// of the first free node tagged with a generation count in the upper
+// bits to protect the compare-and-swap from ABA.
+//
+#define UM_SHM_FREE_OFF_BITS   40
+#define UM_SHM_FREE_OFF_MASK   ((1ULL << UM_SHM_FREE_OFF_BITS) - 1)
+
 struct um_shm_list {
 	uintptr_t list_off;
-	uintptr_t free_off;
+	uint64_t  free_top;   // tagged offset of first free node
 	uintptr_t head_off;
 	uint32_t  node_off;
 	uint32_t  list_size;
+	uint32_t  seq;        // odd while the used list is being modified
 };
 
+//
+// Sequence count helpers, writers must be serialized by the caller,
+// readers never block writers and retry if a write happened while
+// they were reading.
+//
+inline uint32_t um_shm_seq_read_begin(const uint32_t *seq)
+{
+	uint32_t s;
+
+	while ((s = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1)
+		;
+
+	return s;
+}
+
+inline bool um_shm_seq_read_retry(const uint32_t *seq, uint32_t start)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+}
+
+inline void um_shm_seq_write_begin(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+inline void um_shm_seq_write_end(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+inline uintptr_t um_shm_free_top_off(uint64_t top)
+{
+	return (uintptr_t)(top & UM_SHM_FREE_OFF_MASK);
+}
+
+inline uint64_t um_shm_free_top_make(uintptr_t off, uint64_t prev_top)
+{
+	uint64_t tag = (prev_top >> UM_SHM_FREE_OFF_BITS) + 1;
+
+	return (tag << UM_SHM_FREE_OFF_BITS) | ((uint64_t)off & UM_SHM_FREE_OFF_MASK);
+}
+
+inline struct um_shm_list_head *um_shm_free_list_pop(struct um_shm_list *list)
+{
+	const char *shm_base = (const char *)list - list->list_off;
+	uint64_t top = __atomic_load_n(&list->free_top, __ATOMIC_ACQUIRE);
+	struct um_shm_list_head *head;
+
+	do {
+		if (!um_shm_free_top_off(top))
+			return nullptr;
+
+		head = (struct um_shm_list_head *)(shm_base + um_shm_free_top_off(top));
+	} while (!__atomic_compare_exchange_n(&list->free_top,
+					      &top,
+					      um_shm_free_top_make(__atomic_load_n(&head->next_off,
+										   __ATOMIC_RELAXED),
+								   top),
+					      false,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return head;
+}
+
+inline void um_shm_free_list_push(struct um_shm_list      *list,
+				  struct um_shm_list_head *node)
+{
+	uint64_t top = __atomic_load_n(&list->free_top, __ATOMIC_RELAXED);
+
+	node->prev_off = 0;
+	do {
+		__atomic_store_n(&node->next_off, um_shm_free_top_off(top), __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&list->free_top,
+					      &top,
+					      um_shm_free_top_make(node->off, top),
+					      false,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
 template<class T>
 void um_shm_list_init(const char              *shm_base,
 		      struct um_shm_list      *list,
@@ -51,17 +143,17 @@ void um_shm_list_init(const char              *shm_base,
 		      bool                     is_append = false)
 {
 	uintptr_t off = (uintptr_t)head - (uintptr_t)shm_base;
+	uintptr_t first_off = off;
 	uintptr_t prev_off = 0;
+	struct um_shm_list_head *tail = head;
 
-	if (is_append) {
-		list->free_off = off;
-		list->list_size += list_size;
-	} else {
+	if (!is_append) {
 		list->list_off = (uintptr_t)list - (uintptr_t)shm_base;
-		list->free_off = off;
+		list->free_top = 0;
 		list->head_off = 0;
+		list->seq = 0;
 		list->node_off = (uintptr_t)head - (uintptr_t)first;
-		list->list_size = list_size;
+		list->list_size = 0;
 	}
 
 	for (int i = 0; i < list_size; i++) {
@@ -76,10 +168,32 @@ void um_shm_list_init(const char              *shm_base,
 		if (init_cb)
 			(*init_cb)((T *)((uintptr_t)first + (i * entry_size)));
 
+		tail = head;
 		prev_off = off;
 		off += entry_size;
 		head = (struct um_shm_list_head *)(shm_base + off);
 	}
+
+	if (list_size <= 0)
+		return;
+
+	__atomic_add_fetch(&list->list_size, list_size, __ATOMIC_RELAXED);
+
+	//
+	// The new chain is fully linked, hook its tail on the current
+	// free top and publish it. When appending, other processes may
+	// pop or push free nodes concurrently.
+	//
+	uint64_t top = __atomic_load_n(&list->free_top, __ATOMIC_RELAXED);
+
+	do {
+		__atomic_store_n(&tail->next_off, um_shm_free_top_off(top), __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&list->free_top,
+					      &top,
+					      um_shm_free_top_make(first_off, top),
+					      false,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
 }
 
 bool inline um_shm_list_is_empty(struct um_shm_list *list)
@@ -87,35 +201,45 @@ bool inline um_shm_list_is_empty(struct um_shm_list *list)
 	return list->head_off == 0;
 }
 
+//
+// Lock-less traversal of the used list, readers iterate with
+// um_shm_list_first/next between these two calls and restart when
+// um_shm_list_read_retry returns true. A traversal racing with a
+// writer may follow stale links, so it must also stop after
+// list_size steps.
+//
+inline uint32_t um_shm_list_read_begin(const struct um_shm_list *list)
+{
+	return um_shm_seq_read_begin(&list->seq);
+}
+
+inline bool um_shm_list_read_retry(const struct um_shm_list *list, uint32_t start)
+{
+	return um_shm_seq_read_retry(&list->seq, start);
+}
+
 template <class T>
 bool um_shm_list_alloc(struct um_shm_list *list,
 		       T                 *&elem,
 		       sem_t              *lock)
 {
-	if (lock)
-		sem_wait(lock);
+	// Get node out of the free list, no need to hold the lock for that
+	struct um_shm_list_head *head = um_shm_free_list_pop(list);
 
-	if (!list->free_off) {
-		if (lock)
-			sem_post(lock);
+	if (!head) {
 		elem = nullptr;
 		return false;
 	}
 
 	const char *shm_base = (const char *)list - list->list_off;
 
-	struct um_shm_list_head *head =
-		(struct um_shm_list_head *)(shm_base + list->free_off);
+	if (lock)
+		sem_wait(lock);
 
-	// Get node out of the free list
-	list->free_off = head->next_off;
-	if (head->next_off) {
-		struct um_shm_list_head *next_head =
-			(struct um_shm_list_head *)(shm_base + head->next_off);
-		next_head->prev_off = 0;
-	}
+	um_shm_seq_write_begin(&list->seq);
 
 	// Put node as the new head
+	head->prev_off = 0;
 	if (list->head_off) {
 		struct um_shm_list_head *cur_head =
 			(struct um_shm_list_head *)(shm_base + list->head_off);
@@ -124,6 +248,8 @@ bool um_shm_list_alloc(struct um_shm_list *list,
 	head->next_off = list->head_off;
 	list->head_off = head->off;
 
+	um_shm_seq_write_end(&list->seq);
+
 	if (lock)
 		sem_post(lock);
 
@@ -144,6 +270,8 @@ void um_shm_list_del(struct um_shm_list *list,
 	struct um_shm_list_head *node =
 		(struct um_shm_list_head *)((uintptr_t)elem + list->node_off);
 
+	um_shm_seq_write_begin(&list->seq);
+
 	// Put node out of the head list
 	struct um_shm_list_head *prev_node = nullptr;
 	struct um_shm_list_head *next_node = nullptr;
@@ -161,19 +289,13 @@ void um_shm_list_del(struct um_shm_list *list,
 		next_node->prev_off = node->prev_off;
 	}
 
-
-	// Insert the node to the start of the free list
-	node->prev_off = 0;
-	node->next_off = list->free_off;
-	if (list->free_off) {
-		next_node = (struct um_shm_list_head *)(shm_base +
-							list->free_off);
-		next_node->prev_off = node->off;
-	}
-	list->free_off = node->off;
+	um_shm_seq_write_end(&list->seq);
 
 	if (lock)
 		sem_post(lock);
+
+	// Insert the node to the start of the free list
+	um_shm_free_list_push(list, node);
 }
 
 inline void *um_shm_list_shm_base(const struct um_shm_list_head *node)
@@ -51,6 +51,11 @@ int cve_device_init(struct cve_device *dev, int index, u64 pe_value)
 	/* Initializes Invalid Persistent Nw*/
 	dev->dev_ntw_id = INVALID_NETWORK_ID;
 
+	/* No idle history yet, fixed power-off delay applies */
+	dev->pm.samples = 0;
+	dev->pm.delay_ms = 0;
+	dev->pm.gap_open = false;
+
 	pe_mask = BIT_ULL(dev->dev_index) << 4;
 	/*If device is ON*/
 	if ((pe_value & pe_mask) != pe_mask)
@@ -107,6 +112,8 @@ int cve_device_init(struct cve_device *dev, int index, u64 pe_value)
 	cve_dg_add_device(dev);
 
 	ice_di_start_llc_pmon(dev, true);
+	/* PMON2/3 feed the LLC allocator */
+	ice_di_start_llc_pmon(dev, false);
 
 	ice_swc_create_dev_node(dev);
 
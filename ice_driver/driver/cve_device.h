@@ -198,6 +198,21 @@ struct ice_pmon_config {
 	const char *pmon_name;
 	u32 pmon_value;
 };
+/* Log2 ms buckets of ICE idle gaps, last one catches everything above */
+#define ICE_PM_GAP_BINS 17
+
+/* Per ICE idle gap history used to pick its power-off delay */
+struct ice_pm_stats {
+	/* Gaps between release and next reservation of the ICE */
+	u32 gap_hist[ICE_PM_GAP_BINS];
+	/* Number of gaps in gap_hist, halved when window is full */
+	u32 samples;
+	/* Power-off delay (msec) currently picked for this ICE */
+	u32 delay_ms;
+	/* ICE was released and next reservation is not yet recorded */
+	bool gap_open;
+};
+
 struct cve_device {
 	/* device index */
 	u32 dev_index;
@@ -209,6 +224,8 @@ struct cve_device {
 	struct cve_dle_t poweroff_list;
 	/* Timestamp of when Power Off request was raised */
 	unsigned long poff_jiffy;
+	/* Idle gap history for predictive power-off */
+	struct ice_pm_stats pm;
 	/* Pointer to FIFO Descriptor of current Network */
 	struct fifo_descriptor *fifo_desc;
 	struct di_cve_dump_buffer *cve_dump_buf;
@@ -285,8 +302,15 @@ struct llc_pmon_config {
 	u64 pmon3_cfg;
 	/*LLC PMON disable flag */
 	bool disable_llc_pmon;
+	/* Last ICEBO hit/miss readings consumed by the LLC allocator */
+	u64 alloc_hit;
+	u64 alloc_miss;
 };
 
+/* PMON2/PMON3 events used to measure ICEBO LLC hit/miss */
+#define LLC_PMON_HIT_BO 0x17663B98
+#define LLC_PMON_MISS_BO 0x27663B98
+
 struct icebo_desc {
 	/* icebo id */
 	u8 bo_id;
@@ -351,6 +375,25 @@ struct clos_manager {
 	u64 clos_default[ICE_CLOS_MAX];
 	u64 pqr_default;
 	/* -------------- */
+	/* Sum of CLOS_1/CLOS_2 shares of all running Ntw */
+	u32 demand[ICE_CLOS_MAX];
+	/* Rebalances in a row that asked for a smaller partition */
+	u32 shrink_streak;
+};
+
+/* Per Ntw LLC share, adapted from measured ICEBO hit/miss */
+struct ice_llc_share {
+	/* Current share per CLOS, starts from the static request */
+	u32 ways[ICE_CLOS_MAX];
+	/* Share added to clos_manager demand while Ntw is running */
+	u32 charged[ICE_CLOS_MAX];
+	/* Miss ratio EWMA in permille */
+	u32 miss_ewma;
+	/* Number of valid samples folded into miss_ewma */
+	u32 samples;
+	/* Consecutive samples above/below the miss thresholds */
+	u8 grow_streak;
+	u8 shrink_streak;
 };
 #ifndef RING3_VALIDATION
 /*sph mailbox related structure*/
@@ -407,18 +450,16 @@ struct cve_device_group {
 	u32 dg_id;
 	/* expected device group size */
 	u32 expected_devices_nr;
-	/* hardware counter list */
-	struct cve_hw_cntr_descriptor *hw_cntr_list;
-	/* holds start address of hardware counter array */
-	struct cve_hw_cntr_descriptor *base_addr_hw_cntr;
-	/* number of counters in free pool */
-	u16 num_avl_cntr;
+	/* Bit N set => hardware counter N is in free pool */
+	u32 cntr_free_mask;
+	/* Network ID to which each hardware counter is attached */
+	u64 cntr_ntw_id[MAX_HW_COUNTER_NR];
 	/* number of non-reserved counters */
 	u16 num_nonres_cntr;
 	/* Pool to Context ID mapping */
 	u64 pool_context_map[MAX_IDC_POOL_NR];
-	/* number of pool in free pool */
-	u16 num_avl_pool;
+	/* Bit N set => pool N is in free pool */
+	u32 pool_free_mask;
 	/* number of non-reserved pool */
 	u16 num_nonres_pool;
 	/* List of ntw holding resources */
@@ -449,6 +490,11 @@ struct cve_device_group {
 	struct cve_device *poweroff_dev_list;
 	/* Lock for accessing poweroff_dev_list */
 	cve_os_lock_t poweroff_dev_list_lock;
+	/* When and for how long (msec) power-off thread went to sleep */
+	unsigned long poweroff_sleep_jiffy;
+	u32 poweroff_sleep_ms;
+	/* Smoothed ICE power-on latency (usec) */
+	u32 ice_wake_us;
 	/* CLOS book keeping */
 	struct clos_manager dg_clos_manager;
 #ifdef _DEBUG
@@ -518,19 +564,6 @@ struct cve_device_group {
 /* Holds all the relevant IDs required for maintaining a map between
  * graph counter ID and hardware counter ID
  */
-struct cve_hw_cntr_descriptor {
-	/* link to the other counter in the DG/Network */
-	struct cve_dle_t list;
-	/* Counter ID */
-	u16 hw_cntr_id;
-	/* Counter ID assigned by graph */
-	u16 graph_cntr_id;
-	/* network ID to which this Counter is attached */
-	u64 cntr_ntw_id;
-	/* Is Counter in free pool */
-	bool in_free_pool;
-};
-
 enum cve_workqueue_state {
 	WQ_STATE_ACTIVE,
 	WQ_STATE_STOPPED,
@@ -585,6 +618,8 @@ struct job_descriptor {
 	u8 graph_ice_id;
 	/* Hw ICE Id. Actual ICE allocated by Driver */
 	u8 hw_ice_id;
+	/* ICE on which this job last executed, used for warm placement */
+	u8 warm_ice_id;
 	/* contains mirror image of patch point for counters*/
 	/* TODO: Move it to Ntw level and do just like InferBuffer patching */
 	struct ice_pp_copy *job_cntr_pp_list;
@@ -742,6 +777,17 @@ struct execution_node {
 
 };
 
+/* Patch points of 'inf' that differ from those of 'base' */
+struct ice_inf_lookahead {
+	/* Infer for which the delta is valid, NULL if none */
+	struct ice_infer *inf;
+	/* Infer patched in CBs when the delta was computed */
+	struct ice_infer *base;
+	/* Indexes into inf_pp_arr, ntw_surf_pp_count entries */
+	u32 *pp_idx;
+	u32 pp_idx_nr;
+};
+
 /* hold information about a network */
 struct ice_network {
 	/* stores a reference to self, should always be first member */
@@ -793,6 +839,8 @@ struct ice_network {
 	/* CLOS requirements */
 	u32 clos[ICE_CLOS_MAX];
 	u32 cntr_bitmap;
+	/* Measured LLC share, see __llc_rebalance */
+	struct ice_llc_share llc;
 	/****/
 
 	/****************************************/
@@ -802,7 +850,8 @@ struct ice_network {
 	/* Indicates if this Network needs to reserve the resources */
 	bool res_resource;
 	struct cve_device *ice_list;
-	struct cve_hw_cntr_descriptor *cntr_list;
+	/* HW Counters of last mapping in cntr_id_map, kept for Lazy Capture */
+	u32 cntr_map_mask;
 	/****************************************/
 
 	/* To keep track of paired jobs */
@@ -887,8 +936,13 @@ struct ice_network {
 	/* Infer buffer patch points */
 	struct ice_pp_copy *ntw_surf_pp_list;
 	u32 ntw_surf_pp_count;
+	/* Infer whose patch point values are currently written in CBs */
+	struct ice_infer *patched_inf;
+	/* Patch delta of next queued Infer, computed while Ntw runs */
+	struct ice_inf_lookahead lookahead;
 
 	u64 ntw_icemask;
+	/* HW Counters currently owned by this Ntw */
 	u64 ntw_cntrmask;
 
 	/* ------------------------- */
@@ -933,6 +987,17 @@ struct ice_network {
 	u64 busy_start_time;
 };
 
+/* Stages of an inference through the driver, see ice_infer.lat_ts */
+enum ice_inf_lat_stage {
+	/* ExecuteInfer request added to scheduler queue */
+	ICE_INF_LAT_QUEUED,
+	/* Picked by scheduler and dispatched to ICEs */
+	ICE_INF_LAT_DISPATCH,
+	/* Last job completion handled */
+	ICE_INF_LAT_DONE,
+	ICE_INF_LAT_MAX
+};
+
 struct ice_infer {
 	/* Infer Id */
 	u64 infer_id;
@@ -975,6 +1040,10 @@ struct ice_infer {
 	u64 process_pid;
 	/* Scheduler's Inference node */
 	struct execution_node inf_sch_node;
+	/* trace_clock_local() of each stage of the current run, 0 if
+	 * not reached. Folded into sub network histograms on event.
+	 */
+	u64 lat_ts[ICE_INF_LAT_MAX];
 };
 
 /* hold information about user buffer allocation (surface or cb) */
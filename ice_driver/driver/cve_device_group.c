@@ -23,6 +23,21 @@
 #define LLC_PMON_HIT_ICE_0 0x17663B88
 #define LLC_PMON_HIT_ICE_1 0x17663B90
 
+/* ICE placement score weights, see __ice_placement_score */
+#define ICE_SCORE_WARM_JOB	8
+#define ICE_SCORE_WARM_NTW	4
+#define ICE_SCORE_POWERED	3
+#define ICE_SCORE_FOREIGN	2
+#define ICE_SCORE_SPLIT_PBO	3
+
+/* Predictive power-off, see __ice_pm_update_delay */
+#define ICE_PM_MIN_SAMPLES	4
+#define ICE_PM_HIST_WINDOW	64
+/* Idle-on time (msec) costing as much energy as one power cycle */
+#define ICE_PM_BREAKEVEN_MS	2
+/* Assumed power-on latency until one is measured */
+#define ICE_PM_DEFAULT_WAKE_US	500
+
 static struct cve_device_groups_config config_param_single_dg_all_dev =
 		DG_CONFIG_SINGLE_GROUP_ALL_DEVICES;
 
@@ -40,6 +55,11 @@ static struct ice_drv_config drv_config_param = {
 	.initial_iccp_config[0] = INITIAL_CDYN_VAL,
 	.initial_iccp_config[1] = RESET_CDYN_VAL,
 	.initial_iccp_config[2] = BLOCKED_CDYN_VAL,
+	.isr_poll_budget = 0,
+	.isr_coalesce_us = 0,
+	.ice_pm_latency_budget_us = 0,
+	.trace_ring_order = ICEDRV_TRING_DEFAULT_ORDER,
+	.ntw_create_workers = 0,
 };
 
 static struct cve_device_group *__get_ref_to_dg(void)
@@ -49,59 +69,28 @@ static struct cve_device_group *__get_ref_to_dg(void)
 
 static int cve_dg_add_hw_counter(struct cve_device_group *p)
 {
-	int retval = CVE_DEFAULT_ERROR_CODE;
 	uint16_t i;
-	size_t sz;
-	struct cve_hw_cntr_descriptor *hw_cntr_list;
-
-	sz = (sizeof(*hw_cntr_list) * NUM_COUNTER_REG);
-	retval = OS_ALLOC_ZERO(sz, (void **)&hw_cntr_list);
-	if (retval != 0) {
-		cve_os_log(CVE_LOGLEVEL_ERROR,
-			"cve_dg_add_hw_counter failed %d\n",
-			retval);
-		goto out;
-	}
-	for (i = 0; i < NUM_COUNTER_REG; i++) {
-		hw_cntr_list[i].hw_cntr_id = i;
-		hw_cntr_list[i].in_free_pool = true;
-		hw_cntr_list[i].cntr_ntw_id = INVALID_NETWORK_ID;
 
-		cve_dle_add_to_list_before(p->hw_cntr_list, list,
-			&hw_cntr_list[i]);
+	for (i = 0; i < NUM_COUNTER_REG; i++)
+		p->cntr_ntw_id[i] = INVALID_NETWORK_ID;
 
-		cve_os_log(CVE_LOGLEVEL_DEBUG,
-		"CntrHwID=%d added to the DeviceGroup=0x%lx. CounterIAVA=0x%lx\n",
-		hw_cntr_list[i].hw_cntr_id,
-		(uintptr_t)p, (uintptr_t)&hw_cntr_list[i]);
-	}
-	p->num_avl_cntr = NUM_COUNTER_REG;
+	p->cntr_free_mask = (u32)((1ULL << NUM_COUNTER_REG) - 1);
 	p->num_nonres_cntr = NUM_COUNTER_REG;
-	p->base_addr_hw_cntr = hw_cntr_list;
-	/* indicate success */
-	retval = 0;
 
-out:
-	return retval;
+	cve_os_log(CVE_LOGLEVEL_DEBUG,
+		"CountersNr:%d added to the DeviceGroup=0x%lx\n",
+		NUM_COUNTER_REG, (uintptr_t)p);
+
+	return 0;
 }
 
 static void cve_dg_remove_hw_counter(struct cve_device_group *p)
 {
-	struct cve_hw_cntr_descriptor *cntr = p->base_addr_hw_cntr;
-
-	while (p->hw_cntr_list) {
-		struct cve_hw_cntr_descriptor *cur_cntr = p->hw_cntr_list;
-
-		cve_dle_remove_from_list(p->hw_cntr_list, list, cur_cntr);
-	}
-
-	OS_FREE(cntr, sizeof(*cntr) * NUM_COUNTER_REG);
 	cve_os_log(CVE_LOGLEVEL_DEBUG,
 		"SUCCESS> DG:%p, CountersNr:%d removed from the DG\n",
-		p, p->num_avl_cntr);
+		p, __builtin_popcount(p->cntr_free_mask));
 
-	p->hw_cntr_list = NULL;
-	p->num_avl_cntr = 0;
+	p->cntr_free_mask = 0;
 	p->num_nonres_cntr = 0;
 }
 
@@ -215,6 +204,127 @@ static u32 __is_time_greater(const u64 t1, const u64 t2)
 		return 1;
 }
 
+static u32 __ice_pm_gap_bin(u32 gap_ms)
+{
+	u32 bin = 0;
+
+	/* bin 0 is < 1 msec, bin k is [2^(k-1), 2^k) msec */
+	while (gap_ms && (bin < (ICE_PM_GAP_BINS - 1))) {
+		gap_ms >>= 1;
+		bin++;
+	}
+
+	return bin;
+}
+
+static u32 __ice_pm_bin_gap(u32 bin)
+{
+	if (bin < 2)
+		return bin;
+
+	/* Mid point of the bucket */
+	return 3 << (bin - 2);
+}
+
+/* Pick the power-off delay that minimises expected energy over the
+ * recorded idle gaps, i.e. idle-on time plus ICE_PM_BREAKEVEN_MS for
+ * every power cycle, while keeping the average power-on latency paid by
+ * a reservation within ice_pm_latency_budget_us. Candidate delays are the
+ * bucket boundaries up to the configured ice_power_off_delay_ms.
+ */
+static void __ice_pm_update_delay(struct cve_device_group *dg,
+		struct cve_device *dev)
+{
+	struct ice_pm_stats *pm = &dev->pm;
+	u32 max_delay = (u32)ice_get_power_off_delay_param();
+	u64 budget = (u64)ice_get_pm_latency_budget_us() * pm->samples;
+	u64 stay_on = 0, best_cost = 0, woken, cost;
+	u32 c, k, delay, best = max_delay;
+	bool found = false;
+
+	for (c = 0; c < ICE_PM_GAP_BINS; c++) {
+		delay = c ? (1 << (c - 1)) : 0;
+		if (delay > max_delay)
+			break;
+
+		/* Gaps from bucket c onwards outlast the delay */
+		woken = 0;
+		for (k = c; k < ICE_PM_GAP_BINS; k++)
+			woken += pm->gap_hist[k];
+
+		cost = stay_on + (woken * (delay + ICE_PM_BREAKEVEN_MS));
+		if (((woken * dg->ice_wake_us) <= budget) &&
+			(!found || (cost <= best_cost))) {
+			best = delay;
+			best_cost = cost;
+			found = true;
+		}
+
+		stay_on += (u64)pm->gap_hist[c] * __ice_pm_bin_gap(c);
+	}
+
+	if (pm->delay_ms != best)
+		cve_os_dev_log(CVE_LOGLEVEL_DEBUG, dev->dev_index,
+			"Power-off delay %u -> %u msec\n", pm->delay_ms, best);
+
+	pm->delay_ms = best;
+	ice_swc_counter_set(dev->hswc,
+			ICEDRV_SWC_DEVICE_COUNTER_POWER_OFF_DELAY,
+			pm->delay_ms);
+}
+
+void ice_dg_pm_record_reserve(struct cve_device *dev)
+{
+	struct cve_device_group *dg = cve_dg_get();
+	struct ice_pm_stats *pm = &dev->pm;
+	u32 gap_ms, k;
+
+	if (dev->power_state == ICE_POWER_OFF)
+		ice_swc_counter_inc(dev->hswc,
+				ICEDRV_SWC_DEVICE_COUNTER_COLD_WAKEUPS);
+	else
+		ice_swc_counter_inc(dev->hswc,
+				ICEDRV_SWC_DEVICE_COUNTER_WARM_WAKEUPS);
+
+	if (!pm->gap_open)
+		return;
+
+	pm->gap_open = false;
+	gap_ms = jiffies_to_msecs(ice_os_get_current_jiffy() - dev->poff_jiffy);
+	pm->gap_hist[__ice_pm_gap_bin(gap_ms)]++;
+
+	if (++pm->samples >= ICE_PM_HIST_WINDOW) {
+		/* Age the history so that the delay follows the traffic */
+		pm->samples = 0;
+		for (k = 0; k < ICE_PM_GAP_BINS; k++) {
+			pm->gap_hist[k] >>= 1;
+			pm->samples += pm->gap_hist[k];
+		}
+	}
+
+	if (ice_get_pm_latency_budget_us() &&
+		(pm->samples >= ICE_PM_MIN_SAMPLES))
+		__ice_pm_update_delay(dg, dev);
+}
+
+void ice_dg_pm_record_power_on(u32 latency_us)
+{
+	struct cve_device_group *dg = cve_dg_get();
+
+	dg->ice_wake_us = ((3 * dg->ice_wake_us) + latency_us) / 4;
+}
+
+u32 ice_dg_pm_poweroff_delay(struct cve_device *dev)
+{
+	u32 max_delay = (u32)ice_get_power_off_delay_param();
+
+	if (!ice_get_pm_latency_budget_us() ||
+		(dev->pm.samples < ICE_PM_MIN_SAMPLES))
+		return max_delay;
+
+	return (dev->pm.delay_ms < max_delay) ? dev->pm.delay_ms : max_delay;
+}
+
 #ifdef RING3_VALIDATION
 static void *ice_pm_monitor_task(void *data)
 #else
@@ -223,11 +333,12 @@ static int ice_pm_monitor_task(void *data)
 {
 	int ret = 0, wq_status;
 	u32 icemask;
-	u32 configured_timeout_ms;
+	u32 configured_timeout_ms, elapsed_ms, delay_ms;
 	u32 time_60sec = 60000;
 	u32 timeout_msec = time_60sec;
 	unsigned long cur_jiffy;
-	struct cve_device *head;
+	struct cve_device *head, *dev, *next;
+	bool last;
 	struct cve_device_group *dg = (struct cve_device_group *)data;
 	const struct sphpb_callbacks *sphpb_cbs;
 	u64 t;
@@ -272,44 +383,62 @@ static int ice_pm_monitor_task(void *data)
 		cur_jiffy = ice_os_get_current_jiffy();
 
 		head = dg->poweroff_dev_list;
+		timeout_msec = time_60sec;
 		if (!head)
 			goto out_null_list;
 
 		icemask = 0;
 		t = trace_clock_local();
 
-		while (jiffies_to_msecs(cur_jiffy - head->poff_jiffy) >=
-				configured_timeout_ms) {
+		/* Every ICE has its own delay, so walk the whole list and
+		 * sleep until the earliest pending expiry
+		 */
+		dev = head;
+		do {
+			next = cve_dle_next(dev, poweroff_list);
+			last = (next == dg->poweroff_dev_list);
+
+			elapsed_ms = jiffies_to_msecs(cur_jiffy - dev->poff_jiffy);
+			delay_ms = ice_dg_pm_poweroff_delay(dev);
+			if (delay_ms > configured_timeout_ms)
+				delay_ms = configured_timeout_ms;
+
+			if (elapsed_ms < delay_ms) {
+				if ((delay_ms - elapsed_ms) < timeout_msec)
+					timeout_msec = delay_ms - elapsed_ms;
+				dev = next;
+				continue;
+			}
 
 			/* The ICEs can be in either ON or INITIATED state
 			 * because maybe power-off thread started after
 			 * executing some tests.
 			 */
-			ASSERT((head->power_state == ICE_POWER_OFF_INITIATED) ||
-				(head->power_state == ICE_POWER_ON));
+			ASSERT((dev->power_state == ICE_POWER_OFF_INITIATED) ||
+				(dev->power_state == ICE_POWER_ON));
 
-			icemask |= (1 << head->dev_index);
-			ice_dev_set_power_state(head, ICE_POWER_OFF);
-			ice_swc_counter_set(head->hswc,
+			icemask |= (1 << dev->dev_index);
+			ice_dev_set_power_state(dev, ICE_POWER_OFF);
+			ice_swc_counter_set(dev->hswc,
 					ICEDRV_SWC_DEVICE_COUNTER_POWER_STATE,
-					ice_dev_get_power_state(head));
+					ice_dev_get_power_state(dev));
 
-			if (!__is_time_greater(head->idle_start_time,
-						head->busy_start_time)) {
-				head->idle_start_time = t;
-				ice_swc_counter_set(head->hswc,
+			if (!__is_time_greater(dev->idle_start_time,
+						dev->busy_start_time)) {
+				dev->idle_start_time = t;
+				ice_swc_counter_set(dev->hswc,
 				ICEDRV_SWC_DEVICE_COUNTER_IDLE_START_TIME,
-				nsec_to_usec(head->idle_start_time));
+				nsec_to_usec(dev->idle_start_time));
 			}
 
 			sphpb_cbs = dg->sphpb.sphpb_cbs;
 			if (sphpb_cbs && sphpb_cbs->set_power_state) {
 				ret = sphpb_cbs->set_power_state(
-						head->dev_index, false);
+						dev->dev_index, false);
 				if (ret) {
 					cve_os_dev_log(
 						CVE_LOGLEVEL_ERROR,
-						head->dev_index,
+						dev->dev_index,
 						"failed setting OFF power state OFF with power balancer (%d)\n",
 						ret);
 				}
@@ -318,33 +447,25 @@ static int ice_pm_monitor_task(void *data)
 			cve_dle_remove_from_list(
 				dg->poweroff_dev_list,
 				poweroff_list,
-				head);
+				dev);
 
-			head = dg->poweroff_dev_list;
-			if (!head)
-				break;
-		}
+			dev = next;
+		} while (!last && dg->poweroff_dev_list);
 
 		if (icemask)
 			unset_idc_registers_multi(icemask, false);
 
+		head = dg->poweroff_dev_list;
+
 out_null_list:
 
 		dg->start_poweroff_thread = 0;
+		dg->poweroff_sleep_jiffy = cur_jiffy;
+		dg->poweroff_sleep_ms = timeout_msec;
 		cve_os_unlock(&dg->poweroff_dev_list_lock);
 
-		if (head) {
-			/* For how long (in msec) the head is in queue */
-			u32 time_spent = jiffies_to_msecs(cur_jiffy -
-							head->poff_jiffy);
-
-			timeout_msec = (configured_timeout_ms - time_spent);
-		} else {
-			timeout_msec = time_60sec;
-
-			if (terminate_thread(dg))
-				break;
-		}
+		if (!head && terminate_thread(dg))
+			break;
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
 			"Thread will wake up in %u msec\n", timeout_msec);
@@ -425,7 +546,7 @@ int ice_kmd_create_dg(void)
 #ifdef _DEBUG
 	device_group->dg_exe_order = 0;
 #endif
-	device_group->num_avl_pool = MAX_IDC_POOL_NR;
+	device_group->pool_free_mask = (1 << MAX_IDC_POOL_NR) - 1;
 	device_group->num_nonres_pool = MAX_IDC_POOL_NR;
 	device_group->ntw_with_resources = NULL;
 	device_group->num_running_ntw = 0;
@@ -439,8 +560,12 @@ int ice_kmd_create_dg(void)
 	device_group->poweroff_dev_list = NULL;
 
 	cve_os_lock_init(&device_group->poweroff_dev_list_lock);
+	device_group->ice_wake_us = ICE_PM_DEFAULT_WAKE_US;
 
 	device_group->dg_clos_manager.size = MAX_CLOS_SIZE_MB;
+	device_group->dg_clos_manager.demand[ICE_CLOS_1] = 0;
+	device_group->dg_clos_manager.demand[ICE_CLOS_2] = 0;
+	device_group->dg_clos_manager.shrink_streak = 0;
 	ice_os_read_clos((void *)&device_group->dg_clos_manager);
 
 	cve_os_log(CVE_LOGLEVEL_DEBUG,
@@ -529,6 +654,10 @@ int cve_dg_add_device(struct cve_device *cve_dev)
 				bo->iccp_init_done = false;
 				bo->llc_pmon_cfg.pmon0_cfg = LLC_PMON_HIT_ICE_0;
 				bo->llc_pmon_cfg.pmon1_cfg = LLC_PMON_HIT_ICE_1;
+				bo->llc_pmon_cfg.pmon2_cfg = LLC_PMON_HIT_BO;
+				bo->llc_pmon_cfg.pmon3_cfg = LLC_PMON_MISS_BO;
+				bo->llc_pmon_cfg.alloc_hit = 0;
+				bo->llc_pmon_cfg.alloc_miss = 0;
 				bo->in_pool_ice = ONE_ICE;
 				bo->non_res_ice = ONE_ICE;
 
@@ -735,10 +864,16 @@ void ice_set_driver_config_param(struct ice_drv_config *param)
 	drv_config_param.initial_iccp_config[0] = param->initial_iccp_config[0];
 	drv_config_param.initial_iccp_config[1] = param->initial_iccp_config[1];
 	drv_config_param.initial_iccp_config[2] = param->initial_iccp_config[2];
+	drv_config_param.isr_poll_budget = param->isr_poll_budget;
+	drv_config_param.isr_coalesce_us = param->isr_coalesce_us;
+	drv_config_param.ice_pm_latency_budget_us =
+			param->ice_pm_latency_budget_us;
+	drv_config_param.trace_ring_order = param->trace_ring_order;
+	drv_config_param.ntw_create_workers = param->ntw_create_workers;
 	ice_set_power_off_delay_param(param->ice_power_off_delay_ms);
 
 	cve_os_log(CVE_LOGLEVEL_INFO,
-			"DriverConfig: enable_llc_config_via_axi_reg:%d sph_soc:%d ice_power_off_delay_ms:%d, is_b_step_enabled: %d is_c_step_enabled: %d Preemption:%d is_iccp_throttling_enabled:%d initial_cdyn:0x%x reset_cdyn:0x%x blocked_cdyn:0x%x\n",
+			"DriverConfig: enable_llc_config_via_axi_reg:%d sph_soc:%d ice_power_off_delay_ms:%d, is_b_step_enabled: %d is_c_step_enabled: %d Preemption:%d is_iccp_throttling_enabled:%d initial_cdyn:0x%x reset_cdyn:0x%x blocked_cdyn:0x%x isr_poll_budget:%u isr_coalesce_us:%u ice_pm_latency_budget_us:%u trace_ring_order:%u ntw_create_workers:%u\n",
 			drv_config_param.enable_llc_config_via_axi_reg,
 			drv_config_param.sph_soc,
 			drv_config_param.ice_power_off_delay_ms,
@@ -748,7 +883,37 @@ void ice_set_driver_config_param(struct ice_drv_config *param)
 			drv_config_param.iccp_throttling,
 			drv_config_param.initial_iccp_config[0],
 			drv_config_param.initial_iccp_config[1],
-			drv_config_param.initial_iccp_config[2]);
+			drv_config_param.initial_iccp_config[2],
+			drv_config_param.isr_poll_budget,
+			drv_config_param.isr_coalesce_us,
+			drv_config_param.ice_pm_latency_budget_us,
+			drv_config_param.trace_ring_order,
+			drv_config_param.ntw_create_workers);
+}
+
+u32 ice_get_isr_poll_budget(void)
+{
+	return drv_config_param.isr_poll_budget;
+}
+
+u32 ice_get_isr_coalesce_us(void)
+{
+	return drv_config_param.isr_coalesce_us;
+}
+
+u32 ice_get_pm_latency_budget_us(void)
+{
+	return drv_config_param.ice_pm_latency_budget_us;
+}
+
+u32 ice_get_trace_ring_order(void)
+{
+	return drv_config_param.trace_ring_order;
+}
+
+u32 ice_get_ntw_create_workers(void)
+{
+	return drv_config_param.ntw_create_workers;
 }
 
 struct ice_drv_config *ice_get_driver_config_param(void)
@@ -897,7 +1062,7 @@ enum resource_status ice_dg_check_resource_availability(struct ice_network *ntw)
 	}
 
 	__local_builtin_popcount(ntw->cntr_bitmap, count);
-	if (count <= dg->num_avl_cntr)
+	if (count <= __builtin_popcount(dg->cntr_free_mask))
 		status = tmp_status;
 	else if (count <= dg->num_nonres_cntr)
 		status = RESOURCE_BUSY;
@@ -912,7 +1077,8 @@ out:
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
 			"NtwID=0x%lx. Ntw_Cntr=%d, DG_ipCntr=%d, DG_nrCntr=%d\n",
-			(uintptr_t)ntw, count, dg->num_avl_cntr,
+			(uintptr_t)ntw, count,
+			__builtin_popcount(dg->cntr_free_mask),
 			dg->num_nonres_cntr);
 	}
 
@@ -976,8 +1142,13 @@ void ice_dg_borrow_this_ice(struct ice_network *ntw,
 			ntw->network_id, dev->dev_index,
 			ice_dev_get_power_state(dev));
 
-	if (!lazy)
+	ice_dg_pm_record_reserve(dev);
+
+	if (!lazy) {
 		cve_di_set_device_reset_flag(dev, CVE_DI_RESET_DUE_NTW_SWITCH);
+		ice_swc_counter_inc(ntw->hswc,
+				ICEDRV_SWC_SUB_NETWORK_NTW_SWITCH_RESETS);
+	}
 
 	cve_dle_add_to_list_before(ntw->ice_list, owner_list, dev);
 	dev->in_free_pool = false;
@@ -1024,48 +1195,145 @@ void ice_dg_borrow_this_ice(struct ice_network *ntw,
 	bo->in_pool_ice--;
 }
 
+/*
+ * Placement score of an ICE for a job. Highest goes to the ICE on which
+ * the job last ran for this network, as it can be captured without a
+ * reset. ICEs holding warm state of another network are avoided so that
+ * networks can be steered back to their own warm ICEs.
+ */
+static int __ice_placement_score(struct ice_network *ntw,
+	struct cve_device *dev, struct job_descriptor *job)
+{
+	int score = 0;
+
+	if (dev->power_state != ICE_POWER_OFF)
+		score += ICE_SCORE_POWERED;
+
+	if (dev->dev_ntw_id == ntw->network_id) {
+		score += ICE_SCORE_WARM_NTW;
+		if (job->warm_ice_id == dev->dev_index)
+			score += ICE_SCORE_WARM_JOB;
+	} else if (dev->dev_ntw_id != INVALID_NETWORK_ID) {
+		score -= ICE_SCORE_FOREIGN;
+	}
+
+	return score;
+}
+
+/* Borrow ICE for job, skipping ICE reset if job's warm state is intact */
+static void __borrow_ice_for_job(struct ice_network *ntw,
+	struct cve_device *dev, struct job_descriptor *job)
+{
+	bool warm = (job->warm_ice_id == dev->dev_index) &&
+			(dev->dev_ntw_id == ntw->network_id) &&
+			(dev->power_state != ICE_POWER_OFF);
+
+	ice_dg_borrow_this_ice(ntw, dev, warm);
+	job->hw_ice_id = dev->dev_index;
+
+	if (warm)
+		ice_swc_counter_inc(ntw->hswc,
+				ICEDRV_SWC_SUB_NETWORK_AVOIDED_RESETS);
+}
+
 void ice_dg_borrow_next_pbo(struct ice_network *ntw,
 	struct job_descriptor *job_0,
 	struct job_descriptor *job_1)
 {
 	struct cve_device_group *dg = cve_dg_get();
-	struct icebo_desc *bo = dg->dev_info.picebo_list;
-	struct cve_device *dev;
+	struct icebo_desc *bo_head = dg->dev_info.picebo_list;
+	struct icebo_desc *bo = bo_head, *best_bo = NULL;
+	struct cve_device *dev_0, *dev_1;
+	int score, cross_score, best_score = 0;
+	bool cross, best_cross = false;
+
+	ASSERT(bo_head);
+
+	/* pick the pBO (and ICE order within it) best matching warm state */
+	do {
+		dev_0 = bo->dev_list;
+		dev_1 = cve_dle_next(dev_0, bo_list);
+
+		score = __ice_placement_score(ntw, dev_0, job_0) +
+			__ice_placement_score(ntw, dev_1, job_1);
+		cross_score = __ice_placement_score(ntw, dev_1, job_0) +
+			__ice_placement_score(ntw, dev_0, job_1);
+
+		cross = (cross_score > score);
+		if (cross)
+			score = cross_score;
+
+		if (!best_bo || score > best_score) {
+			best_score = score;
+			best_cross = cross;
+			best_bo = bo;
+		}
+
+		bo = cve_dle_next(bo, owner_list);
+	} while (bo != bo_head);
 
-	/* add first device of BOn to ntw ice list */
-	dev = bo->dev_list;
-	ice_dg_borrow_this_ice(ntw, dev, false);
-	job_0->hw_ice_id = dev->dev_index;
+	dev_0 = best_bo->dev_list;
+	dev_1 = cve_dle_next(dev_0, bo_list);
+	if (best_cross) {
+		dev_1 = dev_0;
+		dev_0 = cve_dle_next(dev_1, bo_list);
+	}
 
-	dev = cve_dle_next(dev, bo_list);
-	ice_dg_borrow_this_ice(ntw, dev, false);
-	job_1->hw_ice_id = dev->dev_index;
+	__borrow_ice_for_job(ntw, dev_0, job_0);
+	__borrow_ice_for_job(ntw, dev_1, job_1);
 }
 
 void ice_dg_borrow_next_dice(struct ice_network *ntw,
-	struct job_descriptor *job_0)
+	struct job_descriptor *job_0, u32 pbo_left)
 {
 	struct cve_device_group *dg = cve_dg_get();
-	struct icebo_desc *bo;
-	struct cve_device *dev;
-
-	if (dg->dev_info.dicebo_list) {
-		bo = dg->dev_info.dicebo_list;
+	struct icebo_desc *bo, *bo_head;
+	struct cve_device *dev, *best_dev = NULL;
+	int score, best_score = 0;
+
+	/* ICEBOs with single free ICE first, it causes no fragmentation */
+	bo_head = dg->dev_info.dicebo_list;
+	bo = bo_head;
+	while (bo) {
 		dev = bo->dev_list;
-
 		if (!dev->in_free_pool)
 			dev = cve_dle_next(dev, bo_list);
 
-	} else {
-		bo = dg->dev_info.picebo_list;
-		ASSERT(bo);
-		dev = bo->dev_list;
+		score = __ice_placement_score(ntw, dev, job_0);
+		if (!best_dev || score > best_score) {
+			best_score = score;
+			best_dev = dev;
+		}
+
+		bo = cve_dle_next(bo, owner_list);
+		if (bo == bo_head)
+			break;
+	}
 
+	/* Split a pBO only if it is spare or nothing else is available */
+	if (dg->in_pool_pbo > pbo_left || !best_dev) {
+		bo_head = dg->dev_info.picebo_list;
+		bo = bo_head;
+		while (bo) {
+			dev = bo->dev_list;
+			do {
+				score = __ice_placement_score(ntw, dev, job_0) -
+					ICE_SCORE_SPLIT_PBO;
+				if (!best_dev || score > best_score) {
+					best_score = score;
+					best_dev = dev;
+				}
+				dev = cve_dle_next(dev, bo_list);
+			} while (dev != bo->dev_list);
+
+			bo = cve_dle_next(bo, owner_list);
+			if (bo == bo_head)
+				break;
+		}
 	}
 
-	ASSERT(dev);
-	ice_dg_borrow_this_ice(ntw, dev, false);
-	job_0->hw_ice_id = dev->dev_index;
+	ASSERT(best_dev);
+	__borrow_ice_for_job(ntw, best_dev, job_0);
 }
 
 void ice_dg_reserve_this_ice(struct cve_device *dev)
@@ -9,6 +9,7 @@
 #define CVE_DEVICE_GROUP_H_
 
 #include "cve_device.h"
+#include "icedrv_trace_ring.h"
 
 /* Parameters used to convert the timespec values: */
 #define NSEC_PER_USEC	1000L
@@ -37,6 +38,11 @@ struct ice_drv_config {
 	u8 ice_sch_preemption;
 	u8 iccp_throttling;
 	u32 initial_iccp_config[3];
+	u32 isr_poll_budget;
+	u32 isr_coalesce_us;
+	u32 ice_pm_latency_budget_us;
+	u32 trace_ring_order;
+	u32 ntw_create_workers;
 };
 
 /*
@@ -174,6 +180,30 @@ u32 ice_get_reset_cdyn_val(void);
 /*retrive blocked cdyn requested value */
 u32 ice_get_blocked_cdyn_val(void);
 
+/* max number of polls done by ISR BH before re-enabling interrupts */
+u32 ice_get_isr_poll_budget(void);
+
+/* delay in usec between polls of ISR BH */
+u32 ice_get_isr_coalesce_us(void);
+
+/* avg power-on latency per reservation allowed by predictive power-off */
+u32 ice_get_pm_latency_budget_us(void);
+
+/* log2 of records per CPU in binary trace ring, 0 if disabled */
+u32 ice_get_trace_ring_order(void);
+
+/* max threads mapping buffers of one network, 0 if one per online CPU */
+u32 ice_get_ntw_create_workers(void);
+
+/* account ICE idle gap on reservation and pick its power-off delay */
+void ice_dg_pm_record_reserve(struct cve_device *dev);
+
+/* account measured ICE power-on latency */
+void ice_dg_pm_record_power_on(u32 latency_us);
+
+/* power-off delay (msec) to use for this ICE */
+u32 ice_dg_pm_poweroff_delay(struct cve_device *dev);
+
 enum resource_status ice_dg_check_resource_availability(
 		struct ice_network *ntw);
 bool ice_dg_can_lazy_capture_ice(struct ice_network *ntw);
@@ -183,7 +213,7 @@ void ice_dg_borrow_next_pbo(struct ice_network *ntw,
 	struct job_descriptor *job_0,
 	struct job_descriptor *job_1);
 void ice_dg_borrow_next_dice(struct ice_network *ntw,
-	struct job_descriptor *job_0);
+	struct job_descriptor *job_0, u32 pbo_left);
 void ice_dg_reserve_this_ice(struct cve_device *dev);
 void ice_dg_release_this_ice(struct cve_device *dev);
 void ice_dg_return_this_ice(struct ice_network *ntw,
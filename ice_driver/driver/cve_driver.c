@@ -92,6 +92,8 @@ int cve_driver_init(void)
 	}
 #endif
 
+	/* Optional, driver continues without it */
+	icedrv_tring_init();
 
 	return 0;
 
@@ -121,6 +123,8 @@ void cve_driver_cleanup(void)
 
 	ice_di_deactivate_driver();
 
+	icedrv_tring_cleanup();
+
 	cve_di_cleanup();
 
 	cve_debug_destroy();
@@ -517,7 +517,8 @@ static void dispatch_next_subjobs(struct di_job *job,
 			ret = sphpb_cbs->request_ice_dvfs_values(dev->dev_index,
 					job->ddr_bw,
 					job->ring_to_ice_ratio,
-					job->ice_to_ice_ratio);
+					job->ice_to_ice_ratio,
+					ntw->network_id);
 			if (ret) {
 				cve_os_dev_log(CVE_LOGLEVEL_ERROR,
 					dev->dev_index,
@@ -622,6 +623,12 @@ static void dispatch_next_subjobs(struct di_job *job,
 		(nsec_to_usec(dev->busy_start_time)));
 	ice_swc_counter_add(dev->hswc, ICEDRV_SWC_DEVICE_COUNTER_IDLE_TIME,
 		nsec_to_usec(dev->busy_start_time - dev->idle_start_time));
+	/* Gap the dispatch path adds between back to back inferences */
+	if (!is_cold_run)
+		ice_swc_counter_set(dev->hswc,
+			ICEDRV_SWC_DEVICE_COUNTER_JOB_IDLE_GAP,
+			nsec_to_usec(dev->busy_start_time -
+				dev->idle_start_time));
 	cve_os_log(CVE_LOGLEVEL_DEBUG,
 		"busy_start_time(usec)=%llu\n",
 		nsec_to_usec(dev->busy_start_time));
@@ -635,6 +642,9 @@ static void dispatch_next_subjobs(struct di_job *job,
 				ntw->curr_exe->swc_node.sw_id,
 				(void *)job->ds_hjob,
 				SPH_TRACE_OP_STATUS_EXEC_TYPE, is_cold_run));
+	icedrv_tring_log(ICEDRV_TRING_JOB_DOORBELL, SPH_TRACE_OP_STATE_DB,
+		dev->dev_index, is_cold_run, ntw->network_id,
+		ntw->curr_exe->swc_node.sw_id);
 
 }
 
@@ -761,6 +771,7 @@ int set_idc_registers(struct ice_network *ntw, uint8_t lock)
 	bool all_on = true;
 	uint64_t mask = 0;
 	u64 t;
+	u32 wake_us;
 
 	if (lock) {
 		ret = cve_os_lock(&dg->poweroff_dev_list_lock,
@@ -842,6 +853,7 @@ int set_idc_registers(struct ice_network *ntw, uint8_t lock)
 
 	value |= mask;
 
+	t = trace_clock_local();
 	cve_os_write_idc_mmio(dev,
 		cfg_default.bar0_mem_icepe_offset, value);
 
@@ -876,6 +888,8 @@ int set_idc_registers(struct ice_network *ntw, uint8_t lock)
 
 	ice_pe_val = value;
 	sphpb_cbs = dg->sphpb.sphpb_cbs;
+	wake_us = (u32)nsec_to_usec(trace_clock_local() - t);
+	ice_dg_pm_record_power_on(wake_us);
 	t = trace_clock_local();
 
 	do {
@@ -889,6 +903,12 @@ int set_idc_registers(struct ice_network *ntw, uint8_t lock)
 			ice_swc_counter_set(dev->hswc,
 				ICEDRV_SWC_DEVICE_COUNTER_IDLE_START_TIME,
 				nsec_to_usec(dev->idle_start_time));
+			ice_swc_counter_set(dev->hswc,
+				ICEDRV_SWC_DEVICE_COUNTER_POWER_ON_LATENCY,
+				wake_us);
+			icedrv_tring_log(ICEDRV_TRING_POWER_ON,
+				SPH_TRACE_OP_STATE_PO, dev->dev_index, wake_us,
+				ntw->network_id, 0);
 
 			if (sphpb_cbs && sphpb_cbs->set_power_state) {
 				ret = sphpb_cbs->set_power_state(dev->dev_index,
@@ -1405,26 +1425,29 @@ static struct ice_network *__get_ntw_of_overflowed_cntr(int cntr_id,
 
 	/* Check overflow bit of all the counters with which a valid NTW ID
 	 * is associated.
-	 * base_addr_hw_cntr holds the base address of HW CNTR array and can be
-	 * used to get the network ID to which a given counter belongs.
+	 * cntr_ntw_id holds the network ID to which a given counter belongs.
 	 */
-	if (dg->base_addr_hw_cntr[cntr_id].cntr_ntw_id != INVALID_NETWORK_ID) {
+	if (dg->cntr_ntw_id[cntr_id] != INVALID_NETWORK_ID) {
 		evct_prot_reg.val = cve_os_read_idc_mmio(dev->cve_dev, reg);
 		if ((evct_prot_reg.field.OVF) ||
 			ice_os_get_user_idc_intst()) {
 			/* Shouldn't we clead OVF by writing 1? */
 			cve_os_log_default(CVE_LOGLEVEL_ERROR,
 			"Error: NtwID:0x%llx Counter:%x overflow\n",
-			dg->base_addr_hw_cntr[cntr_id].cntr_ntw_id, cntr_id);
-			ntw = (struct ice_network *)
-				dg->base_addr_hw_cntr[cntr_id].cntr_ntw_id;
+			dg->cntr_ntw_id[cntr_id], cntr_id);
+			ntw = (struct ice_network *)dg->cntr_ntw_id[cntr_id];
 		}
 	}
 
 	return ntw;
 }
 
-int cve_di_interrupt_handler(struct idc_device *idc_dev)
+/*
+ * Read and ack IDC/ICE interrupt status into the BH status queue.
+ * Called from the ISR, or from the BH when polling for completions
+ * (polled is true) with ICE done interrupts masked.
+ */
+static int __fill_isr_q(struct idc_device *idc_dev, bool polled)
 {
 	int index;
 	int need_dpc = 0;
@@ -1490,8 +1513,10 @@ int cve_di_interrupt_handler(struct idc_device *idc_dev)
 			cfg_default.bar0_mem_iceintst_offset,
 			(status64 & 0x0000FFF00000FFF0));
 
-	/* Spurious Interrupt */
+	/* Spurious Interrupt, or nothing found while polling */
 	if (!isr_status_node->ice_status && !need_dpc) {
+		if (polled)
+			goto exit;
 		cve_os_log_default(CVE_LOGLEVEL_ERROR,
 				"Spurious ISR IsrQNode[%d] IDC Status:0x%llx ICE Status=0x%llx\n",
 				head,
@@ -1523,6 +1548,10 @@ int cve_di_interrupt_handler(struct idc_device *idc_dev)
 			nsec_to_usec(cve_dev->idle_start_time -
 			cve_dev->busy_start_time));
 
+		if (!polled)
+			ice_swc_counter_inc(cve_dev->hswc,
+				ICEDRV_SWC_DEVICE_COUNTER_INTERRUPTS);
+
 		project_hook_interrupt_handler_entry(cve_dev);
 
 		status_32 = cve_os_read_mmio_32(cve_dev,
@@ -1533,6 +1562,8 @@ int cve_di_interrupt_handler(struct idc_device *idc_dev)
 			index,
 			"Received interrupt from IDC. Status=0x%x\n",
 			status_32);
+		icedrv_tring_log(ICEDRV_TRING_TOP_HALF, SPH_TRACE_OP_STATE_START,
+			index, status_32, cve_dev->dev_ntw_id, 0);
 
 		need_dpc |= (status_32 != 0);
 		isr_status_node->valid = need_dpc;
@@ -1555,6 +1586,65 @@ exit:
 	return need_dpc;
 }
 
+int cve_di_interrupt_handler(struct idc_device *idc_dev)
+{
+	int need_dpc;
+
+#ifndef RING3_VALIDATION
+	spin_lock(&idc_dev->isr_lock);
+#endif
+	need_dpc = __fill_isr_q(idc_dev, false);
+#ifndef RING3_VALIDATION
+	spin_unlock(&idc_dev->isr_lock);
+#endif
+
+	return need_dpc;
+}
+
+/* Check for ICE completions without waiting for an interrupt */
+static int __poll_isr_status(struct idc_device *dev)
+{
+	int need_dpc;
+#ifdef RING3_VALIDATION
+	/* in ring3 the ISR runs under the driver biglock */
+	cve_os_lock(&g_cve_driver_biglock, CVE_NON_INTERRUPTIBLE);
+	need_dpc = __fill_isr_q(dev, true);
+	cve_os_unlock(&g_cve_driver_biglock);
+#else
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->isr_lock, flags);
+	need_dpc = __fill_isr_q(dev, true);
+	spin_unlock_irqrestore(&dev->isr_lock, flags);
+#endif
+
+	return need_dpc;
+}
+
+/*
+ * ICEINTEN holds the ICE normal (done) interrupt enable bits in the
+ * lower half and the error interrupt enable bits in the upper half,
+ * both following the power enabled ICE mask. Only the done half is
+ * toggled so that errors are still reported by interrupt while polling.
+ */
+static void __set_ice_done_intr(struct idc_device *dev, bool enable)
+{
+	struct cve_device_group *dg = cve_dg_get();
+	u64 val64;
+
+	cve_os_lock(&dg->poweroff_dev_list_lock, CVE_NON_INTERRUPTIBLE);
+
+	val64 = idc_mmio_read64(dev->cve_dev,
+			cfg_default.bar0_mem_iceinten_offset);
+	val64 &= 0xFFFFFFFF00000000ULL;
+	if (enable)
+		val64 |= (val64 >> 32);
+	idc_mmio_write64(dev->cve_dev,
+			cfg_default.bar0_mem_iceinten_offset, val64);
+
+	cve_os_unlock(&dg->poweroff_dev_list_lock);
+}
+
 /** Empty the Q and read all node updated by ISR */
 static inline void __read_isr_q(struct idc_device *dev,
 		u64 *idc_status, u64 *ice_status, u32 *q_tail)
@@ -1611,9 +1701,11 @@ static inline void __read_isr_q(struct idc_device *dev,
 	*q_tail = tail;
 }
 
-void cve_di_interrupt_handler_deferred_proc(struct idc_device *dev)
+/* Handle all queued ISR status, returns number of completed jobs */
+static u32 __handle_isr_q(struct idc_device *dev)
 {
 	int index, i;
+	u32 completions = 0;
 	u32 status;
 	u32 status_lo = 0, status_hi = 0, status_hl = 0, ice_err = 0;
 	union icedc_intr_status_t idc_err_status;
@@ -1640,7 +1732,7 @@ void cve_di_interrupt_handler_deferred_proc(struct idc_device *dev)
 		cve_os_log_default(CVE_LOGLEVEL_ERROR,
 			"Received Illegal Interrupt [BH]\n");
 		cve_os_unlock(&g_cve_driver_biglock);
-		return;
+		return 0;
 	}
 
 	dg = cve_dg_get();
@@ -1967,6 +2059,13 @@ handle_interrupt_check_completion:
 
 		project_hook_interrupt_dpc_handler_exit(cve_dev, status);
 
+		completions++;
+		ice_swc_counter_inc(cve_dev->hswc,
+			ICEDRV_SWC_DEVICE_COUNTER_COMPLETIONS);
+		icedrv_tring_log(ICEDRV_TRING_BOTTOM_HALF,
+			SPH_TRACE_OP_STATE_BH, cve_dev->dev_index, job_status,
+			cve_dev->dev_ntw_id, 0);
+
 		/* notify the dispatcher */
 		cve_ds_handle_job_completion(cve_dev,
 				job->ds_hjob,
@@ -1985,6 +2084,39 @@ end:
 				SPH_TRACE_OP_STATUS_Q_TAIL, tail));
 
 	cve_os_unlock(&g_cve_driver_biglock);
+
+	return completions;
+}
+
+void cve_di_interrupt_handler_deferred_proc(struct idc_device *dev)
+{
+	u32 budget = ice_get_isr_poll_budget();
+	u32 coalesce_us = ice_get_isr_coalesce_us();
+
+	if (!__handle_isr_q(dev) || !budget)
+		return;
+
+	/*
+	 * Completions are flowing, keep ICE done interrupts masked and
+	 * poll ICEINTST until idle or budget is consumed.
+	 */
+	__set_ice_done_intr(dev, false);
+
+	while (budget--) {
+		if (coalesce_us)
+			usleep_range(coalesce_us, coalesce_us + (coalesce_us >> 2));
+
+		if (!__poll_isr_status(dev))
+			break;
+
+		__handle_isr_q(dev);
+	}
+
+	__set_ice_done_intr(dev, true);
+
+	/* pick up completions which raced with re-enabling interrupts */
+	if (__poll_isr_status(dev))
+		__handle_isr_q(dev);
 }
 
 void cve_di_dispatch_job(struct cve_device *cve_dev,
@@ -40,6 +40,11 @@
 #include "ice_trace.h"
 #include "icedrv_internal_sw_counter_funcs.h"
 #include "ice_safe_func.h"
+#ifndef RING3_VALIDATION
+#include "intel_sphpb.h"
+#else
+#include "dummy_intel_sphpb.h"
+#endif
 
 
 /* max number of Shared_Read requests from the leader, that */
@@ -109,7 +114,10 @@ static void __ntw_release_ice(struct ice_network *ntw);
 static int __ntw_reserve_cntr(struct ice_network *ntw);
 static void __ntw_release_cntr(struct ice_network *ntw);
 static void __ntw_reset_cntr(struct ice_network *ntw);
-static int __ntw_reserve_clos(struct ice_network *ntw);
+static void __ntw_charge_llc(struct ice_network *ntw);
+static void __ntw_uncharge_llc(struct ice_network *ntw);
+static void __ntw_sample_llc(struct ice_network *ntw);
+static void __llc_rebalance(struct cve_device_group *dg);
 static void __flush_ntw_buffers(struct ice_network *ntw);
 static void __flush_inf_buffers(struct ice_infer *inf);
 static void __destroy_infer_desc(struct ice_infer *inf);
@@ -680,7 +688,7 @@ enum pool_status cve_ds_map_pool_context(struct ds_context *context)
 		pstatus = POOL_EXIST;
 		goto end;
 
-	} else if (dg->num_avl_pool == 0) {
+	} else if (dg->pool_free_mask == 0) {
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
 			"Insufficient Pool for Context=%llu\n",
@@ -690,23 +698,20 @@ enum pool_status cve_ds_map_pool_context(struct ds_context *context)
 		goto end;
 	}
 
-	for (i = 0; i < NUM_POOL_REG; i++) {
-		if (pool_context_map[i] == INVALID_CONTEXT_ID) {
-			pool_context_map[i] = context_id;
-			context->pool_id = i;
+	/* Lowest free Pool */
+	i = __builtin_ctz(dg->pool_free_mask);
+	ASSERT(i < NUM_POOL_REG);
+	ASSERT(pool_context_map[i] == INVALID_CONTEXT_ID);
 
-			cve_os_log(CVE_LOGLEVEL_DEBUG,
-				"Reserved Pool=%u for CtxID=%llu\n",
-				i, context_id);
+	dg->pool_free_mask &= ~(1 << i);
+	pool_context_map[i] = context_id;
+	context->pool_id = i;
 
-			pstatus = POOL_ALLOCATED;
-			dg->num_avl_pool--;
-			goto end;
-		}
-	}
+	cve_os_log(CVE_LOGLEVEL_DEBUG,
+		"Reserved Pool=%u for CtxID=%llu\n",
+		i, context_id);
 
-	pstatus = POOL_EXHAUSTED;
-	ASSERT(false);
+	pstatus = POOL_ALLOCATED;
 
 end:
 	return pstatus;
@@ -720,7 +725,7 @@ void cve_ds_unmap_pool_context(struct ds_context *context)
 
 	pool_context_map[pool_id] = INVALID_CONTEXT_ID;
 	context->pool_id = INVALID_POOL_ID;
-	dg->num_avl_pool++;
+	dg->pool_free_mask |= (1 << pool_id);
 
 	cve_os_log(CVE_LOGLEVEL_INFO,
 		"Released pool %u from Context=%llx\n",
@@ -1087,6 +1092,75 @@ int config_ds_trace_node_sysfs(struct cve_device *dev, struct ice_network *ntw,
 	return retval;
 }
 
+/* CBs are shared by all Infer of a Ntw and cannot be touched while ICEs
+ * execute them. What can be done ahead of time is finding which patch
+ * points of the next queued Infer differ from the Infer already patched
+ * in CBs, so that dispatch only writes those.
+ */
+void ice_ds_prepare_next_inf(struct ice_network *ntw)
+{
+	u32 i;
+	struct ice_inf_lookahead *la = &ntw->lookahead;
+	struct ice_infer *next, *base = ntw->patched_inf;
+	struct ice_pp_value *cur, *old;
+
+	la->inf = NULL;
+
+	if (!la->pp_idx || !base || !base->inf_pp_arr)
+		return;
+
+	next = ice_lsch_peek_next_inf(ntw);
+	if (!next || !next->inf_pp_arr)
+		return;
+
+	la->pp_idx_nr = 0;
+	for (i = 0; i < ntw->ntw_surf_pp_count; i++) {
+		cur = &next->inf_pp_arr[i];
+		old = &base->inf_pp_arr[i];
+
+		if (!cur->ntw_buf)
+			continue;
+
+		if (cur->pp_address == old->pp_address &&
+			cur->pp_value == old->pp_value)
+			continue;
+
+		la->pp_idx[la->pp_idx_nr++] = i;
+	}
+
+	la->inf = next;
+	la->base = base;
+}
+
+static int __ntw_patch_inf(struct ice_network *ntw, struct ice_infer *inf)
+{
+	int ret;
+	u32 nr = ntw->ntw_surf_pp_count;
+	struct ice_inf_lookahead *la = &ntw->lookahead;
+
+	if (la->inf == inf && la->base == ntw->patched_inf) {
+		nr = la->pp_idx_nr;
+		ret = ice_mm_patch_inf_pp_list(inf, la->pp_idx, nr);
+		ice_swc_counter_inc(ntw->hswc,
+			ICEDRV_SWC_SUB_NETWORK_LOOKAHEAD_HITS);
+	} else if (inf == ntw->patched_inf) {
+		/* CBs already hold this Infer's values */
+		nr = 0;
+		ret = 0;
+	} else {
+		ret = ice_mm_patch_inf_pp_arr(inf);
+	}
+
+	la->inf = NULL;
+	/* On failure, CBs may be partially patched */
+	ntw->patched_inf = (ret < 0) ? NULL : inf;
+	if (ret == 0)
+		ice_swc_counter_add(ntw->hswc,
+			ICEDRV_SWC_SUB_NETWORK_PP_PATCHED, nr);
+
+	return ret;
+}
+
 int ice_ds_dispatch_jg(struct jobgroup_descriptor *jobgroup)
 {
 	u32 i, ice_mask = 0;
@@ -1106,41 +1180,28 @@ int ice_ds_dispatch_jg(struct jobgroup_descriptor *jobgroup)
 		ntw->swc_node.sw_id, ntw->network_id,
 		ntw->curr_exe->swc_node.sw_id,
 		SPH_TRACE_OP_STATUS_ICE, ntw->ntw_icemask));
+	icedrv_tring_log(ICEDRV_TRING_INF_DISPATCH, SPH_TRACE_OP_STATE_START,
+		ICEDRV_TRING_NO_ICE, (u32)ntw->ntw_icemask, ntw->network_id,
+		ntw->curr_exe->swc_node.sw_id);
+	ntw->curr_exe->lat_ts[ICE_INF_LAT_DISPATCH] = trace_clock_local();
 
 	ice_swc_counter_inc(ntw->hswc,
 			ICEDRV_SWC_SUB_NETWORK_COUNTER_INF_SCHEDULED);
 
 	/* Patch InferBuffer */
-	retval = ice_mm_patch_inf_pp_arr(ntw->curr_exe);
+	retval = __ntw_patch_inf(ntw, ntw->curr_exe);
 	if (retval < 0) {
 		cve_os_log(CVE_LOGLEVEL_ERROR,
-			"ice_mm_patch_inf_pp_arr failed %d\n", retval);
+			"__ntw_patch_inf failed %d\n", retval);
 		goto exit;
 	}
 
 	dg->num_running_ntw++;
 	ntw->wq->num_ntw_running++;
 
-	if ((dg->num_running_ntw == 1)
-		&& (dg->clos_state != CLOS_STATE_SINGLE_NTW)) {
-		/* If this is the only Ntw running then respect the
-		 * CLOS requirement
-		 */
-
-		cve_os_log(CVE_LOGLEVEL_INFO,
-			"Allocate CLOS for NtwId=0x%lx\n", (uintptr_t)ntw);
-		__ntw_reserve_clos(ntw);
-		ice_os_set_clos((void *)&dg->dg_clos_manager);
-		dg->clos_state = CLOS_STATE_SINGLE_NTW;
-
-	} else if ((dg->num_running_ntw == 2)
-		&& (dg->clos_state != CLOS_STATE_MULTI_NTW)) {
-		cve_os_log(CVE_LOGLEVEL_INFO,
-			"Reset CLOS\n");
-		/* Reset CLOS MSR registers */
-		ice_os_reset_clos((void *)&dg->dg_clos_manager);
-		dg->clos_state = CLOS_STATE_MULTI_NTW;
-	}
+	/* Size CLOS_1/CLOS_2 for every Ntw running from now on */
+	__ntw_charge_llc(ntw);
+	__llc_rebalance(dg);
 
 	retval = set_idc_registers(ntw, true);
 	if (retval < 0) {
@@ -1337,6 +1398,47 @@ static void __reset_network_state(struct ice_network *ntw)
 	ntw->jg_list->aborted_jobs_nr = 0;
 }
 
+static void __lat_hist_add(struct ice_network *ntw, u32 hist,
+	u64 start, u64 end)
+{
+	if (!start || !end)
+		return;
+
+	ice_swc_counter_inc(ntw->hswc,
+		hist + ice_swc_lat_bucket(nsec_to_usec(end - start)));
+}
+
+/* Fold latency record of this run into the sub network histograms */
+static void __inf_record_latency(struct ice_network *ntw,
+	struct ice_infer *inf)
+{
+	u64 now = trace_clock_local();
+	u64 *ts = inf->lat_ts;
+
+	__lat_hist_add(ntw, ICEDRV_SWC_SUB_NETWORK_LAT_QUEUE_HIST,
+		ts[ICE_INF_LAT_QUEUED], ts[ICE_INF_LAT_DISPATCH]);
+	__lat_hist_add(ntw, ICEDRV_SWC_SUB_NETWORK_LAT_EXEC_HIST,
+		ts[ICE_INF_LAT_DISPATCH], ts[ICE_INF_LAT_DONE]);
+	__lat_hist_add(ntw, ICEDRV_SWC_SUB_NETWORK_LAT_EVENT_HIST,
+		ts[ICE_INF_LAT_DONE], now);
+	__lat_hist_add(ntw, ICEDRV_SWC_SUB_NETWORK_LAT_TOTAL_HIST,
+		ts[ICE_INF_LAT_QUEUED], now);
+
+	cve_os_log(CVE_LOGLEVEL_DEBUG,
+		"NtwID:0x%llx InfID:%llu Latency(us) Queue:%llu Exec:%llu Event:%llu\n",
+		ntw->network_id, inf->swc_node.sw_id,
+		ts[ICE_INF_LAT_DISPATCH] ? nsec_to_usec(ts[ICE_INF_LAT_DISPATCH]
+			- ts[ICE_INF_LAT_QUEUED]) : 0,
+		ts[ICE_INF_LAT_DONE] ? nsec_to_usec(ts[ICE_INF_LAT_DONE]
+			- ts[ICE_INF_LAT_DISPATCH]) : 0,
+		ts[ICE_INF_LAT_DONE] ? nsec_to_usec(now
+			- ts[ICE_INF_LAT_DONE]) : 0);
+
+	ts[ICE_INF_LAT_QUEUED] = 0;
+	ts[ICE_INF_LAT_DISPATCH] = 0;
+	ts[ICE_INF_LAT_DONE] = 0;
+}
+
 int ice_ds_raise_event(struct ice_network *ntw,
 	enum cve_jobs_group_status status,
 	bool reschedule)
@@ -1456,6 +1558,11 @@ int ice_ds_raise_event(struct ice_network *ntw,
 	/* Reset counters before scheduling */
 	__ntw_reset_cntr(ntw);
 
+	icedrv_tring_log(ICEDRV_TRING_INF_EVENT, SPH_TRACE_OP_STATE_COMPLETE,
+		ICEDRV_TRING_NO_ICE, abort, ntw->network_id,
+		inf->swc_node.sw_id);
+	__inf_record_latency(ntw, inf);
+
 	if (reschedule)
 		ice_sch_engine(ntw, true);
 
@@ -1626,6 +1733,13 @@ static int __prepare_cb_desc_for_sub_jobs(struct ice_network *ntw,
 	cb_desc_index_arr = (u32 *)job_desc->cb_buf_desc_list;
 	for (i = 0; i < job_desc->cb_nr; i++) {
 		cb_idx = cb_desc_index_arr[i];
+		if (cb_idx >= ntw->num_buf) {
+			ret = -ICEDRV_KERROR_CB_INVAL_BUFFER_ID;
+			cve_os_log_default(CVE_LOGLEVEL_ERROR,
+				"ERROR:%d NtwID:0x%llx CB index %u out of %u buffers\n",
+				ret, ntw->network_id, cb_idx, ntw->num_buf);
+			goto err_invalid_surface;
+		}
 		cur_buf_desc = &ntw->buf_desc_list[cb_idx];
 
 		if (cur_buf_desc->surface_type) {
@@ -1898,6 +2012,7 @@ static int __process_job_list(struct cve_job_group *jg_desc,
 		cur_job->job_cntr_pp_list = NULL;
 		cur_job->jobgroup = jg;
 		cur_job->hw_ice_id = INVALID_ICE_ID;
+		cur_job->warm_ice_id = INVALID_ICE_ID;
 		cur_job->paired_job = NULL;
 		cur_job->id = i;
 
@@ -2094,19 +2209,25 @@ out:
 	return ret;
 }
 
+static void __unmap_buf(struct cve_ntw_buffer *buf)
+{
+	cve_context_id_t dummy_context_id = 0;
+
+	cve_mm_unmap_kva(buf->ntw_buf_alloc);
+
+	cve_mm_destroy_buffer(dummy_context_id, buf->ntw_buf_alloc);
+}
+
 static int __destroy_buf(struct ice_network *ntw,
 	struct cve_ntw_buffer *buf)
 {
 	struct ds_context *context = NULL;
 	struct cve_workqueue *wq = NULL;
-	cve_context_id_t dummy_context_id = 0;
 
 	wq = ntw->wq;
 	context = wq->context;
 
-	cve_mm_unmap_kva(buf->ntw_buf_alloc);
-
-	cve_mm_destroy_buffer(dummy_context_id, buf->ntw_buf_alloc);
+	__unmap_buf(buf);
 
 	/* remove the buffer from the list in the context */
 	cve_dle_remove_from_list(context->buf_list, list, buf);
@@ -2117,18 +2238,17 @@ static int __destroy_buf(struct ice_network *ntw,
 	return 0;
 }
 
+/* Maps the buffer on all ICEs of the network. Touches nothing shared
+ * with other buffers, so that buffers of a network are mapped in parallel.
+ * Adding to the context buffer list is left to the caller.
+ */
 static int __process_buf_desc(struct ice_network *ntw,
 	struct cve_surface_descriptor *buf_desc,
 	struct cve_ntw_buffer *buf)
 {
 	int ret = 0;
-	struct ds_context *context = NULL;
-	struct cve_workqueue *wq = NULL;
 	os_domain_handle cve_os_hdomain[MAX_CVE_DEVICES_NR];
 
-	wq = ntw->wq;
-	context = wq->context;
-
 	if (buf_desc->alloc_higher_va &&
 			buf_desc->low_pp_cnt != buf_desc->high_pp_cnt) {
 		ret = -ICEDRV_KERROR_PP_COUNT_EINVAL;
@@ -2175,9 +2295,6 @@ static int __process_buf_desc(struct ice_network *ntw,
 			),
 		buf->buffer_id);
 
-	/* add it to the buffer list in the context */
-	cve_dle_add_to_list_after(context->buf_list, list, buf);
-
 	/* Set the buffer as cache dirty */
 	cve_mm_set_dirty_cache(buf->ntw_buf_alloc);
 
@@ -2215,11 +2332,37 @@ static int __destroy_buf_list(struct ice_network *ntw,
 	return 0;
 }
 
+struct __buf_desc_par {
+	struct ice_network *ntw;
+	struct cve_surface_descriptor *buf_desc_list;
+};
+
+static int __process_buf_desc_par(void *data, u32 idx)
+{
+	struct __buf_desc_par *par = (struct __buf_desc_par *)data;
+	struct cve_surface_descriptor *buf_desc = &par->buf_desc_list[idx];
+	int ret;
+
+	/* dma-buf FD was already resolved by the calling process */
+	if (buf_desc->fd)
+		return 0;
+
+	ret = __process_buf_desc(par->ntw, buf_desc, &par->ntw->buf_list[idx]);
+	if (ret < 0) {
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"ERROR:%d Mapping of buffer %u failed\n", ret, idx);
+	}
+
+	return ret;
+}
+
 static int __process_buf_desc_list(struct ice_network *ntw,
 	struct cve_surface_descriptor *buf_desc_list)
 {
 	struct cve_ntw_buffer *buf_list = NULL, *cur_buf = NULL;
 	struct cve_surface_descriptor *cur_buf_desc = NULL;
+	struct ds_context *context = ntw->wq->context;
+	struct __buf_desc_par par;
 	u64 *infer_idx_list = NULL;
 	u32 idx = 0, inf_itr = 0;
 	size_t sz = 0;
@@ -2255,17 +2398,37 @@ static int __process_buf_desc_list(struct ice_network *ntw,
 		ntw->infer_idx_list = infer_idx_list;
 	}
 
-	for (; idx < ntw->num_buf; idx++) {
+	/* Shared buffers are looked up in the file table of the calling
+	 * process, which worker threads do not have.
+	 */
+	for (idx = 0; idx < ntw->num_buf; idx++) {
 		cur_buf_desc = &buf_desc_list[idx];
-		cur_buf = &buf_list[idx];
+		if (!cur_buf_desc->fd)
+			continue;
 
-		ret = __process_buf_desc(ntw, cur_buf_desc, cur_buf);
+		ret = __process_buf_desc(ntw, cur_buf_desc, &buf_list[idx]);
 		if (ret < 0) {
 			cve_os_log(CVE_LOGLEVEL_ERROR,
 					"ERROR:%d Allocation for Buffer List failed\n",
 					ret);
 			goto error_buf_desc;
 		}
+	}
+
+	/* Pinning and page table updates of the rest dominate network
+	 * creation, spread them over the worker threads.
+	 */
+	par.ntw = ntw;
+	par.buf_desc_list = buf_desc_list;
+	ret = ice_os_parallel_for(__process_buf_desc_par, &par,
+			ntw->num_buf, ice_get_ntw_create_workers());
+	if (ret < 0)
+		goto error_buf_desc;
+
+	for (idx = 0; idx < ntw->num_buf; idx++) {
+		cur_buf_desc = &buf_desc_list[idx];
+		cur_buf = &buf_list[idx];
+
 		if (!cur_buf_desc->fd && !cur_buf_desc->base_address) {
 
 			if (inf_itr >= ntw->infer_buf_count) {
@@ -2300,12 +2463,28 @@ static int __process_buf_desc_list(struct ice_network *ntw,
 		goto error_buf_desc;
 	}
 
+	/* add them to the buffer list in the context */
+	for (idx = 0; idx < ntw->num_buf; idx++)
+		cve_dle_add_to_list_after(context->buf_list, list,
+				&buf_list[idx]);
+
 	ntw->num_inf_buf = inf_itr;
 
 	return ret;
 
 error_buf_desc:
-	__destroy_buf_list(ntw, buf_list, idx);
+	/* none is in the context list yet, some may not be mapped */
+	for (idx = 0; idx < ntw->num_buf; idx++) {
+		if (buf_list[idx].ntw_buf_alloc)
+			__unmap_buf(&buf_list[idx]);
+	}
+	if (infer_idx_list) {
+		OS_FREE(infer_idx_list,
+			sizeof(*infer_idx_list) * ntw->infer_buf_count);
+		ntw->infer_idx_list = NULL;
+	}
+	OS_FREE(buf_list, sz);
+	ntw->buf_list = NULL;
 out:
 	return ret;
 }
@@ -2406,6 +2585,12 @@ static void __destroy_infer(struct ice_infer *inf)
 
 	__move_completion_events_to_main_list(inf->process_pid, inf);
 
+	if (inf->ntw->patched_inf == inf)
+		inf->ntw->patched_inf = NULL;
+	if (inf->ntw->lookahead.inf == inf ||
+		inf->ntw->lookahead.base == inf)
+		inf->ntw->lookahead.inf = NULL;
+
 	__destroy_infer_desc(inf);
 
 	ice_swc_destroy_infer_node(inf);
@@ -2514,6 +2699,10 @@ static int __destroy_network(struct ice_network *ntw)
 			__destroy_ice_dump_buffer(ntw);
 
 		__destroy_jg_list(ntw);
+		if (ntw->lookahead.pp_idx)
+			OS_FREE(ntw->lookahead.pp_idx,
+				sizeof(*ntw->lookahead.pp_idx) *
+				ntw->ntw_surf_pp_count);
 		__destroy_pp_mirror_image(&ntw->ntw_surf_pp_list);
 		ice_fini_sw_dev_contexts(ntw->dev_hctx_list,
 				ntw->loaded_cust_fw_sections);
@@ -2578,7 +2767,7 @@ static int __process_network_desc(
 	ntw->has_resource = 0;
 	ntw->cntr_bitmap = 0;
 	ntw->ice_list = NULL;
-	ntw->cntr_list = NULL;
+	ntw->cntr_map_mask = 0;
 	ntw->network_id = (u64)ntw;
 	ntw->org_icebo_req = network_desc->icebo_req;
 	ntw->org_pbo_req = 0;
@@ -2592,8 +2781,15 @@ static int __process_network_desc(
 		ntw->ntw_exec_time[i] = 0;
 		ntw->ice_error_status[i] = 0;
 	}
-	for (i = 0; i < ICE_CLOS_MAX; i++)
+	for (i = 0; i < ICE_CLOS_MAX; i++) {
 		ntw->clos[i] = network_desc->llc_size[i];
+		ntw->llc.ways[i] = network_desc->llc_size[i];
+		ntw->llc.charged[i] = 0;
+	}
+	ntw->llc.miss_ewma = 0;
+	ntw->llc.samples = 0;
+	ntw->llc.grow_streak = 0;
+	ntw->llc.shrink_streak = 0;
 
 	/* if user has not provided max shared distance then store
 	 * the default value
@@ -2722,6 +2918,17 @@ static int __process_network_desc(
 		goto err_fifo_alloc;
 	}
 
+	if (ntw->ntw_surf_pp_count) {
+		sz = (sizeof(*ntw->lookahead.pp_idx) * ntw->ntw_surf_pp_count);
+		retval = OS_ALLOC_ZERO(sz, (void **)&ntw->lookahead.pp_idx);
+		if (retval < 0) {
+			cve_os_log(CVE_LOGLEVEL_ERROR,
+				"ERROR:%d Lookahead allocation failed\n",
+				retval);
+			goto err_lookahead_alloc;
+		}
+	}
+
 	sz = (sizeof(*jg_desc_list) * network_desc->num_jg_desc);
 	OS_FREE(jg_desc_list, sz);
 
@@ -2735,6 +2942,8 @@ static int __process_network_desc(
 
 	goto out;
 
+err_lookahead_alloc:
+	dealloc_and_unmap_network_fifo(ntw);
 err_fifo_alloc:
 	__destroy_jg_list(ntw);
 error_jg_desc_process:
@@ -3447,7 +3656,6 @@ static int __get_resource_availability(struct resource_info *res)
 {
 	u32 i;
 	struct cve_device_group *dg = cve_dg_get();
-	u64 *pool_context_map = dg->pool_context_map;
 	int retval = 0;
 
 	retval = ice_memset_s(res, sizeof(struct resource_info),
@@ -3460,11 +3668,8 @@ static int __get_resource_availability(struct resource_info *res)
 
 	res->num_ice = (2 * dg->total_pbo) + dg->total_dice;
 
-	res->num_cntr = dg->num_avl_cntr;
-
-	for (i = 0; i < MAX_IDC_POOL_NR; i++)
-		if (pool_context_map[i] == INVALID_CONTEXT_ID)
-			res->num_pool++;
+	res->num_cntr = __builtin_popcount(dg->cntr_free_mask);
+	res->num_pool = __builtin_popcount(dg->pool_free_mask);
 
 	for (i = 0; i < ICE_CLOS_MAX; i++)
 		res->clos[i] = dg->dg_clos_manager.clos_size[i];
@@ -3685,6 +3890,9 @@ int cve_ds_handle_execute_infer(cve_context_process_id_t context_pid,
 				inf->swc_node.sw_id,
 				SPH_TRACE_OP_STATUS_PRIORITY,
 				data->priority));
+	icedrv_tring_log(ICEDRV_TRING_INF_QUEUED, SPH_TRACE_OP_STATE_QUEUED,
+		ICEDRV_TRING_NO_ICE, data->priority, ntw->network_id,
+		inf->swc_node.sw_id);
 
 	if (!ice_lsch_add_inf_to_queue(inf, data->priority, data->enable_bp)) {
 
@@ -3843,11 +4051,19 @@ void cve_ds_handle_job_completion(struct cve_device *dev,
 
 	ntw->ntw_exec_time[dev->dev_index] = exec_time;
 
+	/* feed power balancer workload model */
+	if (job_status == CVE_JOBSTATUS_COMPLETED && dg->sphpb.sphpb_cbs &&
+			dg->sphpb.sphpb_cbs->report_ice_perf)
+		dg->sphpb.sphpb_cbs->report_ice_perf(dev->dev_index,
+				ntw->network_id, exec_time);
+
 	/* Mark the device as idle */
 	dev->state = CVE_DEVICE_IDLE;
+#ifndef RING3_VALIDATION
 	/* Perform pmon reset to avoid huge cnc traces in DTF */
 	if (dev->daemon.daemon_config_status != TRACE_STATUS_DEFAULT)
 		perform_daemon_suspend(dev);
+#endif
 
 	if (inf->hswc)
 		ice_swc_counter_inc(inf->hswc,
@@ -3908,14 +4124,19 @@ void cve_ds_handle_job_completion(struct cve_device *dev,
 					SPH_TRACE_OP_STATUS_ICE,
 					ntw->ntw_icemask));
 
+		inf->lat_ts[ICE_INF_LAT_DONE] = trace_clock_local();
 		ice_swc_counter_add(ntw->hswc,
 			ICEDRV_SWC_SUB_NETWORK_NETBUSYTIME,
-			nsec_to_usec(trace_clock_local()
+			nsec_to_usec(inf->lat_ts[ICE_INF_LAT_DONE]
 				- ntw->busy_start_time));
 
 		dg->num_running_ntw--;
 		ntw->wq->num_ntw_running--;
 
+		__ntw_sample_llc(ntw);
+		__ntw_uncharge_llc(ntw);
+		__llc_rebalance(dg);
+
 		if (jobgroup->aborted_jobs_nr)
 			jg_status = CVE_JOBSGROUPSTATUS_ABORTED;
 		else
@@ -4609,47 +4830,40 @@ static void __delink_ices_and_pool(struct ice_network *ntw)
 
 static void __link_counters_and_pool(struct ice_network *ntw)
 {
+	int i;
 	int8_t pool_id;
+	u32 cntr_mask = (u32)ntw->ntw_cntrmask;
 	struct cve_device *dev = get_first_device();
 	struct cve_os_device *os_dev = to_cve_os_device(dev);
-	struct cve_hw_cntr_descriptor *head = ntw->cntr_list;
-	struct cve_hw_cntr_descriptor *next = ntw->cntr_list;
-
-	if (!next)
-		return;
 
 	pool_id = ntw->wq->context->pool_id;
 
-	do {
+	while (cntr_mask) {
+		i = __builtin_ctz(cntr_mask);
+		cntr_mask &= ~(1 << i);
+
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
 			"Linking CntrHwID=%d to Pool=%d\n",
-			next->hw_cntr_id, pool_id);
-		cve_set_hw_sync_regs(&os_dev->idc_dev,
-			next->hw_cntr_id, pool_id);
-
-		next = cve_dle_next(next, list);
-	} while (next != head);
+			i, pool_id);
+		cve_set_hw_sync_regs(&os_dev->idc_dev, i, pool_id);
+	}
 }
 
 static void __delink_counters_and_pool(struct ice_network *ntw)
 {
+	int i;
+	u32 cntr_mask = (u32)ntw->ntw_cntrmask;
 	struct cve_device *dev = get_first_device();
 	struct cve_os_device *os_dev = to_cve_os_device(dev);
-	struct cve_hw_cntr_descriptor *head = ntw->cntr_list;
-	struct cve_hw_cntr_descriptor *next = ntw->cntr_list;
 
-	if (!next)
-		return;
+	while (cntr_mask) {
+		i = __builtin_ctz(cntr_mask);
+		cntr_mask &= ~(1 << i);
 
-	do {
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
-			"Delinking CntrHwID=%d from Pool\n",
-			next->hw_cntr_id);
-		cve_reset_hw_sync_regs(&os_dev->idc_dev,
-			next->hw_cntr_id);
-
-		next = cve_dle_next(next, list);
-	} while (next != head);
+			"Delinking CntrHwID=%d from Pool\n", i);
+		cve_reset_hw_sync_regs(&os_dev->idc_dev, i);
+	}
 }
 
 static void __link_resource_and_pool(struct ice_network *ntw)
@@ -4698,7 +4912,7 @@ static void __lazy_capture_ices(struct ice_network *ntw)
 static int __ntw_reserve_ice(struct ice_network *ntw)
 {
 	int ret = 0;
-	u32 i;
+	u32 i, pbo_left = 0;
 	struct cve_device_group *dg = cve_dg_get();
 	struct job_descriptor *job;
 
@@ -4710,19 +4924,31 @@ static int __ntw_reserve_ice(struct ice_network *ntw)
 		return -1;
 	}
 
+	ice_swc_counter_inc(ntw->hswc,
+			ICEDRV_SWC_SUB_NETWORK_ICE_RESERVE);
+
 	if (ice_dg_can_lazy_capture_ice(ntw)) {
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG, "Lazy Capture activated\n");
 
 		__lazy_capture_ices(ntw);
 
+		ice_swc_counter_inc(ntw->hswc,
+				ICEDRV_SWC_SUB_NETWORK_LAZY_CAPTURE);
+		ice_swc_counter_add(ntw->hswc,
+				ICEDRV_SWC_SUB_NETWORK_AVOIDED_RESETS,
+				ntw->jg_list->submitted_jobs_nr);
+
 		goto out;
 
 	} else {
 
-		/* Removing Job2ICE linkage and setting Ntw for Cold run */
+		/* Removing Job2ICE linkage and setting Ntw for Cold run.
+		 * Last ICE is remembered to steer the job back to it.
+		 */
 		for (i = 0; i < ntw->jg_list->submitted_jobs_nr; i++) {
 			job = &ntw->jg_list->job_list[i];
+			job->warm_ice_id = job->hw_ice_id;
 			job->hw_ice_id = INVALID_ICE_ID;
 			ice_di_set_cold_run(job->di_hjob);
 		}
@@ -4733,6 +4959,10 @@ static int __ntw_reserve_ice(struct ice_network *ntw)
 	ntw->given_icebo_req = ntw->temp_icebo_req;
 	ntw->shared_read = (ntw->temp_icebo_req == ICEBO_MANDATORY);
 
+	/* pBOs that must stay whole for paired jobs */
+	if (ntw->given_icebo_req == ICEBO_MANDATORY)
+		pbo_left = ntw->given_pbo_req;
+
 	for (i = 0; i < ntw->jg_list->submitted_jobs_nr; i++) {
 
 		struct job_descriptor *job_0, *job_1;
@@ -4747,9 +4977,11 @@ static int __ntw_reserve_ice(struct ice_network *ntw)
 
 			job_1 = job_0->paired_job;
 			ice_dg_borrow_next_pbo(ntw, job_0, job_1);
+			if (pbo_left)
+				pbo_left--;
 
 		} else
-			ice_dg_borrow_next_dice(ntw, job_0);
+			ice_dg_borrow_next_dice(ntw, job_0, pbo_left);
 	}
 
 out:
@@ -4778,127 +5010,69 @@ static void __ntw_release_ice(struct ice_network *ntw)
 			ntw->num_ice, ntw->network_id);
 }
 
-static void __lazy_capture_counters(struct ice_network *ntw)
-{
-	int i;
-	int8_t cntr_id;
-	u32 mask, cntr_bitmap;
-	struct cve_hw_cntr_descriptor *hw_cntr;
-	struct cve_device_group *dg = g_cve_dev_group_list;
-
-	cntr_bitmap = ntw->cntr_bitmap;
-	while (cntr_bitmap) {
-
-		/* #Trailing zero indicates counter_id */
-		i = __builtin_ctz(cntr_bitmap);
-		mask = (1 << i);
-
-		cntr_bitmap &= ~(mask);
-
-		cntr_id = ntw->cntr_info.cntr_id_map[i];
-		ASSERT(cntr_id != INVALID_CTR_ID);
-
-		hw_cntr = &dg->base_addr_hw_cntr[cntr_id];
-		cve_dle_move(ntw->cntr_list, dg->hw_cntr_list, list, hw_cntr);
-
-		hw_cntr->in_free_pool = false;
-		hw_cntr->cntr_ntw_id = ntw->network_id;
-		dg->num_avl_cntr--;
-
-		cve_os_log(CVE_LOGLEVEL_INFO,
-			"NtwID:0x%llx Map Counter[%u]->%u\n",
-			ntw->network_id, i, hw_cntr->hw_cntr_id);
-	}
-
-}
-
 static int __ntw_reserve_cntr(struct ice_network *ntw)
 {
-	int i, ret = 0;
-	int8_t cntr_id;
-	bool lazy_capture = ntw->cntr_bitmap;
-	u32 mask, cntr_bitmap;
+	int i, hw_id, ret = 0;
+	u32 mask, free_mask, cntr_bitmap;
 	struct cve_device_group *dg = g_cve_dev_group_list;
-	struct cve_hw_cntr_descriptor *hw_cntr;
 	u32 count = 0;
 
 	__local_builtin_popcount(ntw->cntr_bitmap, count);
 
-	/* Check if previous Counters are still available */
-	cntr_bitmap = ntw->cntr_bitmap;
-	while (cntr_bitmap) {
-
-		/* #Trailing zero indicates counter_id */
-		i = __builtin_ctz(cntr_bitmap);
-		mask = (1 << i);
-
-		cntr_bitmap &= ~(mask);
-
-		cntr_id = ntw->cntr_info.cntr_id_map[i];
-		if (cntr_id == INVALID_CTR_ID) {
-			lazy_capture = false;
-			break;
-		}
-
-		hw_cntr = &dg->base_addr_hw_cntr[cntr_id];
-		if (!hw_cntr->in_free_pool) {
-			lazy_capture = false;
-			break;
-		}
-	}
-
-	if (lazy_capture) {
+	/* Previous mapping is reused if all its Counters are still free */
+	mask = ntw->cntr_map_mask;
+	if (mask && ((dg->cntr_free_mask & mask) == mask)) {
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG, "Lazy Capture activated\n");
 
-		__lazy_capture_counters(ntw);
-
 		ntw->patch_cntr = false;
 
 		if (ice_is_soc() && ice_get_a_step_enable_flag())
 			ntw->patch_cntr = true;
 
-		/* ntw->patch_cntr is already false */
-
-		goto out;
+		goto capture;
+	}
 
-	} else {
-		for (i = 0; i < MAX_HW_COUNTER_NR; i++)
-			ntw->cntr_info.cntr_id_map[i] = INVALID_CTR_ID;
+	for (i = 0; i < MAX_HW_COUNTER_NR; i++)
+		ntw->cntr_info.cntr_id_map[i] = INVALID_CTR_ID;
 
-		ntw->patch_cntr = true;
-	}
+	ntw->patch_cntr = true;
 
+	/* Map each graph Counter to lowest free Counter */
+	mask = 0;
+	free_mask = dg->cntr_free_mask;
 	cntr_bitmap = ntw->cntr_bitmap;
 	while (cntr_bitmap) {
 
 		/* #Trailing zero indicates counter_id */
 		i = __builtin_ctz(cntr_bitmap);
-		mask = (1 << i);
-
-		cntr_bitmap &= ~(mask);
-
-		/* Allocate new Counter and map */
-		hw_cntr = dg->hw_cntr_list;
+		cntr_bitmap &= ~(1 << i);
 
 		/* Should make sure that enough Counters are available */
-		ASSERT(hw_cntr != NULL);
-
-		cve_dle_move(ntw->cntr_list, dg->hw_cntr_list, list, hw_cntr);
+		ASSERT(free_mask != 0);
 
-		hw_cntr->in_free_pool = false;
-		dg->num_avl_cntr--;
+		hw_id = __builtin_ctz(free_mask);
+		free_mask &= ~(1 << hw_id);
+		mask |= (1 << hw_id);
 
-		hw_cntr->cntr_ntw_id = ntw->network_id;
-
-		ntw->cntr_info.cntr_id_map[i] = hw_cntr->hw_cntr_id;
+		ntw->cntr_info.cntr_id_map[i] = hw_id;
 
 		cve_os_log(CVE_LOGLEVEL_INFO,
 			"NtwID:0x%llx Map Counter[%u]->%u\n",
-			ntw->network_id, i, hw_cntr->hw_cntr_id);
+			ntw->network_id, i, hw_id);
+	}
+	ntw->cntr_map_mask = mask;
+
+capture:
+	dg->cntr_free_mask &= ~mask;
+	ntw->ntw_cntrmask = mask;
+
+	while (mask) {
+		hw_id = __builtin_ctz(mask);
+		mask &= ~(1 << hw_id);
+		dg->cntr_ntw_id[hw_id] = ntw->network_id;
 	}
 
-out:
 	cve_os_log(CVE_LOGLEVEL_INFO,
 		"Reserved %d Counter for NtwID:0x%llx\n",
 			count, ntw->network_id);
@@ -4908,36 +5082,24 @@ out:
 
 static void __ntw_release_cntr(struct ice_network *ntw)
 {
-	int i;
-	u32 mask, cntr_bitmap;
-	struct cve_hw_cntr_descriptor *head;
+	int hw_id;
+	u32 mask = (u32)ntw->ntw_cntrmask;
 	struct cve_device_group *dg = g_cve_dev_group_list;
 	u32 count = 0;
 
-	__local_builtin_popcount(ntw->cntr_bitmap, count);
+	__local_builtin_popcount(mask, count);
 
-	cntr_bitmap = ntw->cntr_bitmap;
-	while (cntr_bitmap) {
-
-		/* #Trailing zero indicates counter_id */
-		i = __builtin_ctz(cntr_bitmap);
-		mask = (1 << i);
-
-		cntr_bitmap &= ~(mask);
-		if (!ntw->cntr_list)
-			goto out;
-		head = ntw->cntr_list;
-		cve_dle_move(dg->hw_cntr_list, ntw->cntr_list, list, head);
+	dg->cntr_free_mask |= mask;
 
-		head->in_free_pool = true;
-		head->cntr_ntw_id = INVALID_NETWORK_ID;
-		dg->num_avl_cntr++;
+	while (mask) {
+		hw_id = __builtin_ctz(mask);
+		mask &= ~(1 << hw_id);
+		dg->cntr_ntw_id[hw_id] = INVALID_NETWORK_ID;
 
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
-			"Undo Map Counter [%u] = %u\n",
-			i, head->hw_cntr_id);
+			"Undo Map Counter %u\n", hw_id);
 	}
-out:
+
 	cve_os_log(CVE_LOGLEVEL_INFO,
 		"Released %d Counter from NtwID:0x%llx\n",
 				count, ntw->network_id);
@@ -4957,26 +5119,167 @@ static void __ntw_reset_cntr(struct ice_network *ntw)
 	}
 }
 
-static int __ntw_reserve_clos(struct ice_network *ntw)
+/* Dynamic LLC partitioning
+ *
+ * CLOS_1/CLOS_2 are shared by every running Ntw, so each Ntw carries its
+ * own share (starting from the static llc_size[] request) and the MSRs are
+ * sized for the sum of shares of all Ntw currently running. A share grows
+ * by one way when the ICEBO miss ratio stays high and shrinks when it stays
+ * low, both only after ICE_LLC_HYSTERESIS samples in a row.
+ */
+#define ICE_LLC_MIN_CLOS0_MB 3
+#define ICE_LLC_MIN_ACCESSES 4096
+#define ICE_LLC_MISS_HIGH_PM 250
+#define ICE_LLC_MISS_LOW_PM 50
+#define ICE_LLC_HYSTERESIS 3
+
+static void __ntw_charge_llc(struct ice_network *ntw)
 {
-	int ret = 0;
-	struct cve_device_group *dg = cve_dg_get();
-	struct clos_manager *mclos = &dg->dg_clos_manager;
+	struct clos_manager *mclos = &ntw->wq->dg->dg_clos_manager;
+	u32 i;
+
+	for (i = ICE_CLOS_1; i <= ICE_CLOS_2; i++) {
+		ntw->llc.charged[i] = ntw->llc.ways[i];
+		mclos->demand[i] += ntw->llc.charged[i];
+	}
+}
+
+static void __ntw_uncharge_llc(struct ice_network *ntw)
+{
+	struct clos_manager *mclos = &ntw->wq->dg->dg_clos_manager;
+	u32 i;
+
+	for (i = ICE_CLOS_1; i <= ICE_CLOS_2; i++) {
+		mclos->demand[i] -= ntw->llc.charged[i];
+		ntw->llc.charged[i] = 0;
+	}
+}
+
+static void __ntw_sample_llc(struct ice_network *ntw)
+{
+	struct cve_device_group *dg = ntw->wq->dg;
+	struct ice_llc_share *llc = &ntw->llc;
+	u64 hit = 0, miss = 0, bo_hit, bo_miss;
+	u32 bo_mask = 0, bo_id, miss_pm, c, i;
+
+	/* Ntw without an LLC reservation only uses CLOS_0 */
+	if (ntw->clos[ICE_CLOS_1])
+		c = ICE_CLOS_1;
+	else if (ntw->clos[ICE_CLOS_2])
+		c = ICE_CLOS_2;
+	else
+		return;
+
+	for (i = 0; i < MAX_CVE_DEVICES_NR; i++) {
+		if (ntw->ntw_icemask & (1ULL << i))
+			bo_mask |= (1 << (i / 2));
+	}
+
+	/* ICEBO counters are free running, traffic since the last sample
+	 * is attributed to the Ntw that completes on that ICEBO
+	 */
+	for (bo_id = 0; bo_id < MAX_NUM_ICEBO; bo_id++) {
+		if (!(bo_mask & (1 << bo_id)))
+			continue;
+		if (ice_di_sample_llc_pmon(&dg->dev_info.icebo_list[bo_id],
+					&bo_hit, &bo_miss))
+			return;
+		hit += bo_hit;
+		miss += bo_miss;
+	}
+
+	if ((hit + miss) < ICE_LLC_MIN_ACCESSES)
+		return;
+
+	miss_pm = (u32)((miss * 1000) / (hit + miss));
+	if (llc->samples++)
+		llc->miss_ewma = ((3 * llc->miss_ewma) + miss_pm) / 4;
+	else
+		llc->miss_ewma = miss_pm;
+
+	if (llc->miss_ewma > ICE_LLC_MISS_HIGH_PM) {
+		llc->grow_streak++;
+		llc->shrink_streak = 0;
+	} else if (llc->miss_ewma < ICE_LLC_MISS_LOW_PM) {
+		llc->shrink_streak++;
+		llc->grow_streak = 0;
+	} else {
+		llc->grow_streak = 0;
+		llc->shrink_streak = 0;
+	}
+
+	if (llc->grow_streak >= ICE_LLC_HYSTERESIS) {
+		llc->grow_streak = 0;
+		if ((llc->ways[ICE_CLOS_1] + llc->ways[ICE_CLOS_2]) <
+				(MAX_CLOS_SIZE_MB - ICE_LLC_MIN_CLOS0_MB))
+			llc->ways[c]++;
+	} else if (llc->shrink_streak >= ICE_LLC_HYSTERESIS) {
+		llc->shrink_streak = 0;
+		if (llc->ways[c] > 1)
+			llc->ways[c]--;
+	}
 
 	cve_os_log(CVE_LOGLEVEL_DEBUG,
-			"Reserving LLC for NtwID=0x%llx: Required(%u, %u, %u, %u)\n",
-			ntw->network_id,
-			ntw->clos[0], ntw->clos[1], ntw->clos[2], ntw->clos[3]);
+		"NtwID:0x%llx LLC hit:%llu miss:%llu ewma:%u share(%u, %u)\n",
+		ntw->network_id, hit, miss, llc->miss_ewma,
+		llc->ways[ICE_CLOS_1], llc->ways[ICE_CLOS_2]);
+
+	ice_swc_counter_set(ntw->hswc,
+		ICEDRV_SWC_SUB_NETWORK_LLC_MISS_PERMILLE, llc->miss_ewma);
+	ice_swc_counter_set(ntw->hswc, ICEDRV_SWC_SUB_NETWORK_LLC_WAYS,
+		llc->ways[ICE_CLOS_1] + llc->ways[ICE_CLOS_2]);
+}
 
-	mclos->clos_size[ICE_CLOS_1] = ntw->clos[ICE_CLOS_1];
-	mclos->clos_size[ICE_CLOS_2] = ntw->clos[ICE_CLOS_2];
-	mclos->clos_size[ICE_CLOS_0] = (MAX_CLOS_SIZE_MB -
-					(ntw->clos[ICE_CLOS_1] +
-					ntw->clos[ICE_CLOS_2]));
+static void __llc_rebalance(struct cve_device_group *dg)
+{
+	struct clos_manager *mclos = &dg->dg_clos_manager;
+	u32 budget = MAX_CLOS_SIZE_MB - ICE_LLC_MIN_CLOS0_MB;
+	u32 want1 = mclos->demand[ICE_CLOS_1];
+	u32 want2 = mclos->demand[ICE_CLOS_2];
+	u32 total = want1 + want2;
+	bool programmed = (dg->clos_state != CLOS_STATE_DEFAULT);
+
+	/* Keep the last partition while idle */
+	if (!dg->num_running_ntw)
+		return;
 
-	ASSERT(mclos->clos_size[ICE_CLOS_0] >= 3);
+	if (total > budget) {
+		/* Oversubscribed, scale both classes proportionally */
+		want1 = (want1 * budget) / total;
+		want2 = budget - want1;
+	}
 
-	return ret;
+	if (programmed &&
+		(want1 == mclos->clos_size[ICE_CLOS_1]) &&
+		(want2 == mclos->clos_size[ICE_CLOS_2])) {
+		mclos->shrink_streak = 0;
+		return;
+	}
+
+	/* Grow right away, shrink only once the lower demand persists so
+	 * that Ntws starting and stopping do not thrash the CLOS MSRs
+	 */
+	if (programmed &&
+		(want1 <= mclos->clos_size[ICE_CLOS_1]) &&
+		(want2 <= mclos->clos_size[ICE_CLOS_2]) &&
+		(++mclos->shrink_streak < ICE_LLC_HYSTERESIS))
+		return;
+
+	mclos->shrink_streak = 0;
+	mclos->clos_size[ICE_CLOS_1] = want1;
+	mclos->clos_size[ICE_CLOS_2] = want2;
+	mclos->clos_size[ICE_CLOS_0] = MAX_CLOS_SIZE_MB - (want1 + want2);
+
+	ASSERT(mclos->clos_size[ICE_CLOS_0] >= ICE_LLC_MIN_CLOS0_MB);
+
+	cve_os_log(CVE_LOGLEVEL_INFO,
+		"LLC partition for %u Ntw: CLOS(%u, %u, %u)\n",
+		dg->num_running_ntw, mclos->clos_size[ICE_CLOS_0],
+		mclos->clos_size[ICE_CLOS_1], mclos->clos_size[ICE_CLOS_2]);
+
+	ice_os_set_clos((void *)mclos);
+	dg->clos_state = (dg->num_running_ntw == 1) ?
+		CLOS_STATE_SINGLE_NTW : CLOS_STATE_MULTI_NTW;
 }
 
 static int __is_pool_required(struct ice_network *ntw)
@@ -5105,10 +5408,8 @@ enum resource_status ice_ds_ntw_borrow_resource(struct ice_network *ntw)
 	enum resource_status status = RESOURCE_OK;
 	enum pool_status pstatus = POOL_EXIST;
 	struct cve_device *head, *next;
-	struct cve_hw_cntr_descriptor *head_cntr, *next_cntr;
 	struct cve_device_group *dg = cve_dg_get();
 	u64 ntwIceMask = 0;
-	u64 ntwCntrMask = 0;
 
 	if (ntw->has_resource) {
 		cve_os_log(CVE_LOGLEVEL_DEBUG,
@@ -5131,7 +5432,7 @@ enum resource_status ice_ds_ntw_borrow_resource(struct ice_network *ntw)
 
 			if (dg->num_nonres_pool == 0)
 				status = RESOURCE_INSUFFICIENT;
-			else if (dg->num_avl_pool == 0)
+			else if (dg->pool_free_mask == 0)
 				status = RESOURCE_BUSY;
 
 			cve_os_log(CVE_LOGLEVEL_INFO,
@@ -5205,17 +5506,7 @@ enum resource_status ice_ds_ntw_borrow_resource(struct ice_network *ntw)
 		next = cve_dle_next(next, owner_list);
 	} while (head != next);
 
-	head_cntr = ntw->cntr_list;
-	if (head_cntr != NULL) {
-		next_cntr = head_cntr;
-		do {
-			ntwCntrMask |= (1ULL << next_cntr->hw_cntr_id);
-			next_cntr = cve_dle_next(next_cntr, list);
-		} while (head_cntr != next_cntr);
-	}
-
 	ntw->ntw_icemask = ntwIceMask;
-	ntw->ntw_cntrmask = ntwCntrMask;
 	err = __map_resources_and_context(ntw);
 	if (err) {
 		status = RESOURCE_INSUFFICIENT;
@@ -5252,6 +5543,7 @@ static void __power_off_ntw_devices(struct ice_network *ntw)
 	unsigned long cur_jiffy;
 	struct cve_device_group *dg = g_cve_dev_group_list;
 	bool wakeup_po_thread = false;
+	u32 slept_ms, delay_ms;
 
 	retval = cve_os_lock(&dg->poweroff_dev_list_lock, CVE_INTERRUPTIBLE);
 	if (retval != 0) {
@@ -5268,12 +5560,19 @@ static void __power_off_ntw_devices(struct ice_network *ntw)
 	 * it will wake-up in sometime to turn off the already queued ices.
 	 */
 	wakeup_po_thread = (dg->poweroff_dev_list == NULL);
+	slept_ms = jiffies_to_msecs(cur_jiffy - dg->poweroff_sleep_jiffy);
 
 	do {
 		if (next->power_state == ICE_POWER_ON) {
 
 			/* Write current timestamp to Device */
 			next->poff_jiffy = cur_jiffy;
+			next->pm.gap_open = true;
+
+			/* Predicted delay may expire before PO thread wakes */
+			delay_ms = ice_dg_pm_poweroff_delay(next);
+			if ((slept_ms + delay_ms) < dg->poweroff_sleep_ms)
+				wakeup_po_thread = true;
 
 			ice_dev_set_power_state(next, ICE_POWER_OFF_INITIATED);
 			ice_swc_counter_set(next->hswc,
@@ -227,6 +227,7 @@ void ice_ds_ntw_return_resource(struct ice_network *ntw);
 int ice_di_get_core_blob_sz(void);
 
 int ice_ds_dispatch_jg(struct jobgroup_descriptor *jobgroup);
+void ice_ds_prepare_next_inf(struct ice_network *ntw);
 
 int ice_ds_raise_event(struct ice_network *ntw,
 	enum cve_jobs_group_status status,
@@ -108,6 +108,25 @@ static const struct sph_sw_counters_set g_swc_network_set = {
 	ARRAY_SIZE(g_swc_network_group_info)
 };
 
+/* One counter per ICEDRV_SWC_LAT_HIST_BUCKETS bucket */
+#define ICEDRV_SWC_LAT_HIST_INFO(_name, _desc) \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt2us", _desc " < 2us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt4us", _desc " < 4us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt8us", _desc " < 8us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt16us", _desc " < 16us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt32us", _desc " < 32us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt64us", _desc " < 64us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt128us", _desc " < 128us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt256us", _desc " < 256us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt512us", _desc " < 512us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt1ms", _desc " < 1024us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt2ms", _desc " < 2048us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt4ms", _desc " < 4096us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt8ms", _desc " < 8192us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt16ms", _desc " < 16384us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Lt32ms", _desc " < 32768us"}, \
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, _name "Ge32ms", _desc " >= 32768us"}
+
 static const struct sph_sw_counters_group_info
 	g_swc_sub_network_group_info[] = {
 	/* ICEDRV_SWC_SUB_NETWORK_GROUP_GEN */
@@ -135,7 +154,43 @@ static const struct sph_sw_counter_info g_swc_sub_network_info[] = {
 	 "Total number of Destroyed Infer Request"},
 	/* ICEDRV_SWC_SUB_NETWORK_NETBUSYTIME */
 	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "netBusyTime",
-	"Network's total busy duration in microseconds"}
+	"Network's total busy duration in microseconds"},
+	/* ICEDRV_SWC_SUB_NETWORK_ICE_RESERVE */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "iceReserve",
+	"Number of times ICEs were reserved for this network"},
+	/* ICEDRV_SWC_SUB_NETWORK_LAZY_CAPTURE */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "lazyCapture",
+	"Number of ICE reservations done by lazy capture"},
+	/* ICEDRV_SWC_SUB_NETWORK_AVOIDED_RESETS */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "avoidedResets",
+	"Number of ICEs reused warm without network switch reset"},
+	/* ICEDRV_SWC_SUB_NETWORK_NTW_SWITCH_RESETS */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "ntwSwitchResets",
+	"Number of ICEs reset due to network switch"},
+	/* ICEDRV_SWC_SUB_NETWORK_LLC_MISS_PERMILLE */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "llcMissPermille",
+	"Smoothed LLC miss ratio of the network ICEBOs in permille"},
+	/* ICEDRV_SWC_SUB_NETWORK_LLC_WAYS */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "llcWays",
+	"LLC ways (MB) currently requested by the network"},
+	/* ICEDRV_SWC_SUB_NETWORK_LOOKAHEAD_HITS */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "lookaheadHits",
+	"Number of inferences dispatched with precomputed patch delta"},
+	/* ICEDRV_SWC_SUB_NETWORK_PP_PATCHED */
+	{ICEDRV_SWC_SUB_NETWORK_GROUP_GEN, "ppPatched",
+	"Number of patch points written into CBs at dispatch"},
+	/* ICEDRV_SWC_SUB_NETWORK_LAT_QUEUE_HIST */
+	ICEDRV_SWC_LAT_HIST_INFO("latQueue",
+		"Inferences waiting in scheduler queue"),
+	/* ICEDRV_SWC_SUB_NETWORK_LAT_EXEC_HIST */
+	ICEDRV_SWC_LAT_HIST_INFO("latExec",
+		"Inferences executing from dispatch to last job completion"),
+	/* ICEDRV_SWC_SUB_NETWORK_LAT_EVENT_HIST */
+	ICEDRV_SWC_LAT_HIST_INFO("latEvent",
+		"Inferences from last job completion to completion event"),
+	/* ICEDRV_SWC_SUB_NETWORK_LAT_TOTAL_HIST */
+	ICEDRV_SWC_LAT_HIST_INFO("latTotal",
+		"Inferences from ExecuteInfer to completion event")
 };
 
 static const struct sph_sw_counters_set g_swc_sub_network_set = {
@@ -220,6 +275,27 @@ static const struct sph_sw_counter_info g_swc_device_info[] = {
 	/* ICEDRV_SWC_DEVICE_COUNTER_ECC_DERRCOUNT */
 	{ICEDRV_SWC_DEVICE_GROUP_GEN, "eccDerrCount",
 	 "Total count of Deep SRAM ECC double errors"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_INTERRUPTS */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "interrupts",
+	 "Total number of interrupts received from this device"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_COMPLETIONS */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "completions",
+	 "Total number of job completions handled, by interrupt or by polling"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_POWER_OFF_DELAY */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "powerOffDelayMs",
+	 "Power-off delay in msec currently picked for this device"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_POWER_ON_LATENCY */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "powerOnLatencyUs",
+	 "Latency in usec of the last power-on of this device"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_WARM_WAKEUPS */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "warmWakeups",
+	 "Number of reservations that found this device still powered"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_COLD_WAKEUPS */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "coldWakeups",
+	 "Number of reservations that had to power on this device"},
+	/* ICEDRV_SWC_DEVICE_COUNTER_JOB_IDLE_GAP */
+	{ICEDRV_SWC_DEVICE_GROUP_GEN, "jobIdleGap",
+	 "Idle time in usec between last completion and warm doorbell"},
 };
 
 static const struct sph_sw_counters_set g_swc_device_set = {
@@ -76,6 +76,24 @@ enum ICEDRV_SWC_NETWORK_COUNTER {
 	ICEDRV_SWC_NETWORK_COUNTER_SUB_NTW_DESTROYED
 };
 
+/* Bucket i of a latency histogram counts [2^i, 2^(i+1)) usec, except
+ * bucket 0 which starts at 0 and the last bucket which is open ended
+ */
+#define ICEDRV_SWC_LAT_HIST_BUCKETS 16
+
+static inline u32 ice_swc_lat_bucket(u64 usec)
+{
+	u32 bucket = 0;
+
+	usec >>= 1;
+	while (usec && bucket < (ICEDRV_SWC_LAT_HIST_BUCKETS - 1)) {
+		usec >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
 /** Groups in ICEDRV_SWC_CLASS_SUB_NETWORK */
 enum ICEDRV_SWC_SUB_NETWORK_GROUP {
 	ICEDRV_SWC_SUB_NETWORK_GROUP_GEN,
@@ -89,7 +107,26 @@ enum ICEDRV_SWC_SUB_NETWORK_COUNTER {
 	ICEDRV_SWC_SUB_NETWORK_COUNTER_INF_SCHEDULED,
 	ICEDRV_SWC_SUB_NETWORK_COUNTER_INF_COMPLETED,
 	ICEDRV_SWC_SUB_NETWORK_COUNTER_INF_DESTROYED,
-	ICEDRV_SWC_SUB_NETWORK_NETBUSYTIME
+	ICEDRV_SWC_SUB_NETWORK_NETBUSYTIME,
+	ICEDRV_SWC_SUB_NETWORK_ICE_RESERVE,
+	ICEDRV_SWC_SUB_NETWORK_LAZY_CAPTURE,
+	ICEDRV_SWC_SUB_NETWORK_AVOIDED_RESETS,
+	ICEDRV_SWC_SUB_NETWORK_NTW_SWITCH_RESETS,
+	ICEDRV_SWC_SUB_NETWORK_LLC_MISS_PERMILLE,
+	ICEDRV_SWC_SUB_NETWORK_LLC_WAYS,
+	ICEDRV_SWC_SUB_NETWORK_LOOKAHEAD_HITS,
+	ICEDRV_SWC_SUB_NETWORK_PP_PATCHED,
+	/* Latency log-histograms, ICEDRV_SWC_LAT_HIST_BUCKETS each */
+	ICEDRV_SWC_SUB_NETWORK_LAT_QUEUE_HIST,
+	ICEDRV_SWC_SUB_NETWORK_LAT_EXEC_HIST =
+		ICEDRV_SWC_SUB_NETWORK_LAT_QUEUE_HIST +
+		ICEDRV_SWC_LAT_HIST_BUCKETS,
+	ICEDRV_SWC_SUB_NETWORK_LAT_EVENT_HIST =
+		ICEDRV_SWC_SUB_NETWORK_LAT_EXEC_HIST +
+		ICEDRV_SWC_LAT_HIST_BUCKETS,
+	ICEDRV_SWC_SUB_NETWORK_LAT_TOTAL_HIST =
+		ICEDRV_SWC_SUB_NETWORK_LAT_EVENT_HIST +
+		ICEDRV_SWC_LAT_HIST_BUCKETS,
 };
 
 /* Groups in ICEDRV_SWC_CLASS_INFER */
@@ -134,6 +171,13 @@ enum ICEDRV_SWC_DEVICE_COUNTER {
 	ICEDRV_SWC_DEVICE_COUNTER_ECC_SERRCOUNT,
 	ICEDRV_SWC_DEVICE_COUNTER_ECC_DERRCOUNT_WRAP,
 	ICEDRV_SWC_DEVICE_COUNTER_ECC_DERRCOUNT,
+	ICEDRV_SWC_DEVICE_COUNTER_INTERRUPTS,
+	ICEDRV_SWC_DEVICE_COUNTER_COMPLETIONS,
+	ICEDRV_SWC_DEVICE_COUNTER_POWER_OFF_DELAY,
+	ICEDRV_SWC_DEVICE_COUNTER_POWER_ON_LATENCY,
+	ICEDRV_SWC_DEVICE_COUNTER_WARM_WAKEUPS,
+	ICEDRV_SWC_DEVICE_COUNTER_COLD_WAKEUPS,
+	ICEDRV_SWC_DEVICE_COUNTER_JOB_IDLE_GAP,
 };
 
 /* Groups in ICEDRV_SWC_CLASS_INFER_DEVICE */
@@ -0,0 +1,149 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+
+
+#ifdef RING3_VALIDATION
+#include <linux_kernel_mock.h>
+#endif
+
+#include "os_interface.h"
+#include "cve_device_group.h"
+#include "icedrv_trace_ring.h"
+
+struct icedrv_tring *g_icedrv_tring;
+
+static inline struct icedrv_tring_hdr *__tring_hdr(struct icedrv_tring *tr,
+		u32 cpu)
+{
+	return (struct icedrv_tring_hdr *)((u8 *)tr->va +
+			((size_t)cpu * tr->cpu_size));
+}
+
+static inline size_t __tring_cpu_size(u32 order)
+{
+	return ICEDRV_TRING_HDR_SZ +
+		(((size_t)1 << order) * sizeof(struct icedrv_tring_rec));
+}
+
+static inline struct icedrv_tring_rec *__tring_rec(
+		struct icedrv_tring_hdr *hdr, u64 slot)
+{
+	struct icedrv_tring_rec *rec = (struct icedrv_tring_rec *)
+		((u8 *)hdr + ICEDRV_TRING_HDR_SZ);
+
+	return &rec[slot & (hdr->nr_rec - 1)];
+}
+
+void icedrv_tring_init(void)
+{
+	int ret;
+	u32 cpu, nr_cpus, order = ice_get_trace_ring_order();
+	struct icedrv_tring *tr;
+	struct icedrv_tring_hdr *hdr;
+
+	if (!order)
+		return;
+
+	if (order > ICEDRV_TRING_MAX_ORDER)
+		order = ICEDRV_TRING_MAX_ORDER;
+
+	/* total size is u32, keep rings of many CPUs within the limit */
+	nr_cpus = ice_os_tring_nr_cpus();
+	while (order && (size_t)nr_cpus * __tring_cpu_size(order) >
+			ICEDRV_TRING_MAX_SIZE)
+		order--;
+
+	if ((size_t)nr_cpus * __tring_cpu_size(order) >
+			ICEDRV_TRING_MAX_SIZE) {
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"Trace ring not created, too many CPUs %u\n", nr_cpus);
+		return;
+	}
+
+	if (order != ice_get_trace_ring_order())
+		cve_os_log(CVE_LOGLEVEL_WARNING,
+			"Trace ring order lowered to %u for %u CPUs\n",
+			order, nr_cpus);
+
+	ret = OS_ALLOC_ZERO(sizeof(*tr), (void **)&tr);
+	if (ret < 0) {
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"Trace ring allocation failed %d\n", ret);
+		return;
+	}
+
+	tr->nr_cpus = nr_cpus;
+	tr->nr_rec = (1 << order);
+	tr->cpu_size = (u32)__tring_cpu_size(order);
+	tr->size = tr->nr_cpus * tr->cpu_size;
+
+	ret = ice_os_tring_alloc(tr->size, &tr->va);
+	if (ret < 0) {
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"Trace ring of %u bytes not created %d\n",
+			tr->size, ret);
+		OS_FREE(tr, sizeof(*tr));
+		return;
+	}
+
+	for (cpu = 0; cpu < tr->nr_cpus; cpu++) {
+		hdr = __tring_hdr(tr, cpu);
+		hdr->magic = ICEDRV_TRING_MAGIC;
+		hdr->version = ICEDRV_TRING_VERSION;
+		hdr->rec_size = sizeof(struct icedrv_tring_rec);
+		hdr->nr_rec = tr->nr_rec;
+		hdr->cpu = cpu;
+		hdr->nr_cpus = tr->nr_cpus;
+		atomic64_set(&hdr->head, 0);
+	}
+
+	cve_os_log(CVE_LOGLEVEL_INFO,
+		"Trace ring created. CPUs=%u, RecordsPerCPU=%u, Size=%u\n",
+		tr->nr_cpus, tr->nr_rec, tr->size);
+
+	g_icedrv_tring = tr;
+}
+
+void icedrv_tring_cleanup(void)
+{
+	struct icedrv_tring *tr = g_icedrv_tring;
+
+	if (!tr)
+		return;
+
+	g_icedrv_tring = NULL;
+
+	ice_os_tring_free(tr->va, tr->size);
+	OS_FREE(tr, sizeof(*tr));
+}
+
+void __icedrv_tring_log(u16 event, u8 state, u8 ice, u32 arg,
+	u64 ntw_id, u64 inf_id)
+{
+	u32 cpu;
+	u64 slot;
+	struct icedrv_tring_hdr *hdr;
+	struct icedrv_tring_rec *rec;
+	struct icedrv_tring *tr = g_icedrv_tring;
+
+	cpu = ice_os_tring_get_cpu();
+	hdr = __tring_hdr(tr, cpu);
+
+	/* ISR may log on this CPU in between, so slot is taken atomically */
+	slot = cve_os_atomic_increment_64(&hdr->head) - 1;
+	rec = __tring_rec(hdr, slot);
+
+	rec->ts = trace_clock_local();
+	rec->ntw_id = ntw_id;
+	rec->inf_id = inf_id;
+	rec->arg = arg;
+	rec->event = event;
+	rec->state = state;
+	rec->ice = ice;
+
+	ice_os_tring_put_cpu();
+}
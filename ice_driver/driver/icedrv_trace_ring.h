@@ -0,0 +1,100 @@
+/********************************************
+ * Copyright (C) 2019-2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ ********************************************/
+
+
+
+#ifndef _ICEDRV_TRACE_RING_H_
+#define _ICEDRV_TRACE_RING_H_
+
+/* Binary trace ring
+ *
+ * One ring per CPU. Each ring is a ICEDRV_TRING_HDR_SZ header followed by
+ * nr_rec (power of 2) fixed size records, and rings are laid out back to
+ * back in a single buffer that a reader maps read-only
+ * (debugfs/icedrv_trace_ring, or ICE_TRACE_RING_FILE in ring3).
+ * A writer only bumps head and fills the slot, so records
+ * [head - nr_rec, head) of every CPU are valid. Records close to head may
+ * be overwritten while being read. The record layout is ABI for
+ * tools/icedrv_trace_ring_decode.py.
+ */
+
+#define ICEDRV_TRING_MAGIC		0x474e5254 /* "TRNG" */
+#define ICEDRV_TRING_VERSION		1
+#define ICEDRV_TRING_HDR_SZ		4096
+#define ICEDRV_TRING_DEFAULT_ORDER	10
+#define ICEDRV_TRING_MAX_ORDER		20
+/* Limit of all CPU rings together, order is lowered to stay within it */
+#define ICEDRV_TRING_MAX_SIZE		(512 * 1024 * 1024)
+#define ICEDRV_TRING_NO_ICE		0xff
+
+enum icedrv_tring_event {
+	/* ExecuteInfer request added to scheduler queue */
+	ICEDRV_TRING_INF_QUEUED = 1,
+	/* Infer picked by scheduler, arg = ICE mask */
+	ICEDRV_TRING_INF_DISPATCH,
+	/* Doorbell rung on an ICE, arg = cold run */
+	ICEDRV_TRING_JOB_DOORBELL,
+	/* ISR top half, arg = ICE interrupt status */
+	ICEDRV_TRING_TOP_HALF,
+	/* ISR bottom half handled an ICE completion */
+	ICEDRV_TRING_BOTTOM_HALF,
+	/* Completion event delivered to user, arg = aborted */
+	ICEDRV_TRING_INF_EVENT,
+	/* ICE powered on, arg = power-on latency in usec */
+	ICEDRV_TRING_POWER_ON,
+	ICEDRV_TRING_EVENT_MAX
+};
+
+struct icedrv_tring_rec {
+	/* trace_clock_local() in nsec */
+	u64 ts;
+	u64 ntw_id;
+	u64 inf_id;
+	u32 arg;
+	/* enum icedrv_tring_event */
+	u16 event;
+	/* enum sph_trace_op_state_enum */
+	u8 state;
+	/* ICE index, ICEDRV_TRING_NO_ICE if not ICE specific */
+	u8 ice;
+};
+
+struct icedrv_tring_hdr {
+	u32 magic;
+	u16 version;
+	u16 rec_size;
+	u32 nr_rec;
+	u32 cpu;
+	u32 nr_cpus;
+	u32 reserved;
+	/* Number of records ever written on this CPU */
+	atomic64_t head;
+};
+
+struct icedrv_tring {
+	void *va;
+	u32 size;
+	u32 nr_cpus;
+	u32 nr_rec;
+	/* Size of one CPU ring, header included */
+	u32 cpu_size;
+};
+
+extern struct icedrv_tring *g_icedrv_tring;
+
+void icedrv_tring_init(void);
+void icedrv_tring_cleanup(void);
+void __icedrv_tring_log(u16 event, u8 state, u8 ice, u32 arg,
+	u64 ntw_id, u64 inf_id);
+
+static inline void icedrv_tring_log(u16 event, u8 state, u8 ice, u32 arg,
+	u64 ntw_id, u64 inf_id)
+{
+	if (g_icedrv_tring)
+		__icedrv_tring_log(event, state, ice, arg, ntw_id, inf_id);
+}
+
+#endif /* _ICEDRV_TRACE_RING_H_ */
@@ -44,6 +44,10 @@ struct idc_device {
 	struct dev_isr_status isr_status[IDC_ISR_BH_QUEUE_SZ];
 	atomic_t status_q_head;
 	atomic_t status_q_tail;
+#ifndef RING3_VALIDATION
+	/* serialize ISR with status polling done by BH */
+	spinlock_t isr_lock;
+#endif
 };
 
 #define ice_to_idc(ice_dev)\
@@ -743,11 +743,13 @@ static int ice_osmm_get_iceva(struct lin_mm_allocation *ntw_alloc,
 		struct cve_lin_mm_domain *domain =
 			(struct cve_lin_mm_domain *)hdomain[i];
 
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		retval = get_iova(
 			domain->iova_allocator[pid],
 			&domain->mmu_config[pid],
 			inf_alloc->cve_vaddr, ntw_alloc->ice_pages_nr,
 			&base_iova);
+		cve_os_unlock(&domain->lock);
 		if (retval != 0) {
 			cve_os_log(CVE_LOGLEVEL_ERROR,
 				"get_iova failed %d\n", retval);
@@ -764,11 +766,13 @@ revert_iova:
 		struct cve_lin_mm_domain *domain =
 			(struct cve_lin_mm_domain *)hdomain[j];
 
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		cve_iova_free(
 			domain->iova_allocator[pid],
 			VADDR_TO_IOVA(inf_alloc->cve_vaddr,
 			ntw_alloc->page_shift),
 			ntw_alloc->ice_pages_nr);
+		cve_os_unlock(&domain->lock);
 	}
 
 out:
@@ -788,10 +792,12 @@ static int ice_osmm_release_iceva(struct lin_mm_allocation *alloc)
 		struct cve_lin_mm_domain *domain =
 			(struct cve_lin_mm_domain *)alloc->hdomain[i];
 
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		retval = cve_iova_free(
 			domain->iova_allocator[pid],
 			VADDR_TO_IOVA(alloc->cve_vaddr, alloc->page_shift),
 			alloc->ice_pages_nr);
+		cve_os_unlock(&domain->lock);
 		if (retval != 0) {
 			/* TODO: Clean way to release IOVA */
 			cve_os_log(CVE_LOGLEVEL_ERROR,
@@ -1073,9 +1079,13 @@ static int ice_osmm_set_pte(
 		 * on next CVE dev, and so on for all CVE devices in the system
 		 * If cve_iova_claim fails then we should report failure.
 		 */
+		domain = (struct cve_lin_mm_domain *)cve_alloc_data->domain;
+
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		retval = add_to_device_page_table(alloc,
 					cve_alloc_data);
 		if (retval != 0) {
+			cve_os_unlock(&domain->lock);
 			cve_os_log(CVE_LOGLEVEL_ERROR,
 				"add_to_device_page_table failed\n");
 			goto undo_loop;
@@ -1084,8 +1094,8 @@ static int ice_osmm_set_pte(
 		/* mark the flag of "pages added"
 		 * before submission of next job invalidation should occur
 		 */
-		domain = (struct cve_lin_mm_domain *)cve_alloc_data->domain;
 		domain->pt_state |= PAGES_ADDED_TO_PAGE_TABLE;
+		cve_os_unlock(&domain->lock);
 
 		cve_alloc_data = cve_dle_next(cve_alloc_data, list);
 	}
@@ -1096,12 +1106,14 @@ undo_loop:
 	for (j = 0; j < i; j++) {
 		domain = (struct cve_lin_mm_domain *)alloc->hdomain[i];
 
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		remove_from_device_page_table(alloc->cve_vaddr,
 			alloc->ice_pages_nr,
 			domain,
 			alloc->buf_meta_data.partition_id);
 
 		domain->pt_state |= PAGES_REMOVED_FROM_PAGE_TABLE;
+		cve_os_unlock(&domain->lock);
 	}
 out:
 	return retval;
@@ -1116,12 +1128,14 @@ static void ice_osmm_unset_pte(struct lin_mm_allocation *alloc)
 
 		domain = (struct cve_lin_mm_domain *)alloc->hdomain[i];
 
+		cve_os_lock(&domain->lock, CVE_NON_INTERRUPTIBLE);
 		remove_from_device_page_table(alloc->cve_vaddr,
 			alloc->ice_pages_nr,
 			domain,
 			alloc->buf_meta_data.partition_id);
 
 		domain->pt_state |= PAGES_REMOVED_FROM_PAGE_TABLE;
+		cve_os_unlock(&domain->lock);
 	}
 }
 
@@ -78,6 +78,8 @@ struct ice_mmu_config {
 /* holds page table management data */
 struct cve_lin_mm_domain {
 	u8 id;
+	/* serializes IOVA and page table updates of concurrent mappings */
+	cve_os_lock_t lock;
 	/* DMA handle of the page directory */
 	struct cve_dma_handle pgd_dma_handle;
 	/* host virtual address of page directory */
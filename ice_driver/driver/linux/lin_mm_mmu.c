@@ -867,9 +867,7 @@ static int lin_mm_domain_init(u8 id, u64 *sz_per_page_alignment,
 		goto out;
 	}
 
-#ifdef STANDALONE_TESTING
-	ASSERT(os_lock_init(&cve_domain->lock) == 0);
-#endif
+	cve_os_lock_init(&cve_domain->lock);
 	cve_domain->id = id;
 	mmu_config = &cve_domain->mmu_config[ICE_MEM_BASE_PARTITION];
 	__do_mmu_config(cve_domain, sz_per_page_alignment,
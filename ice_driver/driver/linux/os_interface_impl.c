@@ -23,9 +23,12 @@
 #include <linux/uaccess.h>
 #include <asm/processor.h>
 #include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/slab.h>
 #include <linux/miscdevice.h>
 #include <linux/debugfs.h>
+#include <linux/completion.h>
+#include <linux/mmu_context.h>
 #include <asm/processor.h>
 #include "os_interface.h"
 #include "os_interface_impl.h"
@@ -136,6 +139,11 @@ static u32 iccp_throttling = 1;
 static u32 initial_iccp_config[3] = {INITIAL_CDYN_VAL, RESET_CDYN_VAL,
 							BLOCKED_CDYN_VAL};
 static int ice_power_off_delay_ms;
+static u32 isr_poll_budget;
+static u32 isr_coalesce_us;
+static u32 ice_pm_latency_budget_us;
+static u32 trace_ring_order = ICEDRV_TRING_DEFAULT_ORDER;
+static u32 ntw_create_workers;
 #ifdef ENABLE_MEM_DETECT
 static int enable_ice_drv_memleak;
 #endif
@@ -146,6 +154,21 @@ MODULE_PARM_DESC(icemask_user, "User provided ICE Mask");
 module_param(sph_soc, int, 0);
 MODULE_PARM_DESC(sph_soc, "if set, means that driver is running on real SOC and not simulator");
 
+module_param(isr_poll_budget, uint, 0);
+MODULE_PARM_DESC(isr_poll_budget, "Max polls of ICE completions by ISR BH before re-enabling done interrupts (0=interrupt per completion [default])");
+
+module_param(isr_coalesce_us, uint, 0);
+MODULE_PARM_DESC(isr_coalesce_us, "Delay in usec between ISR BH polls to coalesce ICE completions (used only if isr_poll_budget is set)");
+
+module_param(ice_pm_latency_budget_us, uint, 0);
+MODULE_PARM_DESC(ice_pm_latency_budget_us, "Avg ICE power-on latency in usec a reservation may pay; enables per ICE predicted power-off delay (0=fixed ice_power_off_delay_ms [default])");
+
+module_param(trace_ring_order, uint, 0);
+MODULE_PARM_DESC(trace_ring_order, "log2 of records per CPU in binary trace ring debugfs/icedrv_trace_ring (0=disabled, default 10)");
+
+module_param(ntw_create_workers, uint, 0);
+MODULE_PARM_DESC(ntw_create_workers, "Max threads mapping buffers of a network on create (0=one per online CPU [default], 1=serial)");
+
 #ifdef _DEBUG
 
 module_param(ice_fw_select, int, 0);
@@ -506,10 +529,20 @@ uint32_t get_process_pid(void)
 {
 	return current->pid;
 }
+/* helpers of ice_os_parallel_for(), unbound to spread over all CPUs */
+static struct workqueue_struct *ice_par_wq;
+
 int cve_os_interface_init(void)
 {
 	FUNC_ENTER();
 
+	ice_par_wq = alloc_workqueue("icedrv_par", WQ_UNBOUND, 0);
+	if (!ice_par_wq) {
+		/* ice_os_parallel_for() falls back to caller only */
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"error creating icedrv_par workqueue\n");
+	}
+
 	FUNC_LEAVE();
 	return 0;
 }
@@ -517,6 +550,12 @@ int cve_os_interface_init(void)
 void cve_os_interface_cleanup(void)
 {
 	FUNC_ENTER();
+
+	if (ice_par_wq) {
+		destroy_workqueue(ice_par_wq);
+		ice_par_wq = NULL;
+	}
+
 	FUNC_LEAVE();
 }
 
@@ -718,6 +757,8 @@ int cve_os_write_user_memory_32(u32 *user_addr, u32 val)
 #ifdef ENABLE_MEM_DETECT
 struct ice_drv_memleak *g_leak_list;
 u32 mem_leak_count;
+/* allocations may run on ice_os_parallel_for() helpers concurrently */
+static DEFINE_SPINLOCK(g_leak_lock);
 #endif
 
 int __cve_os_malloc_zero(size_t size_bytes, void **out_ptr)
@@ -731,6 +772,7 @@ int __cve_os_malloc_zero(size_t size_bytes, void **out_ptr)
 #ifdef ENABLE_MEM_DETECT
 	if (enable_ice_drv_memleak && p) {
 		struct ice_drv_memleak *leak;
+		unsigned long flags;
 
 		leak = kzalloc(sizeof(struct ice_drv_memleak), GFP_KERNEL);
 		if (leak) {
@@ -738,12 +780,15 @@ int __cve_os_malloc_zero(size_t size_bytes, void **out_ptr)
 			leak->caller_fn2 = __builtin_return_address(1);
 			leak->va = p;
 			leak->size = size_bytes;
-			cve_dle_add_to_list_before(g_leak_list, list, leak);
 		} else {
 			cve_os_log(CVE_LOGLEVEL_ERROR,
 			   "##failed in allocating memory for book keeping\n");
 		}
+		spin_lock_irqsave(&g_leak_lock, flags);
+		if (leak)
+			cve_dle_add_to_list_before(g_leak_list, list, leak);
 		mem_leak_count++;
+		spin_unlock_irqrestore(&g_leak_lock, flags);
 	}
 #endif
 
@@ -759,12 +804,18 @@ int __cve_os_free(void *base_address,
 #ifdef ENABLE_MEM_DETECT
 	if (enable_ice_drv_memleak) {
 		struct ice_drv_memleak *leak;
+		unsigned long flags;
 
+		spin_lock_irqsave(&g_leak_lock, flags);
 		leak = cve_dle_lookup(g_leak_list, list, va, base_address);
 		if (leak) {
 			cve_dle_remove_from_list(g_leak_list, list, leak);
-			kfree(leak);
 			mem_leak_count--;
+		}
+		spin_unlock_irqrestore(&g_leak_lock, flags);
+
+		if (leak) {
+			kfree(leak);
 		} else {
 			cve_os_log(CVE_LOGLEVEL_ERROR,
 			   "##FATAL VA:0x%p not allocated\n", base_address);
@@ -1361,6 +1412,178 @@ u64 cve_os_atomic_increment_64(atomic64_t *n)
 	return (u64)atomic64_inc_return(n);
 }
 
+/* Trace ring is exported read-only as debugfs/icedrv_trace_ring. It can be
+ * mmap-ed for live reading or copied out for offline decoding.
+ */
+static struct dentry *tring_dentry;
+static void *tring_va;
+static u32 tring_size;
+
+static ssize_t __tring_read(struct file *filp, char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	return simple_read_from_buffer(buf, count, ppos, tring_va, tring_size);
+}
+
+static int __tring_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	return remap_vmalloc_range(vma, tring_va, vma->vm_pgoff);
+}
+
+static const struct file_operations fops_tring = {
+	.owner = THIS_MODULE,
+	.read = __tring_read,
+	.mmap = __tring_mmap,
+	.llseek = default_llseek,
+};
+
+int ice_os_tring_alloc(u32 size_bytes, void **va)
+{
+	tring_va = vmalloc_user(size_bytes);
+	if (!tring_va)
+		return -ENOMEM;
+
+	tring_size = size_bytes;
+
+	tring_dentry = debugfs_create_file("icedrv_trace_ring", 0400, NULL,
+			NULL, &fops_tring);
+	if (IS_ERR_OR_NULL(tring_dentry)) {
+		cve_os_log(CVE_LOGLEVEL_ERROR,
+			"error creating icedrv_trace_ring\n");
+		/* If debugfs API failed driver will continue without it */
+		tring_dentry = NULL;
+	}
+
+	*va = tring_va;
+	return 0;
+}
+
+void ice_os_tring_free(void *va, u32 size_bytes)
+{
+	debugfs_remove(tring_dentry);
+	tring_dentry = NULL;
+
+	vfree(va);
+	tring_va = NULL;
+	tring_size = 0;
+}
+
+u32 ice_os_tring_nr_cpus(void)
+{
+	return nr_cpu_ids;
+}
+
+u32 ice_os_tring_get_cpu(void)
+{
+	return get_cpu();
+}
+
+void ice_os_tring_put_cpu(void)
+{
+	put_cpu();
+}
+
+#define ICE_OS_PAR_MAX_WORKERS 16
+
+struct ice_os_par {
+	ice_os_par_fn fn;
+	void *data;
+	u32 count;
+	atomic_t next;
+	atomic_t err;
+	/* threads still running, caller included */
+	atomic_t pending;
+	struct completion done;
+	struct mm_struct *mm;
+};
+
+struct ice_os_par_work {
+	struct work_struct work;
+	struct ice_os_par *par;
+};
+
+static void __par_run(struct ice_os_par *par)
+{
+	u32 idx;
+	int ret;
+
+	while (!atomic_read(&par->err)) {
+		idx = (u32)atomic_inc_return(&par->next) - 1;
+		if (idx >= par->count)
+			break;
+
+		ret = par->fn(par->data, idx);
+		if (ret)
+			atomic_cmpxchg(&par->err, 0, ret);
+	}
+}
+
+static void __par_work(struct work_struct *work)
+{
+	struct ice_os_par_work *w =
+		container_of(work, struct ice_os_par_work, work);
+	struct ice_os_par *par = w->par;
+
+	/* user buffers are pinned through the mm of the caller */
+	if (par->mm)
+		use_mm(par->mm);
+
+	__par_run(par);
+
+	if (par->mm)
+		unuse_mm(par->mm);
+
+	if (atomic_dec_and_test(&par->pending))
+		complete(&par->done);
+}
+
+int ice_os_parallel_for(ice_os_par_fn fn, void *data, u32 count,
+		u32 max_workers)
+{
+	struct ice_os_par par;
+	struct ice_os_par_work *works = NULL;
+	u32 i, nr_helpers;
+
+	if (!max_workers)
+		max_workers = num_online_cpus();
+	if (max_workers > ICE_OS_PAR_MAX_WORKERS)
+		max_workers = ICE_OS_PAR_MAX_WORKERS;
+	nr_helpers = ((count < max_workers) ? count : max_workers);
+	nr_helpers = (nr_helpers > 1) ? (nr_helpers - 1) : 0;
+
+	if (nr_helpers && ice_par_wq)
+		works = kcalloc(nr_helpers, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		nr_helpers = 0;
+
+	par.fn = fn;
+	par.data = data;
+	par.count = count;
+	par.mm = current->mm;
+	atomic_set(&par.next, 0);
+	atomic_set(&par.err, 0);
+	atomic_set(&par.pending, nr_helpers + 1);
+	init_completion(&par.done);
+
+	for (i = 0; i < nr_helpers; i++) {
+		works[i].par = &par;
+		INIT_WORK(&works[i].work, __par_work);
+		queue_work(ice_par_wq, &works[i].work);
+	}
+
+	__par_run(&par);
+
+	if (!atomic_dec_and_test(&par.pending))
+		wait_for_completion(&par.done);
+
+	kfree(works);
+
+	return atomic_read(&par.err);
+}
+
 /* misc memory utils */
 
 void cve_os_memory_barrier(void)
@@ -1621,6 +1844,8 @@ int cve_probe_common(struct cve_os_device *linux_device, int dev_ind)
 		"DISABLE_EMBCB=%u, CORE_MASK=0x%x\n",
 		disable_embcb, core_mask);
 
+	spin_lock_init(&linux_device->idc_dev.isr_lock);
+
 	pe_reg_value = cve_os_read_idc_mmio(
 		&linux_device->idc_dev.cve_dev[0],
 			cfg_default.bar0_mem_icepe_offset);
@@ -2129,6 +2354,16 @@ static int __init cve_init(void)
 	param.initial_iccp_config[0] = initial_iccp_config[0];
 	param.initial_iccp_config[1] = initial_iccp_config[1];
 	param.initial_iccp_config[2] = initial_iccp_config[2];
+#ifdef NULL_DEVICE_RING0
+	/* BH runs in hard IRQ context here, it must not sleep between polls */
+	param.isr_poll_budget = 0;
+#else
+	param.isr_poll_budget = isr_poll_budget;
+#endif
+	param.isr_coalesce_us = isr_coalesce_us;
+	param.ice_pm_latency_budget_us = ice_pm_latency_budget_us;
+	param.trace_ring_order = trace_ring_order;
+	param.ntw_create_workers = ntw_create_workers;
 	ice_set_driver_config_param(&param);
 
 	retval = ice_swc_init();
@@ -1020,6 +1020,34 @@ out:
 	return ret;
 }
 
+int ice_mm_patch_inf_pp_list(struct ice_infer *inf,
+		u32 *pp_idx, u32 pp_idx_nr)
+{
+	u32 i;
+	int ret = 0;
+	struct ice_pp_value *pp_value;
+
+	if (inf->inf_pp_arr == NULL)
+		goto out;
+
+	/* Only the listed patch points differ from what is in CBs */
+	for (i = 0; i < pp_idx_nr; i++) {
+
+		pp_value = &inf->inf_pp_arr[pp_idx[i]];
+
+		ret = __patch_surface(pp_value->ntw_buf,
+				pp_value->pp_address, pp_value->pp_value);
+		if (ret < 0) {
+			cve_os_log(CVE_LOGLEVEL_ERROR,
+				"ERROR:%d __patch_surface() failed\n", ret);
+			goto out;
+		}
+	}
+
+out:
+	return ret;
+}
+
 static int __process_inf_surf_pp(struct cve_patch_point_descriptor *cur_pp_desc,
 		struct cve_ntw_buffer *ntw_buf,
 		struct cve_inf_buffer *inf_buf,
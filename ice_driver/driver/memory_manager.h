@@ -288,6 +288,8 @@ void ice_mm_domain_destroy(void *hdom_inf,
 
 int ice_mm_process_inf_pp_arr(struct ice_infer *inf);
 int ice_mm_patch_inf_pp_arr(struct ice_infer *inf);
+int ice_mm_patch_inf_pp_list(struct ice_infer *inf,
+		u32 *pp_idx, u32 pp_idx_nr);
 
 void ice_mm_get_buf_sizes(cve_mm_allocation_t halloc,
 	u64 *size_bytes, u32 *page_size, u8 *pid);
@@ -724,6 +724,28 @@ u64 ice_os_get_user_idc_intst(void);
 void ice_os_read_clos(void *pmclos);
 void ice_os_set_clos(void *pmclos);
 void ice_os_reset_clos(void *pmclos);
+#ifdef RING3_VALIDATION
+/* Synthetic ICEBO LLC hit/miss counters, the simulator has no LLC */
+void ice_os_llc_pmon_model(u32 bo_id, u64 *hit, u64 *miss);
+#endif
+
+/* Backing store of binary trace ring, mappable by a reader process */
+int ice_os_tring_alloc(u32 size_bytes, void **va);
+void ice_os_tring_free(void *va, u32 size_bytes);
+u32 ice_os_tring_nr_cpus(void);
+/* CPU of the caller, stays valid until ice_os_tring_put_cpu() */
+u32 ice_os_tring_get_cpu(void);
+void ice_os_tring_put_cpu(void);
+
+/*
+ * Run fn(data, idx) for each idx in [0, count) on up to max_workers threads,
+ * the caller being one of them (0 = one per online CPU). No new index is
+ * handed out after the first failure, whose error is returned. Helpers share
+ * the address space of the caller but not its file table.
+ */
+typedef int (*ice_os_par_fn)(void *data, u32 idx);
+int ice_os_parallel_for(ice_os_par_fn fn, void *data, u32 count,
+		u32 max_workers);
 
 int set_llc_freq(void *llc_freq_config);
 uint64_t get_llc_freq(void);
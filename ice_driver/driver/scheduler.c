@@ -425,6 +425,9 @@ static enum sch_status __schedule_node(struct execution_node *node)
 		/* Schedule failed. So this network will be aborted */
 		if (ret == -ICEDRV_KERROR_ICE_DOWN)
 			cur_jg->aborted_jobs_nr++;
+	} else {
+		/* Work on next Infer of this Ntw while ICEs are busy */
+		ice_ds_prepare_next_inf(ntw);
 	}
 
 	cve_os_log(CVE_LOGLEVEL_DEBUG,
@@ -488,6 +491,10 @@ bool ice_lsch_add_inf_to_queue(struct ice_infer *inf,
 		goto out;
 	}
 
+	inf->lat_ts[ICE_INF_LAT_QUEUED] = trace_clock_local();
+	inf->lat_ts[ICE_INF_LAT_DISPATCH] = 0;
+	inf->lat_ts[ICE_INF_LAT_DONE] = 0;
+
 	inf->inf_pr = pr;
 	inf->inf_sch_node.is_queued = true;
 	inf->inf_sch_node.ready_to_run = false;
@@ -526,6 +533,10 @@ out:
 
 		ice_sch_engine(ntw, false);
 
+		/* Not dispatched yet, precompute its patch delta */
+		if (ntw->ntw_running)
+			ice_ds_prepare_next_inf(ntw);
+
 #ifdef RING3_VALIDATION
 		cve_os_log(CVE_LOGLEVEL_DEBUG, "Execute ICEs\n");
 		coral_trigger_simulation();
@@ -690,6 +701,34 @@ out:
 	return ret;
 }
 
+struct ice_infer *ice_lsch_peek_next_inf(struct ice_network *ntw)
+{
+	u32 pr;
+	struct execution_node *head, *node;
+
+	for (pr = EXE_INF_PRIORITY_0; pr < EXE_INF_PRIORITY_MAX; pr++) {
+
+		if (ntw->sch_queue[pr])
+			return ntw->sch_queue[pr]->inf;
+
+		/* First Infer of this Ntw waiting in Scheduler queue */
+		head = sch_queue[pr];
+		node = head;
+		if (!node)
+			continue;
+
+		do {
+			if ((node->ntype == NODE_TYPE_INFERENCE) &&
+				(node->ntw == ntw))
+				return node->inf;
+
+			node = cve_dle_next(node, sch_list[pr]);
+		} while (node != head);
+	}
+
+	return NULL;
+}
+
 void ice_lsch_destroy_network(struct ice_network *ntw)
 {
 	ASSERT(sch_del_ntw == NULL);
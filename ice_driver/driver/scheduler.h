@@ -19,4 +19,5 @@ bool ice_lsch_del_inf_from_queue(struct ice_infer *inf, bool lock);
 bool ice_lsch_add_rr_to_queue(struct execution_node *node);
 bool ice_lsch_del_rr_from_queue(struct execution_node *node, bool lock);
 void ice_lsch_destroy_network(struct ice_network *ntw);
+struct ice_infer *ice_lsch_peek_next_inf(struct ice_network *ntw);
 #endif /* DRIVER_SCHEDULER_H_ */
@@ -54,6 +54,8 @@ void get_hw_revision(struct cve_device *cve_dev,
 int do_reset_device(struct cve_device *cve_dev, uint8_t idc_reset);
 void ice_di_start_llc_pmon(struct cve_device *dev, bool pmon_0_1);
 void ice_di_read_llc_pmon(struct cve_device *dev);
+/* ICEBO LLC hit/miss since the previous call, -EINVAL if not monitored */
+int ice_di_sample_llc_pmon(struct icebo_desc *bo, u64 *hit, u64 *miss);
 void ice_dump_hw_err_info(struct cve_device *cve_dev);
 void store_ecc_err_count(struct cve_device *cve_dev);
 int init_platform_data(struct cve_device *cve_dev);
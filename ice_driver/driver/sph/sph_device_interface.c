@@ -822,26 +822,22 @@ void ice_dump_hw_err_info(struct cve_device *ice)
 
 void ice_dump_hw_cntr_info(struct ice_network *ntw)
 {
-	struct cve_hw_cntr_descriptor *head, *next;
+	int i;
+	u32 cntr_mask = (u32)ntw->ntw_cntrmask;
 	uint32_t offset = IA_IICS_BASE +
 			cfg_default.bar0_mem_evctice0_offset;
 	uint32_t read_val;
 
-	head = ntw->cntr_list;
-	if (!head)
-		return;
-
-	next = head;
+	while (cntr_mask) {
+		i = __builtin_ctz(cntr_mask);
+		cntr_mask &= ~(1 << i);
 
-	do {
 		read_val = cve_os_read_idc_mmio(ice_get_first_dev(),
-				offset + (32 * next->hw_cntr_id));
+				offset + (32 * i));
 
 		cve_os_log_default(CVE_LOGLEVEL_ERROR,
-			"Cntr[%d] = %d\n", next->hw_cntr_id, read_val);
-
-		next = cve_dle_next(next, list);
-	} while (next != head);
+			"Cntr[%d] = %d\n", i, read_val);
+	}
 }
 
 int init_platform_data(struct cve_device *cve_dev)
@@ -2389,6 +2385,45 @@ void ice_di_read_llc_pmon(struct cve_device *dev)
 				pmon_cntr[2], pmon_cntr[3]);
 }
 
+int ice_di_sample_llc_pmon(struct icebo_desc *bo, u64 *hit, u64 *miss)
+{
+	u64 cur_hit, cur_miss;
+#ifndef RING3_VALIDATION
+	u32 offset;
+#endif
+
+	/* PMON2/3 may have been repurposed or disabled through sysfs */
+	if (bo->llc_pmon_cfg.disable_llc_pmon ||
+		bo->llc_pmon_cfg.pmon2_cfg != LLC_PMON_HIT_BO ||
+		bo->llc_pmon_cfg.pmon3_cfg != LLC_PMON_MISS_BO)
+		return -EINVAL;
+
+#ifdef RING3_VALIDATION
+	ice_os_llc_pmon_model(bo->bo_id, &cur_hit, &cur_miss);
+#else
+	/* MEM_A2I_ICEBAR_ICEBO_PMON_COUNTER_2_MMOFFSET */
+	offset = ICEDC_ICEBO_OFFSET(bo->bo_id) +
+			cfg_default.a2i_icebo_pmon_counter_2_offset;
+	cur_hit = cve_os_read_idc_mmio(bo->dev_list, offset);
+
+	/* MEM_A2I_ICEBAR_ICEBO_PMON_COUNTER_3_MMOFFSET */
+	offset = ICEDC_ICEBO_OFFSET(bo->bo_id) +
+			cfg_default.a2i_icebo_pmon_counter_3_offset;
+	cur_miss = cve_os_read_idc_mmio(bo->dev_list, offset);
+#endif
+
+	/* Counters restart from 0 whenever any PMON is reconfigured */
+	*hit = (cur_hit >= bo->llc_pmon_cfg.alloc_hit) ?
+		(cur_hit - bo->llc_pmon_cfg.alloc_hit) : cur_hit;
+	*miss = (cur_miss >= bo->llc_pmon_cfg.alloc_miss) ?
+		(cur_miss - bo->llc_pmon_cfg.alloc_miss) : cur_miss;
+
+	bo->llc_pmon_cfg.alloc_hit = cur_hit;
+	bo->llc_pmon_cfg.alloc_miss = cur_miss;
+
+	return 0;
+}
+
 u32 __get_ice_max_freq(void)
 {
 	struct cve_device_group *dg;
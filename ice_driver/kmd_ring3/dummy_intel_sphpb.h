@@ -72,24 +72,30 @@ struct sphpb_callbacks {
 	 *            ICE_FREQUENCY = (ratio_fx * MAX_FREQUENCY)
 	 */
 
+	/* ntw_id - network to run, ices are ranked by its measured energy per job */
 	int (*get_efficient_ice_list)(uint64_t ice_mask,
 				      enum SPHPB_DDR_REQUEST ddr,
 				      uint16_t ring_divisor_fx,
 				      uint16_t ratio_fx,
+				      uint64_t ntw_id,
 				      uint8_t *o_ice_array,
 				      ssize_t array_size);
 
-	/* request from sphpb to set ice to ring and ice ratio */
+	/* request from sphpb to set ice to ring and ice ratio for network ntw_id */
 	int (*request_ice_dvfs_values)(uint32_t ice_index,
 				       enum SPHPB_DDR_REQUEST ddr,
 				       uint16_t ring_divisor_fx,
-				       uint16_t ratio_fx);
+				       uint16_t ratio_fx,
+				       uint64_t ntw_id);
 
 	/* set ice active state */
 	int (*set_power_state)(uint32_t ice_index, bool bOn);
 
 	/* unregister power balancer driver */
 	void  (*unregister_driver)(void);
+
+	/* report ice cycles a completed job of network ntw_id took */
+	int (*report_ice_perf)(uint32_t ice_index, uint64_t ntw_id, uint64_t cycles);
 };
 
 const struct sphpb_callbacks *sph_power_balancer_register_driver(const struct sphpb_icedrv_callbacks *drv_data);
@@ -0,0 +1,289 @@
+/*
+ * NNP-I Linux Driver
+ * Copyright (c) 2017-2019, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ */
+
+/*
+ * Create network scaling benchmark for the ring3 driver.
+ *
+ * Creates and destroys a network of many user buffers and a single CB
+ * job, and reports the create wall time. Worker count is taken by the
+ * driver on init, so each run covers one count:
+ *
+ *   for w in 1 2 4 8 16; do ./ntw_create_bench -w $w -b 4096; done
+ *
+ * Without a coral tree, build with NULL_DEVICE_RING3=1 and leave CORAL_DIR
+ * unset to run on the null device. FW images are still loaded, from
+ * WORKSPACE and CVE_FW_DIR_PATH.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "driver_interface.h"
+
+#define BENCH_CB_COMMANDS 16
+#define BENCH_CMD_SZ_BYTE 32
+/* buffers go to the 32K partition, whose pages must be 32K aligned */
+#define BENCH_BUF_ALIGN (32 * 1024)
+
+struct bench_cfg {
+	const char *workers;
+	unsigned int num_buf;
+	unsigned int buf_size;
+	unsigned int iterations;
+};
+
+static double __now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+
+static void __usage(const char *prog)
+{
+	printf("usage: %s [-w workers] [-b buffers] [-s buffer_size] [-i iterations]\n",
+			prog);
+	printf("  -w  ICE_NTW_CREATE_WORKERS, 0=one per online CPU (default)\n");
+	printf("  -b  number of buffers in the network (default 1024)\n");
+	printf("  -s  size of each buffer in bytes (default 65536)\n");
+	printf("  -i  number of create/destroy iterations (default 10)\n");
+}
+
+static int __parse_args(int argc, char **argv, struct bench_cfg *cfg)
+{
+	int opt;
+
+	cfg->workers = "0";
+	cfg->num_buf = 1024;
+	cfg->buf_size = 65536;
+	cfg->iterations = 10;
+
+	while ((opt = getopt(argc, argv, "w:b:s:i:h")) != -1) {
+		switch (opt) {
+		case 'w':
+			cfg->workers = optarg;
+			break;
+		case 'b':
+			cfg->num_buf = atoi(optarg);
+			break;
+		case 's':
+			cfg->buf_size = atoi(optarg);
+			break;
+		case 'i':
+			cfg->iterations = atoi(optarg);
+			break;
+		default:
+			__usage(argv[0]);
+			return -1;
+		}
+	}
+
+	/* last buffer is the CB */
+	if (cfg->num_buf < 2 || cfg->buf_size < BENCH_CMD_SZ_BYTE ||
+			cfg->iterations == 0) {
+		__usage(argv[0]);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void __free_buffers(struct cve_surface_descriptor *buf_desc_list,
+		unsigned int num_buf)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_buf; i++)
+		free((void *)(uintptr_t)buf_desc_list[i].base_address);
+	free(buf_desc_list);
+}
+
+static struct cve_surface_descriptor *__alloc_buffers(
+		const struct bench_cfg *cfg)
+{
+	struct cve_surface_descriptor *buf_desc_list;
+	struct cve_surface_descriptor *cb;
+	unsigned int i;
+	void *p;
+
+	buf_desc_list = calloc(cfg->num_buf, sizeof(*buf_desc_list));
+	if (!buf_desc_list)
+		return NULL;
+
+	for (i = 0; i < cfg->num_buf; i++) {
+		if (posix_memalign(&p, BENCH_BUF_ALIGN, cfg->buf_size)) {
+			__free_buffers(buf_desc_list, i);
+			return NULL;
+		}
+		/* touch the pages so pinning is what gets measured */
+		memset(p, 0, cfg->buf_size);
+
+		buf_desc_list[i].obj_id = i;
+		buf_desc_list[i].base_address = (uintptr_t)p;
+		buf_desc_list[i].size_bytes = cfg->buf_size;
+		buf_desc_list[i].actual_size_bytes = cfg->buf_size;
+		buf_desc_list[i].direction = CVE_SURFACE_DIRECTION_IN |
+			CVE_SURFACE_DIRECTION_OUT;
+		buf_desc_list[i].surface_type = ICE_BUFFER_TYPE_SURFACE;
+	}
+
+	cb = &buf_desc_list[cfg->num_buf - 1];
+	cb->surface_type = ICE_BUFFER_TYPE_SIMPLE_CB;
+	cb->actual_size_bytes = BENCH_CB_COMMANDS * BENCH_CMD_SZ_BYTE;
+	if (cb->actual_size_bytes > cb->size_bytes)
+		cb->actual_size_bytes = cb->size_bytes;
+
+	return buf_desc_list;
+}
+
+static int __create_destroy(int fd, __u64 contextid,
+		const struct bench_cfg *cfg,
+		struct cve_surface_descriptor *buf_desc_list,
+		double *o_create_ms)
+{
+	struct cve_ioctl_param param;
+	struct ice_network_descriptor *ntw;
+	struct cve_job_group jg;
+	struct cve_job job;
+	__u32 cb_index = cfg->num_buf - 1;
+	__u64 networkid;
+	double start;
+	int ret;
+
+	memset(&job, 0, sizeof(job));
+	job.cb_nr = 1;
+	job.cb_buf_desc_list = (uintptr_t)&cb_index;
+	job.graph_ice_id = -1;
+
+	memset(&jg, 0, sizeof(jg));
+	jg.jobs_nr = 1;
+	jg.jobs = (uintptr_t)&job;
+	jg.num_of_cves = 1;
+
+	memset(&param, 0, sizeof(param));
+	param.create_network.contextid = contextid;
+	ntw = &param.create_network.network;
+	ntw->obj_id = -1;
+	ntw->parent_obj_id = -1;
+	ntw->num_ice = 1;
+	ntw->buf_desc_list = buf_desc_list;
+	ntw->num_buf_desc = cfg->num_buf;
+	ntw->va_partition_config[ICEDRV_PAGE_ALIGNMENT_32K] =
+		(__u64)cfg->num_buf * cfg->buf_size;
+	ntw->jg_desc_list = &jg;
+	ntw->num_jg_desc = 1;
+	ntw->network_type = ICE_SIMPLE_NETWORK;
+	ntw->icebo_req = ICEBO_DEFAULT;
+
+	start = __now_ms();
+	ret = cve_ioctl_misc(fd, CVE_IOCTL_CREATE_NETWORK, &param);
+	*o_create_ms = __now_ms() - start;
+	if (ret) {
+		printf("create network failed %d\n", ret);
+		return ret;
+	}
+
+	/* ntw points into param */
+	networkid = ntw->network_id;
+	memset(&param, 0, sizeof(param));
+	param.destroy_network.contextid = contextid;
+	param.destroy_network.networkid = networkid;
+	ret = cve_ioctl_misc(fd, CVE_IOCTL_DESTROY_NETWORK, &param);
+	if (ret)
+		printf("destroy network failed %d\n", ret);
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	struct cve_surface_descriptor *buf_desc_list;
+	struct cve_ioctl_param param;
+	struct bench_cfg cfg;
+	double create_ms, min_ms = 0, total_ms = 0;
+	__u64 contextid = 0;
+	unsigned int i;
+	int fd, ret;
+
+	if (__parse_args(argc, argv, &cfg))
+		return 1;
+
+	/* driver reads it on init */
+	setenv("ICE_NTW_CREATE_WORKERS", cfg.workers, 1);
+
+	ret = cve_driver_init();
+	if (ret) {
+		printf("cve_driver_init failed %d\n", ret);
+		return 1;
+	}
+
+	fd = cve_open_misc();
+	if (fd < 0) {
+		printf("cve_open_misc failed %d\n", fd);
+		ret = fd;
+		goto driver_cleanup;
+	}
+
+	memset(&param, 0, sizeof(param));
+	param.create_context.obj_id = -1;
+	ret = cve_ioctl_misc(fd, CVE_IOCTL_CREATE_CONTEXT, &param);
+	if (ret) {
+		printf("create context failed %d\n", ret);
+		goto close_fd;
+	}
+	contextid = param.create_context.out_contextid;
+
+	buf_desc_list = __alloc_buffers(&cfg);
+	if (!buf_desc_list) {
+		printf("buffer allocation failed\n");
+		ret = -1;
+		goto destroy_context;
+	}
+
+	for (i = 0; i < cfg.iterations; i++) {
+		ret = __create_destroy(fd, contextid, &cfg, buf_desc_list,
+				&create_ms);
+		if (ret)
+			break;
+
+		total_ms += create_ms;
+		if (i == 0 || create_ms < min_ms)
+			min_ms = create_ms;
+	}
+
+	if (!ret)
+		printf("workers %s buffers %u size %u iterations %u create min %.3f ms avg %.3f ms buffers/s %.0f\n",
+				cfg.workers, cfg.num_buf, cfg.buf_size,
+				cfg.iterations, min_ms, total_ms / cfg.iterations,
+				(cfg.num_buf * 1000.0) / min_ms);
+
+	__free_buffers(buf_desc_list, cfg.num_buf);
+
+destroy_context:
+	memset(&param, 0, sizeof(param));
+	param.destroy_context.contextid = contextid;
+	cve_ioctl_misc(fd, CVE_IOCTL_DESTROY_CONTEXT, &param);
+close_fd:
+	cve_close_misc(fd);
+driver_cleanup:
+	cve_driver_cleanup();
+
+	return ret ? 1 : 0;
+}
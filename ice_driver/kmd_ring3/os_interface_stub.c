@@ -14,6 +14,7 @@
  */
 
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -23,6 +24,7 @@
 #include <signal.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/stat.h>
@@ -152,12 +154,15 @@ void ice_os_read_clos(void *pmclos)
 		 mclos->pqr_default);
 }
 
+/* LLC ways reserved for CLOS_1 + CLOS_2, drives the PMON model */
+static u32 m_llc_model_ways = MAX_CLOS_SIZE_MB;
+
 void ice_os_set_clos(void *pmclos)
 {
+	struct clos_manager *mclos = (struct clos_manager *)pmclos;
 #ifdef _DEBUG
 	u32 lo;
 	u32 clos_shift;
-	struct clos_manager *mclos = (struct clos_manager *)pmclos;
 
 	/* CLOS 0 */
 	lo = (1 << mclos->clos_size[0]) - 1;
@@ -181,6 +186,9 @@ void ice_os_set_clos(void *pmclos)
 	cve_os_log(CVE_LOGLEVEL_DEBUG, "IA32_PQR_ASSOC=0x%llx\n",
 		lo);
 #endif
+
+	m_llc_model_ways = mclos->clos_size[ICE_CLOS_1] +
+				mclos->clos_size[ICE_CLOS_2];
 }
 
 void ice_os_reset_clos(void *pmclos)
@@ -200,6 +208,176 @@ void ice_os_reset_clos(void *pmclos)
 	cve_os_log(CVE_LOGLEVEL_INFO,
 		"IA32_PQR_ASSOC: Write=0x%llx\n",
 		mclos->pqr_default);
+
+	m_llc_model_ways = MAX_CLOS_SIZE_MB;
+}
+
+/* Every sample sees LLC_MODEL_ACCESSES accesses of a working set of
+ * LLC_MODEL_WS_MB (env, default 8). Whatever does not fit in the ways
+ * reserved for CLOS_1 + CLOS_2 misses, so the allocator can be exercised
+ * without LLC support in the simulator.
+ */
+#define LLC_MODEL_ACCESSES (1 << 16)
+#define LLC_MODEL_MIN_MISS_PM 20
+
+void ice_os_llc_pmon_model(u32 bo_id, u64 *hit, u64 *miss)
+{
+	static u64 model_hit[MAX_NUM_ICEBO];
+	static u64 model_miss[MAX_NUM_ICEBO];
+	u32 ws = 8, miss_pm;
+
+	if (getenv("LLC_MODEL_WS_MB") != NULL)
+		ws = atoi(getenv("LLC_MODEL_WS_MB"));
+
+	if (ws == 0 || m_llc_model_ways >= ws)
+		miss_pm = LLC_MODEL_MIN_MISS_PM;
+	else
+		miss_pm = ((ws - m_llc_model_ways) * 1000) / ws;
+
+	model_miss[bo_id] += (LLC_MODEL_ACCESSES * miss_pm) / 1000;
+	model_hit[bo_id] += LLC_MODEL_ACCESSES -
+				((LLC_MODEL_ACCESSES * miss_pm) / 1000);
+
+	*hit = model_hit[bo_id];
+	*miss = model_miss[bo_id];
+}
+
+/* Trace ring is anonymous memory unless ICE_TRACE_RING_FILE names a file
+ * to back it, so that it can be decoded after the run or mapped by
+ * another process while the simulation runs.
+ */
+static int m_tring_fd = -1;
+static u32 m_tring_nr_cpus;
+
+int ice_os_tring_alloc(u32 size_bytes, void **va)
+{
+	const char *path = getenv("ICE_TRACE_RING_FILE");
+	void *p;
+	int ret;
+
+	if (path == NULL) {
+		p = mmap(NULL, size_bytes, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			return -errno;
+
+		*va = p;
+		return 0;
+	}
+
+	m_tring_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_tring_fd < 0)
+		return -errno;
+
+	if (ftruncate(m_tring_fd, size_bytes) < 0)
+		goto err;
+
+	p = mmap(NULL, size_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+			m_tring_fd, 0);
+	if (p == MAP_FAILED)
+		goto err;
+
+	*va = p;
+	return 0;
+
+err:
+	ret = -errno;
+	close(m_tring_fd);
+	m_tring_fd = -1;
+	return ret;
+}
+
+void ice_os_tring_free(void *va, u32 size_bytes)
+{
+	munmap(va, size_bytes);
+	if (m_tring_fd >= 0)
+		close(m_tring_fd);
+	m_tring_fd = -1;
+}
+
+u32 ice_os_tring_nr_cpus(void)
+{
+	long n;
+
+	if (!m_tring_nr_cpus) {
+		n = sysconf(_SC_NPROCESSORS_CONF);
+		m_tring_nr_cpus = (n > 0) ? (u32)n : 1;
+	}
+
+	return m_tring_nr_cpus;
+}
+
+u32 ice_os_tring_get_cpu(void)
+{
+	int cpu = sched_getcpu();
+
+	/* Thread may migrate, slot is still taken atomically */
+	return (cpu < 0) ? 0 : ((u32)cpu % ice_os_tring_nr_cpus());
+}
+
+void ice_os_tring_put_cpu(void)
+{
+}
+
+#define ICE_OS_PAR_MAX_WORKERS 16
+
+struct ice_os_par {
+	ice_os_par_fn fn;
+	void *data;
+	u32 count;
+	u32 next;
+	int err;
+};
+
+static void *__par_run(void *arg)
+{
+	struct ice_os_par *par = (struct ice_os_par *)arg;
+	u32 idx;
+	int ret;
+
+	while (!__sync_fetch_and_add(&par->err, 0)) {
+		idx = __sync_fetch_and_add(&par->next, 1);
+		if (idx >= par->count)
+			break;
+
+		ret = par->fn(par->data, idx);
+		if (ret)
+			__sync_val_compare_and_swap(&par->err, 0, ret);
+	}
+
+	return NULL;
+}
+
+int ice_os_parallel_for(ice_os_par_fn fn, void *data, u32 count,
+		u32 max_workers)
+{
+	struct ice_os_par par = {fn, data, count, 0, 0};
+	pthread_t helper[ICE_OS_PAR_MAX_WORKERS];
+	u32 i, nr_helpers = 0;
+	long n;
+
+	if (!max_workers) {
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+		max_workers = (n > 0) ? (u32)n : 1;
+	}
+	if (max_workers > ICE_OS_PAR_MAX_WORKERS)
+		max_workers = ICE_OS_PAR_MAX_WORKERS;
+	if (max_workers > count)
+		max_workers = count;
+
+	/* caller is a worker too, run with fewer helpers if creation fails */
+	for (i = 0; i + 1 < max_workers; i++) {
+		if (pthread_create(&helper[nr_helpers], NULL, __par_run, &par))
+			break;
+		nr_helpers++;
+	}
+
+	__par_run(&par);
+
+	for (i = 0; i < nr_helpers; i++)
+		pthread_join(helper[i], NULL);
+
+	return par.err;
 }
 
 int set_llc_freq(void *llc_freq_config)
@@ -216,6 +394,17 @@ unsigned long ice_os_get_current_jiffy(void)
 	return ((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
 }
 
+/* frequency MSRs are not modelled in ring3 */
+uint64_t get_llc_freq(void)
+{
+	return 0;
+}
+
+uint64_t get_ice_freq(void)
+{
+	return 0;
+}
+
 unsigned int jiffies_to_msecs(unsigned long jiffy)
 {
 	return (unsigned int)jiffy;
@@ -380,10 +569,22 @@ int cve_os_interface_init(void)
 	param.enable_llc_config_via_axi_reg = enable_llc_config_via_axi_reg;
 	/* For RING3, space is always set to 0*/
 	param.sph_soc = 0;
-	/* For RING3, ice_power_off_delay is 0 ms */
-
-	/* Should expose ENV to set this value */
+	/* For RING3, ice_power_off_delay is 0 ms unless requested */
 	param.ice_power_off_delay_ms = 0;
+	if (getenv("ICE_POWER_OFF_DELAY_MS") != NULL)
+		param.ice_power_off_delay_ms =
+			atoi(getenv("ICE_POWER_OFF_DELAY_MS"));
+	param.ice_pm_latency_budget_us = 0;
+	if (getenv("ICE_PM_LATENCY_BUDGET_US") != NULL)
+		param.ice_pm_latency_budget_us =
+			atoi(getenv("ICE_PM_LATENCY_BUDGET_US"));
+	param.trace_ring_order = ICEDRV_TRING_DEFAULT_ORDER;
+	if (getenv("ICE_TRACE_RING_ORDER") != NULL)
+		param.trace_ring_order = atoi(getenv("ICE_TRACE_RING_ORDER"));
+	param.ntw_create_workers = 0;
+	if (getenv("ICE_NTW_CREATE_WORKERS") != NULL)
+		param.ntw_create_workers =
+			atoi(getenv("ICE_NTW_CREATE_WORKERS"));
 	if(getenv("ENABLE_C_STEP") != NULL) {
 		param.enable_sph_b_step = false;
 		param.enable_sph_c_step = true;
@@ -412,6 +613,14 @@ int cve_os_interface_init(void)
 		param.iccp_throttling = 0;
 	}
 
+	/* ISR polling is off unless requested, interrupts are simulated */
+	param.isr_poll_budget = 0;
+	param.isr_coalesce_us = 0;
+	if (getenv("ISR_POLL_BUDGET") != NULL)
+		param.isr_poll_budget = atoi(getenv("ISR_POLL_BUDGET"));
+	if (getenv("ISR_COALESCE_US") != NULL)
+		param.isr_coalesce_us = atoi(getenv("ISR_COALESCE_US"));
+
 	ice_set_driver_config_param(&param);
 
 	if (ice_get_c_step_enable_flag()) {
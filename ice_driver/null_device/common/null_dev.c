@@ -25,6 +25,11 @@
 #endif
 int scheduled_ice[MAX_ICE_COUNT] = {0};
 uint64_t ice_error_interrupt = 0;
+#ifndef NULL_DEVICE_RING0
+const char *idc_error;
+const char *ice_error;
+const char *interrupt_delay;
+#endif
 
 int write_mmio(uint64_t reg_offset)
 {
@@ -64,9 +64,9 @@
 #define ICE_READY 65535
 
 #ifndef NULL_DEVICE_RING0
-const char *idc_error;
-const char *ice_error;
-const char *interrupt_delay;
+extern const char *idc_error;
+extern const char *ice_error;
+extern const char *interrupt_delay;
 #endif
 
 #define __FILENAME__ \
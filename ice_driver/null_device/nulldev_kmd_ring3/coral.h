@@ -0,0 +1,47 @@
+/*
+ * NNP-I Linux Driver
+ * Copyright (c) 2018-2019, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ */
+
+/*
+ * Coral simulator API implemented by the null device. Used when the
+ * driver is built without a coral tree, the coral headers take
+ * precedence when -I$(CORAL_DIR)/src is given.
+ */
+
+#ifndef _CORAL_H_
+#define _CORAL_H_
+
+#include <stdint.h>
+
+typedef int Reg_Space;
+#define BAR7 7
+
+/* the driver handler takes (irq) or (irq, dev_id) depending on the build */
+typedef int (*ftype_interrupt_handler)();
+
+int coral_init_multi(const char *cfg_name,
+		ftype_interrupt_handler pfn, uint32_t num_instances);
+uint64_t *coral_get_bar1_base(void);
+void coral_trigger_simulation(void);
+int coral_reset_multi(uint32_t instance_id);
+int coral_mmio_write_multi_offset(uint64_t reg_offset,
+		uint64_t value, Reg_Space space, uint32_t instance_id);
+int coral_mmio_read_multi_offset(uint64_t reg_offset, uint64_t *value,
+		Reg_Space space, uint32_t instance_id);
+int coral_dso_write_offset(uint32_t reg_offset,
+		uint32_t value, Reg_Space space, uint32_t instance_id);
+int coral_dso_read_offset(uint32_t reg_offset, uint32_t *value,
+		Reg_Space space, uint32_t instance_id);
+
+#endif /* _CORAL_H_ */
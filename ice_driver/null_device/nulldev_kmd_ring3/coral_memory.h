@@ -0,0 +1,32 @@
+/*
+ * NNP-I Linux Driver
+ * Copyright (c) 2018-2019, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ */
+
+/*
+ * Coral physical memory API implemented by the null device, see
+ * dummy_coral_memory.c
+ */
+
+#ifndef _CORAL_MEMORY_H_
+#define _CORAL_MEMORY_H_
+
+#include <stdint.h>
+
+int coral_pa_mem_init_with_size(uint64_t *size);
+void coral_pa_mem_delete(void);
+uint64_t coral_pa_mem_allocate_memory(uint64_t size, uint64_t align);
+void *coral_pa_mem_get_direct_ptr(uint64_t pa, uint64_t size);
+uint64_t coral_pa_mem_get_phy_addr_for_ptr(void *ptr);
+
+#endif /* _CORAL_MEMORY_H_ */
@@ -118,6 +118,20 @@ int coral_mmio_read_multi_offset(uint64_t reg_offset, uint64_t *value,
 	int ret = read_mmio(reg_offset, value);
 	return ret;
 }
+
+/* DSO registers are not modelled, reads return 0 */
+int coral_dso_write_offset(uint32_t reg_offset,
+		uint32_t value, Reg_Space space, uint32_t instance_id)
+{
+	return 0;
+}
+
+int coral_dso_read_offset(uint32_t reg_offset, uint32_t *value,
+					Reg_Space space, uint32_t instance_id)
+{
+	*value = 0;
+	return 0;
+}
 void null_device_fini(void)
 {
 	stop_thread = true;
@@ -0,0 +1,103 @@
+/*
+ * NNP-I Linux Driver
+ * Copyright (c) 2018-2019, Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ */
+
+/*
+ * Null device physical memory. Nothing reads it, so allocations come
+ * from malloc and the physical address of a buffer is its host address.
+ * This also covers user buffers, which the driver pins through
+ * coral_pa_mem_get_phy_addr_for_ptr. Allocations are released on
+ * coral_pa_mem_delete, the driver does not free them one by one.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "coral_memory.h"
+#include "null_dev.h"
+
+struct pa_mem_block {
+	struct pa_mem_block *next;
+	void *ptr;
+	uint64_t size;
+};
+
+static pthread_mutex_t pa_mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pa_mem_block *pa_mem_blocks;
+static uint64_t pa_mem_size;
+static uint64_t pa_mem_used;
+
+int coral_pa_mem_init_with_size(uint64_t *size)
+{
+	pthread_mutex_lock(&pa_mem_lock);
+	pa_mem_size = *size;
+	pa_mem_used = 0;
+	pthread_mutex_unlock(&pa_mem_lock);
+
+	return 0;
+}
+
+void coral_pa_mem_delete(void)
+{
+	struct pa_mem_block *block;
+
+	pthread_mutex_lock(&pa_mem_lock);
+	while (pa_mem_blocks) {
+		block = pa_mem_blocks;
+		pa_mem_blocks = block->next;
+		free(block->ptr);
+		free(block);
+	}
+	pa_mem_used = 0;
+	pthread_mutex_unlock(&pa_mem_lock);
+}
+
+uint64_t coral_pa_mem_allocate_memory(uint64_t size, uint64_t align)
+{
+	struct pa_mem_block *block;
+	void *ptr = NULL;
+
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+
+	block = malloc(sizeof(*block));
+	if (!block)
+		return 0;
+
+	pthread_mutex_lock(&pa_mem_lock);
+	if (pa_mem_used + size > pa_mem_size ||
+			posix_memalign(&ptr, align, size)) {
+		pthread_mutex_unlock(&pa_mem_lock);
+		null_device_log("failed to allocate %lu bytes\n", size);
+		free(block);
+		return 0;
+	}
+	block->ptr = ptr;
+	block->size = size;
+	block->next = pa_mem_blocks;
+	pa_mem_blocks = block;
+	pa_mem_used += size;
+	pthread_mutex_unlock(&pa_mem_lock);
+
+	return (uint64_t)(uintptr_t)ptr;
+}
+
+void *coral_pa_mem_get_direct_ptr(uint64_t pa, uint64_t size)
+{
+	return (void *)(uintptr_t)pa;
+}
+
+uint64_t coral_pa_mem_get_phy_addr_for_ptr(void *ptr)
+{
+	return (uint64_t)(uintptr_t)ptr;
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2019-2020 Intel Corporation
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Decode the ICE driver binary trace ring into Chrome trace JSON, which can
+# be opened in chrome://tracing or ui.perfetto.dev.
+#
+# Input is a copy of the ring:
+#   kernel: cp /sys/kernel/debug/icedrv_trace_ring ring.bin
+#   ring3:  the file given by ICE_TRACE_RING_FILE (icedrv_trace_ring.bin)
+#
+# Layout and event ids must match driver/icedrv_trace_ring.h.
+
+import argparse
+import json
+import struct
+import sys
+
+TRING_MAGIC = 0x474e5254
+TRING_VERSION = 1
+TRING_HDR_SZ = 4096
+
+HDR_FMT = '<IHHIIIIQ'
+REC_FMT = '<QQQIHBB'
+NO_ICE = 0xff
+
+INF_QUEUED = 1
+INF_DISPATCH = 2
+JOB_DOORBELL = 3
+TOP_HALF = 4
+BOTTOM_HALF = 5
+INF_EVENT = 6
+POWER_ON = 7
+
+EVENT_NAMES = {
+    INF_QUEUED: 'queued',
+    INF_DISPATCH: 'dispatch',
+    JOB_DOORBELL: 'doorbell',
+    TOP_HALF: 'top_half',
+    BOTTOM_HALF: 'bottom_half',
+    INF_EVENT: 'event',
+    POWER_ON: 'power_on',
+}
+
+PID_INFER = 1
+PID_ICE = 2
+
+
+def read_records(data):
+    """Yield (cpu, ts, ntw_id, inf_id, arg, event, state, ice) of all CPUs"""
+    hdr_sz = struct.calcsize(HDR_FMT)
+    off = 0
+    while off + hdr_sz <= len(data):
+        (magic, version, rec_size, nr_rec, cpu, nr_cpus, _,
+         head) = struct.unpack_from(HDR_FMT, data, off)
+        if magic != TRING_MAGIC or version != TRING_VERSION:
+            sys.exit('bad ring header at offset %d' % off)
+        if rec_size != struct.calcsize(REC_FMT):
+            sys.exit('unexpected record size %d' % rec_size)
+
+        base = off + TRING_HDR_SZ
+        first = head - nr_rec if head > nr_rec else 0
+        for slot in range(first, head):
+            rec = struct.unpack_from(REC_FMT, data,
+                                     base + (slot % nr_rec) * rec_size)
+            if rec[4] == 0:
+                continue
+            yield (cpu,) + rec
+
+        off = base + nr_rec * rec_size
+
+
+def to_chrome(records):
+    out = []
+    ices = set()
+
+    for (cpu, ts, ntw_id, inf_id, arg, event, state, ice) in records:
+        us = ts / 1000.0
+        name = EVENT_NAMES.get(event, 'event%d' % event)
+        args = {'ntw': '0x%x' % ntw_id, 'inf': inf_id, 'arg': arg,
+                'state': state, 'cpu': cpu}
+        infer = '0x%x:%d' % (ntw_id, inf_id)
+
+        if event == INF_QUEUED:
+            out.append({'name': 'queue', 'cat': 'infer', 'ph': 'b',
+                        'id': infer, 'pid': PID_INFER, 'tid': 0,
+                        'ts': us, 'args': args})
+        elif event == INF_DISPATCH:
+            out.append({'name': 'queue', 'cat': 'infer', 'ph': 'e',
+                        'id': infer, 'pid': PID_INFER, 'tid': 0,
+                        'ts': us})
+            out.append({'name': 'execute', 'cat': 'infer', 'ph': 'b',
+                        'id': infer, 'pid': PID_INFER, 'tid': 0,
+                        'ts': us, 'args': args})
+        elif event == INF_EVENT:
+            out.append({'name': 'execute', 'cat': 'infer', 'ph': 'e',
+                        'id': infer, 'pid': PID_INFER, 'tid': 0,
+                        'ts': us, 'args': args})
+        elif event == JOB_DOORBELL:
+            ices.add(ice)
+            out.append({'name': 'job', 'cat': 'ice', 'ph': 'B',
+                        'pid': PID_ICE, 'tid': ice, 'ts': us,
+                        'args': args})
+        elif event == BOTTOM_HALF:
+            ices.add(ice)
+            out.append({'name': 'job', 'cat': 'ice', 'ph': 'E',
+                        'pid': PID_ICE, 'tid': ice, 'ts': us,
+                        'args': args})
+        elif event == POWER_ON:
+            ices.add(ice)
+            out.append({'name': name, 'cat': 'ice', 'ph': 'X',
+                        'pid': PID_ICE, 'tid': ice, 'ts': us - arg,
+                        'dur': arg, 'args': args})
+        else:
+            tid = ice if ice != NO_ICE else 0
+            out.append({'name': name, 'cat': 'ice', 'ph': 'i', 's': 't',
+                        'pid': PID_ICE, 'tid': tid, 'ts': us,
+                        'args': args})
+
+    out.append({'name': 'process_name', 'ph': 'M', 'pid': PID_INFER,
+                'args': {'name': 'Inferences'}})
+    out.append({'name': 'process_name', 'ph': 'M', 'pid': PID_ICE,
+                'args': {'name': 'ICEs'}})
+    for ice in sorted(ices):
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID_ICE,
+                    'tid': ice, 'args': {'name': 'ICE%d' % ice}})
+
+    return {'traceEvents': out, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode ICE driver trace ring to Chrome trace JSON')
+    parser.add_argument('ring', help='copy of the trace ring')
+    parser.add_argument('-o', '--output', default='-',
+                        help='output JSON file (default stdout)')
+    opts = parser.parse_args()
+
+    with open(opts.ring, 'rb') as f:
+        data = f.read()
+
+    records = sorted(read_records(data), key=lambda r: r[1])
+    trace = to_chrome(records)
+
+    if opts.output == '-':
+        json.dump(trace, sys.stdout)
+    else:
+        with open(opts.output, 'w') as f:
+            json.dump(trace, f)
+
+
+if __name__ == '__main__':
+    main()